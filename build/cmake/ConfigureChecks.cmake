@@ -47,6 +47,8 @@ check_include_file(sys/time.h HAVE_SYS_TIME_H)
 check_include_file(sys/un.h HAVE_SYS_UN_H)
 check_include_file(poll.h HAVE_POLL_H)
 check_include_file(sys/poll.h HAVE_SYS_POLL_H)
+check_include_file(sys/eventfd.h HAVE_SYS_EVENTFD_H)
+check_include_file(sys/epoll.h HAVE_SYS_EPOLL_H)
 check_include_file(sys/select.h HAVE_SYS_SELECT_H)
 check_include_file(sched.h HAVE_SCHED_H)
 check_include_file(string.h HAVE_STRING_H)
@@ -57,6 +59,11 @@ check_function_exists(gethostbyname_r HAVE_GETHOSTBYNAME_R)
 check_function_exists(strerror_r HAVE_STRERROR_R)
 check_function_exists(sched_get_priority_max HAVE_SCHED_GET_PRIORITY_MAX)
 check_function_exists(sched_get_priority_min HAVE_SCHED_GET_PRIORITY_MIN)
+check_function_exists(sched_setaffinity HAVE_SCHED_SETAFFINITY)
+
+if(WITH_ADAPTIVE_MUTEX)
+    set(THRIFT_ADAPTIVE_MUTEX 1)
+endif()
 
 include(CheckCSourceCompiles)
 include(CheckCXXSourceCompiles)
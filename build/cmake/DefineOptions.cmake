@@ -73,6 +73,7 @@ if(WITH_CPP)
     find_package(Qt5 QUIET COMPONENTS Core Network)
     CMAKE_DEPENDENT_OPTION(WITH_QT5 "Build with Qt5 support" ON
                            "Qt5_FOUND" OFF)
+    option(WITH_ADAPTIVE_MUTEX "Build concurrency::Mutex and Monitor as spin-then-park futex locks" OFF)
 endif()
 CMAKE_DEPENDENT_OPTION(BUILD_CPP "Build C++ library" ON
                        "BUILD_LIBRARIES;WITH_CPP" OFF)
@@ -185,6 +186,7 @@ if (BUILD_CPP)
     message(STATUS "    Build with libevent support:              ${WITH_LIBEVENT}")
     message(STATUS "    Build with Qt5 support:                   ${WITH_QT5}")
     message(STATUS "    Build with ZLIB support:                  ${WITH_ZLIB}")
+    message(STATUS "    Build with adaptive mutex:                ${WITH_ADAPTIVE_MUTEX}")
 endif ()
 message(STATUS)
 message(STATUS "  Build C (GLib) library:                     ${BUILD_C_GLIB}")
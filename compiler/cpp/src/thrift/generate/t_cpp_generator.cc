@@ -61,6 +61,7 @@ public:
     gen_pure_enums_ = false;
     use_include_prefix_ = false;
     gen_cob_style_ = false;
+    gen_coroutines_ = false;
     gen_no_client_completion_ = false;
     gen_no_default_operators_ = false;
     gen_templates_ = false;
@@ -68,6 +69,10 @@ public:
     gen_moveable_ = false;
     gen_no_ostream_operators_ = false;
     gen_no_skeleton_ = false;
+    gen_string_views_ = false;
+    gen_arena_ = false;
+    gen_lazy_ = false;
+    in_user_struct_ = false;
     has_members_ = false;
 
     for( iter = parsed_options.begin(); iter != parsed_options.end(); ++iter) {
@@ -77,6 +82,9 @@ public:
         use_include_prefix_ = true;
       } else if( iter->first.compare("cob_style") == 0) {
         gen_cob_style_ = true;
+      } else if( iter->first.compare("coroutines") == 0) {
+        gen_cob_style_ = true;
+        gen_coroutines_ = true;
       } else if( iter->first.compare("no_client_completion") == 0) {
         gen_no_client_completion_ = true;
       } else if( iter->first.compare("no_default_operators") == 0) {
@@ -90,6 +98,12 @@ public:
         gen_no_ostream_operators_ = true;
       } else if ( iter->first.compare("no_skeleton") == 0) {
         gen_no_skeleton_ = true;
+      } else if ( iter->first.compare("string_views") == 0) {
+        gen_string_views_ = true;
+      } else if ( iter->first.compare("arena") == 0) {
+        gen_arena_ = true;
+      } else if ( iter->first.compare("lazy") == 0) {
+        gen_lazy_ = true;
       } else {
         throw "unknown option cpp:" + iter->first;
       }
@@ -177,6 +191,9 @@ public:
                                  bool specialized = false);
   void generate_function_helpers(t_service* tservice, t_function* tfunction);
   void generate_service_async_skeleton(t_service* tservice);
+  void generate_service_coroutines(t_service* tservice);
+  std::string coroutine_function_signature(t_function* tfunction);
+  void generate_coroutine_call(std::ostream& out, t_function* tfunction, std::string iface);
 
   /**
    * Serialization constructs
@@ -187,6 +204,8 @@ public:
                                   std::string prefix = "",
                                   std::string suffix = "");
 
+  void generate_deserialize_lazy_field(std::ostream& out, t_field* tfield);
+
   void generate_deserialize_struct(std::ostream& out,
                                    t_struct* tstruct,
                                    std::string prefix = "",
@@ -209,6 +228,8 @@ public:
                                 std::string prefix = "",
                                 std::string suffix = "");
 
+  void generate_serialize_lazy_field(std::ostream& out, t_field* tfield);
+
   void generate_serialize_struct(std::ostream& out,
                                  t_struct* tstruct,
                                  std::string prefix = "",
@@ -266,6 +287,80 @@ public:
 
   bool is_reference(t_field* tfield) { return tfield->get_reference(); }
 
+  /**
+   * True if the field is generated as a TLazyField, i.e. cpp:lazy is on and
+   * the field of a struct, exception or container type is annotated cpp.lazy.
+   */
+  bool is_lazy(t_field* tfield) {
+    if (!gen_lazy_ || !in_user_struct_ || is_reference(tfield)
+        || tfield->annotations_.find("cpp.lazy") == tfield->annotations_.end()) {
+      return false;
+    }
+    t_type* ttype = get_true_type(tfield->get_type());
+    return ttype->is_struct() || ttype->is_xception() || ttype->is_container();
+  }
+
+  /**
+   * True if the (true) type is a string or binary that is generated as a
+   * TStringView, i.e. cpp:string_views is on and no cpp.type overrides it.
+   */
+  bool is_string_view(t_type* ttype) const {
+    return gen_string_views_ && ttype->is_base_type()
+           && ((t_base_type*)ttype)->get_base() == t_base_type::TYPE_STRING
+           && ttype->annotations_.find("cpp.type") == ttype->annotations_.end();
+  }
+
+  /**
+   * True if the (true) type is a string or binary that is generated as a
+   * TArenaString, which the protocols read and write through helpers.
+   */
+  bool is_arena_string(t_type* ttype) const {
+    return gen_arena_ && !gen_string_views_ && ttype->is_base_type()
+           && ((t_base_type*)ttype)->get_base() == t_base_type::TYPE_STRING
+           && ttype->annotations_.find("cpp.type") == ttype->annotations_.end();
+  }
+
+  /**
+   * The suffix of the TProtocol array methods that read and write all of a
+   * list of this (true) type in one call, e.g. "I32" for readI32Array(), or
+   * "" if its elements go one at a time.  Only std::vectors of integers and
+   * doubles with no cpp.type of their own qualify; std::vector<bool> has no
+   * array to pass.
+   */
+  std::string list_array_suffix(t_type* ttype) const {
+    if (!ttype->is_list() || ((t_container*)ttype)->has_cpp_name()) {
+      return "";
+    }
+    t_type* etype = get_true_type(((t_list*)ttype)->get_elem_type());
+    if (!etype->is_base_type() || etype->annotations_.find("cpp.type") != etype->annotations_.end()) {
+      return "";
+    }
+    switch (((t_base_type*)etype)->get_base()) {
+    case t_base_type::TYPE_I8:
+      return "Byte";
+    case t_base_type::TYPE_I16:
+      return "I16";
+    case t_base_type::TYPE_I32:
+      return "I32";
+    case t_base_type::TYPE_I64:
+      return "I64";
+    case t_base_type::TYPE_DOUBLE:
+      return "Double";
+    default:
+      return "";
+    }
+  }
+
+  /**
+   * True if the CobSv method of a function takes an exn_cob: if it declares
+   * exceptions, or for any call with a reply when a coroutine may be behind
+   * it, so whatever the coroutine throws can be reported.
+   */
+  bool has_exn_cob(t_function* tfunction) {
+    return !tfunction->get_xceptions()->get_members().empty()
+           || (gen_coroutines_ && !tfunction->is_oneway());
+  }
+
   bool is_complex_type(t_type* ttype) {
     ttype = get_true_type(ttype);
 
@@ -350,6 +445,12 @@ private:
    */
   bool gen_cob_style_;
 
+  /**
+   * True if we should generate C++20 coroutine interfaces and clients on top
+   * of the cob_style classes.
+   */
+  bool gen_coroutines_;
+
   /**
    * True if we should omit calls to completion__() in CobClient class.
    */
@@ -365,6 +466,30 @@ private:
    */
   bool gen_no_skeleton_;
 
+  /**
+   * True if string and binary fields should be TStringViews that alias the
+   * transport's read buffer rather than std::strings.
+   */
+  bool gen_string_views_;
+
+  /**
+   * True if strings and containers should use apache::thrift::TArenaAllocator
+   * so that deserialized objects can live in a per-request TArena.
+   */
+  bool gen_arena_;
+
+  /**
+   * True if fields annotated cpp.lazy should be TLazyFields that keep their
+   * encoded bytes until first accessed.
+   */
+  bool gen_lazy_;
+
+  /**
+   * True while generating a struct or exception from the IDL, as opposed to
+   * the args and result helpers of a service.
+   */
+  bool in_user_struct_;
+
   /**
    * True if thrift has member(s)
    */
@@ -442,6 +567,12 @@ void t_cpp_generator::init_generator() {
            << "#include <thrift/protocol/TProtocol.h>" << endl
            << "#include <thrift/transport/TTransport.h>" << endl
            << endl;
+  if (gen_arena_) {
+    f_types_ << "#include <thrift/TArena.h>" << endl << endl;
+  }
+  if (gen_lazy_) {
+    f_types_ << "#include <thrift/protocol/TLazyField.h>" << endl << endl;
+  }
   // Include C++xx compatibility header
   f_types_ << "#include <functional>" << endl;
   f_types_ << "#include <memory>" << endl;
@@ -902,6 +1033,7 @@ void t_cpp_generator::generate_forward_declaration(t_struct* tstruct) {
  * @param tstruct The struct definition
  */
 void t_cpp_generator::generate_cpp_struct(t_struct* tstruct, bool is_exception) {
+  in_user_struct_ = true;
   generate_struct_declaration(f_types_, tstruct, is_exception, false, true, true, true, true);
   generate_struct_definition(f_types_impl_, f_types_impl_, tstruct, true, true);
 
@@ -927,6 +1059,7 @@ void t_cpp_generator::generate_cpp_struct(t_struct* tstruct, bool is_exception)
   }
 
   has_members_ = true;
+  in_user_struct_ = false;
 }
 
 void t_cpp_generator::generate_copy_constructor(ostream& out,
@@ -1205,7 +1338,10 @@ void t_cpp_generator::generate_struct_declaration(ostream& out,
       if (!t->is_base_type()) {
         t_const_value* cv = (*m_iter)->get_value();
         if (cv != nullptr) {
-          print_const_value(out, (*m_iter)->get_name(), t, cv);
+          print_const_value(out,
+                            (*m_iter)->get_name() + (is_lazy(*m_iter) ? ".mutate()" : ""),
+                            t,
+                            cv);
         }
       }
     }
@@ -1473,6 +1609,8 @@ void t_cpp_generator::generate_struct_reader(ostream& out, t_struct* tstruct, bo
 
       if (pointers && !(*f_iter)->get_type()->is_xception()) {
         generate_deserialize_field(out, *f_iter, "(*(this->", "))");
+      } else if (is_lazy(*f_iter)) {
+        generate_deserialize_lazy_field(out, *f_iter);
       } else {
         generate_deserialize_field(out, *f_iter, "this->");
       }
@@ -1558,6 +1696,8 @@ void t_cpp_generator::generate_struct_writer(ostream& out, t_struct* tstruct, bo
     // Write field contents
     if (pointers && !(*f_iter)->get_type()->is_xception()) {
       generate_serialize_field(out, *f_iter, "(*(this->", "))");
+    } else if (is_lazy(*f_iter)) {
+      generate_serialize_lazy_field(out, *f_iter);
     } else {
       generate_serialize_field(out, *f_iter, "this->");
     }
@@ -1874,6 +2014,9 @@ void t_cpp_generator::generate_service(t_service* tservice) {
     f_header_ << "#include <thrift/async/TAsyncDispatchProcessor.h>" << endl;
   }
   f_header_ << "#include <thrift/async/TConcurrentClientSyncInfo.h>" << endl;
+  if (gen_coroutines_) {
+    f_header_ << "#include <thrift/async/TCoroutine.h>" << endl;
+  }
   f_header_ << "#include <memory>" << endl;
   f_header_ << "#include \"" << get_include_prefix(*get_program()) << program_name_ << "_types.h\""
             << endl;
@@ -1948,6 +2091,9 @@ void t_cpp_generator::generate_service(t_service* tservice) {
       generate_service_async_skeleton(tservice);
     }
 
+    if (gen_coroutines_) {
+      generate_service_coroutines(tservice);
+    }
   }
 
   f_header_ << "#ifdef _MSC_VER\n"
@@ -2316,6 +2462,185 @@ void t_cpp_generator::generate_service_async_skeleton(t_service* tservice) {
   f_skeleton << "}" << endl << endl;
 }
 
+/**
+ * Generates the C++20 coroutine classes of a service: FooCoroIf, whose
+ * methods return a TTask, FooCoroSvIfAdapter, which serves one through the
+ * FooCobSvIf interface, and FooCoroClient, whose calls go through a pool of
+ * FooCobClients and are awaited.  All are inline in the header, and only
+ * compiled if TCoroutine.h finds the compiler supports coroutines.
+ *
+ * @param tservice The service to generate coroutine classes for
+ */
+void t_cpp_generator::generate_service_coroutines(t_service* tservice) {
+  string svcname = tservice->get_name();
+  t_service* extends_service = tservice->get_extends();
+  string extends_name = (extends_service != nullptr ? type_name(extends_service) : "");
+  vector<t_function*> functions = tservice->get_functions();
+  vector<t_function*>::iterator f_iter;
+
+  f_header_ << "#ifdef THRIFT_HAS_COROUTINES" << endl << endl;
+
+  // The interface takes its arguments by value, as a coroutine may outlive
+  // the caller's copies
+  f_header_ << "class " << svcname << "CoroIf";
+  if (extends_service != nullptr) {
+    f_header_ << " : virtual public " << extends_name << "CoroIf";
+  }
+  f_header_ << " {" << endl << " public:" << endl;
+  indent_up();
+  f_header_ << indent() << "virtual ~" << svcname << "CoroIf() {}" << endl;
+  for (f_iter = functions.begin(); f_iter != functions.end(); ++f_iter) {
+    if ((*f_iter)->has_doc())
+      f_header_ << endl;
+    generate_java_doc(f_header_, *f_iter);
+    f_header_ << indent() << "virtual " << coroutine_function_signature(*f_iter) << " = 0;"
+              << endl;
+  }
+  indent_down();
+  f_header_ << "};" << endl << endl;
+
+  // The adapter
+  string adapter_name = svcname + "CoroSvIfAdapter";
+  f_header_ << "class " << adapter_name << " : virtual public " << svcname << "CobSvIf";
+  if (extends_service != nullptr) {
+    f_header_ << ", public " << extends_name << "CoroSvIfAdapter";
+  }
+  f_header_ << " {" << endl << " public:" << endl;
+  indent_up();
+  f_header_ << indent() << adapter_name << "(const ::std::shared_ptr<" << svcname
+            << "CoroIf>& iface) :" << endl;
+  if (extends_service != nullptr) {
+    f_header_ << indent() << "  " << extends_name << "CoroSvIfAdapter(iface)," << endl;
+  }
+  f_header_ << indent() << "  iface_(iface) {}" << endl;
+  for (f_iter = functions.begin(); f_iter != functions.end(); ++f_iter) {
+    t_type* returntype = (*f_iter)->get_returntype();
+    bool exn_cob = has_exn_cob(*f_iter);
+    f_header_ << indent() << "void " << (*f_iter)->get_name() << "(::std::function<void"
+              << (returntype->is_void() ? "()" : "(" + type_name(returntype) + " const& _return)")
+              << "> cob"
+              << (exn_cob ? ", ::std::function<void(::apache::thrift::TDelayedException* _throw)> exn_cob" : "")
+              << argument_list((*f_iter)->get_arglist(), true, true) << ") override {" << endl;
+    indent_up();
+    f_header_ << indent() << "::apache::thrift::async::completeTask(";
+    generate_coroutine_call(f_header_, *f_iter, "iface_");
+    f_header_ << ", ::std::move(cob)" << (exn_cob ? ", ::std::move(exn_cob)" : "") << ");" << endl;
+    indent_down();
+    f_header_ << indent() << "}" << endl;
+  }
+  f_header_ << endl << " protected:" << endl << indent() << "::std::shared_ptr<" << svcname
+            << "CoroIf> iface_;" << endl;
+  indent_down();
+  f_header_ << "};" << endl << endl;
+
+  // The client
+  string client_name = svcname + "CoroClient";
+  string cob_client_name = svcname + "CobClient";
+  string template_args;
+  if (gen_templates_) {
+    client_name += "T";
+    cob_client_name += "T<Protocol_>";
+    template_args = "<Protocol_>";
+    f_header_ << "template <class Protocol_>" << endl;
+  }
+  f_header_ << "class " << client_name << " : virtual public " << svcname << "CoroIf";
+  if (extends_service != nullptr) {
+    // as for the other clients, the parent is assumed to have templates too
+    f_header_ << ", public " << extends_name << "CoroClient" << (gen_templates_ ? "T" : "")
+              << template_args;
+  }
+  f_header_ << " {" << endl << " public:" << endl;
+  indent_up();
+  f_header_ << indent() << client_name << "(::std::shared_ptr< ::apache::thrift::async::TAsyncChannel> "
+            << "channel, ::apache::thrift::protocol::TProtocolFactory* protocolFactory) :" << endl;
+  if (extends_service != nullptr) {
+    f_header_ << indent() << "  " << extends_name << "CoroClient" << (gen_templates_ ? "T" : "")
+              << template_args << "(channel, protocolFactory)," << endl;
+  }
+  f_header_ << indent() << "  clients_(channel, protocolFactory) {}" << endl
+            << indent() << "::std::shared_ptr< ::apache::thrift::async::TAsyncChannel> getChannel() {"
+            << endl << indent() << "  return clients_.getChannel();" << endl << indent() << "}"
+            << endl;
+  for (f_iter = functions.begin(); f_iter != functions.end(); ++f_iter) {
+    t_type* returntype = get_true_type((*f_iter)->get_returntype());
+    const vector<t_field*>& fields = (*f_iter)->get_arglist()->get_members();
+    vector<t_field*>::const_iterator fld_iter;
+
+    f_header_ << indent() << coroutine_function_signature(*f_iter) << " override {" << endl;
+    indent_up();
+    f_header_ << indent() << "::std::shared_ptr<" << cob_client_name
+              << " > _client = clients_.acquire();" << endl << indent()
+              << "co_await ::apache::thrift::async::awaitCallback([&](::std::function<void()> _done) {"
+              << endl << indent() << "  _client->" << (*f_iter)->get_name()
+              << "([_done](" << cob_client_name << "*) { _done(); }";
+    for (fld_iter = fields.begin(); fld_iter != fields.end(); ++fld_iter) {
+      f_header_ << ", " << (*fld_iter)->get_name();
+    }
+    f_header_ << ");" << endl << indent() << "});" << endl;
+    if ((*f_iter)->is_oneway() || returntype->is_void()) {
+      if (!(*f_iter)->is_oneway()) {
+        f_header_ << indent() << "_client->recv_" << (*f_iter)->get_name() << "();" << endl;
+      }
+    } else if (is_complex_type(returntype)) {
+      f_header_ << indent() << type_name(returntype) << " _return;" << endl << indent()
+                << "_client->recv_" << (*f_iter)->get_name() << "(_return);" << endl << indent()
+                << "co_return _return;" << endl;
+    } else {
+      f_header_ << indent() << "co_return _client->recv_" << (*f_iter)->get_name() << "();"
+                << endl;
+    }
+    indent_down();
+    f_header_ << indent() << "}" << endl;
+  }
+  f_header_ << endl << " protected:" << endl << indent()
+            << "::apache::thrift::async::TCobClientPool<" << cob_client_name << " > clients_;"
+            << endl;
+  indent_down();
+  f_header_ << "};" << endl << endl;
+
+  if (gen_templates_) {
+    f_header_ << "typedef " << client_name << "< ::apache::thrift::protocol::TProtocol> "
+              << svcname << "CoroClient;" << endl << endl;
+  }
+
+  f_header_ << "#endif // THRIFT_HAS_COROUTINES" << endl << endl;
+}
+
+/**
+ * The signature of a FooCoroIf method.
+ */
+string t_cpp_generator::coroutine_function_signature(t_function* tfunction) {
+  string result = "::apache::thrift::async::TTask<" + type_name(tfunction->get_returntype())
+                  + "> " + tfunction->get_name() + "(";
+  const vector<t_field*>& fields = tfunction->get_arglist()->get_members();
+  vector<t_field*>::const_iterator f_iter;
+  for (f_iter = fields.begin(); f_iter != fields.end(); ++f_iter) {
+    if (f_iter != fields.begin()) {
+      result += ", ";
+    }
+    result += type_name((*f_iter)->get_type()) + " " + (*f_iter)->get_name();
+  }
+  return result + ")";
+}
+
+/**
+ * Calls a FooCoroIf method with the arguments of the FooCobSvIf method.
+ */
+void t_cpp_generator::generate_coroutine_call(ostream& out,
+                                              t_function* tfunction,
+                                              string iface) {
+  out << iface << "->" << tfunction->get_name() << "(";
+  const vector<t_field*>& fields = tfunction->get_arglist()->get_members();
+  vector<t_field*>::const_iterator f_iter;
+  for (f_iter = fields.begin(); f_iter != fields.end(); ++f_iter) {
+    if (f_iter != fields.begin()) {
+      out << ", ";
+    }
+    out << (*f_iter)->get_name();
+  }
+  out << ")";
+}
+
 /**
  * Generates a multiface, which is a single server that just takes a set
  * of objects implementing the interface and calls them all, returning the
@@ -3706,7 +4031,7 @@ void t_cpp_generator::generate_process_function(t_service* tservice,
           << ") =" << endl;
       out << indent() << "  &" << tservice->get_name() << "AsyncProcessor" << class_suffix
           << "::return_" << tfunction->get_name() << ";" << endl;
-      if (!xceptions.empty()) {
+      if (has_exn_cob(tfunction)) {
         out << indent() << "void (" << tservice->get_name() << "AsyncProcessor" << class_suffix
             << "::*throw_fn)(::std::function<void(bool ok)> "
             << "cob, int32_t seqid, " << prot_type << "* oprot, void* ctx, "
@@ -3720,7 +4045,7 @@ void t_cpp_generator::generate_process_function(t_service* tservice,
       indent_up();
       out << indent() << "::std::bind(return_fn, this, cob, seqid, oprot, ctx" << ret_placeholder
           << ")";
-      if (!xceptions.empty()) {
+      if (has_exn_cob(tfunction)) {
         out << ',' << endl << indent() << "::std::bind(throw_fn, this, cob, seqid, oprot, "
             << "ctx, ::std::placeholders::_1)";
       }
@@ -3790,7 +4115,7 @@ void t_cpp_generator::generate_process_function(t_service* tservice,
     }
 
     // Exception return.
-    if (!tfunction->is_oneway() && !xceptions.empty()) {
+    if (!tfunction->is_oneway() && has_exn_cob(tfunction)) {
       if (gen_templates_) {
         out << indent() << "template <class Protocol_>" << endl;
       }
@@ -3961,6 +4286,10 @@ void t_cpp_generator::generate_deserialize_field(ostream& out,
     generate_deserialize_struct(out, (t_struct*)type, name, is_reference(tfield));
   } else if (type->is_container()) {
     generate_deserialize_container(out, type, name);
+  } else if (is_arena_string(type)) {
+    indent(out) << "xfer += ::apache::thrift::protocol::"
+                << (type->is_binary() ? "readBinary" : "readString") << "(*iprot, " << name
+                << ");" << endl;
   } else if (type->is_base_type()) {
     indent(out) << "xfer += iprot->";
     t_base_type::t_base tbase = ((t_base_type*)type)->get_base();
@@ -3969,7 +4298,9 @@ void t_cpp_generator::generate_deserialize_field(ostream& out,
       throw "compiler error: cannot serialize void field in a struct: " + name;
       break;
     case t_base_type::TYPE_STRING:
-      if (type->is_binary()) {
+      if (is_string_view(type)) {
+        out << (type->is_binary() ? "readBinaryView(" : "readStringView(") << name << ");";
+      } else if (type->is_binary()) {
         out << "readBinary(" << name << ");";
       } else {
         out << "readString(" << name << ");";
@@ -4009,6 +4340,23 @@ void t_cpp_generator::generate_deserialize_field(ostream& out,
   }
 }
 
+/**
+ * Reads a TLazyField member, handing it a decoder for when the value is
+ * first accessed or the bytes cannot be captured.
+ */
+void t_cpp_generator::generate_deserialize_lazy_field(ostream& out, t_field* tfield) {
+  t_field value(tfield->get_type(), "value");
+  indent(out) << "xfer += this->" << tfield->get_name()
+              << ".read(iprot, ftype, [](::apache::thrift::protocol::TProtocol* iprot, "
+              << type_name(tfield->get_type()) << "& value) -> uint32_t {" << endl;
+  indent_up();
+  indent(out) << "uint32_t xfer = 0;" << endl;
+  generate_deserialize_field(out, &value);
+  indent(out) << "return xfer;" << endl;
+  indent_down();
+  indent(out) << "});" << endl;
+}
+
 /**
  * Generates an unserializer for a variable. This makes two key assumptions,
  * first that there is a const char* variable named data that points to the
@@ -4066,6 +4414,15 @@ void t_cpp_generator::generate_deserialize_container(ostream& out, t_type* ttype
     if (!use_push) {
       indent(out) << prefix << ".resize(" << size << ");" << endl;
     }
+
+    string suffix = list_array_suffix(ttype);
+    if (!suffix.empty()) {
+      indent(out) << "xfer += iprot->read" << suffix << "Array(" << prefix << ".data(), " << size
+                  << ");" << endl;
+      indent(out) << "xfer += iprot->readListEnd();" << endl;
+      scope_down(out);
+      return;
+    }
   }
 
   // For loop iterates over elements
@@ -4166,6 +4523,10 @@ void t_cpp_generator::generate_serialize_field(ostream& out,
     generate_serialize_struct(out, (t_struct*)type, name, is_reference(tfield));
   } else if (type->is_container()) {
     generate_serialize_container(out, type, name);
+  } else if (is_arena_string(type)) {
+    indent(out) << "xfer += ::apache::thrift::protocol::"
+                << (type->is_binary() ? "writeBinary" : "writeString") << "(*oprot, " << name
+                << ");" << endl;
   } else if (type->is_base_type() || type->is_enum()) {
 
     indent(out) << "xfer += oprot->";
@@ -4177,7 +4538,9 @@ void t_cpp_generator::generate_serialize_field(ostream& out,
         throw "compiler error: cannot serialize void field in a struct: " + name;
         break;
       case t_base_type::TYPE_STRING:
-        if (type->is_binary()) {
+        if (is_string_view(type)) {
+          out << (type->is_binary() ? "writeBinaryView(" : "writeStringView(") << name << ");";
+        } else if (type->is_binary()) {
           out << "writeBinary(" << name << ");";
         } else {
           out << "writeString(" << name << ");";
@@ -4216,6 +4579,23 @@ void t_cpp_generator::generate_serialize_field(ostream& out,
   }
 }
 
+/**
+ * Writes a TLazyField member, handing it an encoder for when its captured
+ * bytes cannot be copied through unchanged.
+ */
+void t_cpp_generator::generate_serialize_lazy_field(ostream& out, t_field* tfield) {
+  t_field value(tfield->get_type(), "value");
+  indent(out) << "xfer += this->" << tfield->get_name()
+              << ".write(oprot, [](::apache::thrift::protocol::TProtocol* oprot, const "
+              << type_name(tfield->get_type()) << "& value) -> uint32_t {" << endl;
+  indent_up();
+  indent(out) << "uint32_t xfer = 0;" << endl;
+  generate_serialize_field(out, &value);
+  indent(out) << "return xfer;" << endl;
+  indent_down();
+  indent(out) << "});" << endl;
+}
+
 /**
  * Serializes all the members of a struct.
  *
@@ -4254,6 +4634,15 @@ void t_cpp_generator::generate_serialize_container(ostream& out, t_type* ttype,
     indent(out) << "xfer += oprot->writeListBegin("
                 << type_to_enum(((t_list*)ttype)->get_elem_type()) << ", "
                 << "static_cast<uint32_t>(" << prefix << ".size()));" << endl;
+
+    string suffix = list_array_suffix(ttype);
+    if (!suffix.empty()) {
+      indent(out) << "xfer += oprot->write" << suffix << "Array(" << prefix << ".data(), "
+                  << "static_cast<uint32_t>(" << prefix << ".size()));" << endl;
+      indent(out) << "xfer += oprot->writeListEnd();" << endl;
+      scope_down(out);
+      return;
+    }
   }
 
   string iter = tmp("_iter");
@@ -4420,14 +4809,17 @@ string t_cpp_generator::type_name(t_type* ttype, bool in_typedef, bool arg) {
       cname = tcontainer->get_cpp_name();
     } else if (ttype->is_map()) {
       t_map* tmap = (t_map*)ttype;
-      cname = "std::map<" + type_name(tmap->get_key_type(), in_typedef) + ", "
+      cname = (gen_arena_ ? "::apache::thrift::TArenaMap<" : "std::map<")
+              + type_name(tmap->get_key_type(), in_typedef) + ", "
               + type_name(tmap->get_val_type(), in_typedef) + "> ";
     } else if (ttype->is_set()) {
       t_set* tset = (t_set*)ttype;
-      cname = "std::set<" + type_name(tset->get_elem_type(), in_typedef) + "> ";
+      cname = (gen_arena_ ? "::apache::thrift::TArenaSet<" : "std::set<")
+              + type_name(tset->get_elem_type(), in_typedef) + "> ";
     } else if (ttype->is_list()) {
       t_list* tlist = (t_list*)ttype;
-      cname = "std::vector<" + type_name(tlist->get_elem_type(), in_typedef) + "> ";
+      cname = (gen_arena_ ? "::apache::thrift::TArenaVector<" : "std::vector<")
+              + type_name(tlist->get_elem_type(), in_typedef) + "> ";
     }
 
     if (arg) {
@@ -4477,7 +4869,10 @@ string t_cpp_generator::base_type_name(t_base_type::t_base tbase) {
   case t_base_type::TYPE_VOID:
     return "void";
   case t_base_type::TYPE_STRING:
-    return "std::string";
+    if (gen_string_views_) {
+      return "::apache::thrift::TStringView";
+    }
+    return gen_arena_ ? "::apache::thrift::TArenaString" : "std::string";
   case t_base_type::TYPE_BOOL:
     return "bool";
   case t_base_type::TYPE_I8:
@@ -4514,6 +4909,8 @@ string t_cpp_generator::declare_field(t_field* tfield,
   result += type_name(tfield->get_type());
   if (is_reference(tfield)) {
     result = "::std::shared_ptr<" + result + ">";
+  } else if (is_lazy(tfield)) {
+    result = "::apache::thrift::protocol::TLazyField<" + result + ">";
   }
   if (pointer) {
     result += "*";
@@ -4568,8 +4965,6 @@ string t_cpp_generator::function_signature(t_function* tfunction,
                                            bool name_params) {
   t_type* ttype = tfunction->get_returntype();
   t_struct* arglist = tfunction->get_arglist();
-  bool has_xceptions = !tfunction->get_xceptions()->get_members().empty();
-
   if (style == "") {
     if (is_complex_type(ttype)) {
       return "void " + prefix + tfunction->get_name() + "(" + type_name(ttype)
@@ -4590,7 +4985,7 @@ string t_cpp_generator::function_signature(t_function* tfunction,
       cob_type += "* client)";
     } else if (style == "CobSv") {
       cob_type = (ttype->is_void() ? "()" : ("(" + type_name(ttype) + " const& _return)"));
-      if (has_xceptions) {
+      if (has_exn_cob(tfunction)) {
         exn_cob
             = ", ::std::function<void(::apache::thrift::TDelayedException* _throw)> /* exn_cob */";
       }
@@ -4750,6 +5145,8 @@ THRIFT_REGISTER_GENERATOR(
     cpp,
     "C++",
     "    cob_style:       Generate \"Continuation OBject\"-style classes.\n"
+    "    coroutines:      Also generate C++20 coroutine interfaces, adapters and clients\n"
+    "                     (implies cob_style); compiled only where coroutines are supported.\n"
     "    no_client_completion:\n"
     "                     Omit calls to completion__() in CobClient class.\n"
     "    no_default_operators:\n"
@@ -4760,4 +5157,13 @@ THRIFT_REGISTER_GENERATOR(
     "    moveable_types:  Generate move constructors and assignment operators.\n"
     "    no_ostream_operators:\n"
     "                     Omit generation of ostream definitions.\n"
-    "    no_skeleton:     Omits generation of skeleton.\n")
+    "    no_skeleton:     Omits generation of skeleton.\n"
+    "    string_views:    Deserialize string and binary fields into apache::thrift::TStringView\n"
+    "                     views of the transport's read buffer instead of copying them.\n"
+    "                     Needs a transport that can lend its buffer, e.g. TFramedTransport\n"
+    "                     or TMemoryBuffer; views die when its next message is read.\n"
+    "    arena:           Allocate strings and containers with apache::thrift::TArenaAllocator,\n"
+    "                     from the TArena servers make current for each request.\n"
+    "    lazy:            Generate struct, exception and container fields annotated cpp.lazy\n"
+    "                     as apache::thrift::protocol::TLazyField, which keeps the encoded\n"
+    "                     bytes and decodes them on first access.\n")
@@ -0,0 +1,146 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <cstdlib>
+
+#include <thrift/TArena.h>
+
+namespace apache {
+namespace thrift {
+
+namespace {
+thread_local TArena* currentArena = nullptr;
+
+// Blocks start with their header; keep the data that follows it aligned.
+const size_t BLOCK_HEADER_SIZE = (sizeof(void*) + sizeof(size_t) + alignof(std::max_align_t) - 1)
+                                 & ~(alignof(std::max_align_t) - 1);
+
+uint8_t* alignUp(uint8_t* p, size_t align) {
+  auto bits = reinterpret_cast<uintptr_t>(p);
+  return reinterpret_cast<uint8_t*>((bits + align - 1) & ~(static_cast<uintptr_t>(align) - 1));
+}
+}
+
+TArena::TArena(size_t blockSize)
+  : blockSize_(blockSize < 64 ? 64 : blockSize),
+    blocks_(nullptr),
+    pos_(nullptr),
+    end_(nullptr),
+    bytesAllocated_(0) {
+}
+
+TArena::~TArena() {
+  while (blocks_ != nullptr) {
+    Block* next = blocks_->next;
+    std::free(blocks_);
+    blocks_ = next;
+  }
+}
+
+uint8_t* TArena::blockData(Block* block) {
+  return reinterpret_cast<uint8_t*>(block) + BLOCK_HEADER_SIZE;
+}
+
+void* TArena::allocate(size_t size, size_t align) {
+  // Aligning can step past the end of a block that is not a multiple of
+  // the alignment long, such as an oversized one.
+  uint8_t* p = alignUp(pos_, align);
+  if (pos_ != nullptr && p <= end_ && size <= static_cast<size_t>(end_ - p)) {
+    pos_ = p + size;
+    bytesAllocated_ += size;
+    return p;
+  }
+  return allocateSlow(size, align);
+}
+
+void* TArena::allocateSlow(size_t size, size_t align) {
+  // Oversized requests get a block of their own, linked in behind the
+  // current one so that the rest of the current block is not wasted.
+  bool oversized = size > blockSize_ / 2;
+  size_t dataSize = oversized ? size + align : blockSize_;
+  auto* block = static_cast<Block*>(std::malloc(BLOCK_HEADER_SIZE + dataSize));
+  if (block == nullptr) {
+    throw std::bad_alloc();
+  }
+  block->size = dataSize;
+
+  uint8_t* p = alignUp(blockData(block), align);
+  if (oversized && blocks_ != nullptr) {
+    block->next = blocks_->next;
+    blocks_->next = block;
+  } else {
+    block->next = blocks_;
+    blocks_ = block;
+    pos_ = p + size;
+    end_ = blockData(block) + dataSize;
+  }
+  bytesAllocated_ += size;
+  return p;
+}
+
+void TArena::reset() {
+  if (blocks_ == nullptr) {
+    return;
+  }
+
+  // Keep the oldest full-size block; it is the one every request touches.
+  Block* keep = nullptr;
+  while (blocks_ != nullptr) {
+    Block* next = blocks_->next;
+    if (keep == nullptr && next == nullptr && blocks_->size == blockSize_) {
+      keep = blocks_;
+    } else {
+      std::free(blocks_);
+    }
+    blocks_ = next;
+  }
+
+  blocks_ = keep;
+  if (keep != nullptr) {
+    keep->next = nullptr;
+    pos_ = blockData(keep);
+    end_ = pos_ + blockSize_;
+  } else {
+    pos_ = nullptr;
+    end_ = nullptr;
+  }
+  bytesAllocated_ = 0;
+}
+
+size_t TArena::getBlockCount() const {
+  size_t count = 0;
+  for (Block* block = blocks_; block != nullptr; block = block->next) {
+    ++count;
+  }
+  return count;
+}
+
+TArena* TArena::current() {
+  return currentArena;
+}
+
+TArenaScope::TArenaScope(TArena* arena) : previous_(currentArena) {
+  currentArena = arena;
+}
+
+TArenaScope::~TArenaScope() {
+  currentArena = previous_;
+}
+}
+} // apache::thrift
@@ -0,0 +1,207 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _THRIFT_TARENA_H_
+#define _THRIFT_TARENA_H_ 1
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <new>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <thrift/TNonCopyable.h>
+
+namespace apache {
+namespace thrift {
+
+/**
+ * A bump allocator for objects that all die together, such as everything
+ * deserialized for one request.
+ *
+ * Memory is carved out of blocks of getBlockSize() bytes; allocations bigger
+ * than half a block get a block of their own.  Nothing is freed individually:
+ * reset() releases everything at once and keeps the first block for the next
+ * round, so a steady stream of similar requests settles at no heap traffic.
+ *
+ * An arena is not thread-safe.  It is meant to be owned by whatever drives
+ * a single connection and made current with TArenaScope around each call.
+ */
+class TArena : TNonCopyable {
+public:
+  static const size_t DEFAULT_BLOCK_SIZE = 8 * 1024;
+
+  explicit TArena(size_t blockSize = DEFAULT_BLOCK_SIZE);
+
+  ~TArena();
+
+  /**
+   * Returns size bytes aligned to align, which must be a power of two no
+   * greater than alignof(std::max_align_t).
+   */
+  void* allocate(size_t size, size_t align);
+
+  /**
+   * Releases every allocation.  Objects living in the arena must already
+   * have been destroyed.
+   */
+  void reset();
+
+  size_t getBlockSize() const { return blockSize_; }
+
+  /**
+   * Returns the number of bytes handed out since the last reset().
+   */
+  size_t getBytesAllocated() const { return bytesAllocated_; }
+
+  /**
+   * Returns the number of blocks currently held, including the retained one.
+   */
+  size_t getBlockCount() const;
+
+  /**
+   * Returns the arena made current on this thread by TArenaScope, or nullptr.
+   */
+  static TArena* current();
+
+private:
+  friend class TArenaScope;
+
+  struct Block {
+    Block* next;
+    size_t size;
+  };
+
+  void* allocateSlow(size_t size, size_t align);
+
+  static uint8_t* blockData(Block* block);
+
+  const size_t blockSize_;
+  Block* blocks_;
+  uint8_t* pos_;
+  uint8_t* end_;
+  size_t bytesAllocated_;
+};
+
+/**
+ * Makes an arena current on this thread for the lifetime of the scope, so
+ * that TArenaAllocators created meanwhile allocate from it.  The previous
+ * arena is restored afterwards.  A null arena makes allocators use the heap.
+ */
+class TArenaScope : TNonCopyable {
+public:
+  explicit TArenaScope(TArena* arena);
+  ~TArenaScope();
+
+private:
+  TArena* previous_;
+};
+
+/**
+ * A standard allocator that allocates from the arena that was current when
+ * it was constructed, or from the heap if there was none.
+ *
+ * Containers that are copy-constructed pick up the current arena rather
+ * than the source's, as do the nested strings and containers of a copied
+ * struct, so a copy made during a handler call lives in the request's arena
+ * too.  Use copyToHeap() for one that must outlive it.  Assignment keeps the
+ * target's allocator and copies or moves the elements into it; swap()
+ * exchanges allocators along with the contents.
+ */
+template <class T>
+class TArenaAllocator {
+public:
+  typedef T value_type;
+  typedef std::false_type propagate_on_container_copy_assignment;
+  typedef std::false_type propagate_on_container_move_assignment;
+  typedef std::true_type propagate_on_container_swap;
+
+  TArenaAllocator() : arena_(TArena::current()) {}
+
+  explicit TArenaAllocator(TArena* arena) : arena_(arena) {}
+
+  template <class U>
+  TArenaAllocator(const TArenaAllocator<U>& other) : arena_(other.getArena()) {}
+
+  T* allocate(size_t n) {
+    if (arena_ != nullptr) {
+      return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+    }
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T* p, size_t n) {
+    (void)n;
+    if (arena_ == nullptr) {
+      ::operator delete(p);
+    }
+  }
+
+  TArenaAllocator select_on_container_copy_construction() const { return TArenaAllocator(); }
+
+  TArena* getArena() const { return arena_; }
+
+private:
+  TArena* arena_;
+};
+
+template <class T, class U>
+bool operator==(const TArenaAllocator<T>& lhs, const TArenaAllocator<U>& rhs) {
+  return lhs.getArena() == rhs.getArena();
+}
+
+template <class T, class U>
+bool operator!=(const TArenaAllocator<T>& lhs, const TArenaAllocator<U>& rhs) {
+  return !(lhs == rhs);
+}
+
+/*
+ * The types generated for strings and containers by the cpp:arena option.
+ */
+typedef std::basic_string<char, std::char_traits<char>, TArenaAllocator<char> > TArenaString;
+
+template <class T>
+using TArenaVector = std::vector<T, TArenaAllocator<T> >;
+
+template <class T>
+using TArenaSet = std::set<T, std::less<T>, TArenaAllocator<T> >;
+
+template <class K, class V>
+using TArenaMap = std::map<K, V, std::less<K>, TArenaAllocator<std::pair<const K, V> > >;
+
+/**
+ * Returns a deep copy of value that lives entirely on the heap, nested
+ * strings and containers included, whatever arena is current.  It is made
+ * on the heap itself because copying or assigning it on to another object
+ * would put the elements back in the current arena.
+ */
+template <class T>
+std::unique_ptr<T> copyToHeap(const T& value) {
+  TArenaScope heap(nullptr);
+  return std::unique_ptr<T>(new T(value));
+}
+}
+} // apache::thrift
+
+#endif // #ifndef _THRIFT_TARENA_H_
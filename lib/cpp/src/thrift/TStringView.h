@@ -0,0 +1,127 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _THRIFT_TSTRINGVIEW_H_
+#define _THRIFT_TSTRINGVIEW_H_ 1
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+namespace apache {
+namespace thrift {
+
+/**
+ * A non-owning reference to a run of bytes: a pointer and a length.
+ *
+ * This is what string and binary fields are deserialized into when code is
+ * generated with the cpp:string_views option.  The protocol's
+ * readStringView() points the view straight at the transport's read buffer
+ * instead of copying the bytes into a std::string, so the view is only
+ * valid for as long as that buffer is; see TProtocol::readStringView().
+ *
+ * A view can also refer to any other storage, such as a std::string or a
+ * string literal, which must likewise outlive it.
+ */
+class TStringView {
+public:
+  typedef const char* const_iterator;
+
+  TStringView() : data_(""), size_(0) {}
+
+  TStringView(const char* data, std::size_t size) : data_(data), size_(size) {}
+
+  TStringView(const char* str) : data_(str), size_(std::strlen(str)) {}
+
+  TStringView(const std::string& str) : data_(str.data()), size_(str.size()) {}
+
+  const char* data() const { return data_; }
+
+  std::size_t size() const { return size_; }
+
+  std::size_t length() const { return size_; }
+
+  bool empty() const { return size_ == 0; }
+
+  const_iterator begin() const { return data_; }
+
+  const_iterator end() const { return data_ + size_; }
+
+  char operator[](std::size_t i) const { return data_[i]; }
+
+  void assign(const char* data, std::size_t size) {
+    data_ = data;
+    size_ = size;
+  }
+
+  void clear() { assign("", 0); }
+
+  /**
+   * Copies the referenced bytes into a std::string that owns them.
+   */
+  std::string str() const { return std::string(data_, size_); }
+
+  int compare(const TStringView& rhs) const {
+    int c = size_ == 0 || rhs.size_ == 0
+                ? 0
+                : std::memcmp(data_, rhs.data_, (std::min)(size_, rhs.size_));
+    if (c != 0) {
+      return c;
+    }
+    return size_ < rhs.size_ ? -1 : (size_ > rhs.size_ ? 1 : 0);
+  }
+
+private:
+  const char* data_;
+  std::size_t size_;
+};
+
+inline bool operator==(const TStringView& lhs, const TStringView& rhs) {
+  return lhs.size() == rhs.size() && lhs.compare(rhs) == 0;
+}
+
+inline bool operator!=(const TStringView& lhs, const TStringView& rhs) {
+  return !(lhs == rhs);
+}
+
+inline bool operator<(const TStringView& lhs, const TStringView& rhs) {
+  return lhs.compare(rhs) < 0;
+}
+
+inline bool operator>(const TStringView& lhs, const TStringView& rhs) {
+  return rhs < lhs;
+}
+
+inline bool operator<=(const TStringView& lhs, const TStringView& rhs) {
+  return !(rhs < lhs);
+}
+
+inline bool operator>=(const TStringView& lhs, const TStringView& rhs) {
+  return !(lhs < rhs);
+}
+
+inline std::ostream& operator<<(std::ostream& out, const TStringView& str) {
+  return out.write(str.data(), static_cast<std::streamsize>(str.size()));
+}
+}
+} // apache::thrift
+
+#endif // #ifndef _THRIFT_TSTRINGVIEW_H_
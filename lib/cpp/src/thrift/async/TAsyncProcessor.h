@@ -71,6 +71,23 @@ public:
    */
   virtual std::shared_ptr<TAsyncProcessor> getProcessor(const TConnectionInfo& connInfo) = 0;
 };
+
+/**
+ * A TAsyncProcessorFactory that returns the same processor for every
+ * connection.
+ */
+class TAsyncSingletonProcessorFactory : public TAsyncProcessorFactory {
+public:
+  TAsyncSingletonProcessorFactory(std::shared_ptr<TAsyncProcessor> processor)
+    : processor_(processor) {}
+
+  std::shared_ptr<TAsyncProcessor> getProcessor(const TConnectionInfo&) override {
+    return processor_;
+  }
+
+private:
+  std::shared_ptr<TAsyncProcessor> processor_;
+};
 }
 }
 } // apache::thrift::async
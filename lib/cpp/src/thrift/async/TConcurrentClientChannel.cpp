@@ -0,0 +1,517 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <thrift/async/TConcurrentClientChannel.h>
+
+#include <thrift/TOutput.h>
+#include <thrift/concurrency/Monitor.h>
+#include <thrift/concurrency/ThreadFactory.h>
+#include <thrift/protocol/TProtocolDecorator.h>
+#include <thrift/protocol/TProtocolException.h>
+#include <thrift/transport/PlatformSocket.h>
+#include <thrift/transport/TBufferTransports.h>
+#include <thrift/transport/TSocket.h>
+#include <thrift/transport/TTransportException.h>
+#include <thrift/transport/TVirtualTransport.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#ifdef HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#endif
+
+namespace apache {
+namespace thrift {
+namespace async {
+
+using concurrency::Guard;
+using concurrency::Monitor;
+using concurrency::Synchronized;
+using protocol::TMessageType;
+using protocol::TProtocol;
+using protocol::TProtocolException;
+using transport::TMemoryBuffer;
+using transport::TTransportException;
+
+namespace {
+const uint32_t FRAME_HEADER_SIZE = 4;
+}
+
+/**
+ * The transport of one slot: requests are written to a frame buffer and sent
+ * whole on flush(), and reads wait for the reply and then read its frame.
+ */
+class TConcurrentClientChannel::Call
+  : public transport::TVirtualTransport<TConcurrentClientChannel::Call> {
+public:
+  enum State { IDLE, WAITING, READY, FAILED };
+
+  Call(TConcurrentClientChannel* channel)
+    : channel_(channel),
+      monitor_(&channel->mutex_),
+      seqid_(0),
+      state_(IDLE),
+      out_(FRAME_HEADER_SIZE),
+      rpos_(0),
+      haveReply_(false) {}
+
+  bool isOpen() const override { return channel_->isOpen(); }
+  void open() override {}
+  void close() override {}
+
+  /**
+   * Starts a message, returning the seqid it must carry.
+   */
+  int32_t beginMessage(TMessageType type) {
+    out_.resize(FRAME_HEADER_SIZE);
+    if (type == protocol::T_CALL) {
+      return channel_->registerCall(this);
+    }
+    return 0;
+  }
+
+  void write(const uint8_t* buf, uint32_t len) { out_.insert(out_.end(), buf, buf + len); }
+
+  void flush() override {
+    channel_->send(out_);
+    out_.resize(FRAME_HEADER_SIZE);
+  }
+
+  uint32_t read(uint8_t* buf, uint32_t len) {
+    awaitReply();
+    uint32_t give = (std::min)(len, static_cast<uint32_t>(in_.size() - rpos_));
+    countConsumedMessageBytes(give);
+    std::memcpy(buf, in_.data() + rpos_, give);
+    rpos_ += give;
+    return give;
+  }
+
+  const uint8_t* borrow(uint8_t* buf, uint32_t* len) {
+    (void)buf;
+    awaitReply();
+    uint32_t available = static_cast<uint32_t>(in_.size() - rpos_);
+    if (available < *len) {
+      return nullptr;
+    }
+    *len = available;
+    return in_.data() + rpos_;
+  }
+
+  void consume(uint32_t len) {
+    if (len > in_.size() - rpos_) {
+      throw TTransportException(TTransportException::BAD_ARGS, "consume did not follow a borrow.");
+    }
+    countConsumedMessageBytes(len);
+    rpos_ += len;
+  }
+
+  uint32_t readEnd() override {
+    uint32_t bytes = static_cast<uint32_t>(rpos_);
+    reset();
+    return bytes;
+  }
+
+  /// Forgets any reply and request.  Only for a call that is not WAITING, so
+  /// that the reader thread does not touch it meanwhile.
+  void reset() {
+    out_.resize(FRAME_HEADER_SIZE);
+    in_.clear();
+    rpos_ = 0;
+    haveReply_ = false;
+  }
+
+private:
+  void awaitReply() {
+    if (!haveReply_) {
+      channel_->awaitReply(this);
+      haveReply_ = true;
+      resetConsumedMessageSize();
+      updateKnownMessageSize(static_cast<long>(in_.size()));
+    }
+  }
+
+  TConcurrentClientChannel* channel_;
+
+public:
+  // the rest are guarded by the channel's mutex while the call is WAITING
+  Monitor monitor_;
+  int32_t seqid_;
+  State state_;
+  std::vector<uint8_t> in_;
+
+private:
+  // only touched by the thread making the call
+  std::vector<uint8_t> out_;
+  size_t rpos_;
+  bool haveReply_;
+};
+
+/**
+ * Gives each message of a call the seqid the channel assigned it.
+ */
+class TConcurrentClientChannel::CallProtocol : public protocol::TProtocolDecorator {
+public:
+  CallProtocol(std::shared_ptr<TProtocol> protocol, Call* call)
+    : TProtocolDecorator(protocol), call_(call) {}
+
+  uint32_t writeMessageBegin_virt(const std::string& name,
+                                  const TMessageType messageType,
+                                  const int32_t seqid) override {
+    (void)seqid;
+    return TProtocolDecorator::writeMessageBegin_virt(name,
+                                                      messageType,
+                                                      call_->beginMessage(messageType));
+  }
+
+private:
+  Call* call_;
+};
+
+struct TConcurrentClientChannel::Slot {
+  std::shared_ptr<Call> call;
+  std::shared_ptr<TProtocol> protocol;
+};
+
+class TConcurrentClientChannel::Reader : public concurrency::Runnable {
+public:
+  Reader(TConcurrentClientChannel* channel) : channel_(channel) {}
+
+  void run() override { channel_->readReplies(); }
+
+private:
+  TConcurrentClientChannel* channel_;
+};
+
+TConcurrentClientChannel::TConcurrentClientChannel(
+    std::shared_ptr<transport::TTransport> transport,
+    std::shared_ptr<protocol::TProtocolFactory> protocolFactory)
+  : transport_(transport),
+    protocolFactory_(protocolFactory),
+    recvTimeout_(0),
+    stopping_(false),
+    nextSeqId_(1) {
+  if (!transport_->isOpen()) {
+    transport_->open();
+  }
+  concurrency::ThreadFactory threadFactory(false);
+  readerThread_ = threadFactory.newThread(std::make_shared<Reader>(this));
+  readerThread_->start();
+}
+
+TConcurrentClientChannel::~TConcurrentClientChannel() {
+  {
+    Guard g(mutex_);
+    stopping_ = true;
+  }
+  // Wake the reader from its read.  Shutting a socket down leaves it open,
+  // so unlike closing it does not change the socket under the reader.
+  std::shared_ptr<transport::TSocket> socket
+      = std::dynamic_pointer_cast<transport::TSocket>(transport_);
+  if (socket) {
+    ::shutdown(socket->getSocketFD(), THRIFT_SHUT_RDWR);
+  } else {
+    try {
+      transport_->close();
+    } catch (const TException&) {
+    }
+  }
+  readerThread_->join();
+
+  try {
+    transport_->close();
+  } catch (const TException&) {
+  }
+  for (Slot* slot : freeSlots_) {
+    delete slot;
+  }
+}
+
+bool TConcurrentClientChannel::isOpen() const {
+  Guard g(mutex_);
+  return !stopping_ && failure_.empty();
+}
+
+bool TConcurrentClientChannel::error() const {
+  Guard g(mutex_);
+  return !failure_.empty();
+}
+
+size_t TConcurrentClientChannel::getPendingCount() const {
+  Guard g(mutex_);
+  return pending_.size() + asyncPending_.size();
+}
+
+std::shared_ptr<TProtocol> TConcurrentClientChannel::getProtocol() {
+  Slot* slot = nullptr;
+  {
+    Guard g(mutex_);
+    if (!freeSlots_.empty()) {
+      slot = freeSlots_.back();
+      freeSlots_.pop_back();
+    }
+  }
+  if (!slot) {
+    slot = new Slot();
+    slot->call = std::make_shared<Call>(this);
+    slot->protocol = std::make_shared<CallProtocol>(protocolFactory_->getProtocol(slot->call),
+                                                    slot->call.get());
+  }
+  std::shared_ptr<Slot> lease(slot, [this](Slot* s) { release(s); });
+  return std::shared_ptr<TProtocol>(lease, slot->protocol.get());
+}
+
+void TConcurrentClientChannel::release(Slot* slot) {
+  Guard g(mutex_);
+  Call* call = slot->call.get();
+  if (call->state_ == Call::WAITING) {
+    // sent without waiting for the reply, which will be dropped
+    pending_.erase(call->seqid_);
+  }
+  call->state_ = Call::IDLE;
+  call->reset();
+  freeSlots_.push_back(slot);
+}
+
+int32_t TConcurrentClientChannel::nextSeqId() {
+  // Count in unsigned arithmetic so the id wraps instead of overflowing.
+  int32_t seqid = static_cast<int32_t>(nextSeqId_);
+  while (pending_.count(seqid) || asyncPending_.count(seqid)) {
+    seqid = static_cast<int32_t>(++nextSeqId_);
+  }
+  ++nextSeqId_;
+  return seqid;
+}
+
+int32_t TConcurrentClientChannel::registerCall(Call* call) {
+  Guard g(mutex_);
+  if (!failure_.empty()) {
+    throw TTransportException(TTransportException::NOT_OPEN, failure_);
+  }
+  if (call->state_ == Call::WAITING) {
+    pending_.erase(call->seqid_);
+  }
+  int32_t seqid = nextSeqId();
+  pending_[seqid] = call;
+  call->seqid_ = seqid;
+  call->state_ = Call::WAITING;
+  return seqid;
+}
+
+void TConcurrentClientChannel::awaitReply(Call* call) {
+  Synchronized s(call->monitor_);
+  if (call->state_ == Call::IDLE) {
+    throw TTransportException(TTransportException::BAD_ARGS, "no call is awaiting a reply");
+  }
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(recvTimeout_);
+  while (call->state_ == Call::WAITING) {
+    if (recvTimeout_ <= 0) {
+      call->monitor_.waitForever();
+    } else if (call->monitor_.waitForTime(deadline) == THRIFT_ETIMEDOUT
+               && call->state_ == Call::WAITING) {
+      pending_.erase(call->seqid_);
+      call->state_ = Call::IDLE;
+      throw TTransportException(TTransportException::TIMED_OUT, "timed out waiting for the reply");
+    }
+  }
+  Call::State state = call->state_;
+  call->state_ = Call::IDLE;
+  if (state == Call::FAILED) {
+    throw TTransportException(TTransportException::NOT_OPEN, failure_);
+  }
+}
+
+void TConcurrentClientChannel::sendMessage(const VoidCallback& cob, TMemoryBuffer* message) {
+  std::vector<uint8_t> frame;
+  frameMessage(message, 0, frame);
+  {
+    Guard g(mutex_);
+    if (!failure_.empty()) {
+      throw TTransportException(TTransportException::NOT_OPEN, failure_);
+    }
+  }
+  send(frame);
+  cob();
+}
+
+void TConcurrentClientChannel::recvMessage(const VoidCallback& cob, TMemoryBuffer* message) {
+  (void)cob;
+  (void)message;
+  throw TProtocolException(TProtocolException::NOT_IMPLEMENTED,
+                           "Unexpected call to TConcurrentClientChannel::recvMessage");
+}
+
+void TConcurrentClientChannel::sendAndRecvMessage(const VoidCallback& cob,
+                                                  TMemoryBuffer* sendBuf,
+                                                  TMemoryBuffer* recvBuf) {
+  recvBuf->resetBuffer();
+  int32_t seqid;
+  {
+    Guard g(mutex_);
+    if (!failure_.empty()) {
+      throw TTransportException(TTransportException::NOT_OPEN, failure_);
+    }
+    seqid = nextSeqId();
+    asyncPending_[seqid] = AsyncCall{cob, recvBuf};
+  }
+  std::vector<uint8_t> frame;
+  try {
+    frameMessage(sendBuf, seqid, frame);
+  } catch (...) {
+    Guard g(mutex_);
+    asyncPending_.erase(seqid);
+    throw;
+  }
+  try {
+    send(frame);
+  } catch (const TException&) {
+    // the failure has run cob already
+  }
+}
+
+void TConcurrentClientChannel::frameMessage(TMemoryBuffer* message,
+                                            int32_t seqid,
+                                            std::vector<uint8_t>& frame) {
+  uint8_t* buf;
+  uint32_t size;
+  message->getBuffer(&buf, &size);
+
+  // Read the message header to find where it ends, and write it again
+  // with the new seqid
+  std::string name;
+  TMessageType type;
+  int32_t oldSeqid;
+  std::shared_ptr<TMemoryBuffer> in(new TMemoryBuffer(buf, size, TMemoryBuffer::OBSERVE));
+  protocolFactory_->getProtocol(in)->readMessageBegin(name, type, oldSeqid);
+  uint32_t headerSize = size - in->available_read();
+
+  std::shared_ptr<TMemoryBuffer> out(new TMemoryBuffer(headerSize + 16));
+  protocolFactory_->getProtocol(out)->writeMessageBegin(name, type, seqid);
+  uint8_t* header;
+  uint32_t newHeaderSize;
+  out->getBuffer(&header, &newHeaderSize);
+
+  frame.reserve(FRAME_HEADER_SIZE + newHeaderSize + size - headerSize);
+  frame.resize(FRAME_HEADER_SIZE);
+  frame.insert(frame.end(), header, header + newHeaderSize);
+  frame.insert(frame.end(), buf + headerSize, buf + size);
+}
+
+void TConcurrentClientChannel::send(std::vector<uint8_t>& frame) {
+  uint32_t size = htonl(static_cast<uint32_t>(frame.size() - FRAME_HEADER_SIZE));
+  std::memcpy(frame.data(), &size, FRAME_HEADER_SIZE);
+  try {
+    Guard g(writeMutex_);
+    transport_->write(frame.data(), static_cast<uint32_t>(frame.size()));
+    transport_->flush();
+  } catch (const TException& e) {
+    // part of a frame may have been written, so the connection is lost
+    fail(std::string("write failed: ") + e.what());
+    throw;
+  }
+}
+
+void TConcurrentClientChannel::readReplies() {
+  std::vector<uint8_t> frame;
+  std::string fname;
+  TMessageType mtype;
+  int32_t seqid;
+  try {
+    while (true) {
+      uint32_t size;
+      transport_->readAll(reinterpret_cast<uint8_t*>(&size), FRAME_HEADER_SIZE);
+      size = ntohl(size);
+      if (static_cast<int32_t>(size) < 0
+          || size > static_cast<uint32_t>(transport_->getConfiguration()->getMaxFrameSize())) {
+        throw TTransportException(TTransportException::CORRUPTED_DATA,
+                                  "reply frame size is out of range");
+      }
+      frame.resize(size);
+      transport_->readAll(frame.data(), size);
+
+      std::shared_ptr<TProtocol> peek = protocolFactory_->getProtocol(
+          std::make_shared<TMemoryBuffer>(frame.data(), size, TMemoryBuffer::OBSERVE));
+      peek->readMessageBegin(fname, mtype, seqid);
+
+      AsyncCall async;
+      {
+        Guard g(mutex_);
+        auto it = pending_.find(seqid);
+        if (it != pending_.end()) {
+          Call* call = it->second;
+          pending_.erase(it);
+          call->in_.swap(frame);
+          call->state_ = Call::READY;
+          call->monitor_.notify();
+          continue;
+        }
+        auto ait = asyncPending_.find(seqid);
+        if (ait == asyncPending_.end()) {
+          // its call timed out or was released
+          continue;
+        }
+        async = std::move(ait->second);
+        asyncPending_.erase(ait);
+      }
+      async.recvBuf->resetBuffer();
+      async.recvBuf->write(frame.data(), size);
+      complete(async);
+    }
+  } catch (const TException& e) {
+    bool stopping;
+    {
+      Guard g(mutex_);
+      stopping = stopping_;
+    }
+    fail(stopping ? std::string("channel closed") : std::string("read failed: ") + e.what());
+  }
+}
+
+void TConcurrentClientChannel::fail(const std::string& reason) {
+  std::unordered_map<int32_t, AsyncCall> failed;
+  {
+    Guard g(mutex_);
+    if (failure_.empty()) {
+      failure_ = reason;
+    }
+    for (auto& entry : pending_) {
+      entry.second->state_ = Call::FAILED;
+      entry.second->monitor_.notify();
+    }
+    pending_.clear();
+    failed.swap(asyncPending_);
+  }
+  for (auto& entry : failed) {
+    entry.second.recvBuf->resetBuffer();
+    complete(entry.second);
+  }
+}
+
+void TConcurrentClientChannel::complete(AsyncCall& async) {
+  try {
+    async.cob();
+  } catch (const std::exception& e) {
+    GlobalOutput.printf("TConcurrentClientChannel: callback threw: %s", e.what());
+  } catch (...) {
+    GlobalOutput("TConcurrentClientChannel: callback threw an unknown exception");
+  }
+}
+}
+}
+} // apache::thrift::async
@@ -0,0 +1,190 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _THRIFT_ASYNC_TCONCURRENTCLIENTCHANNEL_H_
+#define _THRIFT_ASYNC_TCONCURRENTCLIENTCHANNEL_H_ 1
+
+#include <thrift/TNonCopyable.h>
+#include <thrift/async/TAsyncChannel.h>
+#include <thrift/concurrency/Mutex.h>
+#include <thrift/concurrency/Thread.h>
+#include <thrift/protocol/TProtocol.h>
+#include <thrift/transport/TTransport.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace apache {
+namespace thrift {
+namespace async {
+
+/**
+ * One connection shared by the calls of many threads at once, with each
+ * reply handed to its call by seqid in whatever order the server sends them.
+ *
+ * Where TConcurrentClientSyncInfo has the waiting callers take turns reading
+ * the connection, here a reader thread owned by the channel reads every reply
+ * frame whole and passes it to the call waiting for its seqid, waking that
+ * caller alone.  Callers only wait on one another to write a frame, so
+ * hundreds of calls can be in flight on one socket.
+ *
+ * Calls are made through ordinary generated clients (not the "concurrent"
+ * style), each bound to a slot of the channel: a buffer for the request, one
+ * for the reply and a monitor to wait on, taken from a pool and returned to
+ * it when the client is released.
+ *
+ *   std::shared_ptr<TSocket> socket(new TSocket(host, port));
+ *   TConcurrentClientChannel channel(socket, protocolFactory);
+ *   ...
+ *   // in any thread
+ *   std::shared_ptr<CalculatorClient> client = channel.getClient<CalculatorClient>();
+ *   client->add(1, 2);
+ *
+ * Like any generated client, each makes one call at a time, possibly split
+ * into send_ and recv_ to do other work while the call is in flight; use a
+ * client per call to have many in flight.  The channel frames every message
+ * as TFramedTransport does, so the transport given is the bare connection and
+ * the server must use framing.  Every client must be released before the
+ * channel is destroyed.
+ *
+ * The channel is also a TAsyncChannel for cob_style clients, which may have
+ * any number of calls out without a thread waiting on each: the seqid of
+ * every request is replaced with one of the channel's, and the callback runs
+ * on the reader thread once the reply is in the receive buffer.  If the
+ * connection is lost it runs with the buffer empty, so the client's recv_
+ * throws.  Callbacks must not make blocking calls through the channel, and
+ * the receive timeout does not apply to them.
+ */
+class TConcurrentClientChannel : public TAsyncChannel, apache::thrift::TNonCopyable {
+public:
+  /**
+   * Opens transport if it is not open and starts the reader thread.
+   */
+  TConcurrentClientChannel(std::shared_ptr<transport::TTransport> transport,
+                           std::shared_ptr<protocol::TProtocolFactory> protocolFactory);
+
+  /**
+   * Stops the reader thread, then closes the transport.  A TSocket is shut
+   * down to wake the reader; any other transport is closed to do so, so its
+   * close() must be safe to call while another thread reads from it.
+   */
+  ~TConcurrentClientChannel();
+
+  /**
+   * Gets a protocol for one client to call through, bound to a slot of its own
+   * until the last reference to it is released.
+   */
+  std::shared_ptr<protocol::TProtocol> getProtocol();
+
+  /**
+   * Makes a Client_ on a protocol from getProtocol().
+   */
+  template <class Client_>
+  std::shared_ptr<Client_> getClient() {
+    return std::make_shared<Client_>(getProtocol());
+  }
+
+  /**
+   * Sets how long a call waits for its reply, in milliseconds, before it
+   * throws TTransportException::TIMED_OUT; 0, the default, waits forever.
+   * A reply that arrives after its call timed out is dropped.
+   */
+  void setRecvTimeout(int64_t timeoutMs) { recvTimeout_ = timeoutMs; }
+  int64_t getRecvTimeout() const { return recvTimeout_; }
+
+  /**
+   * Whether the connection is still usable.  Once reading or writing it fails,
+   * every waiting call and every later one throws
+   * TTransportException::NOT_OPEN.
+   */
+  bool isOpen() const;
+
+  /// Calls waiting for their replies
+  size_t getPendingCount() const;
+
+  bool good() const override { return isOpen(); }
+  bool error() const override;
+  bool timedOut() const override { return false; }
+
+  /**
+   * Sends a oneway message, running cob once it is written.
+   */
+  void sendMessage(const VoidCallback& cob, transport::TMemoryBuffer* message) override;
+
+  /**
+   * Not supported: a reply is only matched to the request it answers.
+   */
+  void recvMessage(const VoidCallback& cob, transport::TMemoryBuffer* message) override;
+
+  /**
+   * Sends a call and runs cob on the reader thread with the reply in
+   * recvBuf, or with recvBuf empty if the connection is lost first.
+   */
+  void sendAndRecvMessage(const VoidCallback& cob,
+                          transport::TMemoryBuffer* sendBuf,
+                          transport::TMemoryBuffer* recvBuf) override;
+
+private:
+  class Call;
+  class CallProtocol;
+  class Reader;
+  struct Slot;
+
+  struct AsyncCall {
+    VoidCallback cob;
+    transport::TMemoryBuffer* recvBuf;
+  };
+
+  int32_t nextSeqId();
+  int32_t registerCall(Call* call);
+  void frameMessage(transport::TMemoryBuffer* message,
+                    int32_t seqid,
+                    std::vector<uint8_t>& frame);
+  void awaitReply(Call* call);
+  void send(std::vector<uint8_t>& frame);
+  void readReplies();
+  void fail(const std::string& reason);
+  void complete(AsyncCall& async);
+  void release(Slot* slot);
+
+  std::shared_ptr<transport::TTransport> transport_;
+  std::shared_ptr<protocol::TProtocolFactory> protocolFactory_;
+  int64_t recvTimeout_;
+
+  /// Held while writing a frame
+  concurrency::Mutex writeMutex_;
+
+  /// Guards everything below, and the state of every Call
+  concurrency::Mutex mutex_;
+  bool stopping_;
+  std::string failure_;
+  uint32_t nextSeqId_;
+  std::unordered_map<int32_t, Call*> pending_;
+  std::unordered_map<int32_t, AsyncCall> asyncPending_;
+  std::vector<Slot*> freeSlots_;
+
+  std::shared_ptr<concurrency::Thread> readerThread_;
+};
+}
+}
+} // apache::thrift::async
+
+#endif // #ifndef _THRIFT_ASYNC_TCONCURRENTCLIENTCHANNEL_H_
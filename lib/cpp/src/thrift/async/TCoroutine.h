@@ -0,0 +1,469 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _THRIFT_ASYNC_TCOROUTINE_H_
+#define _THRIFT_ASYNC_TCOROUTINE_H_ 1
+
+/*
+ * C++20 coroutine support for the code generated with cpp:coroutines.
+ *
+ * A coroutine handler implements FooCoroIf, whose methods return a
+ * TTask<R>, and is served by wrapping it in a FooCoroSvIfAdapter and that in
+ * a FooAsyncProcessor, e.g. on a TNonblockingServer given the processor.
+ * FooCoroClient makes calls through any TAsyncChannel, such as a
+ * TConcurrentClientChannel, and is what a handler co_awaits to call other
+ * services without holding a thread while they answer:
+ *
+ *   TTask<int32_t> total(int32_t a, int32_t b) override {
+ *     std::vector<TTask<int32_t> > calls;
+ *     calls.push_back(backend_->square(a));
+ *     calls.push_back(backend_->square(b));
+ *     std::vector<int32_t> squares = co_await whenAll(std::move(calls));
+ *     co_return squares[0] + squares[1];
+ *   }
+ *
+ * Tasks are lazy: a call is sent when its task is awaited, and whenAll
+ * awaits its tasks all at once.
+ *
+ * A coroutine carries on in whichever thread completes what it awaits: the
+ * reader thread of the channel a reply arrived on, or the server's IO thread
+ * if nothing was waited for.  Nothing here is defined unless the compiler
+ * supports coroutines, which THRIFT_HAS_COROUTINES then says.
+ */
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+#define THRIFT_HAS_COROUTINES 1
+
+#include <thrift/TApplicationException.h>
+#include <thrift/TOutput.h>
+#include <thrift/Thrift.h>
+#include <thrift/async/TAsyncChannel.h>
+#include <thrift/concurrency/Monitor.h>
+#include <thrift/concurrency/Mutex.h>
+#include <thrift/protocol/TProtocol.h>
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace apache {
+namespace thrift {
+namespace async {
+
+template <class T>
+class TTask;
+
+namespace detail {
+
+class TTaskPromiseBase {
+public:
+  struct FinalAwaiter {
+    bool await_ready() noexcept { return false; }
+
+    template <class Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+      std::coroutine_handle<> continuation = handle.promise().continuation_;
+      return continuation ? continuation : std::noop_coroutine();
+    }
+
+    void await_resume() noexcept {}
+  };
+
+  std::suspend_always initial_suspend() noexcept { return {}; }
+  FinalAwaiter final_suspend() noexcept { return {}; }
+  void unhandled_exception() noexcept { exception_ = std::current_exception(); }
+
+  std::coroutine_handle<> continuation_;
+
+protected:
+  void rethrowIfFailed() {
+    if (exception_) {
+      std::rethrow_exception(exception_);
+    }
+  }
+
+private:
+  std::exception_ptr exception_;
+};
+
+template <class T>
+class TTaskPromise : public TTaskPromiseBase {
+public:
+  TTask<T> get_return_object() noexcept;
+
+  template <class U>
+  void return_value(U&& value) {
+    value_.emplace(std::forward<U>(value));
+  }
+
+  T result() {
+    rethrowIfFailed();
+    return std::move(*value_);
+  }
+
+private:
+  std::optional<T> value_;
+};
+
+template <>
+class TTaskPromise<void> : public TTaskPromiseBase {
+public:
+  TTask<void> get_return_object() noexcept;
+
+  void return_void() noexcept {}
+
+  void result() { rethrowIfFailed(); }
+};
+
+/**
+ * The coroutine type of the functions that start a task and hand its
+ * outcome on: it runs at once and frees itself when done.
+ */
+struct TDetachedTask {
+  struct promise_type {
+    TDetachedTask get_return_object() noexcept { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept { std::terminate(); }
+  };
+};
+
+/**
+ * Carries an exception a coroutine threw to a cob_style exn_cob.
+ */
+class TExceptionPtrWrapper : public TDelayedException {
+public:
+  TExceptionPtrWrapper(std::exception_ptr exception) : exception_(exception) {}
+
+  void throw_it() override {
+    std::exception_ptr exception = exception_;
+    delete this;
+    std::rethrow_exception(exception);
+  }
+
+private:
+  std::exception_ptr exception_;
+};
+
+/**
+ * The exception being handled as a TDelayedException; one that is not a
+ * std::exception becomes a TApplicationException, which the async
+ * processors can report.
+ */
+inline TDelayedException* delayCurrentException() {
+  try {
+    throw;
+  } catch (const std::exception&) {
+    return new TExceptionPtrWrapper(std::current_exception());
+  } catch (...) {
+    return TDelayedException::delayException(
+        TApplicationException(TApplicationException::UNKNOWN, "unknown exception"));
+  }
+}
+}
+
+/**
+ * The result of a coroutine, which co_awaiting starts and waits for.  A task
+ * is lazy, so it runs no further than its first co_await until it is itself
+ * awaited, and can be awaited once.
+ */
+template <class T>
+class TTask {
+public:
+  typedef detail::TTaskPromise<T> promise_type;
+
+  TTask(TTask&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+
+  TTask& operator=(TTask&& other) noexcept {
+    if (this != &other) {
+      if (handle_) {
+        handle_.destroy();
+      }
+      handle_ = std::exchange(other.handle_, nullptr);
+    }
+    return *this;
+  }
+
+  ~TTask() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  bool await_ready() const noexcept { return !handle_ || handle_.done(); }
+
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+    handle_.promise().continuation_ = awaiting;
+    return handle_;
+  }
+
+  T await_resume() { return handle_.promise().result(); }
+
+private:
+  friend class detail::TTaskPromise<T>;
+
+  explicit TTask(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+template <class T>
+TTask<T> detail::TTaskPromise<T>::get_return_object() noexcept {
+  return TTask<T>(std::coroutine_handle<TTaskPromise<T> >::from_promise(*this));
+}
+
+inline TTask<void> detail::TTaskPromise<void>::get_return_object() noexcept {
+  return TTask<void>(std::coroutine_handle<TTaskPromise<void> >::from_promise(*this));
+}
+
+/**
+ * Awaits a callback: start is called with a function to call when the work
+ * it starts is done, and the coroutine carries on from there, in the thread
+ * that calls it.  If it is called before start returns the coroutine simply
+ * carries on.
+ */
+template <class Start>
+class TCallbackAwaiter {
+public:
+  explicit TCallbackAwaiter(Start start) : start_(std::move(start)), done_(false) {}
+
+  bool await_ready() const noexcept { return false; }
+
+  bool await_suspend(std::coroutine_handle<> handle) {
+    handle_ = handle;
+    start_([this] {
+      // whichever of the callback and await_suspend comes second resumes
+      if (done_.exchange(true, std::memory_order_acq_rel)) {
+        handle_.resume();
+      }
+    });
+    return !done_.exchange(true, std::memory_order_acq_rel);
+  }
+
+  void await_resume() const noexcept {}
+
+private:
+  Start start_;
+  std::atomic<bool> done_;
+  std::coroutine_handle<> handle_;
+};
+
+template <class Start>
+TCallbackAwaiter<Start> awaitCallback(Start start) {
+  return TCallbackAwaiter<Start>(std::move(start));
+}
+
+/**
+ * Awaits every one of tasks at once, and gives their results in the same
+ * order once all are done.  If any throws, one of those exceptions is
+ * rethrown once all are done.
+ */
+template <class T>
+TTask<std::vector<T> > whenAll(std::vector<TTask<T> > tasks) {
+  std::vector<std::optional<T> > results(tasks.size());
+  std::exception_ptr exception;
+  concurrency::Mutex exceptionMutex;
+
+  if (!tasks.empty()) {
+    co_await awaitCallback([&](std::function<void()> done) {
+      auto remaining = std::make_shared<std::atomic<size_t> >(tasks.size());
+      for (size_t ix = 0; ix < tasks.size(); ix++) {
+        [](TTask<T> task, std::optional<T>& result, std::exception_ptr& exception,
+           concurrency::Mutex& exceptionMutex, std::shared_ptr<std::atomic<size_t> > remaining,
+           std::function<void()> done) -> detail::TDetachedTask {
+          try {
+            result.emplace(co_await std::move(task));
+          } catch (...) {
+            concurrency::Guard g(exceptionMutex);
+            exception = std::current_exception();
+          }
+          if (remaining->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            done();
+          }
+        }(std::move(tasks[ix]), results[ix], exception, exceptionMutex, remaining, done);
+      }
+    });
+  }
+
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+  std::vector<T> values;
+  values.reserve(results.size());
+  for (std::optional<T>& result : results) {
+    values.push_back(std::move(*result));
+  }
+  co_return values;
+}
+
+/**
+ * Runs task to completion, then calls cob with its result, or exnCob with
+ * what it threw.  This is how FooCoroSvIfAdapter answers a cob_style call.
+ */
+template <class T, class Cob, class ExnCob>
+detail::TDetachedTask completeTask(TTask<T> task, Cob cob, ExnCob exnCob) {
+  TDelayedException* error = nullptr;
+  if constexpr (std::is_void<T>::value) {
+    try {
+      co_await std::move(task);
+    } catch (...) {
+      error = detail::delayCurrentException();
+    }
+    if (!error) {
+      cob();
+    }
+  } else {
+    std::optional<T> result;
+    try {
+      result.emplace(co_await std::move(task));
+    } catch (...) {
+      error = detail::delayCurrentException();
+    }
+    if (!error) {
+      cob(*result);
+    }
+  }
+  if (error) {
+    exnCob(error);
+  }
+}
+
+/**
+ * Runs task to completion, then calls cob, for oneway calls, which have
+ * nobody to report an exception to.
+ */
+template <class Cob>
+detail::TDetachedTask completeTask(TTask<void> task, Cob cob) {
+  try {
+    co_await std::move(task);
+  } catch (const std::exception& e) {
+    GlobalOutput.printf("oneway coroutine threw: %s", e.what());
+  } catch (...) {
+    GlobalOutput("oneway coroutine threw an unknown exception");
+  }
+  cob();
+}
+
+/**
+ * Runs task to completion from code that is not a coroutine, blocking the
+ * calling thread until it is done, and returns its result.
+ */
+template <class T>
+T syncWait(TTask<T> task) {
+  concurrency::Monitor monitor;
+  bool done = false;
+  std::optional<std::conditional_t<std::is_void<T>::value, bool, T> > result;
+  std::exception_ptr exception;
+
+  [](TTask<T> task, concurrency::Monitor& monitor, bool& done, auto& result,
+     std::exception_ptr& exception) -> detail::TDetachedTask {
+    try {
+      if constexpr (std::is_void<T>::value) {
+        co_await std::move(task);
+        result.emplace(true);
+      } else {
+        result.emplace(co_await std::move(task));
+      }
+    } catch (...) {
+      exception = std::current_exception();
+    }
+    concurrency::Synchronized s(monitor);
+    done = true;
+    monitor.notify();
+  }(std::move(task), monitor, done, result, exception);
+
+  concurrency::Synchronized s(monitor);
+  while (!done) {
+    monitor.waitForever();
+  }
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+  if constexpr (!std::is_void<T>::value) {
+    return std::move(*result);
+  }
+}
+
+/**
+ * Lends out cob_style clients of one channel, making one when none is free.
+ * A cob_style client has one request and one reply buffer, so it makes one
+ * call at a time; FooCoroClient takes one for each call.
+ */
+template <class Client_>
+class TCobClientPool {
+public:
+  TCobClientPool(std::shared_ptr<TAsyncChannel> channel,
+                 protocol::TProtocolFactory* protocolFactory)
+    : state_(std::make_shared<State>()) {
+    state_->channel = channel;
+    state_->protocolFactory = protocolFactory;
+  }
+
+  /**
+   * Takes a client, which returns to the pool when the last reference to it
+   * is released.
+   */
+  std::shared_ptr<Client_> acquire() {
+    Client_* client = nullptr;
+    {
+      concurrency::Guard g(state_->mutex);
+      if (!state_->free.empty()) {
+        client = state_->free.back().release();
+        state_->free.pop_back();
+      }
+    }
+    if (!client) {
+      client = new Client_(state_->channel, state_->protocolFactory);
+    }
+    std::shared_ptr<State> state = state_;
+    return std::shared_ptr<Client_>(client, [state](Client_* released) {
+      concurrency::Guard g(state->mutex);
+      state->free.emplace_back(released);
+    });
+  }
+
+  std::shared_ptr<TAsyncChannel> getChannel() const { return state_->channel; }
+
+private:
+  struct State {
+    std::shared_ptr<TAsyncChannel> channel;
+    protocol::TProtocolFactory* protocolFactory;
+    concurrency::Mutex mutex;
+    std::vector<std::unique_ptr<Client_> > free;
+  };
+
+  // shared with the clients lent out, which may come back after the pool
+  // is gone
+  std::shared_ptr<State> state_;
+};
+}
+}
+} // apache::thrift::async
+
+#endif // __cpp_impl_coroutine
+
+#endif // #ifndef _THRIFT_ASYNC_TCOROUTINE_H_
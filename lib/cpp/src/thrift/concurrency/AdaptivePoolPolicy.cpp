@@ -0,0 +1,252 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <thrift/thrift-config.h>
+
+#include <thrift/concurrency/AdaptivePoolPolicy.h>
+#include <thrift/concurrency/Exception.h>
+#include <thrift/concurrency/ThreadFactory.h>
+#include <thrift/TOutput.h>
+
+#include <algorithm>
+#include <chrono>
+
+namespace apache {
+namespace thrift {
+namespace concurrency {
+
+using std::shared_ptr;
+
+/**
+ * A task that records how long it waited in the queue.
+ */
+class AdaptivePoolPolicy::Probe : public Runnable {
+
+public:
+  Probe() : queued_(std::chrono::steady_clock::now()), latencyUs_(-1) {}
+
+  void run() override { latencyUs_ = age(); }
+
+  int64_t age() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now()
+                                                                 - queued_).count();
+  }
+
+  const std::chrono::steady_clock::time_point queued_;
+
+  /// -1 until run
+  std::atomic<int64_t> latencyUs_;
+};
+
+/**
+ * Samples the thread manager every interval until the policy is stopped.
+ */
+class AdaptivePoolPolicy::Sampler : public Runnable {
+
+public:
+  Sampler(AdaptivePoolPolicy* policy) : policy_(policy) {}
+
+  void run() override {
+    for (;;) {
+      {
+        Synchronized s(policy_->monitor_);
+        auto due = std::chrono::steady_clock::now()
+                   + std::chrono::milliseconds(policy_->interval_);
+        while (policy_->running_ && std::chrono::steady_clock::now() < due) {
+          policy_->monitor_.waitForTime(due);
+        }
+        if (!policy_->running_) {
+          return;
+        }
+      }
+
+      try {
+        policy_->sample();
+      } catch (const TException& e) {
+        GlobalOutput.printf("AdaptivePoolPolicy: sample failed: %s", e.what());
+      }
+    }
+  }
+
+private:
+  AdaptivePoolPolicy* policy_;
+};
+
+AdaptivePoolPolicy::AdaptivePoolPolicy(shared_ptr<ThreadManager> threadManager,
+                                       size_t minWorkers,
+                                       size_t maxWorkers)
+  : threadManager_(threadManager),
+    minWorkers_(minWorkers),
+    maxWorkers_(maxWorkers),
+    interval_(100),
+    latencyTarget_(10),
+    growDelay_(1),
+    shrinkDelay_(10),
+    running_(false),
+    growVotes_(0),
+    shrinkVotes_(0),
+    sampleCount_(0),
+    growCount_(0),
+    workersAdded_(0),
+    shrinkCount_(0),
+    workersRemoved_(0),
+    lastLatencyUs_(0) {
+  if (!threadManager_ || minWorkers_ == 0 || minWorkers_ > maxWorkers_) {
+    throw InvalidArgumentException();
+  }
+}
+
+AdaptivePoolPolicy::~AdaptivePoolPolicy() {
+  try {
+    stop();
+  } catch (...) {
+    // do nothing
+  }
+}
+
+void AdaptivePoolPolicy::setInterval(int64_t interval) {
+  if (interval <= 0) {
+    throw InvalidArgumentException();
+  }
+  interval_ = interval;
+}
+
+void AdaptivePoolPolicy::setLatencyTarget(int64_t latencyTarget) {
+  if (latencyTarget < 0) {
+    throw InvalidArgumentException();
+  }
+  latencyTarget_ = latencyTarget;
+}
+
+void AdaptivePoolPolicy::setGrowDelay(size_t growDelay) {
+  if (growDelay == 0) {
+    throw InvalidArgumentException();
+  }
+  growDelay_ = growDelay;
+}
+
+void AdaptivePoolPolicy::setShrinkDelay(size_t shrinkDelay) {
+  if (shrinkDelay == 0) {
+    throw InvalidArgumentException();
+  }
+  shrinkDelay_ = shrinkDelay;
+}
+
+void AdaptivePoolPolicy::start() {
+  Synchronized s(monitor_);
+  if (running_) {
+    throw IllegalStateException("AdaptivePoolPolicy::start already started");
+  }
+
+  size_t workerCount = threadManager_->workerCount();
+  if (workerCount < minWorkers_) {
+    threadManager_->addWorker(minWorkers_ - workerCount);
+  }
+
+  growVotes_ = 0;
+  shrinkVotes_ = 0;
+  probe_.reset();
+
+  running_ = true;
+  thread_ = ThreadFactory(false).newThread(shared_ptr<Runnable>(new Sampler(this)));
+  thread_->start();
+}
+
+void AdaptivePoolPolicy::stop() {
+  shared_ptr<Thread> thread;
+  {
+    Synchronized s(monitor_);
+    if (!running_) {
+      return;
+    }
+    running_ = false;
+    monitor_.notifyAll();
+    thread.swap(thread_);
+  }
+  thread->join();
+}
+
+int64_t AdaptivePoolPolicy::probeLatency(size_t pendingCount, size_t idleCount, size_t workerCount) {
+  int64_t latencyUs = 0;
+  if (probe_) {
+    int64_t ran = probe_->latencyUs_;
+    if (ran >= 0) {
+      latencyUs = ran;
+      probe_.reset();
+    } else if (pendingCount == 0 && idleCount == workerCount) {
+      // nothing is queued or running, so the probe was removed or expired
+      probe_.reset();
+    } else {
+      // still waiting, and has waited at least this long
+      latencyUs = probe_->age();
+    }
+  }
+
+  if (!probe_) {
+    probe_.reset(new Probe());
+    // With a timeout of -1 the add gives up rather than wait, both when the
+    // queue is full and when the manager's mutex is busy; either way the
+    // probe is skipped this time and the sample goes ahead without it.
+    try {
+      threadManager_->add(probe_, -1LL);
+    } catch (const TooManyPendingTasksException&) {
+      probe_.reset();
+    } catch (const TimedOutException&) {
+      probe_.reset();
+    }
+  }
+  return latencyUs;
+}
+
+void AdaptivePoolPolicy::sample() {
+  size_t workerCount = threadManager_->workerCount();
+  size_t idleCount = threadManager_->idleWorkerCount();
+  size_t pendingCount = threadManager_->pendingTaskCount();
+  int64_t latencyUs = probeLatency(pendingCount, idleCount, workerCount);
+
+  lastLatencyUs_ = latencyUs;
+  ++sampleCount_;
+
+  int64_t targetUs = latencyTarget_ * 1000;
+  size_t backlog = pendingCount > idleCount ? pendingCount - idleCount : 0;
+  bool slow = targetUs > 0 && latencyUs > targetUs;
+  bool slack = pendingCount == 0 && idleCount > 0 && (targetUs == 0 || latencyUs * 2 <= targetUs);
+
+  growVotes_ = (backlog > 0 || slow) ? growVotes_ + 1 : 0;
+  shrinkVotes_ = slack ? shrinkVotes_ + 1 : 0;
+
+  if (growVotes_ >= growDelay_ && workerCount < maxWorkers_) {
+    // take on the backlog, but no more than double at once
+    size_t count = (std::min)(maxWorkers_ - workerCount,
+                              (std::max)(size_t(1), (std::min)(backlog, workerCount)));
+    threadManager_->addWorker(count);
+    growVotes_ = 0;
+    ++growCount_;
+    workersAdded_ += count;
+  } else if (shrinkVotes_ >= shrinkDelay_ && workerCount > minWorkers_) {
+    size_t count = (std::min)(workerCount - minWorkers_, (std::max)(size_t(1), idleCount / 2));
+    threadManager_->removeWorker(count);
+    shrinkVotes_ = 0;
+    ++shrinkCount_;
+    workersRemoved_ += count;
+  }
+}
+}
+}
+} // apache::thrift::concurrency
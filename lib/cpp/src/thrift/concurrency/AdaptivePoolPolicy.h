@@ -0,0 +1,158 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _THRIFT_CONCURRENCY_ADAPTIVEPOOLPOLICY_H_
+#define _THRIFT_CONCURRENCY_ADAPTIVEPOOLPOLICY_H_ 1
+
+#include <thrift/concurrency/Monitor.h>
+#include <thrift/concurrency/ThreadManager.h>
+
+#include <atomic>
+#include <memory>
+
+namespace apache {
+namespace thrift {
+namespace concurrency {
+
+/**
+ * A pool policy that grows and shrinks the workers of a ThreadManager
+ * between a minimum and a maximum, so the pool need not be sized for peak
+ * load all the time.
+ *
+ * Every interval it samples the pending task count, the idle worker count
+ * and the queueing latency, which it measures by adding a small probe task
+ * and timing how long the task waits to run.  The pool grows when tasks
+ * are waiting with no idle worker to take them, or the latency is over
+ * target, for growDelay samples in a row; it grows by up to the backlog,
+ * at most doubling.  It shrinks when nothing is pending, some workers are
+ * idle and the latency is under half the target for shrinkDelay samples in
+ * a row; it shrinks by half the idle workers.  Shrinking more slowly than
+ * growing keeps the pool from flapping under bursty load.
+ *
+ * The decisions are counted, so they can be checked or exported.
+ *
+ * @version $Id:$
+ */
+class AdaptivePoolPolicy {
+
+public:
+  /**
+   * @param threadManager the thread manager to size; must be started
+   * before this policy and stopped after it
+   * @param minWorkers the number of workers to keep
+   * @param maxWorkers the number of workers not to exceed
+   *
+   * @throws InvalidArgumentException minWorkers is zero or above maxWorkers
+   */
+  AdaptivePoolPolicy(std::shared_ptr<ThreadManager> threadManager,
+                     size_t minWorkers,
+                     size_t maxWorkers);
+
+  virtual ~AdaptivePoolPolicy();
+
+  /**
+   * Adds workers up to minWorkers, then starts sampling on a thread of its own.
+   *
+   * @throws IllegalStateException Already started
+   */
+  virtual void start();
+
+  /**
+   * Stops sampling.  Workers are left as they are.
+   */
+  virtual void stop();
+
+  size_t getMinWorkers() const { return minWorkers_; }
+
+  size_t getMaxWorkers() const { return maxWorkers_; }
+
+  /**
+   * The time in milliseconds between samples, 100 by default.  Set before start().
+   */
+  int64_t getInterval() const { return interval_; }
+  void setInterval(int64_t interval);
+
+  /**
+   * The queueing latency in milliseconds above which the pool grows, 10 by
+   * default; 0 to size on the backlog alone.  Set before start().
+   */
+  int64_t getLatencyTarget() const { return latencyTarget_; }
+  void setLatencyTarget(int64_t latencyTarget);
+
+  /**
+   * The number of samples in a row that must call for growing, 1 by
+   * default, or for shrinking, 10 by default.  Set before start().
+   */
+  size_t getGrowDelay() const { return growDelay_; }
+  void setGrowDelay(size_t growDelay);
+  size_t getShrinkDelay() const { return shrinkDelay_; }
+  void setShrinkDelay(size_t shrinkDelay);
+
+  /// Samples taken
+  uint64_t getSampleCount() const { return sampleCount_; }
+
+  /// Times the pool was grown, and the workers added in all
+  uint64_t getGrowCount() const { return growCount_; }
+  uint64_t getWorkersAdded() const { return workersAdded_; }
+
+  /// Times the pool was shrunk, and the workers removed in all
+  uint64_t getShrinkCount() const { return shrinkCount_; }
+  uint64_t getWorkersRemoved() const { return workersRemoved_; }
+
+  /// The queueing latency at the last sample, in microseconds
+  int64_t getLastLatencyUs() const { return lastLatencyUs_; }
+
+private:
+  class Probe;
+  class Sampler;
+
+  void sample();
+
+  /// Measures the queueing latency in microseconds, adding a probe if none is out
+  int64_t probeLatency(size_t pendingCount, size_t idleCount, size_t workerCount);
+
+  std::shared_ptr<ThreadManager> threadManager_;
+  const size_t minWorkers_;
+  const size_t maxWorkers_;
+  int64_t interval_;
+  int64_t latencyTarget_;
+  size_t growDelay_;
+  size_t shrinkDelay_;
+
+  Monitor monitor_;
+  bool running_;
+  std::shared_ptr<Thread> thread_;
+
+  /// Used only on the sampling thread
+  std::shared_ptr<Probe> probe_;
+  size_t growVotes_;
+  size_t shrinkVotes_;
+
+  std::atomic<uint64_t> sampleCount_;
+  std::atomic<uint64_t> growCount_;
+  std::atomic<uint64_t> workersAdded_;
+  std::atomic<uint64_t> shrinkCount_;
+  std::atomic<uint64_t> workersRemoved_;
+  std::atomic<int64_t> lastLatencyUs_;
+};
+}
+}
+} // apache::thrift::concurrency
+
+#endif // #ifndef _THRIFT_CONCURRENCY_ADAPTIVEPOOLPOLICY_H_
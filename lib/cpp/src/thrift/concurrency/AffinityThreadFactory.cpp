@@ -0,0 +1,169 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <thrift/thrift-config.h>
+
+#include <thrift/concurrency/AffinityThreadFactory.h>
+#include <thrift/concurrency/Exception.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifdef HAVE_SCHED_H
+#include <sched.h>
+#endif
+
+namespace apache {
+namespace thrift {
+namespace concurrency {
+
+namespace {
+
+/**
+ * A thread that pins itself before running its runnable.
+ */
+class AffinityThread : public Thread {
+public:
+  AffinityThread(bool detached,
+                 std::shared_ptr<Runnable> runnable,
+                 const AffinityThreadFactory::CpuSet& cpus)
+    : Thread(detached, runnable), cpus_(cpus) {}
+
+protected:
+  thread_funct_t getThreadFunc() const override { return affinityMain; }
+
+private:
+  static void affinityMain(std::shared_ptr<Thread> thread) {
+    AffinityThreadFactory::setCurrentThreadAffinity(
+        static_cast<AffinityThread*>(thread.get())->cpus_);
+    threadMain(thread);
+  }
+
+  const AffinityThreadFactory::CpuSet cpus_;
+};
+
+/**
+ * Parses a list of CPUs or nodes in the kernel's format, such as "0-3,8".
+ */
+AffinityThreadFactory::CpuSet parseList(const std::string& list) {
+  AffinityThreadFactory::CpuSet result;
+  std::istringstream in(list);
+  std::string range;
+  while (std::getline(in, range, ',')) {
+    int first;
+    int last;
+    char dash;
+    std::istringstream r(range);
+    if (!(r >> first)) {
+      continue;
+    }
+    if (!(r >> dash >> last) || dash != '-') {
+      last = first;
+    }
+    for (int cpu = first; cpu <= last; ++cpu) {
+      result.push_back(cpu);
+    }
+  }
+  return result;
+}
+
+AffinityThreadFactory::CpuSet readList(const std::string& path) {
+  std::ifstream in(path.c_str());
+  std::string list;
+  std::getline(in, list);
+  return parseList(list);
+}
+}
+
+AffinityThreadFactory::AffinityThreadFactory(const std::vector<CpuSet>& cpuSets, bool detached)
+  : ThreadFactory(detached), cpuSets_(cpuSets), next_(0) {
+  if (cpuSets_.empty()) {
+    throw InvalidArgumentException();
+  }
+  for (const auto& cpus : cpuSets_) {
+    if (cpus.empty()) {
+      throw InvalidArgumentException();
+    }
+  }
+}
+
+std::shared_ptr<Thread> AffinityThreadFactory::newThread(std::shared_ptr<Runnable> runnable) const {
+  const CpuSet& cpus = cpuSets_[next_++ % cpuSets_.size()];
+  std::shared_ptr<Thread> result = std::make_shared<AffinityThread>(isDetached(), runnable, cpus);
+  runnable->thread(result);
+  return result;
+}
+
+std::vector<AffinityThreadFactory::CpuSet> AffinityThreadFactory::getNumaNodes() {
+  std::vector<CpuSet> nodes;
+  for (int node : readList("/sys/devices/system/node/online")) {
+    std::ostringstream path;
+    path << "/sys/devices/system/node/node" << node << "/cpulist";
+    CpuSet cpus = readList(path.str());
+    // nodes with memory but no CPUs are of no use here
+    if (!cpus.empty()) {
+      nodes.push_back(cpus);
+    }
+  }
+  if (!nodes.empty()) {
+    return nodes;
+  }
+
+  CpuSet cpus;
+#ifdef HAVE_SCHED_SETAFFINITY
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &mask)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+#endif
+  if (cpus.empty()) {
+    unsigned count = std::thread::hardware_concurrency();
+    for (unsigned cpu = 0; cpu < (count ? count : 1); ++cpu) {
+      cpus.push_back(static_cast<int>(cpu));
+    }
+  }
+  nodes.push_back(cpus);
+  return nodes;
+}
+
+bool AffinityThreadFactory::setCurrentThreadAffinity(const CpuSet& cpus) {
+#ifdef HAVE_SCHED_SETAFFINITY
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  for (int cpu : cpus) {
+    if (cpu >= 0 && cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &mask);
+    }
+  }
+  // pid 0 is the calling thread
+  return CPU_COUNT(&mask) > 0 && sched_setaffinity(0, sizeof(mask), &mask) == 0;
+#else
+  (void)cpus;
+  return false;
+#endif
+}
+}
+}
+} // apache::thrift::concurrency
@@ -0,0 +1,85 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _THRIFT_CONCURRENCY_AFFINITYTHREADFACTORY_H_
+#define _THRIFT_CONCURRENCY_AFFINITYTHREADFACTORY_H_ 1
+
+#include <thrift/concurrency/ThreadFactory.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace apache {
+namespace thrift {
+namespace concurrency {
+
+/**
+ * A thread factory that pins each thread it creates to a set of CPUs.
+ * Threads are given the sets in turn, so a factory with one set per NUMA
+ * node spreads its threads over the nodes, and a factory with a single set
+ * keeps all of them on it.
+ *
+ * Memory is placed on the node of the thread that first touches it, so a
+ * pinned thread's own buffers end up local to it.  To keep a server's IO
+ * threads and the workers they hand calls to on the same node, give each
+ * node a ThreadManager built with a factory for that node alone, and see
+ * TNonblockingServer::setIOThreadCpuSets() and setIOThreadThreadManagers().
+ *
+ * Where CPU affinity is not supported threads are created unpinned.
+ */
+class AffinityThreadFactory : public ThreadFactory {
+public:
+  /// CPU numbers, as the operating system counts them
+  typedef std::vector<int> CpuSet;
+
+  /**
+   * @throws InvalidArgumentException No sets, or an empty one
+   */
+  AffinityThreadFactory(const std::vector<CpuSet>& cpuSets, bool detached = true);
+
+  const std::vector<CpuSet>& getCpuSets() const { return cpuSets_; }
+
+  /**
+   * Creates a thread pinned to the next set in turn.
+   */
+  std::shared_ptr<Thread> newThread(std::shared_ptr<Runnable> runnable) const override;
+
+  /**
+   * Gets the CPUs of each NUMA node, or a single set of all the CPUs this
+   * process may run on if the nodes cannot be found.
+   */
+  static std::vector<CpuSet> getNumaNodes();
+
+  /**
+   * Pins the calling thread to cpus.
+   *
+   * @return false if that failed or is not supported
+   */
+  static bool setCurrentThreadAffinity(const CpuSet& cpus);
+
+private:
+  std::vector<CpuSet> cpuSets_;
+  mutable std::atomic<size_t> next_;
+};
+}
+}
+} // apache::thrift::concurrency
+
+#endif // #ifndef _THRIFT_CONCURRENCY_AFFINITYTHREADFACTORY_H_
@@ -0,0 +1,142 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _THRIFT_CONCURRENCY_FUTEX_H_
+#define _THRIFT_CONCURRENCY_FUTEX_H_ 1
+
+/*
+ * Waiting on and waking a word of memory, for the spin-then-park Mutex and
+ * Monitor built with THRIFT_ADAPTIVE_MUTEX.  Internal; not installed.
+ *
+ * On Linux these are the futex system calls.  Elsewhere a thread parks on
+ * one of a fixed set of condition variables chosen by the word's address.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#ifdef __linux__
+#include <cerrno>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#endif
+
+namespace apache {
+namespace thrift {
+namespace concurrency {
+
+#ifndef __linux__
+struct FutexParkingSlot {
+  std::mutex mutex;
+  std::condition_variable condition;
+};
+
+inline FutexParkingSlot& futexParkingSlot(const void* word) {
+  static FutexParkingSlot slots[64];
+  return slots[(reinterpret_cast<uintptr_t>(word) >> 4) % 64];
+}
+#endif
+
+/**
+ * Blocks while *word holds expected, until futexWake() is called on word
+ * or the deadline, if any, passes.  May also return for no reason, so the
+ * caller must check again what it is waiting for.
+ *
+ * @return false if the deadline passed
+ */
+inline bool futexWait(std::atomic<int>* word,
+                      int expected,
+                      const std::chrono::steady_clock::time_point* deadline) {
+#ifdef __linux__
+  struct timespec timeout;
+  struct timespec* timeoutPtr = nullptr;
+  if (deadline) {
+    auto left = *deadline - std::chrono::steady_clock::now();
+    if (left <= std::chrono::steady_clock::duration::zero()) {
+      return false;
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(left).count();
+    timeout.tv_sec = static_cast<time_t>(ns / 1000000000);
+    timeout.tv_nsec = static_cast<long>(ns % 1000000000);
+    timeoutPtr = &timeout;
+  }
+  if (syscall(SYS_futex,
+              reinterpret_cast<int*>(word),
+              FUTEX_WAIT_PRIVATE,
+              expected,
+              timeoutPtr,
+              nullptr,
+              0) == -1) {
+    return errno != ETIMEDOUT;
+  }
+  return true;
+#else
+  FutexParkingSlot& slot = futexParkingSlot(word);
+  std::unique_lock<std::mutex> lock(slot.mutex);
+  if (word->load(std::memory_order_relaxed) != expected) {
+    return true;
+  }
+  if (deadline) {
+    return slot.condition.wait_until(lock, *deadline) == std::cv_status::no_timeout;
+  }
+  slot.condition.wait(lock);
+  return true;
+#endif
+}
+
+/**
+ * Wakes up to count threads blocked in futexWait() on word.  Change *word
+ * first.
+ */
+inline void futexWake(std::atomic<int>* word, int count) {
+#ifdef __linux__
+  syscall(SYS_futex, reinterpret_cast<int*>(word), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+#else
+  (void)count;
+  FutexParkingSlot& slot = futexParkingSlot(word);
+  {
+    // so a waiter cannot check the word and then miss the wakeup
+    std::lock_guard<std::mutex> lock(slot.mutex);
+  }
+  // other words share the slot, so all must wake and check
+  slot.condition.notify_all();
+#endif
+}
+
+/**
+ * Tells the CPU that this is a spin loop.
+ */
+inline void cpuRelax() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  __builtin_ia32_pause();
+#elif defined(__GNUC__) && defined(__aarch64__)
+  __asm__ __volatile__("yield");
+#endif
+}
+}
+}
+} // apache::thrift::concurrency
+
+#endif // #ifndef _THRIFT_CONCURRENCY_FUTEX_H_
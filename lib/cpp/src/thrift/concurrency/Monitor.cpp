@@ -29,10 +29,103 @@
 #include <thread>
 #include <mutex>
 
+#ifdef THRIFT_ADAPTIVE_MUTEX
+#include <atomic>
+#include <climits>
+#include <thrift/concurrency/Futex.h>
+#endif
+
 namespace apache {
 namespace thrift {
 namespace concurrency {
 
+#ifdef THRIFT_ADAPTIVE_MUTEX
+
+/**
+ * Monitor implementation built with THRIFT_ADAPTIVE_MUTEX
+ *
+ * The condition is a sequence number that notify() advances and waiters
+ * park on with futexWait(), so unlike std::condition_variable_any there is
+ * no lock of its own to take, and notifying with no one waiting is only an
+ * atomic increment.  A waiter that reads the sequence under the mutex cannot
+ * miss a notify() made after it unlocks.
+ */
+class Monitor::Impl {
+
+public:
+  Impl() : ownedMutex_(new Mutex()), sequence_(0), waiters_(0), mutex_(nullptr) {
+    init(ownedMutex_.get());
+  }
+
+  Impl(Mutex* mutex) : ownedMutex_(), sequence_(0), waiters_(0), mutex_(nullptr) { init(mutex); }
+
+  Impl(Monitor* monitor) : ownedMutex_(), sequence_(0), waiters_(0), mutex_(nullptr) {
+    init(&(monitor->mutex()));
+  }
+
+  Mutex& mutex() { return *mutex_; }
+  void lock() { mutex_->lock(); }
+  void unlock() { mutex_->unlock(); }
+
+  void wait(const std::chrono::milliseconds &timeout) {
+    int result = waitForTimeRelative(timeout);
+    if (result == THRIFT_ETIMEDOUT) {
+      throw TimedOutException();
+    } else if (result != 0) {
+      throw TException("Monitor::wait() failed");
+    }
+  }
+
+  int waitForTimeRelative(const std::chrono::milliseconds &timeout) {
+    if (timeout.count() == 0) {
+      return waitForever();
+    }
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    return waitUntil(&deadline);
+  }
+
+  int waitForTime(const std::chrono::time_point<std::chrono::steady_clock>& abstime) {
+    return waitUntil(&abstime);
+  }
+
+  int waitForever() { return waitUntil(nullptr); }
+
+  void notify() {
+    sequence_.fetch_add(1, std::memory_order_release);
+    if (waiters_.load(std::memory_order_relaxed) > 0) {
+      futexWake(&sequence_, 1);
+    }
+  }
+
+  void notifyAll() {
+    sequence_.fetch_add(1, std::memory_order_release);
+    if (waiters_.load(std::memory_order_relaxed) > 0) {
+      futexWake(&sequence_, INT_MAX);
+    }
+  }
+
+private:
+  void init(Mutex* mutex) { mutex_ = mutex; }
+
+  int waitUntil(const std::chrono::steady_clock::time_point* deadline) {
+    assert(mutex_);
+    int sequence = sequence_.load(std::memory_order_relaxed);
+    waiters_.fetch_add(1, std::memory_order_relaxed);
+    mutex_->unlock();
+    bool woken = futexWait(&sequence_, sequence, deadline);
+    mutex_->lock();
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+    return (woken ? 0 : THRIFT_ETIMEDOUT);
+  }
+
+  const std::unique_ptr<Mutex> ownedMutex_;
+  std::atomic<int> sequence_;
+  std::atomic<int> waiters_;
+  Mutex* mutex_;
+};
+
+#else
+
 /**
  * Monitor implementation using the std thread library
  *
@@ -134,6 +227,8 @@ private:
   Mutex* mutex_;
 };
 
+#endif
+
 Monitor::Monitor() : impl_(new Monitor::Impl()) {
 }
 Monitor::Monitor(Mutex* mutex) : impl_(new Monitor::Impl(mutex)) {
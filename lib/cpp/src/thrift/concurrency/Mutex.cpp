@@ -17,15 +17,108 @@
  * under the License.
  */
 
+#include <thrift/thrift-config.h>
+
 #include <thrift/concurrency/Mutex.h>
 
 #include <chrono>
 #include <mutex>
 
+#ifdef THRIFT_ADAPTIVE_MUTEX
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <thrift/concurrency/Futex.h>
+#endif
+
 namespace apache {
 namespace thrift {
 namespace concurrency {
 
+#ifdef THRIFT_ADAPTIVE_MUTEX
+
+/**
+ * Implementation of Mutex class that spins briefly and then parks on a
+ * futex, built with THRIFT_ADAPTIVE_MUTEX
+ *
+ * The state is 0 when unlocked, 1 when locked and 2 when locked with
+ * threads possibly parked, so unlocking an uncontended mutex is one atomic
+ * exchange and never a system call.  How long to spin adapts to how long
+ * spinning has lately taken to get the lock, as in glibc's adaptive mutex,
+ * and there is no spinning at all on a single CPU.
+ */
+class Mutex::impl {
+public:
+  impl() : state_(0), spin_(0) {}
+
+  void lock() {
+    if (!try_lock()) {
+      lockSlow(nullptr);
+    }
+  }
+
+  bool try_lock() {
+    int unlocked = 0;
+    return state_.compare_exchange_strong(unlocked, 1, std::memory_order_acquire);
+  }
+
+  bool try_lock_for(const std::chrono::milliseconds& timeout) {
+    if (try_lock()) {
+      return true;
+    }
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    return lockSlow(&deadline);
+  }
+
+  void unlock() {
+    if (state_.exchange(0, std::memory_order_release) == 2) {
+      futexWake(&state_, 1);
+    }
+  }
+
+private:
+  static const int MAX_SPIN = 100;
+
+  bool lockSlow(const std::chrono::steady_clock::time_point* deadline) {
+    static const int maxSpin = std::thread::hardware_concurrency() > 1 ? MAX_SPIN : 0;
+    int spin = spin_.load(std::memory_order_relaxed);
+    int limit = (std::min)(maxSpin, spin * 2 + 10);
+    int count = 0;
+    for (; count < limit; ++count) {
+      int state = state_.load(std::memory_order_relaxed);
+      if (state == 0 && state_.compare_exchange_weak(state, 1, std::memory_order_acquire)) {
+        spin_.store(spin + (count - spin) / 8, std::memory_order_relaxed);
+        return true;
+      }
+      if (state == 2) {
+        // others are already parked; joining them is fairer than spinning
+        break;
+      }
+      cpuRelax();
+    }
+    if (count > 0) {
+      spin_.store(spin + (count - spin) / 8, std::memory_order_relaxed);
+    }
+
+    // from here on whoever unlocks must wake someone, so the state is 2
+    while (state_.exchange(2, std::memory_order_acquire) != 0) {
+      if (!futexWait(&state_, 2, deadline)) {
+        return state_.exchange(2, std::memory_order_acquire) == 0;
+      }
+    }
+    return true;
+  }
+
+  std::atomic<int> state_;
+
+  /// Spins the slow path took lately, smoothed
+  std::atomic<int> spin_;
+};
+
+const int Mutex::impl::MAX_SPIN;
+
+#else
+
 /**
  * Implementation of Mutex class using C++11 std::timed_mutex
  *
@@ -35,6 +128,8 @@ namespace concurrency {
  */
 class Mutex::impl : public std::timed_mutex {};
 
+#endif
+
 Mutex::Mutex() : impl_(new Mutex::impl()) {
 }
 
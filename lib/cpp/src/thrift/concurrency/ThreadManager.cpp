@@ -25,18 +25,339 @@
 
 #include <memory>
 
+#include <algorithm>
+#include <limits>
 #include <stdexcept>
-#include <deque>
 #include <set>
+#include <vector>
 
 namespace apache {
 namespace thrift {
 namespace concurrency {
 
 using std::shared_ptr;
-using std::unique_ptr;
 using std::dynamic_pointer_cast;
 
+/**
+ * A queued task, kept by value in the TaskRing.  The expiration is a plain
+ * field so that queueing a task allocates nothing.
+ */
+class ThreadManager::Task {
+
+public:
+  Task() : expires_(false) {}
+
+  Task(shared_ptr<Runnable> runnable, int64_t expiration)
+    : runnable_(std::move(runnable)), expires_(expiration != 0LL) {
+    if (expires_) {
+      expireTime_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(expiration);
+    }
+  }
+
+  bool isExpired(const std::chrono::steady_clock::time_point& now) const {
+    return expires_ && expireTime_ < now;
+  }
+
+  bool expires() const { return expires_; }
+
+  const std::chrono::steady_clock::time_point& getExpireTime() const { return expireTime_; }
+
+  shared_ptr<Runnable>& getRunnable() { return runnable_; }
+
+private:
+  shared_ptr<Runnable> runnable_;
+  bool expires_;
+  std::chrono::steady_clock::time_point expireTime_;
+};
+
+namespace {
+
+/**
+ * The pending task queue: a ring of Task slots that only allocates when it
+ * has to grow, so once it has reached the working size adding and taking
+ * tasks costs no allocation.  Tasks are moved out of their slots as they
+ * leave, so the ring keeps no Runnable alive.
+ */
+class TaskRing {
+
+public:
+  typedef ThreadManager::Task Task;
+
+  TaskRing() : head_(0), size_(0) {}
+
+  bool empty() const { return size_ == 0; }
+
+  size_t size() const { return size_; }
+
+  /**
+   * Grows the ring, if needed, to hold count tasks without allocating.
+   */
+  void reserve(size_t count) {
+    if (count <= slots_.size()) {
+      return;
+    }
+
+    size_t capacity = slots_.empty() ? MIN_CAPACITY : slots_.size();
+    while (capacity < count) {
+      if (capacity > std::numeric_limits<size_t>::max() / 2) {
+        throw std::length_error("TaskRing::reserve");
+      }
+      capacity *= 2;
+    }
+
+    std::vector<Task> slots(capacity);
+    for (size_t ix = 0; ix < size_; ix++) {
+      slots[ix] = std::move(at(ix));
+    }
+    slots_.swap(slots);
+    head_ = 0;
+  }
+
+  void push_back(Task&& task) {
+    reserve(size_ + 1);
+    at(size_++) = std::move(task);
+  }
+
+  Task& at(size_t index) { return slots_[(head_ + index) & (slots_.size() - 1)]; }
+
+  /**
+   * Moves the oldest task out of the ring.
+   */
+  Task pop_front() {
+    Task task(std::move(at(0)));
+    head_ = (head_ + 1) & (slots_.size() - 1);
+    --size_;
+    return task;
+  }
+
+  /**
+   * Removes the task at index, keeping the others in order.
+   */
+  void erase(size_t index) {
+    at(index) = Task();
+    for (size_t ix = index; ix + 1 < size_; ix++) {
+      at(ix) = std::move(at(ix + 1));
+    }
+    --size_;
+  }
+
+private:
+  static const size_t MIN_CAPACITY = 64;
+
+public:
+  /// The most slots a pending task limit reserves up front; beyond it the ring grows as needed
+  static const size_t MAX_RESERVE = 1024;
+
+private:
+
+  /// Always empty or a power of two in size
+  std::vector<Task> slots_;
+  size_t head_;
+  size_t size_;
+};
+
+const size_t TaskRing::MIN_CAPACITY;
+const size_t TaskRing::MAX_RESERVE;
+
+/**
+ * The pending tasks of a ThreadManager::Impl, in one or more priority lanes.
+ *
+ * The lane to take a task from is picked by smooth weighted round robin
+ * over the lanes that have tasks: each such lane earns its weight, the
+ * richest is picked and pays the weights of all of them.  Over any stretch
+ * in which the same lanes have tasks, each is picked in proportion to its
+ * weight, and the picks are spread out rather than bunched.
+ *
+ * Once lanes are set up, tasks with an expiration are kept in a heap per
+ * lane and taken earliest deadline first, ties in the order added.  A
+ * single lane that was never set up is a plain FIFO, as it always was.
+ */
+class TaskLanes {
+
+public:
+  typedef ThreadManager::Task Task;
+
+  TaskLanes() : lanes_(1), size_(0), reserved_(0), sequence_(0), deadlineOrder_(false) {}
+
+  bool empty() const { return size_ == 0; }
+
+  size_t size() const { return size_; }
+
+  size_t laneCount() const { return lanes_.size(); }
+
+  /**
+   * Replaces the lanes; only while empty.
+   */
+  void configure(const std::vector<size_t>& weights) {
+    std::vector<Lane> lanes(weights.size());
+    for (size_t ix = 0; ix < weights.size(); ix++) {
+      lanes[ix].weight = static_cast<int64_t>(weights[ix]);
+      lanes[ix].fifo.reserve(reserved_);
+    }
+    lanes_.swap(lanes);
+    deadlineOrder_ = true;
+  }
+
+  void reserve(size_t count) {
+    reserved_ = count;
+    for (auto& lane : lanes_) {
+      lane.fifo.reserve(count);
+    }
+  }
+
+  void push(size_t lane, Task&& task) {
+    Lane& to = lanes_[lane];
+    if (deadlineOrder_ && task.expires()) {
+      to.deadlines.push_back(Deadline(std::move(task), sequence_++));
+      std::push_heap(to.deadlines.begin(), to.deadlines.end(), Deadline::later);
+    } else {
+      to.fifo.push_back(std::move(task));
+    }
+    size_++;
+  }
+
+  /**
+   * Takes the next task to run.  Only while not empty.
+   */
+  Task pop() { return take(lanes_[nextLane()]); }
+
+  /**
+   * Removes the first task found running runnable.
+   */
+  bool remove(const shared_ptr<Runnable>& runnable) {
+    for (auto& lane : lanes_) {
+      for (size_t ix = 0; ix < lane.fifo.size(); ix++) {
+        if (lane.fifo.at(ix).getRunnable() == runnable) {
+          lane.fifo.erase(ix);
+          taken(lane);
+          return true;
+        }
+      }
+      for (size_t ix = 0; ix < lane.deadlines.size(); ix++) {
+        if (lane.deadlines[ix].task.getRunnable() == runnable) {
+          lane.deadlines[ix] = std::move(lane.deadlines.back());
+          lane.deadlines.pop_back();
+          std::make_heap(lane.deadlines.begin(), lane.deadlines.end(), Deadline::later);
+          taken(lane);
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  /**
+   * Removes tasks that expired before now, calling expired with each one,
+   * and returns how many were removed.
+   */
+  template <typename F>
+  size_t removeExpired(const std::chrono::steady_clock::time_point& now, bool justOne, F expired) {
+    size_t count = 0;
+    for (auto& lane : lanes_) {
+      // the expired tasks are at the top of the heap
+      while (!lane.deadlines.empty() && lane.deadlines.front().task.isExpired(now)) {
+        std::pop_heap(lane.deadlines.begin(), lane.deadlines.end(), Deadline::later);
+        Task task(std::move(lane.deadlines.back().task));
+        lane.deadlines.pop_back();
+        taken(lane);
+        expired(task.getRunnable());
+        if (++count == 1 && justOne) {
+          return count;
+        }
+      }
+
+      for (size_t ix = 0; ix < lane.fifo.size();) {
+        if (lane.fifo.at(ix).isExpired(now)) {
+          Task task(std::move(lane.fifo.at(ix)));
+          lane.fifo.erase(ix);
+          taken(lane);
+          expired(task.getRunnable());
+          if (++count == 1 && justOne) {
+            return count;
+          }
+        } else {
+          ++ix;
+        }
+      }
+    }
+    return count;
+  }
+
+private:
+  struct Deadline {
+    Deadline(Task&& value, uint64_t order) : task(std::move(value)), sequence(order) {}
+
+    /// Heap order: whether a is due after b
+    static bool later(const Deadline& a, const Deadline& b) {
+      return a.task.getExpireTime() > b.task.getExpireTime()
+             || (a.task.getExpireTime() == b.task.getExpireTime() && a.sequence > b.sequence);
+    }
+
+    Task task;
+    uint64_t sequence;
+  };
+
+  struct Lane {
+    Lane() : weight(1), current(0) {}
+
+    bool empty() const { return fifo.empty() && deadlines.empty(); }
+
+    int64_t weight;
+    int64_t current;
+    TaskRing fifo;
+    std::vector<Deadline> deadlines;
+  };
+
+  size_t nextLane() {
+    if (lanes_.size() == 1) {
+      return 0;
+    }
+
+    size_t best = lanes_.size();
+    int64_t total = 0;
+    for (size_t ix = 0; ix < lanes_.size(); ix++) {
+      Lane& lane = lanes_[ix];
+      if (!lane.empty()) {
+        lane.current += lane.weight;
+        total += lane.weight;
+        if (best == lanes_.size() || lane.current > lanes_[best].current) {
+          best = ix;
+        }
+      }
+    }
+    lanes_[best].current -= total;
+    return best;
+  }
+
+  Task take(Lane& lane) {
+    if (!lane.deadlines.empty()) {
+      std::pop_heap(lane.deadlines.begin(), lane.deadlines.end(), Deadline::later);
+      Task task(std::move(lane.deadlines.back().task));
+      lane.deadlines.pop_back();
+      taken(lane);
+      return task;
+    }
+    Task task(lane.fifo.pop_front());
+    taken(lane);
+    return task;
+  }
+
+  void taken(Lane& lane) {
+    size_--;
+    if (lane.empty()) {
+      // an idle lane does not bank credit
+      lane.current = 0;
+    }
+  }
+
+  std::vector<Lane> lanes_;
+  size_t size_;
+  size_t reserved_;
+  uint64_t sequence_;
+  bool deadlineOrder_;
+};
+}
+
 /**
  * ThreadManager class
  *
@@ -118,9 +439,24 @@ public:
   void pendingTaskCountMax(const size_t value) {
     Guard g(mutex_);
     pendingTaskCountMax_ = value;
+    tasks_.reserve((std::min)(value, TaskRing::MAX_RESERVE));
+  }
+
+  void add(shared_ptr<Runnable> value, int64_t timeout, int64_t expiration) override {
+    addToLane(0, std::move(value), timeout, expiration);
   }
 
-  void add(shared_ptr<Runnable> value, int64_t timeout, int64_t expiration) override;
+  void setPriorityLanes(const std::vector<size_t>& weights) override;
+
+  size_t priorityLaneCount() const override {
+    Guard g(mutex_);
+    return tasks_.laneCount();
+  }
+
+  void addToLane(size_t lane,
+                 shared_ptr<Runnable> value,
+                 int64_t timeout,
+                 int64_t expiration) override;
 
   void remove(shared_ptr<Runnable> task) override;
 
@@ -161,9 +497,7 @@ private:
   ThreadManager::STATE state_;
   shared_ptr<ThreadFactory> threadFactory_;
 
-  friend class ThreadManager::Task;
-  typedef std::deque<shared_ptr<Task> > TaskQueue;
-  TaskQueue tasks_;
+  TaskLanes tasks_;
   Mutex mutex_;
   Monitor monitor_;
   Monitor maxMonitor_;
@@ -175,39 +509,6 @@ private:
   std::map<const Thread::id_t, shared_ptr<Thread> > idMap_;
 };
 
-class ThreadManager::Task : public Runnable {
-
-public:
-  enum STATE { WAITING, EXECUTING, TIMEDOUT, COMPLETE };
-
-  Task(shared_ptr<Runnable> runnable, uint64_t expiration = 0ULL)
-    : runnable_(runnable),
-      state_(WAITING) {
-        if (expiration != 0ULL) {
-          expireTime_.reset(new std::chrono::steady_clock::time_point(std::chrono::steady_clock::now() + std::chrono::milliseconds(expiration)));
-        }
-    }
-
-  ~Task() override = default;
-
-  void run() override {
-    if (state_ == EXECUTING) {
-      runnable_->run();
-      state_ = COMPLETE;
-    }
-  }
-
-  shared_ptr<Runnable> getRunnable() { return runnable_; }
-
-  const unique_ptr<std::chrono::steady_clock::time_point> & getExpireTime() const { return expireTime_; }
-
-private:
-  shared_ptr<Runnable> runnable_;
-  friend class ThreadManager::Worker;
-  STATE state_;
-  unique_ptr<std::chrono::steady_clock::time_point> expireTime_;
-};
-
 class ThreadManager::Worker : public Runnable {
   enum STATE { UNINITIALIZED, STARTING, STARTED, STOPPING, STOPPED };
 
@@ -273,20 +574,15 @@ public:
         manager_->idleCount_--;
       }
 
-      shared_ptr<ThreadManager::Task> task;
+      ThreadManager::Task task;
+      bool haveTask = false;
+      bool expired = false;
 
       if (active) {
         if (!manager_->tasks_.empty()) {
-          task = manager_->tasks_.front();
-          manager_->tasks_.pop_front();
-          if (task->state_ == ThreadManager::Task::WAITING) {
-            // If the state is changed to anything other than EXECUTING or TIMEDOUT here
-            // then the execution loop needs to be changed below.
-            task->state_ =
-                (task->getExpireTime() && *(task->getExpireTime()) < std::chrono::steady_clock::now()) ?
-                    ThreadManager::Task::TIMEDOUT :
-                    ThreadManager::Task::EXECUTING;
-          }
+          task = manager_->tasks_.pop();
+          haveTask = true;
+          expired = task.isExpired(std::chrono::steady_clock::now());
         }
 
         /* If we have a pending task max and we just dropped below it, wakeup any
@@ -300,27 +596,29 @@ public:
       /**
        * Execution - not holding a lock
        */
-      if (task) {
-        if (task->state_ == ThreadManager::Task::EXECUTING) {
+      if (haveTask) {
+        if (!expired) {
 
           // Release the lock so we can run the task without blocking the thread manager
           manager_->mutex_.unlock();
 
           try {
-            task->run();
+            task.getRunnable()->run();
           } catch (const std::exception& e) {
             GlobalOutput.printf("[ERROR] task->run() raised an exception: %s", e.what());
           } catch (...) {
             GlobalOutput.printf("[ERROR] task->run() raised an unknown exception");
           }
 
+          // Let the task go before taking the lock again
+          task = ThreadManager::Task();
+
           // Re-acquire the lock to proceed in the thread manager
           manager_->mutex_.lock();
 
         } else if (manager_->expireCallback_) {
-          // The only other state the task could have been in is TIMEDOUT (see above)
           manager_->mutex_.unlock();
-          manager_->expireCallback_(task->getRunnable());
+          manager_->expireCallback_(task.getRunnable());
           manager_->mutex_.lock();
           manager_->expiredCount_++;
         }
@@ -450,7 +748,24 @@ bool ThreadManager::Impl::canSleep() const {
   return idMap_.find(id) == idMap_.end();
 }
 
-void ThreadManager::Impl::add(shared_ptr<Runnable> value, int64_t timeout, int64_t expiration) {
+void ThreadManager::Impl::setPriorityLanes(const std::vector<size_t>& weights) {
+  if (weights.empty() || std::find(weights.begin(), weights.end(), 0) != weights.end()) {
+    throw InvalidArgumentException();
+  }
+
+  Guard g(mutex_);
+  if (!tasks_.empty()) {
+    throw IllegalStateException(
+        "ThreadManager::Impl::setPriorityLanes "
+        "tasks are pending");
+  }
+  tasks_.configure(weights);
+}
+
+void ThreadManager::Impl::addToLane(size_t lane,
+                                    shared_ptr<Runnable> value,
+                                    int64_t timeout,
+                                    int64_t expiration) {
   Guard g(mutex_, timeout);
 
   if (!g) {
@@ -463,6 +778,10 @@ void ThreadManager::Impl::add(shared_ptr<Runnable> value, int64_t timeout, int64
         "not started");
   }
 
+  if (lane >= tasks_.laneCount()) {
+    throw InvalidArgumentException();
+  }
+
   // if we're at a limit, remove an expired task to see if the limit clears
   if (pendingTaskCountMax_ > 0 && (tasks_.size() >= pendingTaskCountMax_)) {
     removeExpired(true);
@@ -479,7 +798,7 @@ void ThreadManager::Impl::add(shared_ptr<Runnable> value, int64_t timeout, int64
     }
   }
 
-  tasks_.push_back(std::make_shared<ThreadManager::Task>(value, expiration));
+  tasks_.push(lane, ThreadManager::Task(std::move(value), expiration));
 
   // If idle thread is available notify it, otherwise all worker threads are
   // running and will get around to this task in time.
@@ -496,14 +815,7 @@ void ThreadManager::Impl::remove(shared_ptr<Runnable> task) {
         "started");
   }
 
-  for (auto it = tasks_.begin(); it != tasks_.end(); ++it)
-  {
-    if ((*it)->getRunnable() == task)
-    {
-      tasks_.erase(it);
-      return;
-    }
-  }
+  tasks_.remove(task);
 }
 
 std::shared_ptr<Runnable> ThreadManager::Impl::removeNextPending() {
@@ -518,10 +830,7 @@ std::shared_ptr<Runnable> ThreadManager::Impl::removeNextPending() {
     return std::shared_ptr<Runnable>();
   }
 
-  shared_ptr<ThreadManager::Task> task = tasks_.front();
-  tasks_.pop_front();
-
-  return task->getRunnable();
+  return tasks_.pop().getRunnable();
 }
 
 void ThreadManager::Impl::removeExpired(bool justOne) {
@@ -529,25 +838,14 @@ void ThreadManager::Impl::removeExpired(bool justOne) {
   if (tasks_.empty()) {
     return;
   }
-  auto now = std::chrono::steady_clock::now();
 
-  for (auto it = tasks_.begin(); it != tasks_.end(); )
-  {
-    if ((*it)->getExpireTime() && *((*it)->getExpireTime()) < now) {
-      if (expireCallback_) {
-        expireCallback_((*it)->getRunnable());
-      }
-      it = tasks_.erase(it);
-      ++expiredCount_;
-      if (justOne) {
-        return;
-      }
-    }
-    else
-    {
-      ++it;
-    }
-  }
+  expiredCount_ += tasks_.removeExpired(std::chrono::steady_clock::now(),
+                                        justOne,
+                                        [this](const shared_ptr<Runnable>& runnable) {
+                                          if (expireCallback_) {
+                                            expireCallback_(runnable);
+                                          }
+                                        });
 }
 
 void ThreadManager::Impl::setExpireCallback(ExpireCallback expireCallback) {
@@ -572,6 +870,22 @@ private:
   const size_t pendingTaskCountMax_;
 };
 
+void ThreadManager::setPriorityLanes(const std::vector<size_t>& weights) {
+  if (weights.size() != 1 || weights[0] == 0) {
+    throw InvalidArgumentException();
+  }
+}
+
+void ThreadManager::addToLane(size_t lane,
+                              shared_ptr<Runnable> task,
+                              int64_t timeout,
+                              int64_t expiration) {
+  if (lane != 0) {
+    throw InvalidArgumentException();
+  }
+  add(std::move(task), timeout, expiration);
+}
+
 shared_ptr<ThreadManager> ThreadManager::newThreadManager() {
   return shared_ptr<ThreadManager>(new ThreadManager::Impl());
 }
@@ -22,6 +22,7 @@
 
 #include <functional>
 #include <memory>
+#include <vector>
 #include <thrift/concurrency/ThreadFactory.h>
 
 namespace apache {
@@ -165,6 +166,38 @@ public:
                    int64_t timeout = 0LL,
                    int64_t expiration = 0LL) = 0;
 
+  /**
+   * Splits the pending task queue into priority lanes, one for each weight.
+   * Workers take tasks from the lanes that have any in proportion to their
+   * weights, so a lane of cheap calls with a high weight keeps moving while
+   * a lane of expensive calls is backed up.  Within a lane, tasks with an
+   * expiration run earliest deadline first, ahead of tasks without one,
+   * which run in the order added.
+   *
+   * Without lanes there is a single lane and tasks run in the order added.
+   * Lanes can only be set up while no tasks are pending.
+   *
+   * @throws InvalidArgumentException A weight is zero, or this thread
+   *                                  manager does not support lanes
+   * @throws IllegalStateException Tasks are pending
+   */
+  virtual void setPriorityLanes(const std::vector<size_t>& weights);
+
+  /**
+   * Returns the number of priority lanes, 1 if none were set up.
+   */
+  virtual size_t priorityLaneCount() const { return 1; }
+
+  /**
+   * Adds a task to a priority lane; otherwise as add().
+   *
+   * @throws InvalidArgumentException There is no such lane
+   */
+  virtual void addToLane(size_t lane,
+                         std::shared_ptr<Runnable> task,
+                         int64_t timeout = 0LL,
+                         int64_t expiration = 0LL);
+
   /**
    * Removes a pending task
    */
@@ -200,6 +233,25 @@ public:
   static std::shared_ptr<ThreadManager> newSimpleThreadManager(size_t count = 4,
                                                                  size_t pendingTaskCountMax = 0);
 
+  /**
+   * Creates a thread manager with count work-stealing worker threads and the
+   * same pendingTaskCountMax limit as newSimpleThreadManager().
+   *
+   * Each worker has a deque of its own: tasks added from a worker thread go
+   * onto that worker's deque, tasks added from any other thread go onto a
+   * shared injection queue, and a worker that runs out of work takes a batch
+   * from the injection queue or steals from another worker.  This keeps most
+   * submissions and dequeues off a shared lock when tasks spawn tasks or many
+   * threads submit at once.
+   *
+   * Tasks a worker has already taken into its deque are not visible to
+   * remove(), removeNextPending() or removeExpiredTasks(); those only see
+   * tasks still in the injection queue.  Expired tasks are still dropped
+   * when a worker reaches them.
+   */
+  static std::shared_ptr<ThreadManager> newWorkStealingThreadManager(size_t count = 4,
+                                                                       size_t pendingTaskCountMax = 0);
+
   class Task;
 
   class Worker;
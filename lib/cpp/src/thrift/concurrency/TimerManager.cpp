@@ -20,10 +20,12 @@
 #include <thrift/concurrency/TimerManager.h>
 #include <thrift/concurrency/Exception.h>
 
+#include <algorithm>
 #include <assert.h>
 #include <iostream>
+#include <map>
 #include <memory>
-#include <set>
+#include <vector>
 
 namespace apache {
 namespace thrift {
@@ -32,6 +34,8 @@ namespace concurrency {
 using std::shared_ptr;
 using std::weak_ptr;
 
+typedef std::chrono::time_point<std::chrono::steady_clock> time_point;
+
 /**
  * TimerManager class
  *
@@ -42,7 +46,14 @@ class TimerManager::Task : public Runnable {
 public:
   enum STATE { WAITING, EXECUTING, CANCELLED, COMPLETE };
 
-  Task(shared_ptr<Runnable> runnable) : runnable_(runnable), state_(WAITING) {}
+  Task(shared_ptr<Runnable> runnable)
+    : queued_(false),
+      tick_(0),
+      prev_(nullptr),
+      next_(nullptr),
+      list_(nullptr),
+      runnable_(runnable),
+      state_(WAITING) {}
 
   ~Task() override = default;
 
@@ -55,7 +66,18 @@ public:
 
   bool operator==(const shared_ptr<Runnable> & runnable) const { return runnable_ == runnable; }
 
-  task_iterator it_;
+  /// Whether the task is in the queue, rather than dispatched or removed
+  bool queued_;
+
+  /// Position in an OrderedTaskQueue
+  std::multimap<time_point, shared_ptr<Task> >::iterator it_;
+
+  /// Position in a WheelTaskQueue, which owns the task through self_
+  int64_t tick_;
+  Task* prev_;
+  Task* next_;
+  Task** list_;
+  shared_ptr<Task> self_;
 
 private:
   shared_ptr<Runnable> runnable_;
@@ -63,6 +85,299 @@ private:
   STATE state_;
 };
 
+/**
+ * Where the TimerManager keeps its pending tasks; always used under the
+ * manager's monitor.
+ */
+class TimerManager::TaskQueue {
+
+public:
+  virtual ~TaskQueue() = default;
+
+  virtual void insert(const shared_ptr<Task>& task, const time_point& abstime) = 0;
+
+  /**
+   * Removes a queued task.  The caller holds a reference to it.
+   */
+  virtual void erase(Task* task) = 0;
+
+  /**
+   * Removes every queued task running runnable, returning how many.
+   */
+  virtual size_t erase(const shared_ptr<Runnable>& runnable) = 0;
+
+  /**
+   * Moves the tasks due by now to expired, in the order they fell due.
+   */
+  virtual void takeExpired(const time_point& now, std::vector<shared_ptr<Task> >& expired) = 0;
+
+  /**
+   * Returns when takeExpired() should next be called if nothing is added
+   * meanwhile.  Only called with tasks queued.
+   */
+  virtual time_point nextWakeTime() const = 0;
+
+  virtual void clear() = 0;
+};
+
+/**
+ * Tasks in a multimap ordered by expiration time.
+ */
+class TimerManager::OrderedTaskQueue : public TimerManager::TaskQueue {
+
+public:
+  void insert(const shared_ptr<Task>& task, const time_point& abstime) override {
+    task->it_ = taskMap_.emplace(abstime, task);
+    task->queued_ = true;
+  }
+
+  void erase(Task* task) override {
+    task->queued_ = false;
+    taskMap_.erase(task->it_);
+  }
+
+  size_t erase(const shared_ptr<Runnable>& runnable) override {
+    size_t count = 0;
+    for (auto ix = taskMap_.begin(); ix != taskMap_.end();) {
+      if (*ix->second == runnable) {
+        ix->second->queued_ = false;
+        taskMap_.erase(ix++);
+        count++;
+      } else {
+        ++ix;
+      }
+    }
+    return count;
+  }
+
+  void takeExpired(const time_point& now, std::vector<shared_ptr<Task> >& expired) override {
+    auto expiredTaskEnd = taskMap_.upper_bound(now);
+    for (auto ix = taskMap_.begin(); ix != expiredTaskEnd; ix++) {
+      ix->second->queued_ = false;
+      expired.push_back(ix->second);
+    }
+    taskMap_.erase(taskMap_.begin(), expiredTaskEnd);
+  }
+
+  time_point nextWakeTime() const override { return taskMap_.begin()->first; }
+
+  void clear() override { taskMap_.clear(); }
+
+private:
+  std::multimap<time_point, shared_ptr<Task> > taskMap_;
+};
+
+/**
+ * A hierarchical timing wheel.  Time is counted in millisecond ticks since
+ * the queue was made; a task is due at the first tick at or after its
+ * expiration time.  Level 0 has a slot for each of the next SLOTS ticks,
+ * and each level above has slots SLOTS times as wide.  A task goes into the
+ * lowest level whose span reaches its tick and moves down a level each time
+ * the wheel below comes round to its slot, so adding, removing and firing
+ * a task each take constant time.  Tasks beyond the top level wait in an
+ * overflow list that is looked at whenever the top level moves.
+ */
+class TimerManager::WheelTaskQueue : public TimerManager::TaskQueue {
+
+public:
+  WheelTaskQueue()
+    : epoch_(std::chrono::steady_clock::now()), currentTick_(0), count_(0), overflow_(nullptr),
+      due_(nullptr) {
+    for (auto& level : wheel_) {
+      for (auto& slot : level) {
+        slot = nullptr;
+      }
+    }
+  }
+
+  ~WheelTaskQueue() override { clear(); }
+
+  void insert(const shared_ptr<Task>& task, const time_point& abstime) override {
+    // round up, so that a task never fires before its time
+    auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(abstime - epoch_);
+    if (epoch_ + delay < abstime) {
+      delay += std::chrono::milliseconds(1);
+    }
+    task->tick_ = delay.count();
+    task->self_ = task;
+    task->queued_ = true;
+    place(task.get());
+    count_++;
+  }
+
+  void erase(Task* task) override {
+    unlink(task);
+    count_--;
+    task->queued_ = false;
+    task->self_.reset();
+  }
+
+  size_t erase(const shared_ptr<Runnable>& runnable) override {
+    size_t count = 0;
+    forEachList([&](Task** list) {
+      for (Task* task = *list; task != nullptr;) {
+        Task* next = task->next_;
+        if (*task == runnable) {
+          erase(task);
+          count++;
+        }
+        task = next;
+      }
+    });
+    return count;
+  }
+
+  void takeExpired(const time_point& now, std::vector<shared_ptr<Task> >& expired) override {
+    const int64_t nowTick
+        = std::chrono::duration_cast<std::chrono::milliseconds>(now - epoch_).count();
+
+    if (count_ == 0) {
+      currentTick_ = std::max(currentTick_, nowTick);
+      return;
+    }
+
+    takeAll(&due_, expired);
+    while (currentTick_ < nowTick && count_ > 0) {
+      const int64_t tick = ++currentTick_;
+
+      // move the next slot of each level that has come round down a level,
+      // from the top so that tasks can fall more than one level at once
+      for (int level = LEVELS - 1; level > 0; level--) {
+        if ((tick & ((int64_t(1) << (level * SLOT_BITS)) - 1)) == 0) {
+          if (level == LEVELS - 1) {
+            replace(&overflow_);
+          }
+          replace(&wheel_[level][slotIndex(tick, level)]);
+        }
+      }
+
+      takeAll(&wheel_[0][slotIndex(tick, 0)], expired);
+      takeAll(&due_, expired);
+    }
+    if (count_ == 0) {
+      currentTick_ = std::max(currentTick_, nowTick);
+    }
+  }
+
+  time_point nextWakeTime() const override {
+    if (due_ != nullptr) {
+      return epoch_;
+    }
+
+    // the next full level 0 slot, or else the next time a slot comes down
+    // from above
+    const int64_t boundary = (currentTick_ | (SLOTS - 1)) + 1;
+    for (int64_t tick = currentTick_ + 1; tick < boundary; tick++) {
+      if (wheel_[0][slotIndex(tick, 0)] != nullptr) {
+        return epoch_ + std::chrono::milliseconds(tick);
+      }
+    }
+    return epoch_ + std::chrono::milliseconds(boundary);
+  }
+
+  void clear() override {
+    forEachList([&](Task** list) {
+      while (*list != nullptr) {
+        erase(*list);
+      }
+    });
+  }
+
+private:
+  static const int LEVELS = 4;
+  static const int SLOT_BITS = 8;
+  static const int64_t SLOTS = int64_t(1) << SLOT_BITS;
+
+  static size_t slotIndex(int64_t tick, int level) {
+    return static_cast<size_t>((tick >> (level * SLOT_BITS)) & (SLOTS - 1));
+  }
+
+  void place(Task* task) {
+    const int64_t delta = task->tick_ - currentTick_;
+    Task** list = &overflow_;
+    if (delta <= 0) {
+      list = &due_;
+    } else {
+      for (int level = 0; level < LEVELS; level++) {
+        if (delta < (int64_t(1) << ((level + 1) * SLOT_BITS))) {
+          list = &wheel_[level][slotIndex(task->tick_, level)];
+          break;
+        }
+      }
+    }
+
+    task->list_ = list;
+    task->prev_ = nullptr;
+    task->next_ = *list;
+    if (*list != nullptr) {
+      (*list)->prev_ = task;
+    }
+    *list = task;
+  }
+
+  static void unlink(Task* task) {
+    if (task->prev_ != nullptr) {
+      task->prev_->next_ = task->next_;
+    } else {
+      *task->list_ = task->next_;
+    }
+    if (task->next_ != nullptr) {
+      task->next_->prev_ = task->prev_;
+    }
+    task->prev_ = task->next_ = nullptr;
+    task->list_ = nullptr;
+  }
+
+  /**
+   * Puts the tasks of list where they now belong.
+   */
+  void replace(Task** list) {
+    Task* task = *list;
+    *list = nullptr;
+    while (task != nullptr) {
+      Task* next = task->next_;
+      place(task);
+      task = next;
+    }
+  }
+
+  void takeAll(Task** list, std::vector<shared_ptr<Task> >& expired) {
+    for (Task* task = *list; task != nullptr;) {
+      Task* next = task->next_;
+      task->queued_ = false;
+      task->prev_ = task->next_ = nullptr;
+      task->list_ = nullptr;
+      expired.push_back(std::move(task->self_));
+      count_--;
+      task = next;
+    }
+    *list = nullptr;
+  }
+
+  template <typename F>
+  void forEachList(F f) {
+    for (auto& level : wheel_) {
+      for (auto& slot : level) {
+        f(&slot);
+      }
+    }
+    f(&overflow_);
+    f(&due_);
+  }
+
+  const time_point epoch_;
+
+  /// The last tick whose tasks have been taken
+  int64_t currentTick_;
+
+  size_t count_;
+  Task* wheel_[LEVELS][SLOTS];
+  Task* overflow_;
+
+  /// Tasks already due when added
+  Task* due_;
+};
+
 class TimerManager::Dispatcher : public Runnable {
 
 public:
@@ -73,8 +388,8 @@ public:
   /**
    * Dispatcher entry point
    *
-   * As long as dispatcher thread is running, pull tasks off the task taskMap_
-   * and execute.
+   * As long as dispatcher thread is running, pull due tasks off the task
+   * queue and execute.
    */
   void run() override {
     {
@@ -85,46 +400,44 @@ public:
       }
     }
 
+    std::vector<shared_ptr<TimerManager::Task> > expiredTasks;
     do {
-      std::set<shared_ptr<TimerManager::Task> > expiredTasks;
       {
         Synchronized s(manager_->monitor_);
-        task_iterator expiredTaskEnd;
         auto now = std::chrono::steady_clock::now();
-        while (manager_->state_ == TimerManager::STARTED
-               && (expiredTaskEnd = manager_->taskMap_.upper_bound(now))
-                  == manager_->taskMap_.begin()) {
-          std::chrono::milliseconds timeout(0);
-          if (!manager_->taskMap_.empty()) {
-            timeout = std::chrono::duration_cast<std::chrono::milliseconds>(manager_->taskMap_.begin()->first - now);
+        while (manager_->state_ == TimerManager::STARTED) {
+          manager_->taskQueue_->takeExpired(now, expiredTasks);
+          if (!expiredTasks.empty()) {
+            break;
+          }
+
+          if (manager_->taskCount_ != 0) {
+            manager_->wakeTime_ = manager_->taskQueue_->nextWakeTime();
+            auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(manager_->wakeTime_ - now);
             //because the unit of steady_clock is smaller than millisecond,timeout may be 0.
-            if (timeout.count() == 0) {
+            if (timeout.count() <= 0) {
               timeout = std::chrono::milliseconds(1);
             }
             manager_->monitor_.waitForTimeRelative(timeout);
           } else {
+            manager_->wakeTime_ = time_point::max();
             manager_->monitor_.waitForTimeRelative(0);
           }
           now = std::chrono::steady_clock::now();
         }
 
-        if (manager_->state_ == TimerManager::STARTED) {
-          for (auto ix = manager_->taskMap_.begin(); ix != expiredTaskEnd; ix++) {
-            shared_ptr<TimerManager::Task> task = ix->second;
-            expiredTasks.insert(task);
-            task->it_ = manager_->taskMap_.end();
-            if (task->state_ == TimerManager::Task::WAITING) {
-              task->state_ = TimerManager::Task::EXECUTING;
-            }
-            manager_->taskCount_--;
+        for (const auto& task : expiredTasks) {
+          if (task->state_ == TimerManager::Task::WAITING) {
+            task->state_ = TimerManager::Task::EXECUTING;
           }
-          manager_->taskMap_.erase(manager_->taskMap_.begin(), expiredTaskEnd);
         }
+        manager_->taskCount_ -= expiredTasks.size();
       }
 
       for (const auto & expiredTask : expiredTasks) {
         expiredTask->run();
       }
+      expiredTasks.clear();
 
     } while (manager_->state_ == TimerManager::STARTED);
 
@@ -148,10 +461,16 @@ private:
 #pragma warning(disable : 4355) // 'this' used in base member initializer list
 #endif
 
-TimerManager::TimerManager()
+TimerManager::TimerManager(QUEUE queue)
   : taskCount_(0),
     state_(TimerManager::UNINITIALIZED),
+    wakeTime_(time_point::max()),
     dispatcher_(std::make_shared<Dispatcher>(this)) {
+  if (queue == TIMING_WHEEL) {
+    taskQueue_.reset(new WheelTaskQueue());
+  } else {
+    taskQueue_.reset(new OrderedTaskQueue());
+  }
 }
 
 #if defined(_MSC_VER)
@@ -217,7 +536,7 @@ void TimerManager::stop() {
 
   if (doStop) {
     // Clean up any outstanding tasks
-    taskMap_.clear();
+    taskQueue_->clear();
 
     // Remove dispatcher's reference to us.
     dispatcher_->manager_ = nullptr;
@@ -254,19 +573,16 @@ TimerManager::Timer TimerManager::add(shared_ptr<Runnable> task,
     throw IllegalStateException();
   }
 
-  // If the task map is empty, we will kick the dispatcher for sure. Otherwise, we kick him
-  // if the expiration time is shorter than the current value. Need to test before we insert,
-  // because the new task might insert at the front.
-  bool notifyRequired = (taskCount_ == 0) ? true : abstime < taskMap_.begin()->first;
+  // Kick the dispatcher if it is waiting for nothing or for something due
+  // later than this, so it can update its timeout
+  bool notifyRequired = abstime < wakeTime_;
 
   shared_ptr<Task> timer(new Task(task));
   taskCount_++;
-  timer->it_ = taskMap_.emplace(abstime, timer);
+  taskQueue_->insert(timer, abstime);
 
-  // If the task map was empty, or if we have an expiration that is earlier
-  // than any previously seen, kick the dispatcher so it can update its
-  // timeout
   if (notifyRequired) {
+    wakeTime_ = abstime;
     monitor_.notify();
   }
 
@@ -278,19 +594,11 @@ void TimerManager::remove(shared_ptr<Runnable> task) {
   if (state_ != TimerManager::STARTED) {
     throw IllegalStateException();
   }
-  bool found = false;
-  for (auto ix = taskMap_.begin(); ix != taskMap_.end();) {
-    if (*ix->second == task) {
-      found = true;
-      taskCount_--;
-      taskMap_.erase(ix++);
-    } else {
-      ++ix;
-    }
-  }
-  if (!found) {
+  size_t count = taskQueue_->erase(task);
+  if (count == 0) {
     throw NoSuchTaskException();
   }
+  taskCount_ -= count;
 }
 
 void TimerManager::remove(Timer handle) {
@@ -304,12 +612,12 @@ void TimerManager::remove(Timer handle) {
     throw NoSuchTaskException();
   }
 
-  if (task->it_ == taskMap_.end()) {
+  if (!task->queued_) {
     // Task is being executed
     throw UncancellableTaskException();
   }
 
-  taskMap_.erase(task->it_);
+  taskQueue_->erase(task.get());
   taskCount_--;
 }
 
@@ -23,8 +23,8 @@
 #include <thrift/concurrency/Monitor.h>
 #include <thrift/concurrency/ThreadFactory.h>
 
+#include <chrono>
 #include <memory>
-#include <map>
 
 namespace apache {
 namespace thrift {
@@ -43,7 +43,21 @@ public:
   class Task;
   typedef std::weak_ptr<Task> Timer;
 
-  TimerManager();
+  /**
+   * How pending timers are kept.
+   *
+   * ORDERED_MAP keeps them sorted by expiration time: adding or removing a
+   * timer is O(log n) and allocates a node.
+   *
+   * TIMING_WHEEL keeps them in a hierarchical timing wheel of millisecond
+   * ticks: adding or removing a timer is O(1) and allocates nothing, and
+   * timers falling due in the same tick are dispatched as one batch.  A
+   * timer may fire up to a millisecond late.  This suits many outstanding
+   * timers, such as a timeout for every request in flight.
+   */
+  enum QUEUE { ORDERED_MAP, TIMING_WHEEL };
+
+  TimerManager(QUEUE queue = ORDERED_MAP);
 
   virtual ~TimerManager();
 
@@ -117,18 +131,24 @@ public:
   virtual STATE state() const;
 
 private:
+  class TaskQueue;
+  class OrderedTaskQueue;
+  class WheelTaskQueue;
+
   std::shared_ptr<const ThreadFactory> threadFactory_;
   friend class Task;
-  std::multimap<std::chrono::time_point<std::chrono::steady_clock>, std::shared_ptr<Task> > taskMap_;
+  std::unique_ptr<TaskQueue> taskQueue_;
   size_t taskCount_;
   Monitor monitor_;
   STATE state_;
+
+  /// When the dispatcher is next due to look at the queue by itself
+  std::chrono::time_point<std::chrono::steady_clock> wakeTime_;
+
   class Dispatcher;
   friend class Dispatcher;
   std::shared_ptr<Dispatcher> dispatcher_;
   std::shared_ptr<Thread> dispatcherThread_;
-  using task_iterator = decltype(taskMap_)::iterator;
-  typedef std::pair<task_iterator, task_iterator> task_range;
 };
 }
 }
@@ -0,0 +1,831 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <thrift/thrift-config.h>
+
+#include <thrift/concurrency/ThreadManager.h>
+#include <thrift/concurrency/Exception.h>
+#include <thrift/concurrency/Monitor.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace apache {
+namespace thrift {
+namespace concurrency {
+
+using std::shared_ptr;
+
+namespace {
+
+/**
+ * A queued task.  The expiration, if any, is kept by value so that queueing
+ * a task costs a single allocation.
+ */
+struct StealableTask {
+  StealableTask(shared_ptr<Runnable> value, int64_t expiration)
+    : runnable(std::move(value)), expires(expiration != 0) {
+    if (expires) {
+      expireTime = std::chrono::steady_clock::now() + std::chrono::milliseconds(expiration);
+    }
+  }
+
+  bool isExpired(const std::chrono::steady_clock::time_point& now) const {
+    return expires && expireTime < now;
+  }
+
+  shared_ptr<Runnable> runnable;
+  bool expires;
+  std::chrono::steady_clock::time_point expireTime;
+};
+
+/**
+ * A bounded Chase-Lev deque.  Only the owning worker pushes and pops, at the
+ * bottom; any other worker may steal from the top.  When the deque is full
+ * push() fails and the owner hands the task to the injection queue instead.
+ */
+class TaskDeque {
+public:
+  static const int64_t CAPACITY = 256;
+
+  TaskDeque() : top_(0), bottom_(0) {
+    for (auto& slot : slots_) {
+      slot.store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  bool push(StealableTask* task) {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    int64_t top = top_.load(std::memory_order_acquire);
+    if (bottom - top >= CAPACITY) {
+      return false;
+    }
+    slots_[bottom & (CAPACITY - 1)].store(task, std::memory_order_relaxed);
+    bottom_.store(bottom + 1, std::memory_order_release);
+    return true;
+  }
+
+  StealableTask* pop() {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = top_.load(std::memory_order_relaxed);
+    if (top > bottom) {
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+
+    StealableTask* task = slots_[bottom & (CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (top == bottom) {
+      // the last task: race any thief for it
+      if (!top_.compare_exchange_strong(top,
+                                        top + 1,
+                                        std::memory_order_seq_cst,
+                                        std::memory_order_relaxed)) {
+        task = nullptr;
+      }
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return task;
+  }
+
+  StealableTask* steal() {
+    int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = bottom_.load(std::memory_order_acquire);
+    if (top >= bottom) {
+      return nullptr;
+    }
+
+    StealableTask* task = slots_[top & (CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (!top_.compare_exchange_strong(top,
+                                      top + 1,
+                                      std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      // lost to the owner or another thief; the caller moves on
+      return nullptr;
+    }
+    return task;
+  }
+
+private:
+  std::atomic<int64_t> top_;
+  std::atomic<int64_t> bottom_;
+  std::atomic<StealableTask*> slots_[CAPACITY];
+};
+}
+
+/**
+ * WorkStealingThreadManager class
+ *
+ * A ThreadManager whose workers each own a TaskDeque.  The deques are only
+ * ever added to, so a deque given up by a retiring worker is handed to the
+ * next worker started and thieves can walk the list without locking.
+ *
+ * pendingCount_ counts every queued task wherever it is and is reserved
+ * before a task is queued, which is what enforces pendingTaskCountMax.  A
+ * worker only parks once it has seen pendingCount_ at zero while counted in
+ * sleepers_, and an add() that sees sleepers_ nonzero wakes one, so no task
+ * is left waiting for a worker.
+ */
+class WorkStealingThreadManager : public ThreadManager {
+public:
+  WorkStealingThreadManager(size_t workerCount, size_t pendingTaskCountMax)
+    : initialWorkerCount_(workerCount),
+      pendingTaskCountMax_(pendingTaskCountMax),
+      workerCount_(0),
+      workerMaxCount_(0),
+      idleCount_(0),
+      pendingCount_(0),
+      totalCount_(0),
+      expiredCount_(0),
+      retiring_(0),
+      sleepers_(0),
+      addWaiters_(0),
+      injectedCount_(0),
+      deques_(new DequeList()),
+      state_(ThreadManager::UNINITIALIZED),
+      monitor_(&mutex_),
+      maxMonitor_(&mutex_),
+      workerMonitor_(&mutex_),
+      parkMonitor_(&parkMutex_) {}
+
+  ~WorkStealingThreadManager() override {
+    stop();
+    for (StealableTask* task : injected_) {
+      delete task;
+    }
+    delete deques_.load();
+  }
+
+  void start() override;
+  void stop() override;
+
+  ThreadManager::STATE state() const override { return state_; }
+
+  shared_ptr<ThreadFactory> threadFactory() const override {
+    Guard g(mutex_);
+    return threadFactory_;
+  }
+
+  void threadFactory(shared_ptr<ThreadFactory> value) override {
+    Guard g(mutex_);
+    if (threadFactory_ && threadFactory_->isDetached() != value->isDetached()) {
+      throw InvalidArgumentException();
+    }
+    threadFactory_ = value;
+  }
+
+  void addWorker(size_t value) override;
+
+  void removeWorker(size_t value) override {
+    Guard g(mutex_);
+    removeWorkersUnderLock(value);
+  }
+
+  size_t idleWorkerCount() const override { return idleCount_; }
+
+  size_t workerCount() const override {
+    Guard g(mutex_);
+    return workerCount_;
+  }
+
+  size_t pendingTaskCount() const override { return pendingCount_; }
+
+  size_t totalTaskCount() const override { return totalCount_; }
+
+  size_t pendingTaskCountMax() const override { return pendingTaskCountMax_; }
+
+  size_t expiredTaskCount() const override { return expiredCount_; }
+
+  void add(shared_ptr<Runnable> value, int64_t timeout, int64_t expiration) override;
+
+  void remove(shared_ptr<Runnable> task) override;
+
+  shared_ptr<Runnable> removeNextPending() override;
+
+  void removeExpiredTasks() override {
+    Guard g(mutex_);
+    removeExpired(false);
+  }
+
+  void setExpireCallback(ExpireCallback expireCallback) override {
+    Guard g(mutex_);
+    expireCallback_ = expireCallback;
+  }
+
+private:
+  class Worker;
+  friend class Worker;
+
+  typedef std::vector<TaskDeque*> DequeList;
+
+  /// Upper bound on the tasks a worker moves from the injection queue at once
+  static const size_t MAX_BATCH = 32;
+
+  /// Scans for work before a worker parks
+  static const int SPIN_ROUNDS = 2;
+
+  /**
+   * Reserves room for a task against pendingTaskCountMax_, blocking or
+   * throwing as add() documents when there is none.
+   */
+  void reserve(int64_t timeout);
+  bool tryReserve();
+
+  /**
+   * Queues an already reserved task, on the calling worker's deque if there
+   * is one, and wakes a parked worker if need be.
+   */
+  void enqueue(StealableTask* task);
+  void inject(StealableTask* task);
+  void wakeWorker();
+
+  /**
+   * Claims a deque for a starting worker, or returns nullptr if it is not
+   * needed after all.
+   */
+  TaskDeque* attachWorker();
+  void detachWorker(TaskDeque* deque, shared_ptr<Thread> thread);
+
+  /**
+   * Returns the next task for the worker owning deque, parking while there
+   * is none, or nullptr once the worker is to retire.
+   */
+  StealableTask* nextTask(TaskDeque* deque);
+  StealableTask* takeInjected(TaskDeque* deque);
+  StealableTask* steal(TaskDeque* deque);
+  bool shouldRetire();
+  void park();
+
+  /**
+   * Accounts for a task having left its queue.
+   */
+  void claimed();
+
+  void execute(StealableTask* task);
+
+  /**
+   * Removes one or more expired tasks from the injection queue.  The caller
+   * holds mutex_.
+   */
+  void removeExpired(bool justOne);
+
+  bool canSleep() const;
+
+  void removeWorkersUnderLock(size_t value);
+
+  const size_t initialWorkerCount_;
+  const size_t pendingTaskCountMax_;
+
+  size_t workerCount_;
+  size_t workerMaxCount_;
+  std::atomic<size_t> idleCount_;
+  std::atomic<size_t> pendingCount_;
+  std::atomic<size_t> totalCount_;
+  std::atomic<size_t> expiredCount_;
+  std::atomic<size_t> retiring_;
+  std::atomic<size_t> sleepers_;
+  std::atomic<size_t> addWaiters_;
+  ExpireCallback expireCallback_;
+
+  /// Tasks added from outside the pool, oldest first
+  std::deque<StealableTask*> injected_;
+  std::atomic<size_t> injectedCount_;
+  Mutex injectedMutex_;
+
+  /// Every worker deque ever created; replaced, never changed, under mutex_
+  std::atomic<DequeList*> deques_;
+  std::vector<std::unique_ptr<TaskDeque> > ownedDeques_;
+  std::vector<std::unique_ptr<DequeList> > retiredDequeLists_;
+  std::vector<TaskDeque*> freeDeques_;
+
+  std::atomic<ThreadManager::STATE> state_;
+  shared_ptr<ThreadFactory> threadFactory_;
+
+  Mutex mutex_;
+  Monitor monitor_;
+  Monitor maxMonitor_;
+  Monitor workerMonitor_;
+  Mutex parkMutex_;
+  Monitor parkMonitor_;
+
+  std::set<shared_ptr<Thread> > workers_;
+  std::set<shared_ptr<Thread> > deadWorkers_;
+  std::map<const Thread::id_t, shared_ptr<Thread> > idMap_;
+
+  /// The manager and deque of the worker running on this thread, if any
+  static thread_local WorkStealingThreadManager* currentManager_;
+  static thread_local TaskDeque* currentDeque_;
+  static thread_local uint32_t stealSeed_;
+};
+
+const size_t WorkStealingThreadManager::MAX_BATCH;
+const int WorkStealingThreadManager::SPIN_ROUNDS;
+
+thread_local WorkStealingThreadManager* WorkStealingThreadManager::currentManager_ = nullptr;
+thread_local TaskDeque* WorkStealingThreadManager::currentDeque_ = nullptr;
+thread_local uint32_t WorkStealingThreadManager::stealSeed_ = 0;
+
+class WorkStealingThreadManager::Worker : public Runnable {
+public:
+  Worker(WorkStealingThreadManager* manager) : manager_(manager) {}
+
+  ~Worker() override = default;
+
+  /**
+   * Worker entry point
+   *
+   * Runs tasks from the worker's own deque, the injection queue or other
+   * workers' deques until asked to retire.
+   */
+  void run() override {
+    TaskDeque* deque = manager_->attachWorker();
+    if (deque == nullptr) {
+      return;
+    }
+
+    currentManager_ = manager_;
+    currentDeque_ = deque;
+    stealSeed_ = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(deque) >> 4) | 1;
+
+    while (StealableTask* task = manager_->nextTask(deque)) {
+      manager_->execute(task);
+    }
+
+    currentManager_ = nullptr;
+    currentDeque_ = nullptr;
+    manager_->detachWorker(deque, this->thread());
+  }
+
+private:
+  WorkStealingThreadManager* manager_;
+};
+
+void WorkStealingThreadManager::start() {
+  {
+    Guard g(mutex_);
+    if (state_ == ThreadManager::STOPPED) {
+      return;
+    }
+
+    if (state_ == ThreadManager::UNINITIALIZED) {
+      if (!threadFactory_) {
+        throw InvalidArgumentException();
+      }
+      state_ = ThreadManager::STARTED;
+      monitor_.notifyAll();
+    }
+
+    while (state_ == STARTING) {
+      monitor_.wait();
+    }
+  }
+
+  addWorker(initialWorkerCount_);
+}
+
+void WorkStealingThreadManager::stop() {
+  Guard g(mutex_);
+  bool doStop = false;
+
+  if (state_ != ThreadManager::STOPPING && state_ != ThreadManager::JOINING
+      && state_ != ThreadManager::STOPPED) {
+    doStop = true;
+    state_ = ThreadManager::JOINING;
+  }
+
+  if (doStop) {
+    removeWorkersUnderLock(workerCount_);
+  }
+
+  state_ = ThreadManager::STOPPED;
+}
+
+void WorkStealingThreadManager::addWorker(size_t value) {
+  std::set<shared_ptr<Thread> > newThreads;
+  for (size_t ix = 0; ix < value; ix++) {
+    newThreads.insert(threadFactory_->newThread(std::make_shared<Worker>(this)));
+  }
+
+  Guard g(mutex_);
+  workerMaxCount_ += value;
+  workers_.insert(newThreads.begin(), newThreads.end());
+
+  for (const auto& newThread : newThreads) {
+    newThread->start();
+    idMap_.insert(std::pair<const Thread::id_t, shared_ptr<Thread> >(newThread->getId(), newThread));
+  }
+
+  while (workerCount_ != workerMaxCount_) {
+    workerMonitor_.wait();
+  }
+}
+
+void WorkStealingThreadManager::removeWorkersUnderLock(size_t value) {
+  if (value > workerMaxCount_) {
+    throw InvalidArgumentException();
+  }
+
+  workerMaxCount_ -= value;
+  retiring_ += value;
+
+  // Retiring is claimed by whichever workers get to it first, so all of the
+  // parked ones are woken to look.
+  {
+    Guard p(parkMutex_);
+    parkMonitor_.notifyAll();
+  }
+
+  while (workerCount_ != workerMaxCount_) {
+    workerMonitor_.wait();
+  }
+
+  for (const auto& deadWorker : deadWorkers_) {
+
+    // when used with a joinable thread factory, we join the threads as we remove them
+    if (!threadFactory_->isDetached()) {
+      deadWorker->join();
+    }
+
+    idMap_.erase(deadWorker->getId());
+    workers_.erase(deadWorker);
+  }
+
+  deadWorkers_.clear();
+}
+
+TaskDeque* WorkStealingThreadManager::attachWorker() {
+  Guard g(mutex_);
+  if (workerCount_ >= workerMaxCount_) {
+    return nullptr;
+  }
+
+  TaskDeque* deque;
+  if (!freeDeques_.empty()) {
+    deque = freeDeques_.back();
+    freeDeques_.pop_back();
+  } else {
+    ownedDeques_.emplace_back(new TaskDeque());
+    deque = ownedDeques_.back().get();
+
+    // Thieves may be walking the current list, so it is retired rather than
+    // freed until the manager is destroyed.
+    std::unique_ptr<DequeList> list(new DequeList(*deques_.load()));
+    list->push_back(deque);
+    retiredDequeLists_.emplace_back(deques_.exchange(list.release()));
+  }
+
+  ++idleCount_;
+  if (++workerCount_ == workerMaxCount_) {
+    workerMonitor_.notify();
+  }
+  return deque;
+}
+
+void WorkStealingThreadManager::detachWorker(TaskDeque* deque, shared_ptr<Thread> thread) {
+  // Anything still on the deque goes back to the others
+  bool handedOver = false;
+  while (StealableTask* task = deque->pop()) {
+    inject(task);
+    handedOver = true;
+  }
+  if (handedOver) {
+    wakeWorker();
+  }
+
+  Guard g(mutex_);
+  freeDeques_.push_back(deque);
+  --idleCount_;
+  deadWorkers_.insert(thread);
+  if (--workerCount_ == workerMaxCount_) {
+    workerMonitor_.notify();
+  }
+}
+
+bool WorkStealingThreadManager::canSleep() const {
+  const Thread::id_t id = threadFactory_->getCurrentThreadId();
+  return idMap_.find(id) == idMap_.end();
+}
+
+bool WorkStealingThreadManager::tryReserve() {
+  size_t pending = pendingCount_.load();
+  do {
+    if (pendingTaskCountMax_ > 0 && pending >= pendingTaskCountMax_) {
+      return false;
+    }
+  } while (!pendingCount_.compare_exchange_weak(pending, pending + 1));
+  return true;
+}
+
+void WorkStealingThreadManager::reserve(int64_t timeout) {
+  if (tryReserve()) {
+    return;
+  }
+
+  Guard g(mutex_, timeout);
+  if (!g) {
+    throw TimedOutException();
+  }
+
+  // if we're at a limit, remove an expired task to see if the limit clears
+  removeExpired(true);
+  if (tryReserve()) {
+    return;
+  }
+
+  if (!canSleep() || timeout < 0) {
+    throw TooManyPendingTasksException();
+  }
+
+  // Workers only notify when they see a waiter, so the count is raised
+  // before the last look at pendingCount_.
+  ++addWaiters_;
+  try {
+    while (!tryReserve()) {
+      // This is thread safe because the mutex is shared between monitors.
+      maxMonitor_.wait(timeout);
+    }
+  } catch (...) {
+    --addWaiters_;
+    throw;
+  }
+  --addWaiters_;
+}
+
+void WorkStealingThreadManager::add(shared_ptr<Runnable> value,
+                                    int64_t timeout,
+                                    int64_t expiration) {
+  if (state_ != ThreadManager::STARTED) {
+    throw IllegalStateException(
+        "WorkStealingThreadManager::add ThreadManager "
+        "not started");
+  }
+
+  reserve(timeout);
+  ++totalCount_;
+
+  StealableTask* task;
+  try {
+    task = new StealableTask(std::move(value), expiration);
+  } catch (...) {
+    --totalCount_;
+    --pendingCount_;
+    throw;
+  }
+  enqueue(task);
+}
+
+void WorkStealingThreadManager::enqueue(StealableTask* task) {
+  if (currentManager_ != this || !currentDeque_->push(task)) {
+    inject(task);
+  }
+  wakeWorker();
+}
+
+void WorkStealingThreadManager::inject(StealableTask* task) {
+  Guard g(injectedMutex_);
+  injected_.push_back(task);
+  injectedCount_ = injected_.size();
+}
+
+void WorkStealingThreadManager::wakeWorker() {
+  if (sleepers_ > 0) {
+    Guard p(parkMutex_);
+    parkMonitor_.notify();
+  }
+}
+
+StealableTask* WorkStealingThreadManager::nextTask(TaskDeque* deque) {
+  for (;;) {
+    for (int round = 0; round < SPIN_ROUNDS; ++round) {
+      if (shouldRetire()) {
+        return nullptr;
+      }
+
+      StealableTask* task = deque->pop();
+      if (task == nullptr) {
+        task = takeInjected(deque);
+      }
+      if (task == nullptr) {
+        task = steal(deque);
+      }
+      if (task != nullptr) {
+        claimed();
+        return task;
+      }
+      std::this_thread::yield();
+    }
+    park();
+  }
+}
+
+StealableTask* WorkStealingThreadManager::takeInjected(TaskDeque* deque) {
+  if (injectedCount_ == 0) {
+    return nullptr;
+  }
+
+  Guard g(injectedMutex_);
+  if (injected_.empty()) {
+    return nullptr;
+  }
+
+  StealableTask* task = injected_.front();
+  injected_.pop_front();
+
+  // Take a share of the rest so the next few tasks need no lock; the share
+  // stays small enough for idle workers to steal from.
+  size_t share = std::min(injected_.size() / std::max<size_t>(deques_.load()->size(), 1),
+                          MAX_BATCH);
+  for (size_t ix = 0; ix < share && deque->push(injected_.front()); ix++) {
+    injected_.pop_front();
+  }
+
+  injectedCount_ = injected_.size();
+  return task;
+}
+
+StealableTask* WorkStealingThreadManager::steal(TaskDeque* deque) {
+  const DequeList& deques = *deques_.load();
+  const size_t count = deques.size();
+  if (count < 2) {
+    return nullptr;
+  }
+
+  // xorshift, so that thieves do not all start on the same victim
+  stealSeed_ ^= stealSeed_ << 13;
+  stealSeed_ ^= stealSeed_ >> 17;
+  stealSeed_ ^= stealSeed_ << 5;
+
+  const size_t start = stealSeed_ % count;
+  for (size_t ix = 0; ix < count; ix++) {
+    TaskDeque* victim = deques[(start + ix) % count];
+    if (victim != deque) {
+      if (StealableTask* task = victim->steal()) {
+        return task;
+      }
+    }
+  }
+  return nullptr;
+}
+
+bool WorkStealingThreadManager::shouldRetire() {
+  size_t retiring = retiring_.load();
+  while (retiring > 0) {
+    // A joining manager runs every pending task before its workers go
+    if (state_ == ThreadManager::JOINING && pendingCount_ > 0) {
+      return false;
+    }
+    if (retiring_.compare_exchange_weak(retiring, retiring - 1)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void WorkStealingThreadManager::park() {
+  Guard p(parkMutex_);
+  ++sleepers_;
+  if (pendingCount_ == 0 && retiring_ == 0) {
+    parkMonitor_.waitForever();
+  }
+  --sleepers_;
+}
+
+void WorkStealingThreadManager::claimed() {
+  --idleCount_;
+  --pendingCount_;
+
+  // If we have a pending task max and we just dropped below it, wakeup any
+  // thread that might be blocked on add.
+  if (pendingTaskCountMax_ != 0 && addWaiters_ > 0) {
+    Guard g(mutex_);
+    maxMonitor_.notify();
+  }
+}
+
+void WorkStealingThreadManager::execute(StealableTask* task) {
+  if (!task->isExpired(std::chrono::steady_clock::now())) {
+    try {
+      task->runnable->run();
+    } catch (const std::exception& e) {
+      GlobalOutput.printf("[ERROR] task->run() raised an exception: %s", e.what());
+    } catch (...) {
+      GlobalOutput.printf("[ERROR] task->run() raised an unknown exception");
+    }
+  } else {
+    ExpireCallback expireCallback;
+    {
+      Guard g(mutex_);
+      expireCallback = expireCallback_;
+    }
+    if (expireCallback) {
+      expireCallback(task->runnable);
+      ++expiredCount_;
+    }
+  }
+
+  delete task;
+  --totalCount_;
+  ++idleCount_;
+}
+
+void WorkStealingThreadManager::remove(shared_ptr<Runnable> task) {
+  if (state_ != ThreadManager::STARTED) {
+    throw IllegalStateException(
+        "WorkStealingThreadManager::remove ThreadManager not "
+        "started");
+  }
+
+  Guard g(injectedMutex_);
+  for (auto it = injected_.begin(); it != injected_.end(); ++it) {
+    if ((*it)->runnable == task) {
+      delete *it;
+      injected_.erase(it);
+      injectedCount_ = injected_.size();
+      --pendingCount_;
+      --totalCount_;
+      return;
+    }
+  }
+}
+
+shared_ptr<Runnable> WorkStealingThreadManager::removeNextPending() {
+  if (state_ != ThreadManager::STARTED) {
+    throw IllegalStateException(
+        "WorkStealingThreadManager::removeNextPending "
+        "ThreadManager not started");
+  }
+
+  Guard g(injectedMutex_);
+  if (injected_.empty()) {
+    return shared_ptr<Runnable>();
+  }
+
+  std::unique_ptr<StealableTask> task(injected_.front());
+  injected_.pop_front();
+  injectedCount_ = injected_.size();
+  --pendingCount_;
+  --totalCount_;
+  return task->runnable;
+}
+
+void WorkStealingThreadManager::removeExpired(bool justOne) {
+  // this is always called under mutex_
+  Guard g(injectedMutex_);
+  if (injected_.empty()) {
+    return;
+  }
+  auto now = std::chrono::steady_clock::now();
+
+  for (auto it = injected_.begin(); it != injected_.end();) {
+    if ((*it)->isExpired(now)) {
+      std::unique_ptr<StealableTask> task(*it);
+      it = injected_.erase(it);
+      injectedCount_ = injected_.size();
+      --pendingCount_;
+      --totalCount_;
+      if (expireCallback_) {
+        expireCallback_(task->runnable);
+      }
+      ++expiredCount_;
+      if (justOne) {
+        return;
+      }
+    } else {
+      ++it;
+    }
+  }
+}
+
+shared_ptr<ThreadManager> ThreadManager::newWorkStealingThreadManager(size_t count,
+                                                                      size_t pendingTaskCountMax) {
+  return shared_ptr<ThreadManager>(new WorkStealingThreadManager(count, pendingTaskCountMax));
+}
+}
+}
+} // apache::thrift::concurrency
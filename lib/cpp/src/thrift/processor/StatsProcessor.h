@@ -32,6 +32,8 @@ namespace processor {
 /*
  * Class for keeping track of function call statistics and printing them if desired
  *
+ * This reads every call a second time and is meant for debugging; for call
+ * statistics cheap enough to leave on in production see TStatsEventHandler.
  */
 class StatsProcessor : public apache::thrift::TProcessor {
 public:
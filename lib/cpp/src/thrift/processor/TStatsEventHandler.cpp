@@ -0,0 +1,317 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <thrift/processor/TStatsEventHandler.h>
+
+#include <algorithm>
+#include <chrono>
+
+namespace apache {
+namespace thrift {
+namespace processor {
+
+using concurrency::Guard;
+
+const size_t TShardedCounter::SHARDS;
+const size_t TLatencyHistogram::SHARDS;
+const int TLatencyHistogram::SUB_BITS;
+const int TLatencyHistogram::MAX_EXPONENT;
+const size_t TLatencyHistogram::BUCKETS;
+
+namespace {
+
+std::atomic<size_t> nextShardIndex(0);
+std::atomic<uint64_t> nextHandlerId(1);
+
+inline int log2Floor(uint64_t value) {
+  int result = 0;
+  while (value >>= 1) {
+    ++result;
+  }
+  return result;
+}
+}
+
+TShardedCounter::TShardedCounter() {
+  for (auto& shard : shards_) {
+    shard.value.store(0, std::memory_order_relaxed);
+  }
+}
+
+int64_t TShardedCounter::get() const {
+  int64_t result = 0;
+  for (const auto& shard : shards_) {
+    result += shard.value.load(std::memory_order_relaxed);
+  }
+  return result;
+}
+
+size_t TShardedCounter::shardIndex() {
+  // threads take the shards in turn, so up to SHARDS threads never share one
+  static thread_local size_t index = nextShardIndex.fetch_add(1, std::memory_order_relaxed);
+  return index;
+}
+
+TLatencyHistogram::Shard::Shard() : sum(0), max(0) {
+  for (auto& bucket : buckets) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+TLatencyHistogram::TLatencyHistogram() : shards_(new Shard[SHARDS]) {
+}
+
+size_t TLatencyHistogram::bucketIndex(uint64_t value) {
+  const uint64_t subBuckets = uint64_t(1) << SUB_BITS;
+  if (value < subBuckets) {
+    return static_cast<size_t>(value);
+  }
+  int exponent = log2Floor(value);
+  if (exponent > MAX_EXPONENT) {
+    return BUCKETS - 1;
+  }
+  uint64_t sub = (value >> (exponent - SUB_BITS)) & (subBuckets - 1);
+  return (static_cast<size_t>(exponent - SUB_BITS + 1) << SUB_BITS) + static_cast<size_t>(sub);
+}
+
+uint64_t TLatencyHistogram::bucketUpperBound(size_t bucket) {
+  const size_t subBuckets = size_t(1) << SUB_BITS;
+  if (bucket < subBuckets) {
+    return bucket;
+  }
+  int exponent = static_cast<int>(bucket >> SUB_BITS) + SUB_BITS - 1;
+  uint64_t sub = bucket & (subBuckets - 1);
+  uint64_t lower = (subBuckets + sub) << (exponent - SUB_BITS);
+  return lower + (uint64_t(1) << (exponent - SUB_BITS)) - 1;
+}
+
+void TLatencyHistogram::record(uint64_t value) {
+  Shard& shard = shards_[TShardedCounter::shardIndex() % SHARDS];
+  shard.buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+  shard.sum.fetch_add(value, std::memory_order_relaxed);
+  uint64_t max = shard.max.load(std::memory_order_relaxed);
+  while (value > max && !shard.max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+  }
+}
+
+THistogramSnapshot TLatencyHistogram::snapshot() const {
+  THistogramSnapshot result;
+  result.buckets.assign(BUCKETS, 0);
+  for (size_t ix = 0; ix < SHARDS; ix++) {
+    const Shard& shard = shards_[ix];
+    for (size_t bucket = 0; bucket < BUCKETS; bucket++) {
+      uint64_t count = shard.buckets[bucket].load(std::memory_order_relaxed);
+      result.buckets[bucket] += count;
+      result.count += count;
+    }
+    result.sum += shard.sum.load(std::memory_order_relaxed);
+    result.max = (std::max)(result.max, shard.max.load(std::memory_order_relaxed));
+  }
+  return result;
+}
+
+uint64_t THistogramSnapshot::percentile(double q) const {
+  if (count == 0) {
+    return 0;
+  }
+  q = (std::min)((std::max)(q, 0.0), 1.0);
+  uint64_t rank = (std::max)(uint64_t(1), static_cast<uint64_t>(q * count + 0.5));
+  uint64_t seen = 0;
+  for (size_t bucket = 0; bucket < buckets.size(); bucket++) {
+    seen += buckets[bucket];
+    if (seen >= rank) {
+      return (std::min)(TLatencyHistogram::bucketUpperBound(bucket), max);
+    }
+  }
+  return max;
+}
+
+THistogramSnapshot& THistogramSnapshot::operator+=(const THistogramSnapshot& other) {
+  count += other.count;
+  sum += other.sum;
+  max = (std::max)(max, other.max);
+  if (buckets.size() < other.buckets.size()) {
+    buckets.resize(other.buckets.size(), 0);
+  }
+  for (size_t bucket = 0; bucket < other.buckets.size(); bucket++) {
+    buckets[bucket] += other.buckets[bucket];
+  }
+  return *this;
+}
+
+struct TStatsEventHandler::Method {
+  Method(const std::string& n) : name(n) {}
+
+  const std::string name;
+  TShardedCounter calls;
+  TShardedCounter errors;
+  TShardedCounter bytesIn;
+  TShardedCounter bytesOut;
+  TLatencyHistogram latencyUs;
+};
+
+struct TStatsEventHandler::CallContext {
+  Method* method;
+  std::chrono::steady_clock::time_point start;
+};
+
+/**
+ * Contexts are reused rather than allocated for every call.  A call may
+ * end on another thread than it began on, as with an async processor, so
+ * each thread keeps at most CONTEXT_POOL_SIZE and deletes any beyond that.
+ */
+struct TStatsEventHandler::ContextPool {
+  static const size_t CONTEXT_POOL_SIZE = 64;
+
+  ContextPool() { contexts.reserve(CONTEXT_POOL_SIZE); }
+
+  ~ContextPool() {
+    for (CallContext* context : contexts) {
+      delete context;
+    }
+  }
+
+  std::vector<CallContext*> contexts;
+};
+
+const size_t TStatsEventHandler::ContextPool::CONTEXT_POOL_SIZE;
+
+namespace {
+
+/**
+ * Methods a thread has looked up lately.  Processors pass the same
+ * string constant for every call of a method, so it is found by address,
+ * and the name is compared in case the address was reused.
+ */
+struct MethodCacheEntry {
+  uint64_t handler;
+  const char* name;
+  void* method;
+};
+
+const size_t METHOD_CACHE_SIZE = 64;
+
+thread_local std::vector<MethodCacheEntry> methodCache;
+}
+
+TStatsEventHandler::TStatsEventHandler() : id_(nextHandlerId.fetch_add(1)) {
+}
+
+TStatsEventHandler::~TStatsEventHandler() = default;
+
+TStatsEventHandler::Method* TStatsEventHandler::lookup(const char* fn_name) {
+  for (const auto& entry : methodCache) {
+    if (entry.name == fn_name && entry.handler == id_) {
+      auto* method = static_cast<Method*>(entry.method);
+      if (method->name == fn_name) {
+        return method;
+      }
+    }
+  }
+
+  Method* method;
+  {
+    Guard g(mutex_);
+    std::unique_ptr<Method>& slot = methods_[fn_name];
+    if (!slot) {
+      slot.reset(new Method(fn_name));
+    }
+    method = slot.get();
+  }
+
+  if (methodCache.size() == METHOD_CACHE_SIZE) {
+    methodCache.clear();
+  }
+  MethodCacheEntry entry = {id_, fn_name, method};
+  methodCache.push_back(entry);
+  return method;
+}
+
+TStatsEventHandler::ContextPool& TStatsEventHandler::contextPool() {
+  static thread_local ContextPool pool;
+  return pool;
+}
+
+void* TStatsEventHandler::getContext(const char* fn_name, void* serverContext) {
+  (void)serverContext;
+  Method* method = lookup(fn_name);
+  method->calls.increment();
+
+  std::vector<CallContext*>& pool = contextPool().contexts;
+  CallContext* context;
+  if (pool.empty()) {
+    context = new CallContext;
+  } else {
+    context = pool.back();
+    pool.pop_back();
+  }
+  context->method = method;
+  context->start = std::chrono::steady_clock::now();
+  return context;
+}
+
+void TStatsEventHandler::freeContext(void* ctx, const char* fn_name) {
+  (void)fn_name;
+  auto* context = static_cast<CallContext*>(ctx);
+  auto elapsed = std::chrono::steady_clock::now() - context->start;
+  context->method->latencyUs.record(static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+
+  std::vector<CallContext*>& pool = contextPool().contexts;
+  if (pool.size() < ContextPool::CONTEXT_POOL_SIZE) {
+    pool.push_back(context);
+  } else {
+    delete context;
+  }
+}
+
+void TStatsEventHandler::postRead(void* ctx, const char* fn_name, uint32_t bytes) {
+  (void)fn_name;
+  static_cast<CallContext*>(ctx)->method->bytesIn.add(bytes);
+}
+
+void TStatsEventHandler::postWrite(void* ctx, const char* fn_name, uint32_t bytes) {
+  (void)fn_name;
+  static_cast<CallContext*>(ctx)->method->bytesOut.add(bytes);
+}
+
+void TStatsEventHandler::handlerError(void* ctx, const char* fn_name) {
+  (void)fn_name;
+  static_cast<CallContext*>(ctx)->method->errors.increment();
+}
+
+std::vector<TMethodStats> TStatsEventHandler::getStats() const {
+  std::vector<TMethodStats> result;
+  Guard g(mutex_);
+  result.reserve(methods_.size());
+  for (const auto& entry : methods_) {
+    TMethodStats stats;
+    stats.name = entry.first;
+    stats.calls = entry.second->calls.get();
+    stats.errors = entry.second->errors.get();
+    stats.bytesIn = entry.second->bytesIn.get();
+    stats.bytesOut = entry.second->bytesOut.get();
+    stats.latencyUs = entry.second->latencyUs.snapshot();
+    result.push_back(stats);
+  }
+  return result;
+}
+}
+}
+} // apache::thrift::processor
@@ -0,0 +1,222 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _THRIFT_PROCESSOR_TSTATSEVENTHANDLER_H_
+#define _THRIFT_PROCESSOR_TSTATSEVENTHANDLER_H_ 1
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <thrift/TNonCopyable.h>
+#include <thrift/TProcessor.h>
+#include <thrift/concurrency/Mutex.h>
+
+namespace apache {
+namespace thrift {
+namespace processor {
+
+/**
+ * A counter that many threads can add to without contending.
+ *
+ * Each thread adds to one of SHARDS counters, each on a cache line of its
+ * own wherever the counter is put, and reading sums them.  Adding is a relaxed atomic add to a line
+ * that is rarely shared; reading is slower and only as exact as a sum of
+ * concurrent counters can be.
+ */
+class TShardedCounter : TNonCopyable {
+public:
+  static const size_t SHARDS = 16;
+
+  TShardedCounter();
+
+  void add(int64_t value) {
+    shards_[shardIndex() % SHARDS].value.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  void increment() { add(1); }
+
+  /// Sums the shards.
+  int64_t get() const;
+
+  /// The shard the calling thread adds to; stable for the life of the thread.
+  static size_t shardIndex();
+
+private:
+  // The values are a cache line apart and there is a line's worth of padding
+  // before the first, so no value shares a line with another or with what
+  // lies around the counter.  That holds without aligning the counter, which
+  // C++11 cannot do for one allocated with new.
+  struct Shard {
+    std::atomic<int64_t> value;
+    char pad[64 - sizeof(std::atomic<int64_t>)];
+  };
+
+  char pad_[64];
+  Shard shards_[SHARDS];
+};
+
+/**
+ * The contents of a TLatencyHistogram at one moment.
+ */
+struct THistogramSnapshot {
+  THistogramSnapshot() : count(0), sum(0), max(0) {}
+
+  /// Values recorded
+  uint64_t count;
+
+  /// Their sum, and the largest of them
+  uint64_t sum;
+  uint64_t max;
+
+  /// Values recorded in each bucket; see TLatencyHistogram::bucketUpperBound()
+  std::vector<uint64_t> buckets;
+
+  double mean() const { return count ? static_cast<double>(sum) / count : 0.0; }
+
+  /**
+   * Gets a value that at least the fraction q (0 to 1) of the recorded
+   * values are no greater than, to within the bucket precision.
+   */
+  uint64_t percentile(double q) const;
+
+  /// Adds another snapshot's figures to these.
+  THistogramSnapshot& operator+=(const THistogramSnapshot& other);
+};
+
+/**
+ * A histogram of non-negative values, such as latencies in microseconds,
+ * that many threads can record into without contending.
+ *
+ * Buckets are log-linear, as in an HDR histogram: each power of two is
+ * split into 2^SUB_BITS equal buckets, so a value is known to within
+ * 1/2^SUB_BITS of itself, from 0 up to 2^MAX_EXPONENT; larger values go
+ * in the last bucket.  Like TShardedCounter each thread records into a
+ * shard of its own and snapshot() merges them, at SHARDS * BUCKETS * 8
+ * bytes per histogram.
+ */
+class TLatencyHistogram : TNonCopyable {
+public:
+  static const size_t SHARDS = 8;
+  static const int SUB_BITS = 3;
+  static const int MAX_EXPONENT = 39;
+  static const size_t BUCKETS = (MAX_EXPONENT - SUB_BITS + 2) << SUB_BITS;
+
+  TLatencyHistogram();
+
+  void record(uint64_t value);
+
+  /// Merges the shards.
+  THistogramSnapshot snapshot() const;
+
+  /// The bucket value falls in.
+  static size_t bucketIndex(uint64_t value);
+
+  /// The largest value that falls in bucket.
+  static uint64_t bucketUpperBound(size_t bucket);
+
+private:
+  // Padded on both sides, as TShardedCounter's values are
+  struct Shard {
+    Shard();
+
+    char padBefore[64];
+    std::atomic<uint64_t> buckets[BUCKETS];
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> max;
+    char padAfter[64];
+  };
+
+  std::unique_ptr<Shard[]> shards_;
+};
+
+/**
+ * Call statistics of one method, as read from a TStatsEventHandler.
+ */
+struct TMethodStats {
+  TMethodStats() : calls(0), errors(0), bytesIn(0), bytesOut(0) {}
+
+  /// The method name as the processor gives it, such as "Service.method"
+  std::string name;
+
+  /// Calls begun, and calls whose handler threw an undeclared exception
+  int64_t calls;
+  int64_t errors;
+
+  /// Bytes of arguments read and of results written
+  int64_t bytesIn;
+  int64_t bytesOut;
+
+  /// Time from the start of reading the call to the end of writing the
+  /// result, in microseconds, for calls that have completed
+  THistogramSnapshot latencyUs;
+};
+
+/**
+ * A processor event handler that keeps per-method call counts, bytes in
+ * and out, errors and a latency histogram, cheaply enough to leave on.
+ *
+ * Recording a call touches only TShardedCounter and TLatencyHistogram
+ * shards; the statistics are only added up when getStats() is called.
+ * Each method's slot is looked up by name under a lock the first time a
+ * thread sees it, and from a small per-thread cache after that.
+ *
+ * Install with TProcessor::setEventHandler().
+ */
+class TStatsEventHandler : public TProcessorEventHandler {
+public:
+  TStatsEventHandler();
+  ~TStatsEventHandler() override;
+
+  void* getContext(const char* fn_name, void* serverContext) override;
+  void freeContext(void* ctx, const char* fn_name) override;
+  void postRead(void* ctx, const char* fn_name, uint32_t bytes) override;
+  void postWrite(void* ctx, const char* fn_name, uint32_t bytes) override;
+  void handlerError(void* ctx, const char* fn_name) override;
+
+  /**
+   * Adds up the statistics of every method called so far, in name order.
+   */
+  std::vector<TMethodStats> getStats() const;
+
+private:
+  struct Method;
+  struct CallContext;
+  struct ContextPool;
+
+  Method* lookup(const char* fn_name);
+
+  /// The calling thread's contexts of ended calls, for getContext() to reuse
+  static ContextPool& contextPool();
+
+  /// Tells this handler's entries in the per-thread caches from any other's
+  const uint64_t id_;
+
+  mutable concurrency::Mutex mutex_;
+  std::map<std::string, std::unique_ptr<Method> > methods_;
+};
+}
+}
+} // apache::thrift::processor
+
+#endif // #ifndef _THRIFT_PROCESSOR_TSTATSEVENTHANDLER_H_
@@ -61,13 +61,20 @@ public:
       strict_read_(strict_read),
       strict_write_(strict_write) {}
 
-  void setStringSizeLimit(int32_t string_limit) { string_limit_ = string_limit; }
+  void setStringSizeLimit(int32_t string_limit) {
+    string_limit_ = string_limit;
+    valueProtocolFactory_.reset();
+  }
 
-  void setContainerSizeLimit(int32_t container_limit) { container_limit_ = container_limit; }
+  void setContainerSizeLimit(int32_t container_limit) {
+    container_limit_ = container_limit;
+    valueProtocolFactory_.reset();
+  }
 
   void setStrict(bool strict_read, bool strict_write) {
     strict_read_ = strict_read;
     strict_write_ = strict_write;
+    valueProtocolFactory_.reset();
   }
 
   /**
@@ -119,6 +126,20 @@ public:
 
   inline uint32_t writeBinary(const std::string& str);
 
+  inline uint32_t writeStringView(const TStringView& str);
+
+  inline uint32_t writeBinaryView(const TStringView& str);
+
+  inline uint32_t writeByteArray(const int8_t* values, uint32_t count);
+
+  inline uint32_t writeI16Array(const int16_t* values, uint32_t count);
+
+  inline uint32_t writeI32Array(const int32_t* values, uint32_t count);
+
+  inline uint32_t writeI64Array(const int64_t* values, uint32_t count);
+
+  inline uint32_t writeDoubleArray(const double* values, uint32_t count);
+
   /**
    * Reading functions
    */
@@ -166,8 +187,24 @@ public:
 
   inline uint32_t readBinary(std::string& str);
 
+  inline uint32_t readStringView(TStringView& str);
+
+  inline uint32_t readBinaryView(TStringView& str);
+
+  inline uint32_t readByteArray(int8_t* values, uint32_t count);
+
+  inline uint32_t readI16Array(int16_t* values, uint32_t count);
+
+  inline uint32_t readI32Array(int32_t* values, uint32_t count);
+
+  inline uint32_t readI64Array(int64_t* values, uint32_t count);
+
+  inline uint32_t readDoubleArray(double* values, uint32_t count);
+
   int getMinSerializedSize(TType type);
 
+  std::shared_ptr<TProtocolFactory> getValueProtocolFactory() override;
+
   void checkReadBytesAvailable(TSet& set)
   {
       trans_->checkReadBytesAvailable(set.size_ * getMinSerializedSize(set.elemType_));
@@ -188,6 +225,16 @@ protected:
   template <typename StrType>
   uint32_t readStringBody(StrType& str, int32_t sz);
 
+  uint32_t readStringViewBody(TStringView& str, int32_t sz);
+
+  typedef void (*ByteSwapFunc)(const uint8_t* in, uint8_t* out, uint32_t count);
+
+  template <typename T>
+  uint32_t writeFixedArray(const T* values, uint32_t count, ByteSwapFunc swap);
+
+  template <typename T>
+  uint32_t readFixedArray(T* values, uint32_t count, ByteSwapFunc swap);
+
   Transport_* trans_;
 
   int32_t string_limit_;
@@ -196,6 +243,9 @@ protected:
   // Enforce presence of version identifier
   bool strict_read_;
   bool strict_write_;
+
+  // Made with the limits above when first asked for
+  std::shared_ptr<TProtocolFactory> valueProtocolFactory_;
 };
 
 typedef TBinaryProtocolT<TTransport> TBinaryProtocol;
@@ -21,8 +21,10 @@
 #define _THRIFT_PROTOCOL_TBINARYPROTOCOL_TCC_ 1
 
 #include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/protocol/TByteSwapUtils.h>
 #include <thrift/transport/TTransportException.h>
 
+#include <algorithm>
 #include <limits>
 
 namespace apache {
@@ -193,6 +195,80 @@ uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::writeBinary(const std::string
   return TBinaryProtocolT<Transport_, ByteOrder_>::writeString(str);
 }
 
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::writeStringView(const TStringView& str) {
+  return TBinaryProtocolT<Transport_, ByteOrder_>::writeString(str);
+}
+
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::writeBinaryView(const TStringView& str) {
+  return TBinaryProtocolT<Transport_, ByteOrder_>::writeString(str);
+}
+
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::writeByteArray(const int8_t* values,
+                                                                  uint32_t count) {
+  if (count == 0) {
+    // values may be null, as data() is for an empty vector
+    return 0;
+  }
+  this->trans_->write((const uint8_t*)values, count);
+  return count;
+}
+
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::writeI16Array(const int16_t* values,
+                                                                 uint32_t count) {
+  return writeFixedArray(values, count, &byte_swap_16);
+}
+
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::writeI32Array(const int32_t* values,
+                                                                 uint32_t count) {
+  return writeFixedArray(values, count, &byte_swap_32);
+}
+
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::writeI64Array(const int64_t* values,
+                                                                 uint32_t count) {
+  return writeFixedArray(values, count, &byte_swap_64);
+}
+
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::writeDoubleArray(const double* values,
+                                                                    uint32_t count) {
+  static_assert(sizeof(double) == sizeof(uint64_t), "sizeof(double) == sizeof(uint64_t)");
+  static_assert(std::numeric_limits<double>::is_iec559, "std::numeric_limits<double>::is_iec559");
+  return writeFixedArray(values, count, &byte_swap_64);
+}
+
+/**
+ * Values already in wire order are written straight from the array, the
+ * rest are swapped into a buffer a chunk at a time.
+ */
+template <class Transport_, class ByteOrder_>
+template <typename T>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::writeFixedArray(const T* values,
+                                                                   uint32_t count,
+                                                                   ByteSwapFunc swap) {
+  const bool swapped = ByteOrder_::toWire32(1) != 1;
+  const auto* data = (const uint8_t*)values;
+  uint8_t buf[1024];
+  const uint32_t chunk = swapped ? sizeof(buf) / sizeof(T) : (1U << 24);
+  uint32_t i = 0;
+  while (i < count) {
+    uint32_t n = (std::min)(chunk, count - i);
+    const uint8_t* src = data + i * sizeof(T);
+    if (swapped) {
+      swap(src, buf, n);
+      src = buf;
+    }
+    this->trans_->write(src, n * static_cast<uint32_t>(sizeof(T)));
+    i += n;
+  }
+  return count * static_cast<uint32_t>(sizeof(T));
+}
+
 /**
  * Reading functions
  */
@@ -428,6 +504,76 @@ uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::readBinary(std::string& str)
   return TBinaryProtocolT<Transport_, ByteOrder_>::readString(str);
 }
 
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::readStringView(TStringView& str) {
+  uint32_t result;
+  int32_t size;
+  result = readI32(size);
+  return result + readStringViewBody(str, size);
+}
+
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::readBinaryView(TStringView& str) {
+  return TBinaryProtocolT<Transport_, ByteOrder_>::readStringView(str);
+}
+
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::readByteArray(int8_t* values, uint32_t count) {
+  if (count == 0) {
+    return 0;
+  }
+  this->trans_->readAll((uint8_t*)values, count);
+  return count;
+}
+
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::readI16Array(int16_t* values, uint32_t count) {
+  return readFixedArray(values, count, &byte_swap_16);
+}
+
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::readI32Array(int32_t* values, uint32_t count) {
+  return readFixedArray(values, count, &byte_swap_32);
+}
+
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::readI64Array(int64_t* values, uint32_t count) {
+  return readFixedArray(values, count, &byte_swap_64);
+}
+
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::readDoubleArray(double* values,
+                                                                   uint32_t count) {
+  static_assert(sizeof(double) == sizeof(uint64_t), "sizeof(double) == sizeof(uint64_t)");
+  static_assert(std::numeric_limits<double>::is_iec559, "std::numeric_limits<double>::is_iec559");
+  return readFixedArray(values, count, &byte_swap_64);
+}
+
+/**
+ * Values are read straight into the array, then swapped in place if the wire
+ * order is not the host's, a chunk at a time so that they are still in cache.
+ */
+template <class Transport_, class ByteOrder_>
+template <typename T>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::readFixedArray(T* values,
+                                                                  uint32_t count,
+                                                                  ByteSwapFunc swap) {
+  const bool swapped = ByteOrder_::toWire32(1) != 1;
+  auto* data = (uint8_t*)values;
+  const uint32_t chunk = swapped ? 4096 / sizeof(T) : (1U << 24);
+  uint32_t i = 0;
+  while (i < count) {
+    uint32_t n = (std::min)(chunk, count - i);
+    uint8_t* dst = data + i * sizeof(T);
+    this->trans_->readAll(dst, n * static_cast<uint32_t>(sizeof(T)));
+    if (swapped) {
+      swap(dst, dst, n);
+    }
+    i += n;
+  }
+  return count * static_cast<uint32_t>(sizeof(T));
+}
+
 template <class Transport_, class ByteOrder_>
 template <typename StrType>
 uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::readStringBody(StrType& str, int32_t size) {
@@ -461,6 +607,40 @@ uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::readStringBody(StrType& str,
   return (uint32_t)size;
 }
 
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::readStringViewBody(TStringView& str,
+                                                                      int32_t size) {
+  if (!this->trans_->canLendReadBuffer()) {
+    throw TProtocolException(TProtocolException::NOT_IMPLEMENTED,
+                             "transport cannot lend its read buffer.");
+  }
+
+  // Catch error cases
+  if (size < 0) {
+    throw TProtocolException(TProtocolException::NEGATIVE_SIZE);
+  }
+  if (this->string_limit_ > 0 && size > this->string_limit_) {
+    throw TProtocolException(TProtocolException::SIZE_LIMIT);
+  }
+
+  // Catch empty string case
+  if (size == 0) {
+    str.clear();
+    return 0;
+  }
+
+  // The whole string must already be in the transport's buffer.
+  uint32_t got = size;
+  const uint8_t* borrow_buf = this->trans_->borrow(nullptr, &got);
+  if (borrow_buf == nullptr) {
+    throw transport::TTransportException(transport::TTransportException::END_OF_FILE,
+                                         "string extends past the end of the read buffer.");
+  }
+  str.assign(reinterpret_cast<const char*>(borrow_buf), size);
+  this->trans_->consume(size);
+  return (uint32_t)size;
+}
+
 // Return the minimum number of bytes a type will consume on the wire
 template <class Transport_, class ByteOrder_>
 int TBinaryProtocolT<Transport_, ByteOrder_>::getMinSerializedSize(TType type)
@@ -484,6 +664,17 @@ int TBinaryProtocolT<Transport_, ByteOrder_>::getMinSerializedSize(TType type)
   }
 }
 
+// Values are encoded the same over any transport, but are read with this
+// protocol's limits.
+template <class Transport_, class ByteOrder_>
+std::shared_ptr<TProtocolFactory> TBinaryProtocolT<Transport_, ByteOrder_>::getValueProtocolFactory() {
+  if (!valueProtocolFactory_) {
+    valueProtocolFactory_.reset(new TBinaryProtocolFactoryT<TTransport, ByteOrder_>(
+        string_limit_, container_limit_, strict_read_, strict_write_));
+  }
+  return valueProtocolFactory_;
+}
+
 }
 }
 } // apache::thrift::protocol
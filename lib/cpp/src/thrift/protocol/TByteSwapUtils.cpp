@@ -0,0 +1,104 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <thrift/protocol/TByteSwapUtils.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define THRIFT_BYTESWAP_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace apache {
+namespace thrift {
+namespace protocol {
+
+/**
+ * With SSE2, 16 bytes are swapped at a time: the bytes of each 16 bit lane
+ * are exchanged with shifts, then the lanes within each value are reversed
+ * with shuffles.  The rest are swapped a byte at a time, which compilers
+ * recognize as a bswap.
+ */
+namespace {
+
+template <uint32_t Size>
+void swapEach(const uint8_t* in, uint8_t* out, uint32_t count) {
+  for (uint32_t i = 0; i < count; ++i, in += Size, out += Size) {
+    uint8_t value[Size];
+    for (uint32_t j = 0; j < Size; ++j) {
+      value[j] = in[Size - 1 - j];
+    }
+    for (uint32_t j = 0; j < Size; ++j) {
+      out[j] = value[j];
+    }
+  }
+}
+
+#ifdef THRIFT_BYTESWAP_SSE2
+inline __m128i load(const uint8_t* in) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+}
+
+inline void store(uint8_t* out, __m128i v) {
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), v);
+}
+
+inline __m128i swapLanes(__m128i v) {
+  return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+#endif
+}
+
+void byte_swap_16(const uint8_t* in, uint8_t* out, uint32_t count) {
+  uint32_t i = 0;
+#ifdef THRIFT_BYTESWAP_SSE2
+  for (; i + 8 <= count; i += 8) {
+    store(out + 2 * i, swapLanes(load(in + 2 * i)));
+  }
+#endif
+  swapEach<2>(in + 2 * i, out + 2 * i, count - i);
+}
+
+void byte_swap_32(const uint8_t* in, uint8_t* out, uint32_t count) {
+  uint32_t i = 0;
+#ifdef THRIFT_BYTESWAP_SSE2
+  for (; i + 4 <= count; i += 4) {
+    __m128i v = swapLanes(load(in + 4 * i));
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    store(out + 4 * i, v);
+  }
+#endif
+  swapEach<4>(in + 4 * i, out + 4 * i, count - i);
+}
+
+void byte_swap_64(const uint8_t* in, uint8_t* out, uint32_t count) {
+  uint32_t i = 0;
+#ifdef THRIFT_BYTESWAP_SSE2
+  for (; i + 2 <= count; i += 2) {
+    __m128i v = swapLanes(load(in + 8 * i));
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+    store(out + 8 * i, v);
+  }
+#endif
+  swapEach<8>(in + 8 * i, out + 8 * i, count - i);
+}
+}
+}
+} // apache::thrift::protocol
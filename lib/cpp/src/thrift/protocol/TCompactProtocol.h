@@ -20,6 +20,8 @@
 #ifndef _THRIFT_PROTOCOL_TCOMPACTPROTOCOL_H_
 #define _THRIFT_PROTOCOL_TCOMPACTPROTOCOL_H_ 1
 
+#include <thrift/protocol/TByteSwapUtils.h>
+#include <thrift/protocol/TVarintUtils.h>
 #include <thrift/protocol/TVirtualProtocol.h>
 
 #include <stack>
@@ -140,8 +142,24 @@ public:
 
   uint32_t writeBinary(const std::string& str);
 
+  uint32_t writeStringView(const TStringView& str);
+
+  uint32_t writeBinaryView(const TStringView& str);
+
+  uint32_t writeByteArray(const int8_t* values, uint32_t count);
+
+  uint32_t writeI16Array(const int16_t* values, uint32_t count);
+
+  uint32_t writeI32Array(const int32_t* values, uint32_t count);
+
+  uint32_t writeI64Array(const int64_t* values, uint32_t count);
+
+  uint32_t writeDoubleArray(const double* values, uint32_t count);
+
   int getMinSerializedSize(TType type);
 
+  std::shared_ptr<TProtocolFactory> getValueProtocolFactory() override;
+
   void checkReadBytesAvailable(TSet& set)
   {
       trans_->checkReadBytesAvailable(set.size_ * getMinSerializedSize(set.elemType_));
@@ -176,6 +194,8 @@ protected:
   uint32_t writeCollectionBegin(const TType elemType, int32_t size);
   uint32_t writeVarint32(uint32_t n);
   uint32_t writeVarint64(uint64_t n);
+  template <typename T>
+  uint32_t writeVarintArray(const T* values, uint32_t count, uint32_t maxBytes);
   uint64_t i64ToZigzag(const int64_t l);
   uint32_t i32ToZigzag(const int32_t n);
   inline int8_t getCompactType(const TType ttype);
@@ -213,6 +233,20 @@ public:
 
   uint32_t readBinary(std::string& str);
 
+  uint32_t readStringView(TStringView& str);
+
+  uint32_t readBinaryView(TStringView& str);
+
+  uint32_t readByteArray(int8_t* values, uint32_t count);
+
+  uint32_t readI16Array(int16_t* values, uint32_t count);
+
+  uint32_t readI32Array(int32_t* values, uint32_t count);
+
+  uint32_t readI64Array(int64_t* values, uint32_t count);
+
+  uint32_t readDoubleArray(double* values, uint32_t count);
+
   /*
    *These methods are here for the struct to call, but don't have any wire
    * encoding.
@@ -226,6 +260,10 @@ public:
 protected:
   uint32_t readVarint32(int32_t& i32);
   uint32_t readVarint64(int64_t& i64);
+  template <typename T>
+  uint32_t readVarintArray(T* values,
+                           uint32_t count,
+                           uint32_t (TCompactProtocolT::*readOne)(T&));
   int32_t zigzagToI32(uint32_t n);
   int64_t zigzagToI64(uint64_t n);
   TType getTType(int8_t type);
@@ -236,6 +274,9 @@ protected:
   uint8_t* string_buf_;
   int32_t string_buf_size_;
   int32_t container_limit_;
+
+  // Made with the limits above when first asked for
+  std::shared_ptr<TProtocolFactory> valueProtocolFactory_;
 };
 
 typedef TCompactProtocolT<TTransport> TCompactProtocol;
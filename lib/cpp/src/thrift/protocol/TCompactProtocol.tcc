@@ -19,6 +19,7 @@
 #ifndef _THRIFT_PROTOCOL_TCOMPACTPROTOCOL_TCC_
 #define _THRIFT_PROTOCOL_TCOMPACTPROTOCOL_TCC_ 1
 
+#include <algorithm>
 #include <limits>
 
 #include "thrift/config.h"
@@ -272,6 +273,16 @@ uint32_t TCompactProtocolT<Transport_>::writeString(const std::string& str) {
 
 template <class Transport_>
 uint32_t TCompactProtocolT<Transport_>::writeBinary(const std::string& str) {
+  return writeBinaryView(str);
+}
+
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::writeStringView(const TStringView& str) {
+  return writeBinaryView(str);
+}
+
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::writeBinaryView(const TStringView& str) {
   if(str.size() > (std::numeric_limits<uint32_t>::max)())
     throw TProtocolException(TProtocolException::SIZE_LIMIT);
   auto ssize = static_cast<uint32_t>(str.size());
@@ -285,6 +296,65 @@ uint32_t TCompactProtocolT<Transport_>::writeBinary(const std::string& str) {
   return wsize;
 }
 
+/**
+ * Write a run of bytes with one write.
+ */
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::writeByteArray(const int8_t* values, uint32_t count) {
+  if (count == 0) {
+    // values may be null, as data() is for an empty vector
+    return 0;
+  }
+  trans_->write((const uint8_t*)values, count);
+  return count;
+}
+
+/**
+ * Write runs of i16s, i32s and i64s as zigzag varints, encoded a chunk at a
+ * time with one write each.
+ */
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::writeI16Array(const int16_t* values, uint32_t count) {
+  return writeVarintArray(values, count, kMaxVarint32Bytes);
+}
+
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::writeI32Array(const int32_t* values, uint32_t count) {
+  return writeVarintArray(values, count, kMaxVarint32Bytes);
+}
+
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::writeI64Array(const int64_t* values, uint32_t count) {
+  return writeVarintArray(values, count, kMaxVarint64Bytes);
+}
+
+/**
+ * Write a run of doubles straight from the array on little endian hosts, and
+ * a chunk at a time through a buffer elsewhere.
+ */
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::writeDoubleArray(const double* values, uint32_t count) {
+  static_assert(sizeof(double) == sizeof(uint64_t), "sizeof(double) == sizeof(uint64_t)");
+  static_assert(std::numeric_limits<double>::is_iec559, "std::numeric_limits<double>::is_iec559");
+
+  const bool swapped = THRIFT_htolell(static_cast<uint64_t>(1)) != 1;
+  const auto* data = (const uint8_t*)values;
+  uint8_t buf[1024];
+  const uint32_t chunk = swapped ? sizeof(buf) / 8 : (1U << 24);
+  uint32_t i = 0;
+  while (i < count) {
+    uint32_t n = (std::min)(chunk, count - i);
+    const uint8_t* src = data + i * 8;
+    if (swapped) {
+      byte_swap_64(src, buf, n);
+      src = buf;
+    }
+    trans_->write(src, n * 8);
+    i += n;
+  }
+  return count * 8;
+}
+
 //
 // Internal Writing methods
 //
@@ -381,6 +451,29 @@ uint32_t TCompactProtocolT<Transport_>::writeVarint64(uint64_t n) {
   return wsize;
 }
 
+/**
+ * Write values as zigzag varints, each taking at most maxBytes.
+ */
+template <class Transport_>
+template <typename T>
+uint32_t TCompactProtocolT<Transport_>::writeVarintArray(const T* values,
+                                                         uint32_t count,
+                                                         uint32_t maxBytes) {
+  uint8_t buf[1280];
+  const uint32_t chunk = sizeof(buf) / maxBytes;
+  uint32_t wsize = 0;
+
+  while (count > 0) {
+    uint32_t n = count < chunk ? count : chunk;
+    uint32_t len = zigzag_varint_encode(values, n, buf);
+    trans_->write(buf, len);
+    wsize += len;
+    values += n;
+    count -= n;
+  }
+  return wsize;
+}
+
 /**
  * Convert l into a zigzag long. This allows negative numbers to be
  * represented compactly as a varint.
@@ -654,6 +747,61 @@ uint32_t TCompactProtocolT<Transport_>::readI64(int64_t& i64) {
   return rsize;
 }
 
+/**
+ * Read a run of bytes with one read.
+ */
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::readByteArray(int8_t* values, uint32_t count) {
+  if (count == 0) {
+    return 0;
+  }
+  trans_->readAll((uint8_t*)values, count);
+  return count;
+}
+
+/**
+ * Read runs of i16s, i32s and i64s written as zigzag varints.
+ */
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::readI16Array(int16_t* values, uint32_t count) {
+  return readVarintArray(values, count, &TCompactProtocolT<Transport_>::readI16);
+}
+
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::readI32Array(int32_t* values, uint32_t count) {
+  return readVarintArray(values, count, &TCompactProtocolT<Transport_>::readI32);
+}
+
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::readI64Array(int64_t* values, uint32_t count) {
+  return readVarintArray(values, count, &TCompactProtocolT<Transport_>::readI64);
+}
+
+/**
+ * Read a run of doubles straight into the array, swapping them in place a
+ * chunk at a time on big endian hosts.
+ */
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::readDoubleArray(double* values, uint32_t count) {
+  static_assert(sizeof(double) == sizeof(uint64_t), "sizeof(double) == sizeof(uint64_t)");
+  static_assert(std::numeric_limits<double>::is_iec559, "std::numeric_limits<double>::is_iec559");
+
+  const bool swapped = THRIFT_letohll(static_cast<uint64_t>(1)) != 1;
+  auto* data = (uint8_t*)values;
+  const uint32_t chunk = swapped ? 4096 / 8 : (1U << 24);
+  uint32_t i = 0;
+  while (i < count) {
+    uint32_t n = (std::min)(chunk, count - i);
+    uint8_t* dst = data + i * 8;
+    trans_->readAll(dst, n * 8);
+    if (swapped) {
+      byte_swap_64(dst, dst, n);
+    }
+    i += n;
+  }
+  return count * 8;
+}
+
 /**
  * No magic here - just read a double off the wire.
  */
@@ -717,6 +865,52 @@ uint32_t TCompactProtocolT<Transport_>::readBinary(std::string& str) {
   return rsize + (uint32_t)size;
 }
 
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::readStringView(TStringView& str) {
+  return readBinaryView(str);
+}
+
+/**
+ * Read a byte[] from the wire without copying it out of the transport.
+ */
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::readBinaryView(TStringView& str) {
+  if (!trans_->canLendReadBuffer()) {
+    throw TProtocolException(TProtocolException::NOT_IMPLEMENTED,
+                             "transport cannot lend its read buffer.");
+  }
+
+  int32_t rsize = 0;
+  int32_t size;
+
+  rsize += readVarint32(size);
+  // Catch empty string case
+  if (size == 0) {
+    str.clear();
+    return rsize;
+  }
+
+  // Catch error cases
+  if (size < 0) {
+    throw TProtocolException(TProtocolException::NEGATIVE_SIZE);
+  }
+  if (string_limit_ > 0 && size > string_limit_) {
+    throw TProtocolException(TProtocolException::SIZE_LIMIT);
+  }
+
+  // The whole string must already be in the transport's buffer.
+  uint32_t got = size;
+  const uint8_t* borrow_buf = trans_->borrow(nullptr, &got);
+  if (borrow_buf == nullptr) {
+    throw transport::TTransportException(transport::TTransportException::END_OF_FILE,
+                                         "string extends past the end of the read buffer.");
+  }
+  str.assign(reinterpret_cast<const char*>(borrow_buf), size);
+  trans_->consume(size);
+
+  return rsize + (uint32_t)size;
+}
+
 /**
  * Read an i32 from the wire as a varint. The MSB of each byte is set
  * if there is another byte to follow. This can read up to 5 bytes.
@@ -780,6 +974,38 @@ uint32_t TCompactProtocolT<Transport_>::readVarint64(int64_t& i64) {
   }
 }
 
+/**
+ * Read count zigzag varints.  Whatever the transport has buffered is decoded
+ * in one go; a value that runs past the end of it, or any value when there is
+ * nothing to borrow, is read on its own with readOne.
+ */
+template <class Transport_>
+template <typename T>
+uint32_t TCompactProtocolT<Transport_>::readVarintArray(T* values,
+                                                        uint32_t count,
+                                                        uint32_t (TCompactProtocolT::*readOne)(T&)) {
+  uint32_t rsize = 0;
+
+  while (count > 0) {
+    uint32_t got = 0;
+    uint32_t avail = 1;
+    const uint8_t* borrowed = trans_->borrow(nullptr, &avail);
+    if (borrowed != nullptr) {
+      got = count;
+      uint32_t len = zigzag_varint_decode(borrowed, avail, values, got);
+      trans_->consume(len);
+      rsize += len;
+    }
+    if (got == 0) {
+      rsize += (this->*readOne)(values[0]);
+      got = 1;
+    }
+    values += got;
+    count -= got;
+  }
+  return rsize;
+}
+
 /**
  * Convert from zigzag int to int.
  */
@@ -852,6 +1078,16 @@ int TCompactProtocolT<Transport_>::getMinSerializedSize(TType type)
   }
 }
 
+// Values are encoded the same over any transport, but are read with this
+// protocol's limits.
+template <class Transport_>
+std::shared_ptr<TProtocolFactory> TCompactProtocolT<Transport_>::getValueProtocolFactory() {
+  if (!valueProtocolFactory_) {
+    valueProtocolFactory_.reset(
+        new TCompactProtocolFactoryT<TTransport>(string_limit_, container_limit_));
+  }
+  return valueProtocolFactory_;
+}
 
 }}} // apache::thrift::protocol
 
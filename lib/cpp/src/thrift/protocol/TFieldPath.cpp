@@ -0,0 +1,103 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <thrift/protocol/TFieldPath.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace apache {
+namespace thrift {
+namespace protocol {
+
+using apache::thrift::transport::TMemoryBuffer;
+using apache::thrift::transport::TTransportException;
+
+TFieldPath TFieldPath::parse(const std::string& path) {
+  std::vector<int16_t> ids;
+  std::string::size_type start = 0;
+  while (!path.empty()) {
+    std::string::size_type dot = path.find('.', start);
+    std::string id = path.substr(start, dot == std::string::npos ? dot : dot - start);
+    char* idEnd = nullptr;
+    long value = std::strtol(id.c_str(), &idEnd, 10);
+    if (id.empty() || id.find_first_not_of("-0123456789") != std::string::npos
+        || *idEnd != '\0' || value < std::numeric_limits<int16_t>::min()
+        || value > std::numeric_limits<int16_t>::max()) {
+      throw std::invalid_argument("invalid field path: " + path);
+    }
+    ids.push_back(static_cast<int16_t>(value));
+    if (dot == std::string::npos) {
+      break;
+    }
+    start = dot + 1;
+  }
+  return TFieldPath(ids);
+}
+
+namespace detail {
+namespace field_path {
+
+uint32_t consume(TMemoryBuffer* trans, uint64_t len) {
+  if (len > trans->available_read()) {
+    throw TTransportException(TTransportException::END_OF_FILE, "No more data to read.");
+  }
+  uint32_t got = static_cast<uint32_t>(len);
+  trans->borrow(nullptr, &got);
+  trans->consume(static_cast<uint32_t>(len));
+  return static_cast<uint32_t>(len);
+}
+
+uint32_t skipVarints(TMemoryBuffer* trans, uint64_t count) {
+  uint32_t result = 0;
+  while (count > 0) {
+    uint32_t avail = 1;
+    const uint8_t* buf = trans->borrow(nullptr, &avail);
+    if (buf == nullptr) {
+      throw TTransportException(TTransportException::END_OF_FILE, "No more data to read.");
+    }
+
+    // A varint ends at each byte without the high bit set.  Eight bytes hold
+    // at most eight of them, so whole words are counted while that many are
+    // still wanted.
+    uint32_t pos = 0;
+    while (count >= 8 && avail - pos >= 8) {
+      uint64_t word;
+      std::memcpy(&word, buf + pos, 8);
+      uint64_t ends = (~word >> 7) & 0x0101010101010101ULL;
+      count -= (ends * 0x0101010101010101ULL) >> 56;
+      pos += 8;
+    }
+    while (count > 0 && pos < avail) {
+      if (!(buf[pos++] & 0x80)) {
+        count--;
+      }
+    }
+    trans->consume(pos);
+    result += pos;
+  }
+  return result;
+}
+}
+} // detail::field_path
+}
+}
+} // apache::thrift::protocol
@@ -0,0 +1,361 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _THRIFT_PROTOCOL_TFIELDPATH_H_
+#define _THRIFT_PROTOCOL_TFIELDPATH_H_ 1
+
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/protocol/TCompactProtocol.h>
+#include <thrift/transport/TBufferTransports.h>
+
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+namespace apache {
+namespace thrift {
+namespace protocol {
+
+/**
+ * The field ids leading from a struct down to one of its nested fields, e.g.
+ * {1, 3, 2} for field 2 of the struct in field 3 of the struct in field 1.
+ * An empty path names the struct itself.
+ */
+class TFieldPath {
+public:
+  TFieldPath() {}
+
+  TFieldPath(std::initializer_list<int16_t> ids) : ids_(ids) {}
+
+  explicit TFieldPath(const std::vector<int16_t>& ids) : ids_(ids) {}
+
+  /**
+   * Compiles a path written as dot separated field ids, such as "1.3.2".
+   *
+   * @throws std::invalid_argument if path is not of that form
+   */
+  static TFieldPath parse(const std::string& path);
+
+  const std::vector<int16_t>& getIds() const { return ids_; }
+
+  bool empty() const { return ids_.empty(); }
+
+  size_t size() const { return ids_.size(); }
+
+private:
+  std::vector<int16_t> ids_;
+};
+
+/**
+ * How readFieldPath() reads a value of type T: the type it must have on the
+ * wire and the call that reads it.  Generated structs and the base types are
+ * covered; specialize it for others.  A TStringView is read without copying
+ * and lives as long as the buffer it was read from.
+ */
+template <typename T>
+struct TFieldPathValue {
+  static const TType type = T_STRUCT;
+  template <class Protocol_>
+  static uint32_t read(Protocol_& prot, T& value) {
+    return value.read(&prot);
+  }
+};
+
+#define THRIFT_FIELD_PATH_VALUE(Type_, TType_, read_)                                              \
+  template <>                                                                                      \
+  struct TFieldPathValue<Type_> {                                                                  \
+    static const TType type = TType_;                                                              \
+    template <class Protocol_>                                                                     \
+    static uint32_t read(Protocol_& prot, Type_& value) {                                          \
+      return prot.read_(value);                                                                    \
+    }                                                                                              \
+  };
+
+THRIFT_FIELD_PATH_VALUE(bool, T_BOOL, readBool)
+THRIFT_FIELD_PATH_VALUE(int8_t, T_BYTE, readByte)
+THRIFT_FIELD_PATH_VALUE(int16_t, T_I16, readI16)
+THRIFT_FIELD_PATH_VALUE(int32_t, T_I32, readI32)
+THRIFT_FIELD_PATH_VALUE(int64_t, T_I64, readI64)
+THRIFT_FIELD_PATH_VALUE(double, T_DOUBLE, readDouble)
+THRIFT_FIELD_PATH_VALUE(std::string, T_STRING, readBinary)
+THRIFT_FIELD_PATH_VALUE(TStringView, T_STRING, readBinaryView)
+
+#undef THRIFT_FIELD_PATH_VALUE
+
+namespace detail {
+namespace field_path {
+
+// Consumes len bytes from trans, throwing END_OF_FILE if it has fewer
+uint32_t consume(transport::TMemoryBuffer* trans, uint64_t len);
+
+// Consumes count varints from trans; returns the number of bytes they took
+uint32_t skipVarints(transport::TMemoryBuffer* trans, uint64_t count);
+
+/**
+ * Skips values of a protocol over a TMemoryBuffer without reading them out:
+ * strings are stepped over in the buffer and runs of fixed size (or, with
+ * Varints_, varint) list, set and map elements are consumed in one go.
+ */
+template <class Protocol_, bool Varints_>
+class TBufferSkipper {
+public:
+  explicit TBufferSkipper(Protocol_& prot)
+    : prot_(prot),
+      trans_(static_cast<transport::TMemoryBuffer*>(prot.getTransport().get())) {}
+
+  uint32_t skip(TType type) {
+    switch (type) {
+    case T_BOOL: {
+      // TCompactProtocol may hold a bool field's value in the field header
+      bool boolv;
+      return prot_.readBool(boolv);
+    }
+    case T_STRING: {
+      TStringView str;
+      return prot_.readBinaryView(str);
+    }
+    case T_STRUCT: {
+      TInputRecursionTracker tracker(prot_);
+      uint32_t result = 0;
+      std::string name;
+      int16_t fid;
+      TType ftype;
+      result += prot_.readStructBegin(name);
+      while (true) {
+        result += prot_.readFieldBegin(name, ftype, fid);
+        if (ftype == T_STOP) {
+          break;
+        }
+        result += skip(ftype);
+        result += prot_.readFieldEnd();
+      }
+      result += prot_.readStructEnd();
+      return result;
+    }
+    case T_MAP: {
+      TInputRecursionTracker tracker(prot_);
+      uint32_t result = 0;
+      TType keyType;
+      TType valType;
+      uint32_t size;
+      result += prot_.readMapBegin(keyType, valType, size);
+      uint32_t keyWidth = width(keyType);
+      uint32_t valWidth = width(valType);
+      if (keyWidth != 0 && valWidth != 0) {
+        result += consume(trans_, static_cast<uint64_t>(keyWidth + valWidth) * size);
+      } else {
+        for (uint32_t i = 0; i < size; i++) {
+          result += skip(keyType);
+          result += skip(valType);
+        }
+      }
+      result += prot_.readMapEnd();
+      return result;
+    }
+    case T_SET: {
+      TInputRecursionTracker tracker(prot_);
+      uint32_t result = 0;
+      TType elemType;
+      uint32_t size;
+      result += prot_.readSetBegin(elemType, size);
+      result += skipElements(elemType, size);
+      result += prot_.readSetEnd();
+      return result;
+    }
+    case T_LIST: {
+      TInputRecursionTracker tracker(prot_);
+      uint32_t result = 0;
+      TType elemType;
+      uint32_t size;
+      result += prot_.readListBegin(elemType, size);
+      result += skipElements(elemType, size);
+      result += prot_.readListEnd();
+      return result;
+    }
+    default:
+      if (uint32_t bytes = width(type)) {
+        return consume(trans_, bytes);
+      }
+      if (isVarint(type)) {
+        return skipVarints(trans_, 1);
+      }
+      break;
+    }
+
+    throw TProtocolException(TProtocolException::INVALID_DATA, "invalid TType");
+  }
+
+private:
+  uint32_t skipElements(TType type, uint32_t count) {
+    if (uint32_t bytes = width(type)) {
+      return consume(trans_, static_cast<uint64_t>(bytes) * count);
+    }
+    if (isVarint(type)) {
+      return skipVarints(trans_, count);
+    }
+    uint32_t result = 0;
+    for (uint32_t i = 0; i < count; i++) {
+      result += skip(type);
+    }
+    return result;
+  }
+
+  // the bytes a value of type takes in a container, or 0 if that varies
+  static uint32_t width(TType type) {
+    switch (type) {
+    case T_BOOL:
+    case T_BYTE:
+      return 1;
+    case T_I16:
+      return Varints_ ? 0 : 2;
+    case T_I32:
+      return Varints_ ? 0 : 4;
+    case T_I64:
+      return Varints_ ? 0 : 8;
+    case T_DOUBLE:
+      return 8;
+    default:
+      return 0;
+    }
+  }
+
+  static bool isVarint(TType type) {
+    return Varints_ && (type == T_I16 || type == T_I32 || type == T_I64);
+  }
+
+  Protocol_& prot_;
+  transport::TMemoryBuffer* trans_;
+};
+}
+} // detail::field_path
+
+/**
+ * Skips the fields readFieldPath() passes over.  Protocols in general skip
+ * with TProtocol::skip(); TBinaryProtocolT and TCompactProtocolT over a
+ * TMemoryBuffer step over the encoded bytes instead.
+ */
+template <class Protocol_>
+class TFieldPathSkipper {
+public:
+  explicit TFieldPathSkipper(Protocol_& prot) : prot_(prot) {}
+
+  uint32_t skip(TType type) { return prot_.skip(type); }
+
+private:
+  Protocol_& prot_;
+};
+
+template <class ByteOrder_>
+class TFieldPathSkipper<TBinaryProtocolT<transport::TMemoryBuffer, ByteOrder_> >
+  : public detail::field_path::TBufferSkipper<TBinaryProtocolT<transport::TMemoryBuffer, ByteOrder_>,
+                                              false> {
+public:
+  explicit TFieldPathSkipper(TBinaryProtocolT<transport::TMemoryBuffer, ByteOrder_>& prot)
+    : detail::field_path::TBufferSkipper<TBinaryProtocolT<transport::TMemoryBuffer, ByteOrder_>,
+                                         false>(prot) {}
+};
+
+template <>
+class TFieldPathSkipper<TCompactProtocolT<transport::TMemoryBuffer> >
+  : public detail::field_path::TBufferSkipper<TCompactProtocolT<transport::TMemoryBuffer>, true> {
+public:
+  explicit TFieldPathSkipper(TCompactProtocolT<transport::TMemoryBuffer>& prot)
+    : detail::field_path::TBufferSkipper<TCompactProtocolT<transport::TMemoryBuffer>, true>(prot) {}
+};
+
+/**
+ * Reads the single value a TFieldPath leads to out of a struct, skipping
+ * every other field on the way without decoding it.
+ */
+template <class Protocol_>
+class TFieldPathReader {
+public:
+  explicit TFieldPathReader(Protocol_& prot) : prot_(prot), skipper_(prot) {}
+
+  /**
+   * Reads a struct from prot, setting value to the field path leads to.
+   * Returns false, leaving value alone, if that field is not there or its
+   * type on the wire does not match T.  Either way the whole struct is read,
+   * so prot is left at whatever follows it.
+   */
+  template <typename T>
+  bool read(const TFieldPath& path, T& value) {
+    const std::vector<int16_t>& ids = path.getIds();
+    bool found = false;
+    readValue(ids.data(), ids.data() + ids.size(), T_STRUCT, value, found);
+    return found;
+  }
+
+private:
+  template <typename T>
+  uint32_t readValue(const int16_t* id, const int16_t* end, TType type, T& value, bool& found) {
+    if (id == end) {
+      if (type != TFieldPathValue<T>::type) {
+        return skipper_.skip(type);
+      }
+      found = true;
+      return TFieldPathValue<T>::read(prot_, value);
+    }
+    if (type != T_STRUCT) {
+      return skipper_.skip(type);
+    }
+
+    TInputRecursionTracker tracker(prot_);
+    uint32_t result = 0;
+    std::string name;
+    int16_t fid;
+    TType ftype;
+    result += prot_.readStructBegin(name);
+    while (true) {
+      result += prot_.readFieldBegin(name, ftype, fid);
+      if (ftype == T_STOP) {
+        break;
+      }
+      if (!found && fid == *id) {
+        result += readValue(id + 1, end, ftype, value, found);
+      } else {
+        result += skipper_.skip(ftype);
+      }
+      result += prot_.readFieldEnd();
+    }
+    result += prot_.readStructEnd();
+    return result;
+  }
+
+  Protocol_& prot_;
+  TFieldPathSkipper<Protocol_> skipper_;
+};
+
+/**
+ * Reads the value path leads to out of the next struct on prot.  Use the
+ * protocol's own type rather than TProtocol, e.g.
+ * TBinaryProtocolT<TMemoryBuffer>, to avoid virtual calls and, over a
+ * TMemoryBuffer, to step over skipped fields without reading them.
+ *
+ * @see TFieldPathReader::read()
+ */
+template <class Protocol_, typename T>
+bool readFieldPath(Protocol_& prot, const TFieldPath& path, T& value) {
+  return TFieldPathReader<Protocol_>(prot).read(path, value);
+}
+}
+}
+} // apache::thrift::protocol
+
+#endif // #define _THRIFT_PROTOCOL_TFIELDPATH_H_
@@ -146,6 +146,34 @@ uint32_t THeaderProtocol::writeBinary(const std::string& str) {
   return proto_->writeBinary(str);
 }
 
+uint32_t THeaderProtocol::writeStringView(const TStringView& str) {
+  return proto_->writeStringView(str);
+}
+
+uint32_t THeaderProtocol::writeBinaryView(const TStringView& str) {
+  return proto_->writeBinaryView(str);
+}
+
+uint32_t THeaderProtocol::writeByteArray(const int8_t* values, uint32_t count) {
+  return proto_->writeByteArray(values, count);
+}
+
+uint32_t THeaderProtocol::writeI16Array(const int16_t* values, uint32_t count) {
+  return proto_->writeI16Array(values, count);
+}
+
+uint32_t THeaderProtocol::writeI32Array(const int32_t* values, uint32_t count) {
+  return proto_->writeI32Array(values, count);
+}
+
+uint32_t THeaderProtocol::writeI64Array(const int64_t* values, uint32_t count) {
+  return proto_->writeI64Array(values, count);
+}
+
+uint32_t THeaderProtocol::writeDoubleArray(const double* values, uint32_t count) {
+  return proto_->writeDoubleArray(values, count);
+}
+
 /**
  * Reading functions
  */
@@ -246,6 +274,38 @@ uint32_t THeaderProtocol::readString(std::string& str) {
 uint32_t THeaderProtocol::readBinary(std::string& binary) {
   return proto_->readBinary(binary);
 }
+
+uint32_t THeaderProtocol::readStringView(TStringView& str) {
+  return proto_->readStringView(str);
+}
+
+uint32_t THeaderProtocol::readBinaryView(TStringView& binary) {
+  return proto_->readBinaryView(binary);
+}
+
+uint32_t THeaderProtocol::readByteArray(int8_t* values, uint32_t count) {
+  return proto_->readByteArray(values, count);
+}
+
+uint32_t THeaderProtocol::readI16Array(int16_t* values, uint32_t count) {
+  return proto_->readI16Array(values, count);
+}
+
+uint32_t THeaderProtocol::readI32Array(int32_t* values, uint32_t count) {
+  return proto_->readI32Array(values, count);
+}
+
+uint32_t THeaderProtocol::readI64Array(int64_t* values, uint32_t count) {
+  return proto_->readI64Array(values, count);
+}
+
+uint32_t THeaderProtocol::readDoubleArray(double* values, uint32_t count) {
+  return proto_->readDoubleArray(values, count);
+}
+
+std::shared_ptr<TProtocolFactory> THeaderProtocol::getValueProtocolFactory() {
+  return proto_->getValueProtocolFactory();
+}
 }
 }
 } // apache::thrift::protocol
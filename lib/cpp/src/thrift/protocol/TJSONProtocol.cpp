@@ -21,15 +21,24 @@
 
 #include <boost/locale.hpp>
 
+#include <cfloat>
 #include <cmath>
+#include <cstring>
 #include <limits>
 #include <locale>
 #include <sstream>
 #include <stdexcept>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define THRIFT_JSON_SSE2 1
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
 #include <thrift/protocol/TBase64Utils.h>
 #include <thrift/transport/TTransportException.h>
-#include <thrift/TToString.h>
 
 using namespace apache::thrift::transport;
 
@@ -49,8 +58,6 @@ static const uint8_t kJSONBackslash = '\\';
 static const uint8_t kJSONStringDelimiter = '"';
 static const uint8_t kJSONEscapeChar = 'u';
 
-static const std::string kJSONEscapePrefix("\\u00");
-
 static const uint32_t kThriftVersion1 = 1;
 
 static const std::string kThriftNan("NaN");
@@ -148,60 +155,14 @@ static TType getTypeIDForTypeName(const std::string& name) {
   return result;
 }
 
-// This table describes the handling for the first 0x30 characters
+// This table describes the handling for the control characters, the only
+// ones besides '"' and '\' that are escaped
 //  0 : escape using "\u00xx" notation
-//  1 : just output index
 // <other> : escape using "\<other>" notation
-static const uint8_t kJSONCharTable[0x30] = {
-    //  0   1   2   3   4   5   6   7   8   9   A   B   C   D   E   F
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    'b',
-    't',
-    'n',
-    0,
-    'f',
-    'r',
-    0,
-    0, // 0
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0, // 1
-    1,
-    1,
-    '"',
-    1,
-    1,
-    1,
-    1,
-    1,
-    1,
-    1,
-    1,
-    1,
-    1,
-    1,
-    1,
-    1, // 2
+static const uint8_t kJSONCharTable[0x20] = {
+    //  0   1   2   3   4   5   6   7   8    9    A    B  C    D    E  F
+    0, 0, 0, 0, 0, 0, 0, 0, 'b', 't', 'n', 0, 'f', 'r', 0, 0, // 0
+    0, 0, 0, 0, 0, 0, 0, 0, 0,   0,   0,   0, 0,   0,   0, 0, // 1
 };
 
 // This string's characters must match up with the elements in kEscapeCharVals.
@@ -295,173 +256,809 @@ static bool isLowSurrogate(uint16_t val) {
 }
 
 /**
- * Class to serve as base JSON context and as base class for other context
- * implementations
+ * Scanning strings.  Both scanners look at 16 bytes at a time with SSE2 where
+ * it is available and 8 at a time in a 64 bit word elsewhere, then finish
+ * byte by byte.
  */
-class TJSONContext {
+namespace {
 
-public:
-  TJSONContext() = default;
+const uint64_t kEveryByte = 0x0101010101010101ULL;
+const uint64_t kEveryHighBit = 0x8080808080808080ULL;
+
+uint64_t loadWord(const uint8_t* buf) {
+  uint64_t word;
+  std::memcpy(&word, buf, sizeof(word));
+  return word;
+}
+
+// Nonzero if any byte of word is less than n, which must be at most 128
+uint64_t hasByteLessThan(uint64_t word, uint8_t n) {
+  return (word - kEveryByte * n) & ~word & kEveryHighBit;
+}
+
+// Nonzero if any byte of word is ch
+uint64_t hasByte(uint64_t word, uint8_t ch) {
+  return hasByteLessThan(word ^ (kEveryByte * ch), 1);
+}
+
+#ifdef THRIFT_JSON_SSE2
+uint32_t firstSetBit(uint32_t mask) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return static_cast<uint32_t>(index);
+#else
+  return static_cast<uint32_t>(__builtin_ctz(mask));
+#endif
+}
+#endif
+
+// Returns how many bytes at the start of buf come before the first '"' or
+// '\', all of which are read into a string as they are.
+uint32_t scanStringRun(const uint8_t* buf, uint32_t len) {
+  uint32_t pos = 0;
+#ifdef THRIFT_JSON_SSE2
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  for (; pos + 16 <= len; pos += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + pos));
+    int mask = _mm_movemask_epi8(
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+    if (mask != 0) {
+      return pos + firstSetBit(static_cast<uint32_t>(mask));
+    }
+  }
+#endif
+  for (; pos + 8 <= len; pos += 8) {
+    uint64_t word = loadWord(buf + pos);
+    if (hasByte(word, kJSONStringDelimiter) | hasByte(word, kJSONBackslash)) {
+      break;
+    }
+  }
+  while (pos < len && buf[pos] != kJSONStringDelimiter && buf[pos] != kJSONBackslash) {
+    ++pos;
+  }
+  return pos;
+}
+
+// Returns how many bytes at the start of buf come before the first '"', '\'
+// or control character, all of which are written into a string as they are.
+uint32_t scanUnescapedRun(const uint8_t* buf, uint32_t len) {
+  uint32_t pos = 0;
+#ifdef THRIFT_JSON_SSE2
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i lastControl = _mm_set1_epi8(0x1F);
+  for (; pos + 16 <= len; pos += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + pos));
+    // unsigned chunk <= 0x1F exactly where max(chunk, 0x1F) == 0x1F
+    __m128i control = _mm_cmpeq_epi8(_mm_max_epu8(chunk, lastControl), lastControl);
+    int mask = _mm_movemask_epi8(_mm_or_si128(
+        control, _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash))));
+    if (mask != 0) {
+      return pos + firstSetBit(static_cast<uint32_t>(mask));
+    }
+  }
+#endif
+  for (; pos + 8 <= len; pos += 8) {
+    uint64_t word = loadWord(buf + pos);
+    if (hasByteLessThan(word, 0x20) | hasByte(word, kJSONStringDelimiter)
+        | hasByte(word, kJSONBackslash)) {
+      break;
+    }
+  }
+  while (pos < len && buf[pos] >= 0x20 && buf[pos] != kJSONStringDelimiter
+         && buf[pos] != kJSONBackslash) {
+    ++pos;
+  }
+  return pos;
+}
+}
 
-  virtual ~TJSONContext() = default;
+/**
+ * Formatting and parsing numbers, without going through streams or the C
+ * locale.
+ */
+namespace {
 
-  /**
-   * Write context data to the transport. Default is to do nothing.
-   */
-  virtual uint32_t write(TTransport& trans) {
-    (void)trans;
-    return 0;
-  };
+const char kDigitPairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// Writes num in decimal to out, which must have room for 20 digits, and
+// returns how many were written.
+uint32_t formatDecimal(uint64_t num, uint8_t* out) {
+  uint8_t digits[20];
+  uint8_t* pos = digits + sizeof(digits);
+  while (num >= 100) {
+    const char* pair = kDigitPairs + (num % 100) * 2;
+    num /= 100;
+    *--pos = pair[1];
+    *--pos = pair[0];
+  }
+  if (num >= 10) {
+    const char* pair = kDigitPairs + num * 2;
+    *--pos = pair[1];
+    *--pos = pair[0];
+  } else {
+    *--pos = static_cast<uint8_t>('0' + num);
+  }
+  auto length = static_cast<uint32_t>(digits + sizeof(digits) - pos);
+  std::memcpy(out, pos, length);
+  return length;
+}
 
-  /**
-   * Read context data from the transport. Default is to do nothing.
-   */
-  virtual uint32_t read(TJSONProtocol::LookaheadReader& reader) {
-    (void)reader;
-    return 0;
-  };
+// Writes num to out, which must have room for a sign and 20 digits, and
+// returns how many characters were written.
+uint32_t formatInteger(int64_t num, uint8_t* out) {
+  if (num < 0) {
+    *out = '-';
+    return 1 + formatDecimal(0 - static_cast<uint64_t>(num), out + 1);
+  }
+  return formatDecimal(static_cast<uint64_t>(num), out);
+}
+
+// Reads str, an optionally signed run of decimal digits, into num, returning
+// false if it is anything else or out of range.  As with strtoull(), a
+// negative number read into an unsigned type wraps around.
+template <typename NumberType>
+bool parseInteger(const std::string& str, NumberType& num) {
+  const char* pos = str.data();
+  const char* end = pos + str.length();
+  bool negative = false;
+  if (pos != end && (*pos == '-' || *pos == '+')) {
+    negative = (*pos == '-');
+    ++pos;
+  }
+  if (pos == end) {
+    return false;
+  }
+  uint64_t magnitude = 0;
+  for (; pos != end; ++pos) {
+    auto digit = static_cast<uint64_t>(*pos - '0');
+    if (digit > 9 || magnitude > ((std::numeric_limits<uint64_t>::max)() - digit) / 10) {
+      return false;
+    }
+    magnitude = magnitude * 10 + digit;
+  }
+  const auto max = static_cast<uint64_t>((std::numeric_limits<NumberType>::max)());
+  if (std::numeric_limits<NumberType>::is_signed) {
+    if (negative) {
+      if (magnitude > max + 1) {
+        return false;
+      }
+      num = magnitude == 0 ? 0 : static_cast<NumberType>(-static_cast<int64_t>(magnitude - 1) - 1);
+      return true;
+    }
+  } else if (negative) {
+    magnitude = 0 - magnitude;
+  }
+  if (magnitude > max) {
+    return false;
+  }
+  num = static_cast<NumberType>(magnitude);
+  return true;
+}
 
-  /**
-   * Return true if numbers need to be escaped as strings in this context.
-   * Default behavior is to return false.
-   */
-  virtual bool escapeNum() { return false; }
+/**
+ * Shortest round trip double formatting, after Florian Loitsch's Grisu2
+ * ("Printing Floating-Point Numbers Quickly and Accurately with Integers",
+ * PLDI 2010).  The digits always read back as exactly the same double, and
+ * for all but a tiny fraction of doubles are the fewest that do.
+ */
+
+// A floating point number f * 2^e, with a 64 bit significand
+struct DiyFp {
+  uint64_t f;
+  int e;
 };
 
-// Context class for object member key-value pairs
-class JSONPairContext : public TJSONContext {
+const int kDoubleSignificandSize = 52;
+const uint64_t kDoubleHiddenBit = 0x0010000000000000ULL;
+const uint64_t kDoubleSignificandMask = 0x000FFFFFFFFFFFFFULL;
+const int kDoubleExponentBias = 0x3FF + kDoubleSignificandSize;
+
+// Normalized 10^-348, 10^-340, ..., 10^340
+const DiyFp kCachedPowers[] = {
+    {0xfa8fd5a0081c0288ULL, -1220}, // 1e-348
+    {0xbaaee17fa23ebf76ULL, -1193}, // 1e-340
+    {0x8b16fb203055ac76ULL, -1166}, // 1e-332
+    {0xcf42894a5dce35eaULL, -1140}, // 1e-324
+    {0x9a6bb0aa55653b2dULL, -1113}, // 1e-316
+    {0xe61acf033d1a45dfULL, -1087}, // 1e-308
+    {0xab70fe17c79ac6caULL, -1060}, // 1e-300
+    {0xff77b1fcbebcdc4fULL, -1034}, // 1e-292
+    {0xbe5691ef416bd60cULL, -1007}, // 1e-284
+    {0x8dd01fad907ffc3cULL, -980}, // 1e-276
+    {0xd3515c2831559a83ULL, -954}, // 1e-268
+    {0x9d71ac8fada6c9b5ULL, -927}, // 1e-260
+    {0xea9c227723ee8bcbULL, -901}, // 1e-252
+    {0xaecc49914078536dULL, -874}, // 1e-244
+    {0x823c12795db6ce57ULL, -847}, // 1e-236
+    {0xc21094364dfb5637ULL, -821}, // 1e-228
+    {0x9096ea6f3848984fULL, -794}, // 1e-220
+    {0xd77485cb25823ac7ULL, -768}, // 1e-212
+    {0xa086cfcd97bf97f4ULL, -741}, // 1e-204
+    {0xef340a98172aace5ULL, -715}, // 1e-196
+    {0xb23867fb2a35b28eULL, -688}, // 1e-188
+    {0x84c8d4dfd2c63f3bULL, -661}, // 1e-180
+    {0xc5dd44271ad3cdbaULL, -635}, // 1e-172
+    {0x936b9fcebb25c996ULL, -608}, // 1e-164
+    {0xdbac6c247d62a584ULL, -582}, // 1e-156
+    {0xa3ab66580d5fdaf6ULL, -555}, // 1e-148
+    {0xf3e2f893dec3f126ULL, -529}, // 1e-140
+    {0xb5b5ada8aaff80b8ULL, -502}, // 1e-132
+    {0x87625f056c7c4a8bULL, -475}, // 1e-124
+    {0xc9bcff6034c13053ULL, -449}, // 1e-116
+    {0x964e858c91ba2655ULL, -422}, // 1e-108
+    {0xdff9772470297ebdULL, -396}, // 1e-100
+    {0xa6dfbd9fb8e5b88fULL, -369}, // 1e-92
+    {0xf8a95fcf88747d94ULL, -343}, // 1e-84
+    {0xb94470938fa89bcfULL, -316}, // 1e-76
+    {0x8a08f0f8bf0f156bULL, -289}, // 1e-68
+    {0xcdb02555653131b6ULL, -263}, // 1e-60
+    {0x993fe2c6d07b7facULL, -236}, // 1e-52
+    {0xe45c10c42a2b3b06ULL, -210}, // 1e-44
+    {0xaa242499697392d3ULL, -183}, // 1e-36
+    {0xfd87b5f28300ca0eULL, -157}, // 1e-28
+    {0xbce5086492111aebULL, -130}, // 1e-20
+    {0x8cbccc096f5088ccULL, -103}, // 1e-12
+    {0xd1b71758e219652cULL, -77}, // 1e-4
+    {0x9c40000000000000ULL, -50}, // 1e4
+    {0xe8d4a51000000000ULL, -24}, // 1e12
+    {0xad78ebc5ac620000ULL, 3}, // 1e20
+    {0x813f3978f8940984ULL, 30}, // 1e28
+    {0xc097ce7bc90715b3ULL, 56}, // 1e36
+    {0x8f7e32ce7bea5c70ULL, 83}, // 1e44
+    {0xd5d238a4abe98068ULL, 109}, // 1e52
+    {0x9f4f2726179a2245ULL, 136}, // 1e60
+    {0xed63a231d4c4fb27ULL, 162}, // 1e68
+    {0xb0de65388cc8ada8ULL, 189}, // 1e76
+    {0x83c7088e1aab65dbULL, 216}, // 1e84
+    {0xc45d1df942711d9aULL, 242}, // 1e92
+    {0x924d692ca61be758ULL, 269}, // 1e100
+    {0xda01ee641a708deaULL, 295}, // 1e108
+    {0xa26da3999aef774aULL, 322}, // 1e116
+    {0xf209787bb47d6b85ULL, 348}, // 1e124
+    {0xb454e4a179dd1877ULL, 375}, // 1e132
+    {0x865b86925b9bc5c2ULL, 402}, // 1e140
+    {0xc83553c5c8965d3dULL, 428}, // 1e148
+    {0x952ab45cfa97a0b3ULL, 455}, // 1e156
+    {0xde469fbd99a05fe3ULL, 481}, // 1e164
+    {0xa59bc234db398c25ULL, 508}, // 1e172
+    {0xf6c69a72a3989f5cULL, 534}, // 1e180
+    {0xb7dcbf5354e9beceULL, 561}, // 1e188
+    {0x88fcf317f22241e2ULL, 588}, // 1e196
+    {0xcc20ce9bd35c78a5ULL, 614}, // 1e204
+    {0x98165af37b2153dfULL, 641}, // 1e212
+    {0xe2a0b5dc971f303aULL, 667}, // 1e220
+    {0xa8d9d1535ce3b396ULL, 694}, // 1e228
+    {0xfb9b7cd9a4a7443cULL, 720}, // 1e236
+    {0xbb764c4ca7a44410ULL, 747}, // 1e244
+    {0x8bab8eefb6409c1aULL, 774}, // 1e252
+    {0xd01fef10a657842cULL, 800}, // 1e260
+    {0x9b10a4e5e9913129ULL, 827}, // 1e268
+    {0xe7109bfba19c0c9dULL, 853}, // 1e276
+    {0xac2820d9623bf429ULL, 880}, // 1e284
+    {0x80444b5e7aa7cf85ULL, 907}, // 1e292
+    {0xbf21e44003acdd2dULL, 933}, // 1e300
+    {0x8e679c2f5e44ff8fULL, 960}, // 1e308
+    {0xd433179d9c8cb841ULL, 986}, // 1e316
+    {0x9e19db92b4e31ba9ULL, 1013}, // 1e324
+    {0xeb96bf6ebadf77d9ULL, 1039}, // 1e332
+    {0xaf87023b9bf0ee6bULL, 1066}, // 1e340
+};
 
-public:
-  JSONPairContext() : first_(true), colon_(true) {}
+const uint64_t kPowersOfTen[] = {1ULL,
+                                 10ULL,
+                                 100ULL,
+                                 1000ULL,
+                                 10000ULL,
+                                 100000ULL,
+                                 1000000ULL,
+                                 10000000ULL,
+                                 100000000ULL,
+                                 1000000000ULL,
+                                 10000000000ULL,
+                                 100000000000ULL,
+                                 1000000000000ULL,
+                                 10000000000000ULL,
+                                 100000000000000ULL,
+                                 1000000000000000ULL,
+                                 10000000000000000ULL,
+                                 100000000000000000ULL,
+                                 1000000000000000000ULL,
+                                 10000000000000000000ULL};
+
+DiyFp toDiyFp(double d) {
+  uint64_t bits;
+  std::memcpy(&bits, &d, sizeof(bits));
+  auto biasedExponent = static_cast<int>((bits >> kDoubleSignificandSize) & 0x7FF);
+  DiyFp result;
+  result.f = bits & kDoubleSignificandMask;
+  if (biasedExponent != 0) {
+    result.f += kDoubleHiddenBit;
+    result.e = biasedExponent - kDoubleExponentBias;
+  } else {
+    result.e = 1 - kDoubleExponentBias;
+  }
+  return result;
+}
 
-  uint32_t write(TTransport& trans) override {
-    if (first_) {
-      first_ = false;
-      colon_ = true;
-      return 0;
-    } else {
-      trans.write(colon_ ? &kJSONPairSeparator : &kJSONElemSeparator, 1);
-      colon_ = !colon_;
-      return 1;
-    }
+DiyFp multiply(const DiyFp& x, const DiyFp& y) {
+  const uint64_t kMask32 = 0xFFFFFFFFULL;
+  uint64_t a = x.f >> 32;
+  uint64_t b = x.f & kMask32;
+  uint64_t c = y.f >> 32;
+  uint64_t d = y.f & kMask32;
+  uint64_t ac = a * c;
+  uint64_t bc = b * c;
+  uint64_t ad = a * d;
+  uint64_t bd = b * d;
+  uint64_t tmp = (bd >> 32) + (ad & kMask32) + (bc & kMask32);
+  tmp += 1ULL << 31; // round
+  DiyFp result = {ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), x.e + y.e + 64};
+  return result;
+}
+
+DiyFp normalize(DiyFp x) {
+  while (!(x.f & (1ULL << 63))) {
+    x.f <<= 1;
+    x.e--;
   }
+  return x;
+}
 
-  uint32_t read(TJSONProtocol::LookaheadReader& reader) override {
-    if (first_) {
-      first_ = false;
-      colon_ = true;
-      return 0;
-    } else {
-      uint8_t ch = (colon_ ? kJSONPairSeparator : kJSONElemSeparator);
-      colon_ = !colon_;
-      return readSyntaxChar(reader, ch);
+// The normalized bounds of the interval of reals that round to v, with the
+// same exponent
+void normalizedBoundaries(const DiyFp& v, DiyFp& minus, DiyFp& plus) {
+  plus.f = (v.f << 1) + 1;
+  plus.e = v.e - 1;
+  while (!(plus.f & (kDoubleHiddenBit << 1))) {
+    plus.f <<= 1;
+    plus.e--;
+  }
+  plus.f <<= 64 - kDoubleSignificandSize - 2;
+  plus.e -= 64 - kDoubleSignificandSize - 2;
+  // the gap below a power of two is half the gap above it
+  if (v.f == kDoubleHiddenBit) {
+    minus.f = (v.f << 2) - 1;
+    minus.e = v.e - 2;
+  } else {
+    minus.f = (v.f << 1) - 1;
+    minus.e = v.e - 1;
+  }
+  minus.f <<= minus.e - plus.e;
+  minus.e = plus.e;
+}
+
+// The cached power of ten c = 10^-k that brings e into the range [-60, -32]
+DiyFp cachedPower(int e, int& k) {
+  double dk = (-61 - e) * 0.30102999566398114 + 347; // 1 / lg(10)
+  auto ik = static_cast<int>(dk);
+  if (dk - ik > 0.0) {
+    ik++;
+  }
+  auto index = static_cast<unsigned>((ik >> 3) + 1);
+  k = -(-348 + static_cast<int>(index << 3));
+  return kCachedPowers[index];
+}
+
+void grisuRound(char* buffer,
+                int length,
+                uint64_t delta,
+                uint64_t rest,
+                uint64_t tenKappa,
+                uint64_t distance) {
+  while (rest < distance && delta - rest >= tenKappa
+         && (rest + tenKappa < distance || distance - rest > rest + tenKappa - distance)) {
+    buffer[length - 1]--;
+    rest += tenKappa;
+  }
+}
+
+int countDecimalDigits(uint32_t n) {
+  int count = 1;
+  while (n >= 10) {
+    n /= 10;
+    count++;
+  }
+  return count;
+}
+
+void digitGen(const DiyFp& w, const DiyFp& mp, uint64_t delta, char* buffer, int& length, int& k) {
+  const DiyFp one = {1ULL << -mp.e, mp.e};
+  const uint64_t distance = mp.f - w.f;
+  auto p1 = static_cast<uint32_t>(mp.f >> -one.e);
+  uint64_t p2 = mp.f & (one.f - 1);
+  int kappa = countDecimalDigits(p1);
+  length = 0;
+  while (kappa > 0) {
+    uint32_t divisor = static_cast<uint32_t>(kPowersOfTen[kappa - 1]);
+    uint32_t d = p1 / divisor;
+    p1 %= divisor;
+    if (d || length) {
+      buffer[length++] = static_cast<char>('0' + d);
+    }
+    kappa--;
+    uint64_t rest = (static_cast<uint64_t>(p1) << -one.e) + p2;
+    if (rest <= delta) {
+      k += kappa;
+      grisuRound(buffer, length, delta, rest, kPowersOfTen[kappa] << -one.e, distance);
+      return;
     }
   }
+  for (;;) {
+    p2 *= 10;
+    delta *= 10;
+    auto d = static_cast<char>(p2 >> -one.e);
+    if (d || length) {
+      buffer[length++] = static_cast<char>('0' + d);
+    }
+    p2 &= one.f - 1;
+    kappa--;
+    if (p2 < delta) {
+      k += kappa;
+      int index = -kappa;
+      grisuRound(buffer, length, delta, p2, one.f, distance * (index < 20 ? kPowersOfTen[index] : 0));
+      return;
+    }
+  }
+}
 
-  // Numbers must be turned into strings if they are the key part of a pair
-  bool escapeNum() override { return colon_; }
+// Writes the digits of value, which must be finite and positive, to buffer,
+// such that value reads back from buffer * 10^k.
+void grisu2(double value, char* buffer, int& length, int& k) {
+  const DiyFp v = toDiyFp(value);
+  DiyFp minus, plus;
+  normalizedBoundaries(v, minus, plus);
+  const DiyFp c = cachedPower(plus.e, k);
+  const DiyFp w = multiply(normalize(v), c);
+  DiyFp wPlus = multiply(plus, c);
+  DiyFp wMinus = multiply(minus, c);
+  wMinus.f++;
+  wPlus.f--;
+  digitGen(w, wPlus, wPlus.f - wMinus.f, buffer, length, k);
+}
+
+// Writes num, which must be finite, to out in the style of printf("%.17g")
+// but with only as many digits as it takes to read back exactly, and returns
+// how many characters were written.  out must have room for 25.
+uint32_t formatDouble(double num, uint8_t* out) {
+  uint8_t* pos = out;
+  if (std::signbit(num)) {
+    *pos++ = '-';
+    num = -num;
+  }
+  if (num == 0.0) {
+    *pos++ = '0';
+    return static_cast<uint32_t>(pos - out);
+  }
 
-private:
-  bool first_;
-  bool colon_;
-};
+  char digits[32];
+  int length = 0;
+  int k = 0;
+  grisu2(num, digits, length, k);
+  // the power of ten of the first digit
+  int exponent = length + k - 1;
+
+  if (exponent < -4 || exponent >= 17) {
+    *pos++ = digits[0];
+    if (length > 1) {
+      *pos++ = '.';
+      std::memcpy(pos, digits + 1, length - 1);
+      pos += length - 1;
+    }
+    *pos++ = 'e';
+    *pos++ = exponent < 0 ? '-' : '+';
+    int magnitude = exponent < 0 ? -exponent : exponent;
+    if (magnitude >= 100) {
+      *pos++ = static_cast<uint8_t>('0' + magnitude / 100);
+      magnitude %= 100;
+    }
+    *pos++ = kDigitPairs[magnitude * 2];
+    *pos++ = kDigitPairs[magnitude * 2 + 1];
+  } else if (exponent < 0) {
+    *pos++ = '0';
+    *pos++ = '.';
+    std::memset(pos, '0', -exponent - 1);
+    pos += -exponent - 1;
+    std::memcpy(pos, digits, length);
+    pos += length;
+  } else if (length <= exponent + 1) {
+    std::memcpy(pos, digits, length);
+    pos += length;
+    std::memset(pos, '0', exponent + 1 - length);
+    pos += exponent + 1 - length;
+  } else {
+    std::memcpy(pos, digits, exponent + 1);
+    pos += exponent + 1;
+    *pos++ = '.';
+    std::memcpy(pos, digits + exponent + 1, length - exponent - 1);
+    pos += length - exponent - 1;
+  }
+  return static_cast<uint32_t>(pos - out);
+}
+
+// The powers of ten a double holds exactly
+const double kExactPowersOfTen[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                    1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                    1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+// Reads str into num when it has at most 19 significant digits, these fit in
+// a double exactly and the power of ten is at most 22, so that a single
+// correctly rounded multiplication or division gives the nearest double
+// (Clinger's fast path).  Returns false for everything else.
+bool parseDoubleFast(const std::string& str, double& num) {
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+  const char* pos = str.data();
+  const char* end = pos + str.length();
+  bool negative = false;
+  if (pos != end && *pos == '-') {
+    negative = true;
+    ++pos;
+  }
+  uint64_t significand = 0;
+  int digits = 0;
+  int exponent = 0;
+  bool any = false;
+  for (; pos != end && *pos >= '0' && *pos <= '9'; ++pos, any = true) {
+    if ((significand != 0 || *pos != '0') && ++digits > 19) {
+      return false;
+    }
+    significand = significand * 10 + (*pos - '0');
+  }
+  if (pos != end && *pos == '.') {
+    for (++pos; pos != end && *pos >= '0' && *pos <= '9'; ++pos, any = true) {
+      if ((significand != 0 || *pos != '0') && ++digits > 19) {
+        return false;
+      }
+      significand = significand * 10 + (*pos - '0');
+      exponent--;
+    }
+  }
+  if (!any) {
+    return false;
+  }
+  if (pos != end && (*pos == 'e' || *pos == 'E')) {
+    ++pos;
+    bool negativeExponent = false;
+    if (pos != end && (*pos == '-' || *pos == '+')) {
+      negativeExponent = (*pos == '-');
+      ++pos;
+    }
+    if (pos == end || end - pos > 4) {
+      return false;
+    }
+    int power = 0;
+    for (; pos != end; ++pos) {
+      if (*pos < '0' || *pos > '9') {
+        return false;
+      }
+      power = power * 10 + (*pos - '0');
+    }
+    exponent += negativeExponent ? -power : power;
+  }
+  if (pos != end || significand > (1ULL << 53) || exponent < -22 || exponent > 22) {
+    return false;
+  }
+  auto value = static_cast<double>(significand);
+  if (exponent < 0) {
+    value /= kExactPowersOfTen[-exponent];
+  } else {
+    value *= kExactPowersOfTen[exponent];
+  }
+  num = negative ? -value : value;
+  return true;
+#else
+  (void)str;
+  (void)num;
+  return false;
+#endif
+}
 
-// Context class for lists
-class JSONListContext : public TJSONContext {
+template <typename T>
+T fromString(const std::string& s) {
+  T t;
+  std::istringstream str(s);
+  str.imbue(std::locale::classic());
+  str >> t;
+  if (str.bad() || !str.eof())
+    throw std::runtime_error(s);
+  return t;
+}
 
-public:
-  JSONListContext() : first_(true) {}
+double parseDouble(const std::string& str) {
+  double num;
+  if (!parseDoubleFast(str, num)) {
+    num = fromString<double>(str);
+  }
+  return num;
+}
+}
 
-  uint32_t write(TTransport& trans) override {
-    if (first_) {
-      first_ = false;
+uint32_t TJSONProtocol::LookaheadReader::readStringRun(std::string& str) {
+  uint32_t result = 0;
+  if (hasData_) {
+    if (data_ == kJSONStringDelimiter || data_ == kJSONBackslash) {
       return 0;
-    } else {
-      trans.write(&kJSONElemSeparator, 1);
-      return 1;
+    }
+    str += static_cast<char>(data_);
+    hasData_ = false;
+    ++result;
+  }
+  while (true) {
+    uint32_t len = 1;
+    const uint8_t* buf = trans_->borrow(nullptr, &len);
+    if (buf == nullptr) {
+      // Nothing to lend: go a byte at a time until the transport refills
+      uint8_t ch = peek();
+      if (ch == kJSONStringDelimiter || ch == kJSONBackslash) {
+        return result;
+      }
+      str += static_cast<char>(ch);
+      hasData_ = false;
+      ++result;
+      continue;
+    }
+    uint32_t run = scanStringRun(buf, len);
+    str.append(reinterpret_cast<const char*>(buf), run);
+    trans_->consume(run);
+    result += run;
+    if (run < len) {
+      return result;
     }
   }
+}
 
-  uint32_t read(TJSONProtocol::LookaheadReader& reader) override {
-    if (first_) {
-      first_ = false;
+uint32_t TJSONProtocol::LookaheadReader::readNumericRun(std::string& str) {
+  uint32_t result = 0;
+  if (hasData_) {
+    if (!isJSONNumeric(data_)) {
       return 0;
-    } else {
-      return readSyntaxChar(reader, kJSONElemSeparator);
     }
+    str += static_cast<char>(data_);
+    hasData_ = false;
+    ++result;
   }
-
-private:
-  bool first_;
-};
+  while (true) {
+    uint32_t len = 1;
+    const uint8_t* buf = trans_->borrow(nullptr, &len);
+    if (buf == nullptr) {
+      uint8_t ch = peek();
+      if (!isJSONNumeric(ch)) {
+        return result;
+      }
+      str += static_cast<char>(ch);
+      hasData_ = false;
+      ++result;
+      continue;
+    }
+    uint32_t run = 0;
+    while (run < len && isJSONNumeric(buf[run])) {
+      ++run;
+    }
+    str.append(reinterpret_cast<const char*>(buf), run);
+    trans_->consume(run);
+    result += run;
+    if (run < len) {
+      return result;
+    }
+  }
+}
 
 TJSONProtocol::TJSONProtocol(std::shared_ptr<TTransport> ptrans)
   : TVirtualProtocol<TJSONProtocol>(ptrans),
     trans_(ptrans.get()),
-    context_(new TJSONContext()),
     reader_(*ptrans) {
+  // Deep enough for most data never to grow it
+  contexts_.reserve(32);
+  pushContext(JSONContext::TOP_LEVEL);
 }
 
 TJSONProtocol::~TJSONProtocol() = default;
 
-void TJSONProtocol::pushContext(std::shared_ptr<TJSONContext> c) {
-  contexts_.push(context_);
-  context_ = c;
+void TJSONProtocol::pushContext(JSONContext::Kind kind) {
+  JSONContext context = {static_cast<uint8_t>(kind), true, true};
+  contexts_.push_back(context);
 }
 
 void TJSONProtocol::popContext() {
-  context_ = contexts_.top();
-  contexts_.pop();
+  contexts_.pop_back();
+}
+
+// Moves the current context on to its next value, and returns the separator
+// to go before that value, or 0 if none does.
+uint8_t TJSONProtocol::nextSeparator() {
+  JSONContext& context = contexts_.back();
+  if (context.kind == JSONContext::TOP_LEVEL) {
+    return 0;
+  }
+  if (context.first) {
+    context.first = false;
+    context.colon = true;
+    return 0;
+  }
+  if (context.kind == JSONContext::LIST) {
+    return kJSONElemSeparator;
+  }
+  uint8_t separator = context.colon ? kJSONPairSeparator : kJSONElemSeparator;
+  context.colon = !context.colon;
+  return separator;
+}
+
+// Numbers must be turned into strings if they are the key part of a pair
+bool TJSONProtocol::escapeNum() const {
+  const JSONContext& context = contexts_.back();
+  return context.kind == JSONContext::PAIR && context.colon;
+}
+
+uint32_t TJSONProtocol::writeContext() {
+  uint8_t separator = nextSeparator();
+  if (separator == 0) {
+    return 0;
+  }
+  trans_->write(&separator, 1);
+  return 1;
 }
 
-// Write the character ch as a JSON escape sequence ("\u00xx")
-uint32_t TJSONProtocol::writeJSONEscapeChar(uint8_t ch) {
-  trans_->write((const uint8_t*)kJSONEscapePrefix.c_str(),
-                static_cast<uint32_t>(kJSONEscapePrefix.length()));
-  uint8_t outCh = hexChar(ch >> 4);
-  trans_->write(&outCh, 1);
-  outCh = hexChar(ch);
-  trans_->write(&outCh, 1);
-  return 6;
+uint32_t TJSONProtocol::readContext() {
+  uint8_t separator = nextSeparator();
+  if (separator == 0) {
+    return 0;
+  }
+  return readSyntaxChar(reader_, separator);
 }
 
-// Write the character ch as part of a JSON string, escaping as appropriate.
+// Write the character ch, one that cannot appear in a JSON string as it is,
+// as an escape sequence: "\x" where there is a short one, or "\u00xx".
 uint32_t TJSONProtocol::writeJSONChar(uint8_t ch) {
-  if (ch >= 0x30) {
-    if (ch == kJSONBackslash) { // Only special character >= 0x30 is '\'
-      trans_->write(&kJSONBackslash, 1);
-      trans_->write(&kJSONBackslash, 1);
-      return 2;
-    } else {
-      trans_->write(&ch, 1);
-      return 1;
-    }
-  } else {
-    uint8_t outCh = kJSONCharTable[ch];
-    // Check if regular character, backslash escaped, or JSON escaped
-    if (outCh == 1) {
-      trans_->write(&ch, 1);
-      return 1;
-    } else if (outCh > 1) {
-      trans_->write(&kJSONBackslash, 1);
-      trans_->write(&outCh, 1);
-      return 2;
-    } else {
-      return writeJSONEscapeChar(ch);
+  uint8_t escape[6] = {kJSONBackslash, ch, 0, 0, 0, 0};
+  if (ch < 0x20) {
+    escape[1] = kJSONCharTable[ch];
+    if (escape[1] == 0) {
+      escape[1] = kJSONEscapeChar;
+      escape[2] = '0';
+      escape[3] = '0';
+      escape[4] = hexChar(ch >> 4);
+      escape[5] = hexChar(ch);
+      trans_->write(escape, 6);
+      return 6;
     }
   }
+  trans_->write(escape, 2);
+  return 2;
 }
 
 // Write out the contents of the string str as a JSON string, escaping
 // characters as appropriate.
 uint32_t TJSONProtocol::writeJSONString(const std::string& str) {
-  uint32_t result = context_->write(*trans_);
+  if (str.length() > (std::numeric_limits<uint32_t>::max)())
+    throw TProtocolException(TProtocolException::SIZE_LIMIT);
+  uint32_t result = writeContext();
   result += 2; // For quotes
   trans_->write(&kJSONStringDelimiter, 1);
-  std::string::const_iterator iter(str.begin());
-  std::string::const_iterator end(str.end());
-  while (iter != end) {
-    result += writeJSONChar(*iter++);
+  const auto* bytes = reinterpret_cast<const uint8_t*>(str.data());
+  auto len = static_cast<uint32_t>(str.length());
+  uint32_t pos = 0;
+  while (pos < len) {
+    uint32_t run = scanUnescapedRun(bytes + pos, len - pos);
+    if (run > 0) {
+      trans_->write(bytes + pos, run);
+      result += run;
+      pos += run;
+    }
+    if (pos < len) {
+      result += writeJSONChar(bytes[pos++]);
+    }
   }
   trans_->write(&kJSONStringDelimiter, 1);
   return result;
@@ -470,21 +1067,25 @@ uint32_t TJSONProtocol::writeJSONString(const std::string& str) {
 // Write out the contents of the string as JSON string, base64-encoding
 // the string's contents, and escaping as appropriate
 uint32_t TJSONProtocol::writeJSONBase64(const std::string& str) {
-  uint32_t result = context_->write(*trans_);
+  uint32_t result = writeContext();
   result += 2; // For quotes
   trans_->write(&kJSONStringDelimiter, 1);
-  uint8_t b[4];
   const auto* bytes = (const uint8_t*)str.c_str();
   if (str.length() > (std::numeric_limits<uint32_t>::max)())
     throw TProtocolException(TProtocolException::SIZE_LIMIT);
   auto len = static_cast<uint32_t>(str.length());
+  // Encode 3 bytes at a time, a buffer full at a time
+  uint8_t b[256];
   while (len >= 3) {
-    // Encode 3 bytes at a time
-    base64_encode(bytes, 3, b);
-    trans_->write(b, 4);
-    result += 4;
-    bytes += 3;
-    len -= 3;
+    uint32_t encoded = 0;
+    while (len >= 3 && encoded + 4 <= sizeof(b)) {
+      base64_encode(bytes, 3, b + encoded);
+      encoded += 4;
+      bytes += 3;
+      len -= 3;
+    }
+    trans_->write(b, encoded);
+    result += encoded;
   }
   if (len) { // Handle remainder
     base64_encode(bytes, len, b);
@@ -499,81 +1100,78 @@ uint32_t TJSONProtocol::writeJSONBase64(const std::string& str) {
 // if the context requires it (eg: key in a map pair).
 template <typename NumberType>
 uint32_t TJSONProtocol::writeJSONInteger(NumberType num) {
-  uint32_t result = context_->write(*trans_);
-  std::string val(to_string(num));
-  bool escapeNum = context_->escapeNum();
-  if (escapeNum) {
-    trans_->write(&kJSONStringDelimiter, 1);
-    result += 1;
-  }
-  if (val.length() > (std::numeric_limits<uint32_t>::max)())
-    throw TProtocolException(TProtocolException::SIZE_LIMIT);
-  trans_->write((const uint8_t*)val.c_str(), static_cast<uint32_t>(val.length()));
-  result += static_cast<uint32_t>(val.length());
-  if (escapeNum) {
-    trans_->write(&kJSONStringDelimiter, 1);
-    result += 1;
+  // separator, quotes, sign and 20 digits
+  uint8_t buf[24];
+  uint32_t len = 0;
+  uint8_t separator = nextSeparator();
+  if (separator) {
+    buf[len++] = separator;
   }
-  return result;
-}
-
-namespace {
-std::string doubleToString(double d) {
-  std::ostringstream str;
-  str.imbue(std::locale::classic());
-  const std::streamsize max_digits10 = 2 + std::numeric_limits<double>::digits10;
-  str.precision(max_digits10);
-  str << d;
-  return str.str();
-}
+  bool quote = escapeNum();
+  if (quote) {
+    buf[len++] = kJSONStringDelimiter;
+  }
+  len += formatInteger(static_cast<int64_t>(num), buf + len);
+  if (quote) {
+    buf[len++] = kJSONStringDelimiter;
+  }
+  trans_->write(buf, len);
+  return len;
 }
 
 // Convert the given double to a JSON string, which is either the number,
 // "NaN" or "Infinity" or "-Infinity".
 uint32_t TJSONProtocol::writeJSONDouble(double num) {
-  uint32_t result = context_->write(*trans_);
-  std::string val;
+  // separator, quotes and up to 25 characters of number
+  uint8_t buf[32];
+  uint32_t len = 0;
+  uint8_t separator = nextSeparator();
+  if (separator) {
+    buf[len++] = separator;
+  }
 
-  bool special = false;
+  const std::string* special = nullptr;
   switch (std::fpclassify(num)) {
   case FP_INFINITE:
-    if (std::signbit(num)) {
-      val = kThriftNegativeInfinity;
-    } else {
-      val = kThriftInfinity;
-    }
-    special = true;
+    special = std::signbit(num) ? &kThriftNegativeInfinity : &kThriftInfinity;
     break;
   case FP_NAN:
-    val = kThriftNan;
-    special = true;
-    break;
-  default:
-    val = doubleToString(num);
+    special = &kThriftNan;
     break;
   }
 
-  bool escapeNum = special || context_->escapeNum();
-  if (escapeNum) {
-    trans_->write(&kJSONStringDelimiter, 1);
-    result += 1;
+  bool quote = special || escapeNum();
+  if (quote) {
+    buf[len++] = kJSONStringDelimiter;
   }
-  if (val.length() > (std::numeric_limits<uint32_t>::max)())
-    throw TProtocolException(TProtocolException::SIZE_LIMIT);
-  trans_->write((const uint8_t*)val.c_str(), static_cast<uint32_t>(val.length()));
-  result += static_cast<uint32_t>(val.length());
-  if (escapeNum) {
-    trans_->write(&kJSONStringDelimiter, 1);
-    result += 1;
+  if (special) {
+    std::memcpy(buf + len, special->data(), special->length());
+    len += static_cast<uint32_t>(special->length());
+  } else {
+    len += formatDouble(num, buf + len);
   }
-  return result;
+  if (quote) {
+    buf[len++] = kJSONStringDelimiter;
+  }
+  trans_->write(buf, len);
+  return len;
+}
+
+uint32_t TJSONProtocol::writeJSONStart(JSONContext::Kind kind, uint8_t ch) {
+  uint8_t buf[2];
+  uint32_t len = 0;
+  uint8_t separator = nextSeparator();
+  if (separator) {
+    buf[len++] = separator;
+  }
+  buf[len++] = ch;
+  trans_->write(buf, len);
+  pushContext(kind);
+  return len;
 }
 
 uint32_t TJSONProtocol::writeJSONObjectStart() {
-  uint32_t result = context_->write(*trans_);
-  trans_->write(&kJSONObjectStart, 1);
-  pushContext(std::shared_ptr<TJSONContext>(new JSONPairContext()));
-  return result + 1;
+  return writeJSONStart(JSONContext::PAIR, kJSONObjectStart);
 }
 
 uint32_t TJSONProtocol::writeJSONObjectEnd() {
@@ -583,10 +1181,7 @@ uint32_t TJSONProtocol::writeJSONObjectEnd() {
 }
 
 uint32_t TJSONProtocol::writeJSONArrayStart() {
-  uint32_t result = context_->write(*trans_);
-  trans_->write(&kJSONArrayStart, 1);
-  pushContext(std::shared_ptr<TJSONContext>(new JSONListContext()));
-  return result + 1;
+  return writeJSONStart(JSONContext::LIST, kJSONArrayStart);
 }
 
 uint32_t TJSONProtocol::writeJSONArrayEnd() {
@@ -681,8 +1276,8 @@ uint32_t TJSONProtocol::writeBool(const bool value) {
 }
 
 uint32_t TJSONProtocol::writeByte(const int8_t byte) {
-  // writeByte() must be handled specially because to_string sees
-  // int8_t as a text type instead of an integer type
+  // writeByte() widens the byte so that it is written as a number rather
+  // than a character
   return writeJSONInteger((int16_t)byte);
 }
 
@@ -736,52 +1331,57 @@ uint32_t TJSONProtocol::readJSONEscapeChar(uint16_t* out) {
 
 // Decodes a JSON string, including unescaping, and returns the string via str
 uint32_t TJSONProtocol::readJSONString(std::string& str, bool skipContext) {
-  uint32_t result = (skipContext ? 0 : context_->read(reader_));
+  uint32_t result = (skipContext ? 0 : readContext());
   result += readJSONSyntaxChar(kJSONStringDelimiter);
   std::vector<uint16_t> codeunits;
   uint8_t ch;
   str.clear();
   while (true) {
+    uint32_t run = reader_.readStringRun(str);
+    if (run > 0) {
+      if (!codeunits.empty()) {
+        throw TProtocolException(TProtocolException::INVALID_DATA,
+                                 "Missing UTF-16 low surrogate pair.");
+      }
+      result += run;
+    }
     ch = reader_.read();
     ++result;
     if (ch == kJSONStringDelimiter) {
       break;
     }
-    if (ch == kJSONBackslash) {
-      ch = reader_.read();
-      ++result;
-      if (ch == kJSONEscapeChar) {
-        uint16_t cp;
-        result += readJSONEscapeChar(&cp);
-        if (isHighSurrogate(cp)) {
-          codeunits.push_back(cp);
-        } else {
-          if (isLowSurrogate(cp)
-               && codeunits.empty()) {
-            throw TProtocolException(TProtocolException::INVALID_DATA,
-                                     "Missing UTF-16 high surrogate pair.");
-          }
-          codeunits.push_back(cp);
-          codeunits.push_back(0);
-          str += boost::locale::conv::utf_to_utf<char>(codeunits.data());
-          codeunits.clear();
-        }
-        continue;
+    // ch is a backslash
+    ch = reader_.read();
+    ++result;
+    if (ch == kJSONEscapeChar) {
+      uint16_t cp;
+      result += readJSONEscapeChar(&cp);
+      if (isHighSurrogate(cp)) {
+        codeunits.push_back(cp);
       } else {
-        size_t pos = kEscapeChars.find(ch);
-        if (pos == kEscapeChars.npos) {
+        if (isLowSurrogate(cp)
+             && codeunits.empty()) {
           throw TProtocolException(TProtocolException::INVALID_DATA,
-                                   "Expected control char, got '" + std::string((const char*)&ch, 1)
-                                   + "'.");
+                                   "Missing UTF-16 high surrogate pair.");
         }
-        ch = kEscapeCharVals[pos];
+        codeunits.push_back(cp);
+        codeunits.push_back(0);
+        str += boost::locale::conv::utf_to_utf<char>(codeunits.data());
+        codeunits.clear();
       }
+      continue;
+    }
+    size_t pos = kEscapeChars.find(ch);
+    if (pos == kEscapeChars.npos) {
+      throw TProtocolException(TProtocolException::INVALID_DATA,
+                               "Expected control char, got '" + std::string((const char*)&ch, 1)
+                               + "'.");
     }
     if (!codeunits.empty()) {
       throw TProtocolException(TProtocolException::INVALID_DATA,
                                "Missing UTF-16 low surrogate pair.");
     }
-    str += ch;
+    str += kEscapeCharVals[pos];
   }
 
   if (!codeunits.empty()) {
@@ -825,50 +1425,26 @@ uint32_t TJSONProtocol::readJSONBase64(std::string& str) {
 // Reads a sequence of characters, stopping at the first one that is not
 // a valid JSON numeric character.
 uint32_t TJSONProtocol::readJSONNumericChars(std::string& str) {
-  uint32_t result = 0;
   str.clear();
-  while (true) {
-    uint8_t ch = reader_.peek();
-    if (!isJSONNumeric(ch)) {
-      break;
-    }
-    reader_.read();
-    str += ch;
-    ++result;
-  }
-  return result;
-}
-
-namespace {
-template <typename T>
-T fromString(const std::string& s) {
-  T t;
-  std::istringstream str(s);
-  str.imbue(std::locale::classic());
-  str >> t;
-  if (str.bad() || !str.eof())
-    throw std::runtime_error(s);
-  return t;
-}
+  return reader_.readNumericRun(str);
 }
 
 // Reads a sequence of characters and assembles them into a number,
 // returning them via num
 template <typename NumberType>
 uint32_t TJSONProtocol::readJSONInteger(NumberType& num) {
-  uint32_t result = context_->read(reader_);
-  if (context_->escapeNum()) {
+  uint32_t result = readContext();
+  bool quoted = escapeNum();
+  if (quoted) {
     result += readJSONSyntaxChar(kJSONStringDelimiter);
   }
   std::string str;
   result += readJSONNumericChars(str);
-  try {
-    num = fromString<NumberType>(str);
-  } catch (const std::runtime_error&) {
+  if (!parseInteger(str, num)) {
     throw TProtocolException(TProtocolException::INVALID_DATA,
                              "Expected numeric value; got \"" + str + "\"");
   }
-  if (context_->escapeNum()) {
+  if (quoted) {
     result += readJSONSyntaxChar(kJSONStringDelimiter);
   }
   return result;
@@ -876,7 +1452,7 @@ uint32_t TJSONProtocol::readJSONInteger(NumberType& num) {
 
 // Reads a JSON number or string and interprets it as a double.
 uint32_t TJSONProtocol::readJSONDouble(double& num) {
-  uint32_t result = context_->read(reader_);
+  uint32_t result = readContext();
   std::string str;
   if (reader_.peek() == kJSONStringDelimiter) {
     result += readJSONString(str, true);
@@ -888,26 +1464,26 @@ uint32_t TJSONProtocol::readJSONDouble(double& num) {
     } else if (str == kThriftNegativeInfinity) {
       num = -HUGE_VAL;
     } else {
-      if (!context_->escapeNum()) {
+      if (!escapeNum()) {
         // Throw exception -- we should not be in a string in this case
         throw TProtocolException(TProtocolException::INVALID_DATA,
                                      "Numeric data unexpectedly quoted");
       }
       try {
-        num = fromString<double>(str);
+        num = parseDouble(str);
       } catch (const std::runtime_error&) {
         throw TProtocolException(TProtocolException::INVALID_DATA,
                                      "Expected numeric value; got \"" + str + "\"");
       }
     }
   } else {
-    if (context_->escapeNum()) {
+    if (escapeNum()) {
       // This will throw - we should have had a quote if escapeNum == true
       readJSONSyntaxChar(kJSONStringDelimiter);
     }
     result += readJSONNumericChars(str);
     try {
-      num = fromString<double>(str);
+      num = parseDouble(str);
     } catch (const std::runtime_error&) {
       throw TProtocolException(TProtocolException::INVALID_DATA,
                                    "Expected numeric value; got \"" + str + "\"");
@@ -917,9 +1493,9 @@ uint32_t TJSONProtocol::readJSONDouble(double& num) {
 }
 
 uint32_t TJSONProtocol::readJSONObjectStart() {
-  uint32_t result = context_->read(reader_);
+  uint32_t result = readContext();
   result += readJSONSyntaxChar(kJSONObjectStart);
-  pushContext(std::shared_ptr<TJSONContext>(new JSONPairContext()));
+  pushContext(JSONContext::PAIR);
   return result;
 }
 
@@ -930,9 +1506,9 @@ uint32_t TJSONProtocol::readJSONObjectEnd() {
 }
 
 uint32_t TJSONProtocol::readJSONArrayStart() {
-  uint32_t result = context_->read(reader_);
+  uint32_t result = readContext();
   result += readJSONSyntaxChar(kJSONArrayStart);
-  pushContext(std::shared_ptr<TJSONContext>(new JSONListContext()));
+  pushContext(JSONContext::LIST);
   return result;
 }
 
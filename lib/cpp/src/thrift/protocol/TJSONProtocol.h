@@ -22,15 +22,12 @@
 
 #include <thrift/protocol/TVirtualProtocol.h>
 
-#include <stack>
+#include <vector>
 
 namespace apache {
 namespace thrift {
 namespace protocol {
 
-// Forward declaration
-class TJSONContext;
-
 /**
  * JSON protocol for Thrift.
  *
@@ -83,15 +80,14 @@ class TJSONContext;
  *    version #, the message name, the message type, and the sequence ID as
  *    the first 4 elements.
  *
- * More discussion of the double handling is probably warranted. The aim of
- * the current implementation is to match as closely as possible the behavior
- * of Java's Double.toString(), which has no precision loss.  Implementors in
- * other languages should strive to achieve that where possible. I have not
- * yet verified whether std::istringstream::operator>>, which is doing that
- * work for me in C++, loses any precision, but I am leaving this as a future
- * improvement. I may try to provide a C component for this, so that other
- * languages could bind to the same underlying implementation for maximum
- * consistency.
+ * Doubles are written with as few digits as read back as exactly the same
+ * value, in the manner of Java's Double.toString(), so 0.1 is written as 0.1
+ * rather than 0.10000000000000001.  Readers accept any number of digits.
+ *
+ * Strings are scanned and written a run of plain characters at a time, as
+ * much as the transport will lend (see TTransport::borrow()), rather than a
+ * byte at a time, and the nesting of objects and arrays is tracked in a flat
+ * stack that does not allocate once it is as deep as the data has been.
  *
  */
 class TJSONProtocol : public TVirtualProtocol<TJSONProtocol> {
@@ -101,11 +97,29 @@ public:
   ~TJSONProtocol() override;
 
 private:
-  void pushContext(std::shared_ptr<TJSONContext> c);
+  /**
+   * Where in the JSON text the protocol is: at the top level, in an array or
+   * in an object, whether the next value is the first there, and in an
+   * object whether it is a key (after which a ':' comes) or a value.
+   */
+  struct JSONContext {
+    enum Kind { TOP_LEVEL, LIST, PAIR };
+    uint8_t kind;
+    bool first;
+    bool colon;
+  };
+
+  void pushContext(JSONContext::Kind kind);
 
   void popContext();
 
-  uint32_t writeJSONEscapeChar(uint8_t ch);
+  uint8_t nextSeparator();
+
+  bool escapeNum() const;
+
+  uint32_t writeContext();
+
+  uint32_t readContext();
 
   uint32_t writeJSONChar(uint8_t ch);
 
@@ -118,6 +132,8 @@ private:
 
   uint32_t writeJSONDouble(double num);
 
+  uint32_t writeJSONStart(JSONContext::Kind kind, uint8_t ch);
+
   uint32_t writeJSONObjectStart();
 
   uint32_t writeJSONObjectEnd();
@@ -285,6 +301,18 @@ public:
       return data_;
     }
 
+    /**
+     * Appends to str the characters up to, not including, the next '"' or a
+     * backslash, and returns how many there were.
+     */
+    uint32_t readStringRun(std::string& str);
+
+    /**
+     * Appends to str the characters up to the first that cannot be part of a
+     * JSON number, and returns how many there were.
+     */
+    uint32_t readNumericRun(std::string& str);
+
   private:
     TTransport* trans_;
     bool hasData_;
@@ -294,8 +322,7 @@ public:
 private:
   TTransport* trans_;
 
-  std::stack<std::shared_ptr<TJSONContext> > contexts_;
-  std::shared_ptr<TJSONContext> context_;
+  std::vector<JSONContext> contexts_;
   LookaheadReader reader_;
 };
 
@@ -0,0 +1,118 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <thrift/protocol/TLazyField.h>
+
+#include <typeinfo>
+
+#include <thrift/protocol/TProtocolTap.h>
+#include <thrift/transport/TBufferTransports.h>
+
+using apache::thrift::transport::TMemoryBuffer;
+using apache::thrift::transport::TTransportException;
+
+namespace apache {
+namespace thrift {
+namespace protocol {
+
+namespace {
+
+// The length of the value of type type at the start of the avail bytes at
+// start, or 0 if it does not end within them.
+uint32_t valueLength(TProtocolFactory& factory,
+                     const std::shared_ptr<TConfiguration>& config,
+                     const uint8_t* start,
+                     uint32_t avail,
+                     TType type) {
+  std::shared_ptr<TMemoryBuffer> window(
+      new TMemoryBuffer(const_cast<uint8_t*>(start), avail, TMemoryBuffer::OBSERVE, config));
+  try {
+    factory.getProtocol(window)->skip(type);
+  } catch (const TTransportException& e) {
+    if (e.getType() == TTransportException::END_OF_FILE) {
+      return 0;
+    }
+    throw;
+  }
+  return avail - window->available_read();
+}
+}
+
+bool TLazyBytes::read(TProtocol* iprot, TType type, uint32_t& xfer) {
+  std::shared_ptr<TProtocolFactory> factory = iprot->getValueProtocolFactory();
+  if (!factory) {
+    return false;
+  }
+
+  std::shared_ptr<TTransport> trans = iprot->getTransport();
+  std::shared_ptr<TConfiguration> config = trans->getConfiguration();
+  std::shared_ptr<std::string> bytes(new std::string());
+  uint32_t avail = 1;
+  const uint8_t* start = trans->borrow(nullptr, &avail);
+  uint32_t size = start != nullptr ? valueLength(*factory, config, start, avail, type) : 0;
+  if (size != 0) {
+    bytes->assign(reinterpret_cast<const char*>(start), size);
+    trans->consume(size);
+    xfer += size;
+  } else {
+    // Not all in the buffer, so make a copy as it is read
+    std::shared_ptr<TMemoryBuffer> sink(new TMemoryBuffer());
+    TProtocolTap tap(std::shared_ptr<TProtocol>(std::shared_ptr<TProtocol>(), iprot),
+                     factory->getProtocol(sink));
+    xfer += tap.skip(type);
+    *bytes = sink->getBufferAsString();
+  }
+
+  bytes_ = bytes;
+  factory_ = factory;
+  config_ = config;
+  return true;
+}
+
+bool TLazyBytes::write(TProtocol* oprot, uint32_t& xfer) const {
+  if (!factory_) {
+    return false;
+  }
+  std::shared_ptr<TProtocolFactory> factory = oprot->getValueProtocolFactory();
+  if (!factory || typeid(*factory) != typeid(*factory_)) {
+    return false;
+  }
+  auto size = static_cast<uint32_t>(bytes_->size());
+  oprot->getTransport()->write(reinterpret_cast<const uint8_t*>(bytes_->data()), size);
+  xfer += size;
+  return true;
+}
+
+std::shared_ptr<TProtocol> TLazyBytes::getReader() const {
+  std::shared_ptr<TMemoryBuffer> buffer(
+      new TMemoryBuffer(reinterpret_cast<uint8_t*>(const_cast<char*>(bytes_->data())),
+                        static_cast<uint32_t>(bytes_->size()),
+                        TMemoryBuffer::OBSERVE,
+                        config_));
+  return factory_->getProtocol(buffer);
+}
+
+void TLazyBytes::clear() {
+  bytes_.reset();
+  factory_.reset();
+  config_.reset();
+}
+}
+}
+} // apache::thrift::protocol
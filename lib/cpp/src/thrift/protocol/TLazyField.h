@@ -0,0 +1,171 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _THRIFT_PROTOCOL_TLAZYFIELD_H_
+#define _THRIFT_PROTOCOL_TLAZYFIELD_H_ 1
+
+#include <thrift/TToString.h>
+#include <thrift/protocol/TProtocol.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace apache {
+namespace thrift {
+namespace protocol {
+
+/**
+ * The bytes of one value exactly as a protocol encoded them, kept apart from
+ * the message they were read from.  Copies share the bytes.
+ */
+class TLazyBytes {
+public:
+  /**
+   * Reads the next value, of type type, from iprot and keeps its bytes.  They
+   * are taken straight from the transport's buffer when all of the value is
+   * there, and copied out as the value is read otherwise.
+   *
+   * Returns false, having read nothing, if iprot cannot encode a value on its
+   * own (see TProtocol::getValueProtocolFactory()).
+   */
+  bool read(TProtocol* iprot, TType type, uint32_t& xfer);
+
+  /**
+   * Writes the kept bytes to oprot if it encodes values as the protocol they
+   * were read with did.  Returns false, having written nothing, otherwise.
+   */
+  bool write(TProtocol* oprot, uint32_t& xfer) const;
+
+  // A protocol reading the kept bytes, which must not be empty, with the
+  // limits and configuration of the one they were read with
+  std::shared_ptr<TProtocol> getReader() const;
+
+  bool empty() const { return !factory_; }
+
+  void clear();
+
+private:
+  std::shared_ptr<const std::string> bytes_;
+  std::shared_ptr<TProtocolFactory> factory_;
+  std::shared_ptr<TConfiguration> config_;
+};
+
+/**
+ * A struct field that the C++ generator's lazy option makes of fields
+ * annotated cpp.lazy.  Its value is kept as the bytes it was read as until it
+ * is first used, and written back out as those same bytes if it was not
+ * changed in between, so a struct that only passes the field along never
+ * decodes it.
+ *
+ * get() decodes the value on first use, which changes the field even though
+ * it is const, so a struct with lazy fields must not be used from more than
+ * one thread at a time without locking, even to read it.
+ */
+template <typename T>
+class TLazyField {
+public:
+  typedef uint32_t (*Reader)(TProtocol* iprot, T& value);
+  typedef uint32_t (*Writer)(TProtocol* oprot, const T& value);
+
+  TLazyField() : value_(), reader_(nullptr) {}
+
+  TLazyField(const T& value) : value_(value), reader_(nullptr) {}
+
+  TLazyField& operator=(const T& value) {
+    value_ = value;
+    bytes_.clear();
+    return *this;
+  }
+
+  const T& get() const {
+    decode();
+    return value_;
+  }
+
+  // The value to change, which is then written out anew
+  T& mutate() {
+    decode();
+    return value_;
+  }
+
+  const T& operator*() const { return get(); }
+  const T* operator->() const { return &get(); }
+
+  // True while the value is still kept as the bytes it was read as
+  bool isPending() const { return !bytes_.empty(); }
+
+  /**
+   * Reads the next value, of type type, from iprot, keeping its bytes to be
+   * decoded with reader when first used.  If iprot cannot hand them over,
+   * decodes the value with reader now.
+   */
+  uint32_t read(TProtocol* iprot, TType type, Reader reader) {
+    uint32_t xfer = 0;
+    if (bytes_.read(iprot, type, xfer)) {
+      reader_ = reader;
+    } else {
+      bytes_.clear();
+      xfer += reader(iprot, value_);
+    }
+    return xfer;
+  }
+
+  /**
+   * Writes the value's bytes to oprot if it is still pending and oprot
+   * encodes values as the protocol it was read with did, or else writes the
+   * value with writer.
+   */
+  uint32_t write(TProtocol* oprot, Writer writer) const {
+    uint32_t xfer = 0;
+    if (!bytes_.write(oprot, xfer)) {
+      xfer += writer(oprot, get());
+    }
+    return xfer;
+  }
+
+  bool operator==(const TLazyField& rhs) const { return get() == rhs.get(); }
+
+  bool operator!=(const TLazyField& rhs) const { return !(*this == rhs); }
+
+private:
+  void decode() const {
+    if (!bytes_.empty()) {
+      T value;
+      reader_(bytes_.getReader().get(), value);
+      value_ = std::move(value);
+      bytes_.clear();
+    }
+  }
+
+  mutable T value_;
+  mutable TLazyBytes bytes_;
+  Reader reader_;
+};
+
+template <typename T>
+std::string to_string(const TLazyField<T>& field) {
+  using ::apache::thrift::to_string;
+  return to_string(field.get());
+}
+}
+}
+} // apache::thrift::protocol
+
+#endif // #define _THRIFT_PROTOCOL_TLAZYFIELD_H_
@@ -25,6 +25,7 @@
 #include <Winsock2.h>
 #endif
 
+#include <thrift/TStringView.h>
 #include <thrift/transport/TTransport.h>
 #include <thrift/protocol/TProtocolException.h>
 #include <thrift/protocol/TEnum.h>
@@ -174,6 +175,8 @@ namespace protocol {
 
 using apache::thrift::transport::TTransport;
 
+class TProtocolFactory;
+
 /**
  * Abstract class for a thrift protocol driver. These are all the methods that
  * a protocol must implement. Essentially, there must be some way of reading
@@ -243,6 +246,20 @@ public:
 
   virtual uint32_t writeBinary_virt(const std::string& str) = 0;
 
+  virtual uint32_t writeStringView_virt(const TStringView& str) = 0;
+
+  virtual uint32_t writeBinaryView_virt(const TStringView& str) = 0;
+
+  virtual uint32_t writeByteArray_virt(const int8_t* values, uint32_t count) = 0;
+
+  virtual uint32_t writeI16Array_virt(const int16_t* values, uint32_t count) = 0;
+
+  virtual uint32_t writeI32Array_virt(const int32_t* values, uint32_t count) = 0;
+
+  virtual uint32_t writeI64Array_virt(const int64_t* values, uint32_t count) = 0;
+
+  virtual uint32_t writeDoubleArray_virt(const double* values, uint32_t count) = 0;
+
   uint32_t writeMessageBegin(const std::string& name,
                              const TMessageType messageType,
                              const int32_t seqid) {
@@ -350,6 +367,57 @@ public:
     return writeBinary_virt(str);
   }
 
+  uint32_t writeStringView(const TStringView& str) {
+    T_VIRTUAL_CALL();
+    return writeStringView_virt(str);
+  }
+
+  uint32_t writeBinaryView(const TStringView& str) {
+    T_VIRTUAL_CALL();
+    return writeBinaryView_virt(str);
+  }
+
+  /**
+   * Writes count values exactly as that many calls to writeByte() would, for
+   * the elements of a list between writeListBegin() and writeListEnd().
+   */
+  uint32_t writeByteArray(const int8_t* values, uint32_t count) {
+    T_VIRTUAL_CALL();
+    return writeByteArray_virt(values, count);
+  }
+
+  /**
+   * Writes count values exactly as that many calls to writeI16() would.
+   */
+  uint32_t writeI16Array(const int16_t* values, uint32_t count) {
+    T_VIRTUAL_CALL();
+    return writeI16Array_virt(values, count);
+  }
+
+  /**
+   * Writes count values exactly as that many calls to writeI32() would.
+   */
+  uint32_t writeI32Array(const int32_t* values, uint32_t count) {
+    T_VIRTUAL_CALL();
+    return writeI32Array_virt(values, count);
+  }
+
+  /**
+   * Writes count values exactly as that many calls to writeI64() would.
+   */
+  uint32_t writeI64Array(const int64_t* values, uint32_t count) {
+    T_VIRTUAL_CALL();
+    return writeI64Array_virt(values, count);
+  }
+
+  /**
+   * Writes count values exactly as that many calls to writeDouble() would.
+   */
+  uint32_t writeDoubleArray(const double* values, uint32_t count) {
+    T_VIRTUAL_CALL();
+    return writeDoubleArray_virt(values, count);
+  }
+
   /**
    * Reading functions
    */
@@ -398,6 +466,20 @@ public:
 
   virtual uint32_t readBinary_virt(std::string& str) = 0;
 
+  virtual uint32_t readStringView_virt(TStringView& str) = 0;
+
+  virtual uint32_t readBinaryView_virt(TStringView& str) = 0;
+
+  virtual uint32_t readByteArray_virt(int8_t* values, uint32_t count) = 0;
+
+  virtual uint32_t readI16Array_virt(int16_t* values, uint32_t count) = 0;
+
+  virtual uint32_t readI32Array_virt(int32_t* values, uint32_t count) = 0;
+
+  virtual uint32_t readI64Array_virt(int64_t* values, uint32_t count) = 0;
+
+  virtual uint32_t readDoubleArray_virt(double* values, uint32_t count) = 0;
+
   uint32_t readMessageBegin(std::string& name, TMessageType& messageType, int32_t& seqid) {
     T_VIRTUAL_CALL();
     return readMessageBegin_virt(name, messageType, seqid);
@@ -498,6 +580,73 @@ public:
     return readBinary_virt(str);
   }
 
+  /**
+   * Reads a string without copying it: str is pointed at the bytes in the
+   * transport's read buffer.
+   *
+   * The view is valid until the transport starts reading its next message,
+   * is written to or is destroyed.  For TFramedTransport that means until
+   * the next frame is read; for TMemoryBuffer until it is written to or
+   * reset.  Copy the bytes out with TStringView::str() to keep them longer.
+   *
+   * @throws TProtocolException(NOT_IMPLEMENTED) if the protocol or the
+   *         transport cannot lend its buffer (see
+   *         TTransport::canLendReadBuffer())
+   */
+  uint32_t readStringView(TStringView& str) {
+    T_VIRTUAL_CALL();
+    return readStringView_virt(str);
+  }
+
+  /**
+   * Reads binary data without copying it.  See readStringView().
+   */
+  uint32_t readBinaryView(TStringView& str) {
+    T_VIRTUAL_CALL();
+    return readBinaryView_virt(str);
+  }
+
+  /**
+   * Reads count values into values exactly as that many calls to readByte()
+   * would, for the elements of a list after readListBegin().
+   */
+  uint32_t readByteArray(int8_t* values, uint32_t count) {
+    T_VIRTUAL_CALL();
+    return readByteArray_virt(values, count);
+  }
+
+  /**
+   * Reads count values exactly as that many calls to readI16() would.
+   */
+  uint32_t readI16Array(int16_t* values, uint32_t count) {
+    T_VIRTUAL_CALL();
+    return readI16Array_virt(values, count);
+  }
+
+  /**
+   * Reads count values exactly as that many calls to readI32() would.
+   */
+  uint32_t readI32Array(int32_t* values, uint32_t count) {
+    T_VIRTUAL_CALL();
+    return readI32Array_virt(values, count);
+  }
+
+  /**
+   * Reads count values exactly as that many calls to readI64() would.
+   */
+  uint32_t readI64Array(int64_t* values, uint32_t count) {
+    T_VIRTUAL_CALL();
+    return readI64Array_virt(values, count);
+  }
+
+  /**
+   * Reads count values exactly as that many calls to readDouble() would.
+   */
+  uint32_t readDoubleArray(double* values, uint32_t count) {
+    T_VIRTUAL_CALL();
+    return readDoubleArray_virt(values, count);
+  }
+
   /*
    * std::vector is specialized for bool, and its elements are individual bits
    * rather than bools.   We need to define a different version of readBool()
@@ -549,6 +698,17 @@ public:
     return 0;
   }
 
+  /**
+   * Returns a factory for protocols that encode values exactly as this one
+   * does, so that the bytes of one value can be decoded, or written out again
+   * as they are, apart from the message they came in (see TLazyField).  Those
+   * whose values depend on what surrounds them, as TJSONProtocol's do, return
+   * nullptr.
+   */
+  virtual std::shared_ptr<TProtocolFactory> getValueProtocolFactory() {
+    return std::shared_ptr<TProtocolFactory>();
+  }
+
 protected:
   TProtocol(std::shared_ptr<TTransport> ptrans)
     : ptrans_(ptrans), input_recursion_depth_(0), output_recursion_depth_(0), 
@@ -745,6 +905,56 @@ uint32_t skip(Protocol_& prot, TType type) {
                            "invalid TType");
 }
 
+/**
+ * Per-thread buffer that strings with a custom allocator are read through.
+ */
+inline std::string& stringReadScratch() {
+  static thread_local std::string scratch;
+  return scratch;
+}
+
+/**
+ * Helper templates for reading and writing strings whose allocator is not
+ * std::allocator, such as the TArenaString generated by cpp:arena.
+ *
+ * Reads go through stringReadScratch(), whose capacity is reused from one
+ * call to the next, so the only allocation made is the one by str's own
+ * allocator.  Writes hand the bytes to the protocol as a view.
+ */
+template <class Protocol_, class Alloc_>
+uint32_t readString(Protocol_& prot, std::basic_string<char, std::char_traits<char>, Alloc_>& str) {
+  std::string& scratch = stringReadScratch();
+  uint32_t result = prot.readString(scratch);
+  str.assign(scratch.data(), scratch.size());
+  if (scratch.capacity() > 64 * 1024) {
+    std::string().swap(scratch);
+  }
+  return result;
+}
+
+template <class Protocol_, class Alloc_>
+uint32_t readBinary(Protocol_& prot, std::basic_string<char, std::char_traits<char>, Alloc_>& str) {
+  std::string& scratch = stringReadScratch();
+  uint32_t result = prot.readBinary(scratch);
+  str.assign(scratch.data(), scratch.size());
+  if (scratch.capacity() > 64 * 1024) {
+    std::string().swap(scratch);
+  }
+  return result;
+}
+
+template <class Protocol_, class Alloc_>
+uint32_t writeString(Protocol_& prot,
+                     const std::basic_string<char, std::char_traits<char>, Alloc_>& str) {
+  return prot.writeStringView(TStringView(str.data(), str.size()));
+}
+
+template <class Protocol_, class Alloc_>
+uint32_t writeBinary(Protocol_& prot,
+                     const std::basic_string<char, std::char_traits<char>, Alloc_>& str) {
+  return prot.writeBinaryView(TStringView(str.data(), str.size()));
+}
+
 }}} // apache::thrift::protocol
 
 #endif // #define _THRIFT_PROTOCOL_TPROTOCOL_H_ 1
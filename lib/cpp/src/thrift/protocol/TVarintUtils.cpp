@@ -0,0 +1,393 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <thrift/protocol/TVarintUtils.h>
+
+#include <cstddef>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define THRIFT_VARINT_SSE2 1
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include <thrift/protocol/TProtocol.h>
+
+namespace apache {
+namespace thrift {
+namespace protocol {
+
+/**
+ * Most lists of integers are mostly small values, which take one byte each.
+ * Both directions look for runs of those a block at a time (with SSE2 where
+ * it is available, in a 64 bit word elsewhere) and copy a whole block across
+ * at once, handling anything longer one value at a time.
+ */
+namespace {
+
+const uint64_t kEveryByte = 0x0101010101010101ULL;
+const uint64_t kEveryHighBit = 0x8080808080808080ULL;
+
+uint32_t toZigzag(int16_t n) {
+  return (static_cast<uint32_t>(n) << 1) ^ static_cast<uint32_t>(n >> 15);
+}
+
+uint32_t toZigzag(int32_t n) {
+  return (static_cast<uint32_t>(n) << 1) ^ static_cast<uint32_t>(n >> 31);
+}
+
+uint64_t toZigzag(int64_t n) {
+  return (static_cast<uint64_t>(n) << 1) ^ static_cast<uint64_t>(n >> 63);
+}
+
+// The 32 bit values are truncated as TCompactProtocol::readVarint32() does.
+void fromZigzag(uint64_t n, int16_t& value) {
+  uint32_t n32 = static_cast<uint32_t>(n);
+  value = static_cast<int16_t>((n32 >> 1) ^ (0U - (n32 & 1)));
+}
+
+void fromZigzag(uint64_t n, int32_t& value) {
+  uint32_t n32 = static_cast<uint32_t>(n);
+  value = static_cast<int32_t>((n32 >> 1) ^ (0U - (n32 & 1)));
+}
+
+void fromZigzag(uint64_t n, int64_t& value) {
+  value = static_cast<int64_t>((n >> 1) ^ (0ULL - (n & 1)));
+}
+
+// The index of the lowest set bit of x, which must not be 0
+inline uint32_t lowestSetBit(uint64_t x) {
+#if defined(__GNUC__)
+  return static_cast<uint32_t>(__builtin_ctzll(x));
+#elif defined(_MSC_VER) && defined(_WIN64)
+  unsigned long index;
+  _BitScanForward64(&index, x);
+  return static_cast<uint32_t>(index);
+#else
+  uint32_t index = 0;
+  while (!(x & 1)) {
+    x >>= 1;
+    ++index;
+  }
+  return index;
+#endif
+}
+
+// Gathers the low 7 bits of each byte of x into its low 56 bits.
+inline uint64_t packGroups(uint64_t x) {
+  x &= ~kEveryHighBit;
+  x = ((x & 0x7f007f007f007f00ULL) >> 1) | (x & 0x007f007f007f007fULL);
+  x = ((x & 0x3fff00003fff0000ULL) >> 2) | (x & 0x00003fff00003fffULL);
+  return ((x & 0x0fffffff00000000ULL) >> 4) | (x & 0x000000000fffffffULL);
+}
+
+// Spreads the low 56 bits of x over the low 7 bits of each byte.
+inline uint64_t spreadGroups(uint64_t x) {
+  x = ((x & 0x00fffffff0000000ULL) << 4) | (x & 0x000000000fffffffULL);
+  x = ((x & 0x0fffc0000fffc000ULL) << 2) | (x & 0x00003fff00003fffULL);
+  return ((x & 0x3f803f803f803f80ULL) << 1) | (x & 0x007f007f007f007fULL);
+}
+
+// Writes n as a varint at out and returns its length.
+uint32_t putVarint(uint64_t n, uint8_t* out) {
+  uint32_t wsize = 0;
+  while (n >= 0x80) {
+    out[wsize++] = static_cast<uint8_t>(n | 0x80);
+    n >>= 7;
+  }
+  out[wsize++] = static_cast<uint8_t>(n);
+  return wsize;
+}
+
+// Like putVarint(), but stores a whole 64 bit word at out, so out must have 8
+// bytes of room.  Those of up to 8 bytes, which is every i16 and i32, are
+// encoded without a branch on their length.
+inline uint32_t putVarintWord(uint64_t n, uint8_t* out) {
+  if (n >> 56) {
+    return putVarint(n, out);
+  }
+  uint64_t x = spreadGroups(n);
+  // the high bit of every nonzero byte, then of every byte up to the last of
+  // them (and always the first)
+  uint64_t used = ((x | kEveryHighBit) - kEveryByte) & kEveryHighBit;
+  used |= 0x80;
+  used |= used >> 8;
+  used |= used >> 16;
+  used |= used >> 32;
+  // every byte before the last carries the continuation bit
+  x |= used >> 8;
+  x = THRIFT_htolell(x);
+  std::memcpy(out, &x, sizeof(x));
+  return static_cast<uint32_t>((((used >> 7) & kEveryByte) * kEveryByte) >> 56);
+}
+
+// Finishes reading a varint of over 8 bytes, the first 8 of which are word.
+uint32_t getLongVarint(const uint8_t* pos, uint64_t word, uint64_t& n) {
+  uint64_t val = packGroups(word);
+  for (uint32_t i = 8; i < kMaxVarint64Bytes; ++i) {
+    uint64_t byte = pos[i];
+    val |= (byte & 0x7f) << (7 * i);
+    if (byte < 0x80) {
+      n = val;
+      return i + 1;
+    }
+  }
+  throw TProtocolException(TProtocolException::INVALID_DATA, "Variable-length int over 10 bytes.");
+}
+
+// Reads the varint at pos, which must have the longest one after it, and
+// returns its length.  Those of up to 8 bytes are decoded from one 64 bit
+// word without a branch on their length.
+inline uint32_t getVarint(const uint8_t* pos, uint64_t& n) {
+  uint64_t word;
+  std::memcpy(&word, pos, sizeof(word));
+  word = THRIFT_letohll(word);
+  uint64_t stops = ~word & kEveryHighBit;
+  if (stops == 0) {
+    return getLongVarint(pos, word, n);
+  }
+  // the high bit of the last byte is bit 8 * length - 1
+  uint32_t bits = lowestSetBit(stops) + 1;
+  n = packGroups(bits == 64 ? word : word & ((1ULL << bits) - 1));
+  return bits >> 3;
+}
+
+// Reads the varint at pos and returns its length, or 0 if it does not end
+// before end.
+uint32_t getVarint(const uint8_t* pos, const uint8_t* end, uint64_t& n) {
+  uint32_t avail = static_cast<uint32_t>(end - pos);
+  if (avail > kMaxVarint64Bytes) {
+    avail = kMaxVarint64Bytes;
+  }
+  uint64_t val = 0;
+  for (uint32_t i = 0; i < avail; ++i) {
+    uint8_t byte = pos[i];
+    val |= static_cast<uint64_t>(byte & 0x7f) << (7 * i);
+    if (!(byte & 0x80)) {
+      n = val;
+      return i + 1;
+    }
+  }
+  if (avail == kMaxVarint64Bytes) {
+    throw TProtocolException(TProtocolException::INVALID_DATA,
+                             "Variable-length int over 10 bytes.");
+  }
+  return 0;
+}
+
+// The values before this index can be stored with putVarintWord(), leaving
+// at least two after them for its extra bytes to fall within count * 5.
+uint32_t wordLimit(uint32_t count) {
+  return count > 2 ? count - 2 : 0;
+}
+
+// Encodes values[i, count) a block of 8 at a time.
+template <typename T>
+uint8_t* encodeBlocks(const T* values, uint32_t i, uint32_t count, uint8_t* pos) {
+  const uint32_t limit = wordLimit(count);
+  for (; i + 8 <= limit; i += 8) {
+    uint64_t any = 0;
+    for (uint32_t j = 0; j < 8; ++j) {
+      any |= toZigzag(values[i + j]);
+    }
+    if (any < 0x80) {
+      for (uint32_t j = 0; j < 8; ++j) {
+        pos[j] = static_cast<uint8_t>(toZigzag(values[i + j]));
+      }
+      pos += 8;
+    } else {
+      for (uint32_t j = 0; j < 8; ++j) {
+        pos += putVarintWord(toZigzag(values[i + j]), pos);
+      }
+    }
+  }
+  for (; i < limit; ++i) {
+    pos += putVarintWord(toZigzag(values[i]), pos);
+  }
+  for (; i < count; ++i) {
+    pos += putVarint(toZigzag(values[i]), pos);
+  }
+  return pos;
+}
+
+#ifdef THRIFT_VARINT_SSE2
+// Stores the 16 one byte varints in chunk as values.
+void storeOneByteValues(__m128i chunk, int16_t* values) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi16(1);
+  __m128i lo = _mm_unpacklo_epi8(chunk, zero);
+  __m128i hi = _mm_unpackhi_epi8(chunk, zero);
+  lo = _mm_xor_si128(_mm_srli_epi16(lo, 1), _mm_sub_epi16(zero, _mm_and_si128(lo, one)));
+  hi = _mm_xor_si128(_mm_srli_epi16(hi, 1), _mm_sub_epi16(zero, _mm_and_si128(hi, one)));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(values), lo);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(values + 8), hi);
+}
+
+void storeOneByteValues(__m128i chunk, int32_t* values) {
+  int16_t narrow[16];
+  storeOneByteValues(chunk, narrow);
+  for (int i = 0; i < 16; i += 8) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(narrow + i));
+    // sign extend each half to 32 bits
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(values + i),
+                     _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(values + i + 4),
+                     _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+  }
+}
+
+void storeOneByteValues(__m128i chunk, int64_t* values) {
+  int32_t narrow[16];
+  storeOneByteValues(chunk, narrow);
+  for (int i = 0; i < 16; i += 4) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(narrow + i));
+    __m128i sign = _mm_srai_epi32(v, 31);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(values + i), _mm_unpacklo_epi32(v, sign));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(values + i + 2), _mm_unpackhi_epi32(v, sign));
+  }
+}
+#endif
+
+template <typename T>
+uint32_t decode(const uint8_t* in, uint32_t len, T* values, uint32_t& count) {
+  const uint8_t* pos = in;
+  const uint8_t* const end = in + len;
+  uint32_t i = 0;
+  while (i < count) {
+#ifdef THRIFT_VARINT_SSE2
+    while (count - i >= 16 && end - pos >= 16) {
+      __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+      if (_mm_movemask_epi8(chunk) != 0) {
+        break;
+      }
+      storeOneByteValues(chunk, values + i);
+      i += 16;
+      pos += 16;
+    }
+#else
+    while (count - i >= 8 && end - pos >= 8) {
+      uint64_t word;
+      std::memcpy(&word, pos, sizeof(word));
+      if (word & kEveryHighBit) {
+        break;
+      }
+      for (uint32_t j = 0; j < 8; ++j) {
+        fromZigzag(pos[j], values[i + j]);
+      }
+      i += 8;
+      pos += 8;
+    }
+#endif
+
+    // Then up to a block's worth one at a time before looking for another
+    // run, so that values of mixed lengths cost one failed check per block.
+    uint32_t stop = count - i > 16 ? i + 16 : count;
+    while (i < stop && end - pos >= static_cast<ptrdiff_t>(kMaxVarint64Bytes)) {
+      uint64_t n;
+      pos += getVarint(pos, n);
+      fromZigzag(n, values[i++]);
+    }
+    if (i < stop) {
+      uint64_t n = 0;
+      uint32_t size = getVarint(pos, end, n);
+      if (size == 0) {
+        break;
+      }
+      fromZigzag(n, values[i++]);
+      pos += size;
+    }
+  }
+  count = i;
+  return static_cast<uint32_t>(pos - in);
+}
+}
+
+uint32_t zigzag_varint_encode(const int16_t* values, uint32_t count, uint8_t* out) {
+  uint8_t* pos = out;
+  uint32_t i = 0;
+#ifdef THRIFT_VARINT_SSE2
+  // The zigzag of an i16 fits in 16 bits, so a lane at a time works.
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i high = _mm_set1_epi16(static_cast<int16_t>(0xFF80));
+  for (; i + 16 <= wordLimit(count); i += 16) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i + 8));
+    a = _mm_xor_si128(_mm_slli_epi16(a, 1), _mm_srai_epi16(a, 15));
+    b = _mm_xor_si128(_mm_slli_epi16(b, 1), _mm_srai_epi16(b, 15));
+    __m128i big = _mm_and_si128(_mm_or_si128(a, b), high);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi16(big, zero)) == 0xFFFF) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(pos), _mm_packus_epi16(a, b));
+      pos += 16;
+    } else {
+      for (uint32_t j = 0; j < 16; ++j) {
+        pos += putVarintWord(toZigzag(values[i + j]), pos);
+      }
+    }
+  }
+#endif
+  return static_cast<uint32_t>(encodeBlocks(values, i, count, pos) - out);
+}
+
+uint32_t zigzag_varint_encode(const int32_t* values, uint32_t count, uint8_t* out) {
+  uint8_t* pos = out;
+  uint32_t i = 0;
+#ifdef THRIFT_VARINT_SSE2
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i high = _mm_set1_epi32(~0x7F);
+  for (; i + 8 <= wordLimit(count); i += 8) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i + 4));
+    a = _mm_xor_si128(_mm_slli_epi32(a, 1), _mm_srai_epi32(a, 31));
+    b = _mm_xor_si128(_mm_slli_epi32(b, 1), _mm_srai_epi32(b, 31));
+    __m128i big = _mm_and_si128(_mm_or_si128(a, b), high);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(big, zero)) == 0xFFFF) {
+      __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(a, b), zero);
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(pos), bytes);
+      pos += 8;
+    } else {
+      for (uint32_t j = 0; j < 8; ++j) {
+        pos += putVarintWord(toZigzag(values[i + j]), pos);
+      }
+    }
+  }
+#endif
+  return static_cast<uint32_t>(encodeBlocks(values, i, count, pos) - out);
+}
+
+uint32_t zigzag_varint_encode(const int64_t* values, uint32_t count, uint8_t* out) {
+  return static_cast<uint32_t>(encodeBlocks(values, 0, count, out) - out);
+}
+
+uint32_t zigzag_varint_decode(const uint8_t* in, uint32_t len, int16_t* values, uint32_t& count) {
+  return decode(in, len, values, count);
+}
+
+uint32_t zigzag_varint_decode(const uint8_t* in, uint32_t len, int32_t* values, uint32_t& count) {
+  return decode(in, len, values, count);
+}
+
+uint32_t zigzag_varint_decode(const uint8_t* in, uint32_t len, int64_t* values, uint32_t& count) {
+  return decode(in, len, values, count);
+}
+}
+}
+} // apache::thrift::protocol
@@ -0,0 +1,55 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _THRIFT_PROTOCOL_TVARINTUTILS_H_
+#define _THRIFT_PROTOCOL_TVARINTUTILS_H_
+
+#include <stdint.h>
+
+namespace apache {
+namespace thrift {
+namespace protocol {
+
+// Runs of zigzag varints, as TCompactProtocol writes i16, i32 and i64 values.
+
+// the most bytes one value can take
+const uint32_t kMaxVarint32Bytes = 5;
+const uint32_t kMaxVarint64Bytes = 10;
+
+// out must have room for count * kMaxVarint32Bytes (kMaxVarint64Bytes for
+// int64_t) bytes
+// returns the number of bytes written
+uint32_t zigzag_varint_encode(const int16_t* values, uint32_t count, uint8_t* out);
+uint32_t zigzag_varint_encode(const int32_t* values, uint32_t count, uint8_t* out);
+uint32_t zigzag_varint_encode(const int64_t* values, uint32_t count, uint8_t* out);
+
+// reads up to count values from the len bytes at in, stopping early at a
+// value that does not end within them; values are truncated to their type
+// as TCompactProtocol::readI16() and readI32() do
+// count is set to the number of values read
+// returns the number of bytes they took
+// throws TProtocolException(INVALID_DATA) on a varint over 10 bytes
+uint32_t zigzag_varint_decode(const uint8_t* in, uint32_t len, int16_t* values, uint32_t& count);
+uint32_t zigzag_varint_decode(const uint8_t* in, uint32_t len, int32_t* values, uint32_t& count);
+uint32_t zigzag_varint_decode(const uint8_t* in, uint32_t len, int64_t* values, uint32_t& count);
+}
+}
+} // apache::thrift::protocol
+
+#endif // #define _THRIFT_PROTOCOL_TVARINTUTILS_H_
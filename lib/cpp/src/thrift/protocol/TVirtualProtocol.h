@@ -169,6 +169,18 @@ public:
                              "this protocol does not support reading (yet).");
   }
 
+  uint32_t readStringView(TStringView& str) {
+    (void)str;
+    throw TProtocolException(TProtocolException::NOT_IMPLEMENTED,
+                             "this protocol does not support borrowed string reads.");
+  }
+
+  uint32_t readBinaryView(TStringView& str) {
+    (void)str;
+    throw TProtocolException(TProtocolException::NOT_IMPLEMENTED,
+                             "this protocol does not support borrowed string reads.");
+  }
+
   uint32_t writeMessageBegin(const std::string& name,
                              const TMessageType messageType,
                              const int32_t seqid) {
@@ -298,6 +310,11 @@ public:
                              "this protocol does not support writing (yet).");
   }
 
+  // Protocols that cannot write a view directly write a copy of it.
+  uint32_t writeStringView(const TStringView& str) { return writeString_virt(str.str()); }
+
+  uint32_t writeBinaryView(const TStringView& str) { return writeBinary_virt(str.str()); }
+
   uint32_t skip(TType type) { return ::apache::thrift::protocol::skip(*this, type); }
 
 protected:
@@ -393,6 +410,34 @@ public:
     return static_cast<Protocol_*>(this)->writeBinary(str);
   }
 
+  uint32_t writeStringView_virt(const TStringView& str) override {
+    return static_cast<Protocol_*>(this)->writeStringView(str);
+  }
+
+  uint32_t writeBinaryView_virt(const TStringView& str) override {
+    return static_cast<Protocol_*>(this)->writeBinaryView(str);
+  }
+
+  uint32_t writeByteArray_virt(const int8_t* values, uint32_t count) override {
+    return static_cast<Protocol_*>(this)->writeByteArray(values, count);
+  }
+
+  uint32_t writeI16Array_virt(const int16_t* values, uint32_t count) override {
+    return static_cast<Protocol_*>(this)->writeI16Array(values, count);
+  }
+
+  uint32_t writeI32Array_virt(const int32_t* values, uint32_t count) override {
+    return static_cast<Protocol_*>(this)->writeI32Array(values, count);
+  }
+
+  uint32_t writeI64Array_virt(const int64_t* values, uint32_t count) override {
+    return static_cast<Protocol_*>(this)->writeI64Array(values, count);
+  }
+
+  uint32_t writeDoubleArray_virt(const double* values, uint32_t count) override {
+    return static_cast<Protocol_*>(this)->writeDoubleArray(values, count);
+  }
+
   /**
    * Reading functions
    */
@@ -471,6 +516,34 @@ public:
     return static_cast<Protocol_*>(this)->readBinary(str);
   }
 
+  uint32_t readStringView_virt(TStringView& str) override {
+    return static_cast<Protocol_*>(this)->readStringView(str);
+  }
+
+  uint32_t readBinaryView_virt(TStringView& str) override {
+    return static_cast<Protocol_*>(this)->readBinaryView(str);
+  }
+
+  uint32_t readByteArray_virt(int8_t* values, uint32_t count) override {
+    return static_cast<Protocol_*>(this)->readByteArray(values, count);
+  }
+
+  uint32_t readI16Array_virt(int16_t* values, uint32_t count) override {
+    return static_cast<Protocol_*>(this)->readI16Array(values, count);
+  }
+
+  uint32_t readI32Array_virt(int32_t* values, uint32_t count) override {
+    return static_cast<Protocol_*>(this)->readI32Array(values, count);
+  }
+
+  uint32_t readI64Array_virt(int64_t* values, uint32_t count) override {
+    return static_cast<Protocol_*>(this)->readI64Array(values, count);
+  }
+
+  uint32_t readDoubleArray_virt(double* values, uint32_t count) override {
+    return static_cast<Protocol_*>(this)->readDoubleArray(values, count);
+  }
+
   uint32_t skip_virt(TType type) override { return static_cast<Protocol_*>(this)->skip(type); }
 
   /*
@@ -503,6 +576,101 @@ public:
   }
   using Super_::readBool; // so we don't hide readBool(bool&)
 
+  /*
+   * Provide default array implementations that read or write one value at a
+   * time with the non-virtual methods.  Protocols with a faster way to handle
+   * a run of values can define their own.
+   */
+  uint32_t writeByteArray(const int8_t* values, uint32_t count) {
+    auto* const prot = static_cast<Protocol_*>(this);
+    uint32_t wsize = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+      wsize += prot->writeByte(values[i]);
+    }
+    return wsize;
+  }
+
+  uint32_t writeI16Array(const int16_t* values, uint32_t count) {
+    auto* const prot = static_cast<Protocol_*>(this);
+    uint32_t wsize = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+      wsize += prot->writeI16(values[i]);
+    }
+    return wsize;
+  }
+
+  uint32_t writeI32Array(const int32_t* values, uint32_t count) {
+    auto* const prot = static_cast<Protocol_*>(this);
+    uint32_t wsize = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+      wsize += prot->writeI32(values[i]);
+    }
+    return wsize;
+  }
+
+  uint32_t writeI64Array(const int64_t* values, uint32_t count) {
+    auto* const prot = static_cast<Protocol_*>(this);
+    uint32_t wsize = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+      wsize += prot->writeI64(values[i]);
+    }
+    return wsize;
+  }
+
+  uint32_t writeDoubleArray(const double* values, uint32_t count) {
+    auto* const prot = static_cast<Protocol_*>(this);
+    uint32_t wsize = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+      wsize += prot->writeDouble(values[i]);
+    }
+    return wsize;
+  }
+
+  uint32_t readByteArray(int8_t* values, uint32_t count) {
+    auto* const prot = static_cast<Protocol_*>(this);
+    uint32_t rsize = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+      rsize += prot->readByte(values[i]);
+    }
+    return rsize;
+  }
+
+  uint32_t readI16Array(int16_t* values, uint32_t count) {
+    auto* const prot = static_cast<Protocol_*>(this);
+    uint32_t rsize = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+      rsize += prot->readI16(values[i]);
+    }
+    return rsize;
+  }
+
+  uint32_t readI32Array(int32_t* values, uint32_t count) {
+    auto* const prot = static_cast<Protocol_*>(this);
+    uint32_t rsize = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+      rsize += prot->readI32(values[i]);
+    }
+    return rsize;
+  }
+
+  uint32_t readI64Array(int64_t* values, uint32_t count) {
+    auto* const prot = static_cast<Protocol_*>(this);
+    uint32_t rsize = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+      rsize += prot->readI64(values[i]);
+    }
+    return rsize;
+  }
+
+  uint32_t readDoubleArray(double* values, uint32_t count) {
+    auto* const prot = static_cast<Protocol_*>(this);
+    uint32_t rsize = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+      rsize += prot->readDouble(values[i]);
+    }
+    return rsize;
+  }
+
 protected:
   TVirtualProtocol(std::shared_ptr<TTransport> ptrans) : Super_(ptrans) {}
 };
@@ -0,0 +1,155 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <thrift/server/TBufferPool.h>
+
+#include <cstdlib>
+#include <new>
+
+namespace apache {
+namespace thrift {
+namespace server {
+
+using apache::thrift::concurrency::Guard;
+
+TBufferPoolStats& TBufferPoolStats::operator+=(const TBufferPoolStats& other) {
+  pooledBytes += other.pooledBytes;
+  borrowed += other.borrowed;
+  oversized += other.oversized;
+  discarded += other.discarded;
+  for (const auto& theirs : other.classes) {
+    auto ours = classes.begin();
+    while (ours != classes.end() && ours->bufferSize < theirs.bufferSize) {
+      ++ours;
+    }
+    if (ours != classes.end() && ours->bufferSize == theirs.bufferSize) {
+      ours->pooled += theirs.pooled;
+      ours->hits += theirs.hits;
+      ours->misses += theirs.misses;
+    } else {
+      classes.insert(ours, theirs);
+    }
+  }
+  return *this;
+}
+
+TBufferPool::TBufferPool(size_t maxPooledBytes, uint32_t minBufferSize, uint32_t maxBufferSize)
+  : maxPooledBytes_(maxPooledBytes), minBufferSize_(1) {
+  while (minBufferSize_ < minBufferSize) {
+    minBufferSize_ <<= 1;
+  }
+  for (uint64_t size = minBufferSize_; size <= maxBufferSize; size <<= 1) {
+    SizeClass sizeClass;
+    sizeClass.stats.bufferSize = static_cast<uint32_t>(size);
+    sizeClass.stats.pooled = 0;
+    sizeClass.stats.hits = 0;
+    sizeClass.stats.misses = 0;
+    classes_.push_back(sizeClass);
+  }
+}
+
+TBufferPool::~TBufferPool() {
+  for (auto& sizeClass : classes_) {
+    for (auto buf : sizeClass.free) {
+      std::free(buf);
+    }
+  }
+}
+
+size_t TBufferPool::classFor(uint32_t size) const {
+  size_t index = 0;
+  while (index < classes_.size() && classes_[index].stats.bufferSize < size) {
+    ++index;
+  }
+  return index;
+}
+
+uint8_t* TBufferPool::take(uint32_t size, uint32_t* capacity) {
+  size_t index = classFor(size);
+  uint32_t allocSize = size;
+  {
+    Guard g(mutex_);
+    ++totals_.borrowed;
+    if (index == classes_.size()) {
+      ++totals_.oversized;
+    } else {
+      SizeClass& sizeClass = classes_[index];
+      allocSize = sizeClass.stats.bufferSize;
+      if (!sizeClass.free.empty()) {
+        uint8_t* buf = sizeClass.free.back();
+        sizeClass.free.pop_back();
+        --sizeClass.stats.pooled;
+        ++sizeClass.stats.hits;
+        totals_.pooledBytes -= allocSize;
+        *capacity = allocSize;
+        return buf;
+      }
+      ++sizeClass.stats.misses;
+    }
+  }
+
+  auto* buf = static_cast<uint8_t*>(std::malloc(allocSize));
+  if (buf == nullptr) {
+    Guard g(mutex_);
+    --totals_.borrowed;
+    throw std::bad_alloc();
+  }
+  *capacity = allocSize;
+  return buf;
+}
+
+void TBufferPool::giveBack(uint8_t* buf, uint32_t capacity) {
+  if (buf == nullptr) {
+    return;
+  }
+
+  // File the buffer under the largest class it can stand in for; buffers
+  // outside the range of classes are not kept.
+  size_t index = classFor(capacity);
+  if (index < classes_.size() && classes_[index].stats.bufferSize != capacity) {
+    index = index > 0 ? index - 1 : classes_.size();
+  }
+
+  {
+    Guard g(mutex_);
+    --totals_.borrowed;
+    if (index < classes_.size()
+        && totals_.pooledBytes + classes_[index].stats.bufferSize <= maxPooledBytes_) {
+      SizeClass& sizeClass = classes_[index];
+      sizeClass.free.push_back(buf);
+      ++sizeClass.stats.pooled;
+      totals_.pooledBytes += sizeClass.stats.bufferSize;
+      return;
+    }
+    ++totals_.discarded;
+  }
+  std::free(buf);
+}
+
+TBufferPoolStats TBufferPool::getStats() const {
+  Guard g(mutex_);
+  TBufferPoolStats stats = totals_;
+  for (const auto& sizeClass : classes_) {
+    stats.classes.push_back(sizeClass.stats);
+  }
+  return stats;
+}
+}
+}
+} // apache::thrift::server
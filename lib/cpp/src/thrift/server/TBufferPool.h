@@ -0,0 +1,144 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _THRIFT_SERVER_TBUFFERPOOL_H_
+#define _THRIFT_SERVER_TBUFFERPOOL_H_ 1
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <thrift/TNonCopyable.h>
+#include <thrift/concurrency/Mutex.h>
+
+namespace apache {
+namespace thrift {
+namespace server {
+
+/**
+ * Occupancy of one size class of a TBufferPool.
+ */
+struct TBufferPoolClassStats {
+  /// Capacity of the buffers in this class
+  uint32_t bufferSize;
+
+  /// Buffers parked in the pool, ready to be handed out
+  size_t pooled;
+
+  /// Requests served from a parked buffer
+  uint64_t hits;
+
+  /// Requests that had to allocate a new buffer
+  uint64_t misses;
+};
+
+/**
+ * Occupancy of a TBufferPool, or the sum over several of them.
+ */
+struct TBufferPoolStats {
+  TBufferPoolStats() : pooledBytes(0), borrowed(0), oversized(0), discarded(0) {}
+
+  /// Bytes held in parked buffers
+  size_t pooledBytes;
+
+  /// Buffers handed out and not yet given back, including oversized ones
+  size_t borrowed;
+
+  /// Requests larger than the largest class, served straight from the heap
+  uint64_t oversized;
+
+  /// Buffers freed on return because the pool was full
+  uint64_t discarded;
+
+  /// One entry per size class, smallest first
+  std::vector<TBufferPoolClassStats> classes;
+
+  /// Adds another pool's figures to these.
+  TBufferPoolStats& operator+=(const TBufferPoolStats& other);
+};
+
+/**
+ * A pool of heap buffers in power-of-two size classes.
+ *
+ * take() hands out a buffer at least as big as requested, preferring one
+ * parked in the pool; giveBack() parks it again unless the pool already
+ * holds getMaxPooledBytes().  Buffers come from std::malloc(), so a borrower
+ * may std::realloc() one (TMemoryBuffer does when it grows) and give back
+ * the result, and anything the pool does not keep is released with
+ * std::free().
+ *
+ * TNonblockingServer keeps one pool per IO thread so that connections only
+ * hold buffers while a request is in flight.  The pool is locked internally
+ * since connections are occasionally closed from worker threads, but in the
+ * common case only its own IO thread touches it.
+ */
+class TBufferPool : apache::thrift::TNonCopyable {
+public:
+  static const uint32_t DEFAULT_MIN_BUFFER_SIZE = 512;
+  static const uint32_t DEFAULT_MAX_BUFFER_SIZE = 1024 * 1024;
+
+  /**
+   * @param maxPooledBytes upper bound on the bytes parked in the pool
+   * @param minBufferSize capacity of the smallest class, rounded up to a
+   *                      power of two
+   * @param maxBufferSize capacity of the largest class; bigger requests
+   *                      bypass the pool
+   */
+  explicit TBufferPool(size_t maxPooledBytes,
+                       uint32_t minBufferSize = DEFAULT_MIN_BUFFER_SIZE,
+                       uint32_t maxBufferSize = DEFAULT_MAX_BUFFER_SIZE);
+
+  ~TBufferPool();
+
+  /**
+   * Returns a buffer of at least size bytes and stores its real capacity
+   * in *capacity.  Throws std::bad_alloc if the heap is exhausted.
+   */
+  uint8_t* take(uint32_t size, uint32_t* capacity);
+
+  /**
+   * Returns a buffer obtained from take() (or reallocated from one) with
+   * its current capacity.  Null buffers are ignored.
+   */
+  void giveBack(uint8_t* buf, uint32_t capacity);
+
+  size_t getMaxPooledBytes() const { return maxPooledBytes_; }
+
+  TBufferPoolStats getStats() const;
+
+private:
+  struct SizeClass {
+    std::vector<uint8_t*> free;
+    TBufferPoolClassStats stats;
+  };
+
+  /// Index of the smallest class that can hold size bytes.
+  size_t classFor(uint32_t size) const;
+
+  const size_t maxPooledBytes_;
+  uint32_t minBufferSize_;
+  std::vector<SizeClass> classes_;
+  TBufferPoolStats totals_;
+  mutable apache::thrift::concurrency::Mutex mutex_;
+};
+}
+}
+} // apache::thrift::server
+
+#endif // #ifndef _THRIFT_SERVER_TBUFFERPOOL_H_
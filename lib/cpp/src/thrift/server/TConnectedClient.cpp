@@ -23,6 +23,8 @@ namespace apache {
 namespace thrift {
 namespace server {
 
+using apache::thrift::TArena;
+using apache::thrift::TArenaScope;
 using apache::thrift::TProcessor;
 using apache::thrift::protocol::TProtocol;
 using apache::thrift::server::TServerEventHandler;
@@ -35,13 +37,15 @@ TConnectedClient::TConnectedClient(const shared_ptr<TProcessor>& processor,
                                    const shared_ptr<TProtocol>& inputProtocol,
                                    const shared_ptr<TProtocol>& outputProtocol,
                                    const shared_ptr<TServerEventHandler>& eventHandler,
-                                   const shared_ptr<TTransport>& client)
+                                   const shared_ptr<TTransport>& client,
+                                   size_t arenaBlockSize)
 
   : processor_(processor),
     inputProtocol_(inputProtocol),
     outputProtocol_(outputProtocol),
     eventHandler_(eventHandler),
     client_(client),
+    arena_(arenaBlockSize > 0 ? new TArena(arenaBlockSize) : nullptr),
     opaqueContext_(nullptr) {
 }
 
@@ -58,6 +62,11 @@ void TConnectedClient::run() {
     }
 
     try {
+      // Everything the previous request allocated in the arena is gone by now.
+      if (arena_) {
+        arena_->reset();
+      }
+      TArenaScope arenaScope(arena_.get());
       if (!processor_->process(inputProtocol_, outputProtocol_, opaqueContext_)) {
         break;
       }
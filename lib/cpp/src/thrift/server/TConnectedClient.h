@@ -21,6 +21,7 @@
 #define _THRIFT_SERVER_TCONNECTEDCLIENT_H_ 1
 
 #include <memory>
+#include <thrift/TArena.h>
 #include <thrift/TProcessor.h>
 #include <thrift/protocol/TProtocol.h>
 #include <thrift/server/TServer.h>
@@ -53,7 +54,8 @@ public:
       const std::shared_ptr<apache::thrift::protocol::TProtocol>& inputProtocol,
       const std::shared_ptr<apache::thrift::protocol::TProtocol>& outputProtocol,
       const std::shared_ptr<apache::thrift::server::TServerEventHandler>& eventHandler,
-      const std::shared_ptr<apache::thrift::transport::TTransport>& client);
+      const std::shared_ptr<apache::thrift::transport::TTransport>& client,
+      size_t arenaBlockSize = 0);
 
   /**
    * Destructor.
@@ -66,7 +68,9 @@ public:
    *
    * [optional] call eventHandler->createContext once
    * [optional] call eventHandler->processContext per request
-   *            call processor->process per request
+   * [optional] reset the request arena per request
+   *            call processor->process per request, with the request
+   *              arena current if there is one
    *              handle expected transport exceptions:
    *                END_OF_FILE means the client is gone
    *                INTERRUPTED means the client was interrupted
@@ -98,6 +102,11 @@ private:
   std::shared_ptr<apache::thrift::server::TServerEventHandler> eventHandler_;
   std::shared_ptr<apache::thrift::transport::TTransport> client_;
 
+  /**
+   * Arena for the objects of the request being processed, if enabled.
+   */
+  std::unique_ptr<apache::thrift::TArena> arena_;
+
   /**
    * Context acquired from the eventHandler_ if one exists.
    */
@@ -0,0 +1,260 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <thrift/thrift-config.h>
+
+#include <thrift/server/TEventLoop.h>
+#include <thrift/Thrift.h>
+#include <thrift/TOutput.h>
+
+#include <cerrno>
+
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+namespace apache {
+namespace thrift {
+namespace server {
+
+const short TEventLoop::READ;
+const short TEventLoop::WRITE;
+
+namespace {
+
+/**
+ * The loop TNonblockingServer has always used: libevent, on an event_base
+ * of its own or on one provided by the user.
+ */
+class TLibeventLoop : public TEventLoop {
+public:
+  explicit TLibeventLoop(event_base* userEventBase)
+    : eventBase_(userEventBase), ownEventBase_(userEventBase == nullptr) {
+    if (ownEventBase_) {
+      eventBase_ = event_base_new();
+      if (eventBase_ == nullptr) {
+        throw TException("TLibeventLoop: event_base_new() failed");
+      }
+    }
+  }
+
+  ~TLibeventLoop() override {
+    if (ownEventBase_) {
+      event_base_free(eventBase_);
+    }
+  }
+
+  bool update(TEventWatch* watch, short events) override {
+    if (watch->events == events) {
+      return true;
+    }
+
+    if (watch->events && event_del(&watch->ev) == -1) {
+      GlobalOutput.perror("TLibeventLoop::update() event_del ", THRIFT_GET_SOCKET_ERROR);
+      return false;
+    }
+    watch->events = 0;
+    if (!events) {
+      return true;
+    }
+
+    // The event is set up afresh each time since the descriptor and base
+    // may have changed while it was not in use.
+    event_set(&watch->ev, watch->fd, events | EV_PERSIST, TLibeventLoop::dispatch, watch);
+    event_base_set(eventBase_, &watch->ev);
+    if (event_add(&watch->ev, nullptr) == -1) {
+      GlobalOutput.perror("TLibeventLoop::update() event_add ", THRIFT_GET_SOCKET_ERROR);
+      return false;
+    }
+    watch->events = events;
+    return true;
+  }
+
+  void loop() override { event_base_loop(eventBase_, 0); }
+
+  void breakLoop() override { event_base_loopbreak(eventBase_); }
+
+  std::string getMethod() const override {
+    return std::string("libevent ") + event_get_version() + " method "
+           + event_base_get_method(eventBase_);
+  }
+
+  event_base* getEventBase() const override { return eventBase_; }
+
+private:
+  static void dispatch(evutil_socket_t fd, short which, void* v) {
+    (void)fd;
+    auto* watch = static_cast<TEventWatch*>(v);
+    watch->callback(watch->fd, which & (READ | WRITE), watch->arg);
+  }
+
+  event_base* eventBase_;
+  bool ownEventBase_;
+};
+
+#ifdef HAVE_SYS_EPOLL_H
+/**
+ * A loop on epoll alone.  Unlike libevent it does not have to keep a
+ * change list or re-add a descriptor whose interest changes: an update is
+ * a single epoll_ctl(), and one that changes nothing costs nothing.
+ */
+class TEpollEventLoop : public TEventLoop {
+public:
+  TEpollEventLoop()
+    : epollFd_(epoll_create1(EPOLL_CLOEXEC)),
+      numWatched_(0),
+      numReady_(0),
+      nextReady_(0),
+      breakRequested_(false) {
+    if (epollFd_ == -1) {
+      int errno_copy = errno;
+      throw TException("TEpollEventLoop: epoll_create1() failed: "
+                       + TOutput::strerror_s(errno_copy));
+    }
+  }
+
+  ~TEpollEventLoop() override { ::close(epollFd_); }
+
+  bool update(TEventWatch* watch, short events) override {
+    if (watch->events == events) {
+      return true;
+    }
+
+    int op = EPOLL_CTL_MOD;
+    if (!events) {
+      op = EPOLL_CTL_DEL;
+    } else if (!watch->events) {
+      op = EPOLL_CTL_ADD;
+    }
+
+    struct epoll_event interest;
+    interest.events = ((events & READ) ? static_cast<uint32_t>(EPOLLIN) : 0)
+                      | ((events & WRITE) ? static_cast<uint32_t>(EPOLLOUT) : 0);
+    interest.data.ptr = watch;
+    if (epoll_ctl(epollFd_, op, watch->fd, &interest) == -1) {
+      int errno_copy = errno;
+      // a descriptor that has been closed has left the epoll set already
+      if (op != EPOLL_CTL_DEL || (errno_copy != EBADF && errno_copy != ENOENT)) {
+        GlobalOutput.perror("TEpollEventLoop::update() epoll_ctl ", errno_copy);
+        return false;
+      }
+    }
+
+    if (op == EPOLL_CTL_ADD) {
+      ++numWatched_;
+    } else if (op == EPOLL_CTL_DEL) {
+      --numWatched_;
+      forgetReady(watch);
+    }
+    watch->events = events;
+    return true;
+  }
+
+  void loop() override {
+    breakRequested_ = false;
+    while (!breakRequested_ && numWatched_ > 0) {
+      int count = epoll_wait(epollFd_, ready_, MAX_READY, -1);
+      if (count == -1) {
+        if (errno == EINTR) {
+          continue;
+        }
+        GlobalOutput.perror("TEpollEventLoop::loop() epoll_wait ", errno);
+        return;
+      }
+
+      numReady_ = count;
+      nextReady_ = 0;
+      while (nextReady_ < numReady_ && !breakRequested_) {
+        const struct epoll_event& ready = ready_[nextReady_++];
+        auto* watch = static_cast<TEventWatch*>(ready.data.ptr);
+        if (watch == nullptr) {
+          continue;
+        }
+
+        // Errors and hang-ups are left for the read or write to report
+        short events = 0;
+        if (ready.events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+          events |= READ;
+        }
+        if (ready.events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) {
+          events |= WRITE;
+        }
+        events &= watch->events;
+        if (events) {
+          watch->callback(watch->fd, events, watch->arg);
+        }
+      }
+      numReady_ = 0;
+      nextReady_ = 0;
+    }
+  }
+
+  void breakLoop() override { breakRequested_ = true; }
+
+  std::string getMethod() const override { return "epoll"; }
+
+private:
+  static const int MAX_READY = 64;
+
+  /**
+   * A callback earlier in the batch may stop watching a descriptor, and
+   * may even reuse the watch for a new one, so events still pending for
+   * it must not be delivered.
+   */
+  void forgetReady(TEventWatch* watch) {
+    for (int i = nextReady_; i < numReady_; ++i) {
+      if (ready_[i].data.ptr == watch) {
+        ready_[i].data.ptr = nullptr;
+      }
+    }
+  }
+
+  int epollFd_;
+  int numWatched_;
+  struct epoll_event ready_[MAX_READY];
+  int numReady_;
+  int nextReady_;
+  bool breakRequested_;
+};
+#endif
+}
+
+std::unique_ptr<TEventLoop> TEventLoop::create(TEventLoopType type, event_base* userEventBase) {
+  switch (type) {
+  case T_EVENT_LOOP_LIBEVENT:
+    return std::unique_ptr<TEventLoop>(new TLibeventLoop(userEventBase));
+
+  case T_EVENT_LOOP_EPOLL:
+    if (userEventBase != nullptr) {
+      throw TException("TEventLoop::create(): a user event_base needs the libevent loop");
+    }
+#ifdef HAVE_SYS_EPOLL_H
+    return std::unique_ptr<TEventLoop>(new TEpollEventLoop());
+#else
+    break;
+#endif
+  }
+  throw TException("TEventLoop::create(): event loop type not supported on this platform");
+}
+}
+}
+} // apache::thrift::server
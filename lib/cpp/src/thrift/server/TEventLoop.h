@@ -0,0 +1,130 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _THRIFT_SERVER_TEVENTLOOP_H_
+#define _THRIFT_SERVER_TEVENTLOOP_H_ 1
+
+#include <memory>
+#include <string>
+
+#include <thrift/TNonCopyable.h>
+#include <thrift/transport/PlatformSocket.h>
+
+#include <event.h>
+#include <event2/event_compat.h>
+#include <event2/event_struct.h>
+
+namespace apache {
+namespace thrift {
+namespace server {
+
+/// The event loop implementations a TNonblockingServer can run on.
+enum TEventLoopType {
+  T_EVENT_LOOP_LIBEVENT, ///< libevent, on whatever method it picks
+  T_EVENT_LOOP_EPOLL     ///< epoll directly, where available
+};
+
+/**
+ * Called with the descriptor and the TEventLoop::READ / WRITE events that
+ * are ready on it.
+ */
+typedef void (*TEventCallback)(THRIFT_SOCKET fd, short events, void* arg);
+
+/**
+ * A descriptor watched by a TEventLoop, together with what to call when it
+ * becomes ready.  Watches are owned by the caller and must outlive their
+ * registration: stop watching (update() with no events) before the watch
+ * is destroyed or its descriptor is closed.
+ */
+struct TEventWatch {
+  TEventWatch()
+    : fd(THRIFT_INVALID_SOCKET), events(0), callback(nullptr), arg(nullptr), ev() {}
+
+  /**
+   * Sets the descriptor and callback.  Only allowed while not watching.
+   */
+  void set(THRIFT_SOCKET watchFd, TEventCallback watchCallback, void* watchArg) {
+    fd = watchFd;
+    callback = watchCallback;
+    arg = watchArg;
+  }
+
+  THRIFT_SOCKET fd;
+
+  /// The events currently watched for, 0 if none
+  short events;
+
+  TEventCallback callback;
+  void* arg;
+
+  /// Registration used by the libevent loop
+  struct event ev;
+};
+
+/**
+ * The readiness loop of one TNonblockingServer IO thread.  Watches are
+ * level-triggered and persist until changed, as with libevent's
+ * EV_PERSIST.  Everything but construction must happen on the thread that
+ * runs the loop.
+ */
+class TEventLoop : apache::thrift::TNonCopyable {
+public:
+  static const short READ = EV_READ;
+  static const short WRITE = EV_WRITE;
+
+  virtual ~TEventLoop() {}
+
+  /**
+   * Creates a loop of the given type.  A user-provided event_base is used
+   * (and left to its owner) by the libevent loop and is an error with any
+   * other.  Throws TException if the type is not supported here.
+   */
+  static std::unique_ptr<TEventLoop> create(TEventLoopType type, event_base* userEventBase = nullptr);
+
+  /**
+   * Changes the events watch is watched for; 0 stops watching.  Returns
+   * false, after logging why, if the change could not be made.
+   */
+  virtual bool update(TEventWatch* watch, short events) = 0;
+
+  /**
+   * Dispatches events until breakLoop() is called or nothing is watched.
+   */
+  virtual void loop() = 0;
+
+  /**
+   * Makes loop() return once the running callback does.
+   */
+  virtual void breakLoop() = 0;
+
+  /**
+   * Returns a description of the loop for logging.
+   */
+  virtual std::string getMethod() const = 0;
+
+  /**
+   * Returns the underlying event_base, or nullptr if not libevent based.
+   */
+  virtual event_base* getEventBase() const { return nullptr; }
+};
+}
+}
+} // apache::thrift::server
+
+#endif // #ifndef _THRIFT_SERVER_TEVENTLOOP_H_
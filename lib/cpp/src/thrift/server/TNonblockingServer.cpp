@@ -26,6 +26,7 @@
 #include <thrift/transport/PlatformSocket.h>
 
 #include <algorithm>
+#include <chrono>
 #include <iostream>
 
 #ifdef HAVE_POLL_H
@@ -63,6 +64,10 @@
 #include <sched.h>
 #endif
 
+#ifdef HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h>
+#endif
+
 #ifndef AF_LOCAL
 #define AF_LOCAL AF_UNIX
 #endif
@@ -121,11 +126,27 @@ private:
   /// TProcessor
   std::shared_ptr<TProcessor> processor_;
 
+  /// Async processor, used instead of processor_ if the server has one
+  std::shared_ptr<async::TAsyncProcessor> asyncProcessor_;
+
+  /// Where the async processor is with a call, kept with the call's number
+  /// so that a callback for an earlier call is told apart from the current one
+  enum TAsyncState { ASYNC_DISPATCHING, ASYNC_RETURNED, ASYNC_COMPLETED };
+  static const int ASYNC_STATE_BITS = 2;
+  static const uint64_t ASYNC_STATE_MASK = (1 << ASYNC_STATE_BITS) - 1;
+  static uint64_t asyncStateOf(uint64_t call, TAsyncState state) {
+    return (call << ASYNC_STATE_BITS) | state;
+  }
+  std::atomic<uint64_t> asyncState_;
+
+  /// Number of the latest call given to the async processor
+  uint64_t asyncCall_;
+
   /// Object wrapping network socket
   std::shared_ptr<TSocket> tSocket_;
 
   /// Libevent object
-  struct event event_;
+  TEventWatch event_;
 
   /// Libevent flags
   short eventFlags_;
@@ -185,11 +206,29 @@ private:
   /// Thrift call context, if any
   void* connectionContext_;
 
+  /// Arena for the objects of the request being processed, if enabled
+  std::unique_ptr<TArena> arena_;
+
+  /// Pool that buffers are borrowed from while a request is in flight, if any
+  TBufferPool* bufferPool_;
+
+  /// Link in the IO thread's queue of completed connections
+  TConnection* nextCompleted_;
+
+  /// Runs this connection's requests on the thread manager, made on first use
+  std::shared_ptr<Runnable> task_;
+
+  /// Reads the method name of a request for the task lane selector, made on first use
+  std::shared_ptr<TMemoryBuffer> laneTransport_;
+  std::shared_ptr<TProtocol> laneProtocol_;
+
+  friend class TNonblockingIOThread;
+
   /// Go into read mode
-  void setRead() { setFlags(EV_READ | EV_PERSIST); }
+  void setRead() { setFlags(TEventLoop::READ); }
 
   /// Go into write mode
-  void setWrite() { setFlags(EV_WRITE | EV_PERSIST); }
+  void setWrite() { setFlags(TEventLoop::WRITE); }
 
   /// Set socket idle
   void setIdle() { setFlags(0); }
@@ -209,6 +248,18 @@ private:
    */
   void workSocket();
 
+  /// Give the read buffer back to the pool.
+  void releaseReadBuffer();
+
+  /// The thread manager lane for the request in the read buffer.
+  size_t selectTaskLane();
+
+  /// Called by the async processor, in any thread, when a call is done.
+  void asyncComplete(uint64_t call);
+
+  /// Give the write buffer back to the pool.
+  void releaseWriteBuffer();
+
 public:
   class Task;
 
@@ -217,15 +268,19 @@ public:
               TNonblockingIOThread* ioThread) {
     readBuffer_ = nullptr;
     readBufferSize_ = 0;
+    nextCompleted_ = nullptr;
+    asyncCall_ = 0;
+    asyncState_ = asyncStateOf(asyncCall_, ASYNC_COMPLETED);
 
     ioThread_ = ioThread;
     server_ = ioThread->getServer();
 
     // Allocate input and output transports these only need to be allocated
-    // once per TConnection (they don't need to be reallocated on init() call)
+    // once per TConnection (they don't need to be reallocated on init() call).
+    // Pooled connections only get a write buffer while processing.
     inputTransport_.reset(new TMemoryBuffer(readBuffer_, readBufferSize_));
-    outputTransport_.reset(
-        new TMemoryBuffer(static_cast<uint32_t>(server_->getWriteBufferDefaultSize())));
+    outputTransport_.reset(new TMemoryBuffer(
+        ioThread->getBufferPool() ? 0 : static_cast<uint32_t>(server_->getWriteBufferDefaultSize())));
 
     tSocket_ =  socket;
 
@@ -266,8 +321,8 @@ public:
    * @param which the flags associated with the event.
    * @param v void* callback arg where we placed TConnection's "this".
    */
-  static void eventHandler(evutil_socket_t fd, short /* which */, void* v) {
-    assert(fd == static_cast<evutil_socket_t>(((TConnection*)v)->getTSocket()->getSocketFD()));
+  static void eventHandler(THRIFT_SOCKET fd, short /* which */, void* v) {
+    assert(fd == ((TConnection*)v)->getTSocket()->getSocketFD());
     ((TConnection*)v)->workSocket();
   }
 
@@ -312,29 +367,38 @@ public:
 
   /// return the Thrift connection context if any
   void* getConnectionContext() { return connectionContext_; }
+
+  /// return the request arena, or nullptr if disabled
+  TArena* getArena() const { return arena_.get(); }
 };
 
+/**
+ * Runs a connection's request on a ThreadManager worker.  A connection has
+ * at most one request out at a time, so it keeps a single Task for its
+ * lifetime and dispatching a request allocates nothing.
+ */
 class TNonblockingServer::TConnection::Task : public Runnable {
 public:
-  Task(std::shared_ptr<TProcessor> processor,
-       std::shared_ptr<TProtocol> input,
-       std::shared_ptr<TProtocol> output,
-       TConnection* connection)
-    : processor_(processor),
-      input_(input),
-      output_(output),
-      connection_(connection),
-      serverEventHandler_(connection_->getServerEventHandler()),
-      connectionContext_(connection_->getConnectionContext()) {}
+  explicit Task(TConnection* connection) : connection_(connection) {}
 
   void run() override {
+    // The connection is idle while the task is out, so nothing here changes
+    // under us.
+    TArena* arena = connection_->getArena();
     try {
       for (;;) {
-        if (serverEventHandler_) {
-          serverEventHandler_->processContext(connectionContext_, connection_->getTSocket());
+        if (connection_->serverEventHandler_) {
+          connection_->serverEventHandler_->processContext(connection_->connectionContext_,
+                                                           connection_->getTSocket());
+        }
+        if (arena) {
+          arena->reset();
         }
-        if (!processor_->process(input_, output_, connectionContext_)
-            || !input_->getTransport()->peek()) {
+        TArenaScope arenaScope(arena);
+        if (!connection_->processor_->process(connection_->inputProtocol_,
+                                              connection_->outputProtocol_,
+                                              connection_->connectionContext_)
+            || !connection_->inputProtocol_->getTransport()->peek()) {
           break;
         }
       }
@@ -351,7 +415,7 @@ public:
       GlobalOutput.printf("TNonblockingServer: unknown exception while processing.");
     }
 
-    // Signal completion back to the libevent thread via a pipe
+    // Signal completion back to the libevent thread
     if (!connection_->notifyIOThread()) {
       GlobalOutput.printf("TNonblockingServer: failed to notifyIOThread, closing.");
       connection_->server_->decrementActiveProcessors();
@@ -363,17 +427,13 @@ public:
   TConnection* getTConnection() { return connection_; }
 
 private:
-  std::shared_ptr<TProcessor> processor_;
-  std::shared_ptr<TProtocol> input_;
-  std::shared_ptr<TProtocol> output_;
   TConnection* connection_;
-  std::shared_ptr<TServerEventHandler> serverEventHandler_;
-  void* connectionContext_;
 };
 
 void TNonblockingServer::TConnection::init(TNonblockingIOThread* ioThread) {
   ioThread_ = ioThread;
   server_ = ioThread->getServer();
+  bufferPool_ = ioThread->getBufferPool();
   appState_ = APP_INIT;
   eventFlags_ = 0;
 
@@ -388,6 +448,10 @@ void TNonblockingServer::TConnection::init(TNonblockingIOThread* ioThread) {
   socketState_ = SOCKET_RECV_FRAMING;
   callsForResize_ = 0;
 
+  if (server_->getRequestArenaBlockSize() > 0) {
+    arena_.reset(new TArena(server_->getRequestArenaBlockSize()));
+  }
+
   // get input/transports
   factoryInputTransport_ = server_->getInputTransportFactory()->getTransport(inputTransport_);
   factoryOutputTransport_ = server_->getOutputTransportFactory()->getTransport(outputTransport_);
@@ -411,7 +475,11 @@ void TNonblockingServer::TConnection::init(TNonblockingIOThread* ioThread) {
   }
 
   // Get the processor
-  processor_ = server_->getProcessor(inputProtocol_, outputProtocol_, tSocket_);
+  if (server_->isAsyncProcessing()) {
+    asyncProcessor_ = server_->getAsyncProcessor(inputProtocol_, outputProtocol_, tSocket_);
+  } else {
+    processor_ = server_->getProcessor(inputProtocol_, outputProtocol_, tSocket_);
+  }
 }
 
 void TNonblockingServer::TConnection::setSocket(std::shared_ptr<TSocket> socket) {
@@ -442,6 +510,7 @@ void TNonblockingServer::TConnection::workSocket() {
         return;
       }
       readBufferPos_ += fetch;
+      ioThread_->addRecentBytes(fetch);
     } catch (TTransportException& te) {
       //In Nonblocking SSLSocket some operations need to be retried again.
       //Current approach is parsing exception message, but a better solution needs to be investigated.
@@ -516,6 +585,7 @@ void TNonblockingServer::TConnection::workSocket() {
     if (got > 0) {
       // Move along in the buffer
       readBufferPos_ += got;
+      ioThread_->addRecentBytes(got);
 
       // Check that we did not overdo it
       assert(readBufferPos_ <= readWant_);
@@ -553,6 +623,7 @@ void TNonblockingServer::TConnection::workSocket() {
     }
 
     writeBufferPos_ += sent;
+    ioThread_->addRecentBytes(sent);
 
     // Did we overdo it?
     assert(writeBufferPos_ <= writeBufferSize_);
@@ -593,6 +664,12 @@ void TNonblockingServer::TConnection::transition() {
   case APP_READ_REQUEST:
     // We are done reading the request, package the read buffer into transport
     // and get back some data from the dispatch function
+    if (bufferPool_) {
+      uint32_t capacity;
+      uint8_t* buf = bufferPool_->take(
+          static_cast<uint32_t>(server_->getWriteBufferDefaultSize()), &capacity);
+      outputTransport_->resetBuffer(buf, capacity, TMemoryBuffer::TAKE_OWNERSHIP);
+    }
     if (server_->getHeaderTransport()) {
       inputTransport_->resetBuffer(readBuffer_, readBufferPos_);
       outputTransport_->resetBuffer();
@@ -610,12 +687,56 @@ void TNonblockingServer::TConnection::transition() {
 
     server_->incrementActiveProcessors();
 
-    if (server_->isThreadPoolProcessing()) {
+    if (asyncProcessor_) {
+      // The application is now waiting on the processor's callback, and the
+      // connection is idle until then
+      appState_ = APP_WAIT_TASK;
+      setIdle();
+      uint64_t call = ++asyncCall_;
+      asyncState_.store(asyncStateOf(call, ASYNC_DISPATCHING), std::memory_order_relaxed);
+
+      try {
+        if (serverEventHandler_) {
+          serverEventHandler_->processContext(connectionContext_, getTSocket());
+        }
+        if (arena_) {
+          arena_->reset();
+        }
+        TArenaScope arenaScope(arena_.get());
+        asyncProcessor_->process([this, call](bool) { asyncComplete(call); },
+                                 inputProtocol_,
+                                 outputProtocol_);
+      } catch (const std::exception& x) {
+        GlobalOutput.printf("Server::process() uncaught exception: %s: %s",
+                            typeid(x).name(),
+                            x.what());
+        asyncState_.store(asyncStateOf(call, ASYNC_COMPLETED), std::memory_order_release);
+        server_->decrementActiveProcessors();
+        close();
+        return;
+      } catch (...) {
+        GlobalOutput.printf("Server::process() unknown exception");
+        asyncState_.store(asyncStateOf(call, ASYNC_COMPLETED), std::memory_order_release);
+        server_->decrementActiveProcessors();
+        close();
+        return;
+      }
+
+      uint64_t dispatching = asyncStateOf(call, ASYNC_DISPATCHING);
+      if (asyncState_.compare_exchange_strong(dispatching,
+                                              asyncStateOf(call, ASYNC_RETURNED),
+                                              std::memory_order_acq_rel)) {
+        // The callback will notify us when the call is done
+        return;
+      }
+      // The call was done before process() returned, so carry on here
+    } else if (server_->isThreadPoolProcessing()) {
       // We are setting up a Task to do this work and we will wait on it
 
-      // Create task and dispatch to the thread manager
-      std::shared_ptr<Runnable> task = std::shared_ptr<Runnable>(
-          new Task(processor_, inputProtocol_, outputProtocol_, this));
+      // Dispatch this connection's task to the thread manager
+      if (!task_) {
+        task_ = std::make_shared<Task>(this);
+      }
       // The application is now waiting on the task to finish
       appState_ = APP_WAIT_TASK;
 
@@ -625,7 +746,12 @@ void TNonblockingServer::TConnection::transition() {
       setIdle();
 
       try {
-        server_->addTask(task);
+        server_->addTask(task_, selectTaskLane(), ioThread_->getThreadNumber());
+      } catch (InvalidArgumentException& iae) {
+        // The selector picked a lane the ThreadManager does not have
+        GlobalOutput.printf("[ERROR] InvalidArgumentException: Server::process() %s", iae.what());
+        server_->decrementActiveProcessors();
+        close();
       } catch (IllegalStateException& ise) {
         // The ThreadManager is not ready to handle any more tasks (it's probably shutting down).
         GlobalOutput.printf("IllegalStateException: Server::process() %s", ise.what());
@@ -644,6 +770,10 @@ void TNonblockingServer::TConnection::transition() {
           serverEventHandler_->processContext(connectionContext_, getTSocket());
         }
         // Invoke the processor
+        if (arena_) {
+          arena_->reset();
+        }
+        TArenaScope arenaScope(arena_.get());
         processor_->process(inputProtocol_, outputProtocol_, connectionContext_);
       } catch (const TTransportException& ttx) {
         GlobalOutput.printf(
@@ -681,6 +811,11 @@ void TNonblockingServer::TConnection::transition() {
     // Get the result of the operation
     outputTransport_->getBuffer(&writeBuffer_, &writeBufferSize_);
 
+    // The request has been consumed, so its buffer can serve someone else
+    if (bufferPool_) {
+      releaseReadBuffer();
+    }
+
     // If the function call generated return data, then move into the send
     // state and get going
     // 4 bytes were reserved for frame size
@@ -710,7 +845,7 @@ void TNonblockingServer::TConnection::transition() {
     if (writeBufferSize_ > largestWriteBufferSize_) {
       largestWriteBufferSize_ = writeBufferSize_;
     }
-    if (server_->getResizeBufferEveryN() > 0
+    if (!bufferPool_ && server_->getResizeBufferEveryN() > 0
         && ++callsForResize_ >= server_->getResizeBufferEveryN()) {
       checkIdleBufferMemLimit(server_->getIdleReadBufferLimit(),
                               server_->getIdleWriteBufferLimit());
@@ -727,6 +862,9 @@ void TNonblockingServer::TConnection::transition() {
     writeBuffer_ = nullptr;
     writeBufferPos_ = 0;
     writeBufferSize_ = 0;
+    if (bufferPool_) {
+      releaseWriteBuffer();
+    }
 
     // Into read4 state we go
     socketState_ = SOCKET_RECV_FRAMING;
@@ -743,8 +881,14 @@ void TNonblockingServer::TConnection::transition() {
     readWant_ += 4;
 
     // We just read the request length
-    // Double the buffer size until it is big enough
-    if (readWant_ > readBufferSize_) {
+    if (bufferPool_) {
+      // Borrow a buffer big enough for the whole frame
+      if (readWant_ > readBufferSize_) {
+        releaseReadBuffer();
+        readBuffer_ = bufferPool_->take(readWant_, &readBufferSize_);
+      }
+    } else if (readWant_ > readBufferSize_) {
+      // Double the buffer size until it is big enough
       if (readBufferSize_ == 0) {
         readBufferSize_ = 1;
       }
@@ -788,54 +932,16 @@ void TNonblockingServer::TConnection::setFlags(short eventFlags) {
     return;
   }
 
-  // Delete a previously existing event
-  if (eventFlags_ && event_del(&event_) == -1) {
-    GlobalOutput.perror("TConnection::setFlags() event_del", THRIFT_GET_SOCKET_ERROR);
-    return;
-  }
-
-  // Update in memory structure
-  eventFlags_ = eventFlags;
-
-  // Do not call event_set if there are no flags
+  // A new socket (or a recycled connection) has to be watched afresh
   if (!eventFlags_) {
-    return;
+    event_.set(tSocket_->getSocketFD(), TConnection::eventHandler, this);
   }
 
-  /*
-   * event_set:
-   *
-   * Prepares the event structure &event to be used in future calls to
-   * event_add() and event_del().  The event will be prepared to call the
-   * eventHandler using the 'sock' file descriptor to monitor events.
-   *
-   * The events can be either EV_READ, EV_WRITE, or both, indicating
-   * that an application can read or write from the file respectively without
-   * blocking.
-   *
-   * The eventHandler will be called with the file descriptor that triggered
-   * the event and the type of event which will be one of: EV_TIMEOUT,
-   * EV_SIGNAL, EV_READ, EV_WRITE.
-   *
-   * The additional flag EV_PERSIST makes an event_add() persistent until
-   * event_del() has been called.
-   *
-   * Once initialized, the &event struct can be used repeatedly with
-   * event_add() and event_del() and does not need to be reinitialized unless
-   * the eventHandler and/or the argument to it are to be changed.  However,
-   * when an ev structure has been added to libevent using event_add() the
-   * structure must persist until the event occurs (assuming EV_PERSIST
-   * is not set) or is removed using event_del().  You may not reuse the same
-   * ev structure for multiple monitored descriptors; each descriptor needs
-   * its own ev.
-   */
-  event_set(&event_, tSocket_->getSocketFD(), eventFlags_, TConnection::eventHandler, this);
-  event_base_set(ioThread_->getEventBase(), &event_);
+  // The loop logs the reason if this fails
+  ioThread_->getEventLoop()->update(&event_, eventFlags);
 
-  // Add the event
-  if (event_add(&event_, nullptr) == -1) {
-    GlobalOutput.perror("TConnection::setFlags(): could not event_add", THRIFT_GET_SOCKET_ERROR);
-  }
+  // Update in memory structure
+  eventFlags_ = event_.events;
 }
 
 /**
@@ -847,6 +953,7 @@ void TNonblockingServer::TConnection::close() {
   if (serverEventHandler_) {
     serverEventHandler_->deleteContext(connectionContext_, inputProtocol_, outputProtocol_);
   }
+  ioThread_->removeConnection();
   ioThread_ = nullptr;
 
   // Close the socket
@@ -858,12 +965,98 @@ void TNonblockingServer::TConnection::close() {
 
   // release processor and handler
   processor_.reset();
+  asyncProcessor_.reset();
+
+  // idle connections don't keep request memory
+  arena_.reset();
+  if (bufferPool_) {
+    releaseReadBuffer();
+    releaseWriteBuffer();
+  }
 
   // Give this object back to the server that owns it
   server_->returnConnection(this);
 }
 
+void TNonblockingServer::TConnection::releaseReadBuffer() {
+  inputTransport_->resetBuffer(nullptr, 0);
+  bufferPool_->giveBack(readBuffer_, readBufferSize_);
+  readBuffer_ = nullptr;
+  readBufferSize_ = 0;
+}
+
+void TNonblockingServer::TConnection::releaseWriteBuffer() {
+  uint32_t capacity;
+  uint8_t* buf = outputTransport_->releaseBuffer(&capacity);
+  bufferPool_->giveBack(buf, capacity);
+}
+
+void TNonblockingServer::TConnection::asyncComplete(uint64_t call) {
+  uint64_t state = asyncState_.load(std::memory_order_acquire);
+  do {
+    if ((state >> ASYNC_STATE_BITS) != call
+        || (state & ASYNC_STATE_MASK) == ASYNC_COMPLETED) {
+      // The call is over: process() threw and the connection was closed, or
+      // the callback already ran.  The connection may be serving another.
+      return;
+    }
+  } while (!asyncState_.compare_exchange_weak(state,
+                                              asyncStateOf(call, ASYNC_COMPLETED),
+                                              std::memory_order_acq_rel));
+  if ((state & ASYNC_STATE_MASK) == ASYNC_DISPATCHING) {
+    // Still inside process() on the IO thread, which carries on from there
+    return;
+  }
+
+  // Signal completion back to the libevent thread
+  if (!notifyIOThread()) {
+    GlobalOutput.printf("TNonblockingServer: failed to notifyIOThread, closing.");
+    server_->decrementActiveProcessors();
+    close();
+  }
+}
+
+size_t TNonblockingServer::TConnection::selectTaskLane() {
+  const TaskLaneSelector& selector = server_->getTaskLaneSelector();
+  if (!selector || server_->getHeaderTransport()) {
+    return 0;
+  }
+
+  if (!laneProtocol_) {
+    laneTransport_.reset(new TMemoryBuffer());
+    laneProtocol_ = server_->getInputProtocolFactory()->getProtocol(laneTransport_);
+  }
+  laneTransport_->resetBuffer(readBuffer_ + 4, readBufferPos_ - 4, TMemoryBuffer::OBSERVE);
+
+  std::string name;
+  try {
+    TMessageType type;
+    int32_t seqid;
+    laneProtocol_->readMessageBegin(name, type, seqid);
+  } catch (const TException&) {
+    // let the processor report it
+    laneProtocol_.reset();
+    return 0;
+  }
+
+  // Only the start of the message was read.  A protocol that cannot end it
+  // there, as TJSONProtocol cannot, is left midway through it, so is made
+  // anew for the next request.
+  try {
+    laneProtocol_->readMessageEnd();
+  } catch (const TException&) {
+    laneProtocol_.reset();
+  }
+  laneTransport_->readEnd();
+  return selector(name);
+}
+
 void TNonblockingServer::TConnection::checkIdleBufferMemLimit(size_t readLimit, size_t writeLimit) {
+  // pooled connections hold no buffers while idle
+  if (bufferPool_) {
+    return;
+  }
+
   if (readLimit > 0 && readBufferSize_ > readLimit) {
     free(readBuffer_);
     readBuffer_ = nullptr;
@@ -902,16 +1095,15 @@ TNonblockingServer::~TNonblockingServer() {
  * Creates a new connection either by reusing an object off the stack or
  * by allocating a new one entirely
  */
-TNonblockingServer::TConnection* TNonblockingServer::createConnection(std::shared_ptr<TSocket> socket) {
+TNonblockingServer::TConnection* TNonblockingServer::createConnection(std::shared_ptr<TSocket> socket,
+                                                                     TNonblockingIOThread* ioThread) {
   // Check the stack
   Guard g(connMutex_);
 
-  // pick an IO thread to handle this connection -- currently round robin
-  assert(nextIOThread_ < ioThreads_.size());
-  int selectedThreadIdx = nextIOThread_;
-  nextIOThread_ = static_cast<uint32_t>((nextIOThread_ + 1) % ioThreads_.size());
-
-  TNonblockingIOThread* ioThread = ioThreads_[selectedThreadIdx].get();
+  if (ioThread == nullptr) {
+    ioThread = selectIOThread();
+  }
+  ioThread->addConnection();
 
   // Check the connection stack to see if we can re-use
   TConnection* result = nullptr;
@@ -928,6 +1120,67 @@ TNonblockingServer::TConnection* TNonblockingServer::createConnection(std::share
   return result;
 }
 
+/**
+ * Picks an IO thread for a new connection.  The load-aware policies scan
+ * from nextIOThread_ so that threads with equal load still take turns.
+ */
+TNonblockingIOThread* TNonblockingServer::selectIOThread() {
+  assert(nextIOThread_ < ioThreads_.size());
+  const size_t numThreads = ioThreads_.size();
+  size_t selected = nextIOThread_;
+
+  switch (ioThreadAssignment_) {
+  case T_IO_THREAD_ROUND_ROBIN:
+    break;
+
+  case T_IO_THREAD_LEAST_CONNECTIONS: {
+    uint32_t least = ioThreads_[selected]->getNumConnections();
+    for (size_t i = 1; i < numThreads && least > 0; ++i) {
+      size_t idx = (nextIOThread_ + i) % numThreads;
+      uint32_t connections = ioThreads_[idx]->getNumConnections();
+      if (connections < least) {
+        least = connections;
+        selected = idx;
+      }
+    }
+    break;
+  }
+
+  case T_IO_THREAD_LEAST_RECENT_BYTES: {
+    uint64_t least = ioThreads_[selected]->getRecentBytes();
+    for (size_t i = 1; i < numThreads && least > 0; ++i) {
+      size_t idx = (nextIOThread_ + i) % numThreads;
+      uint64_t bytes = ioThreads_[idx]->getRecentBytes();
+      if (bytes < least) {
+        least = bytes;
+        selected = idx;
+      }
+    }
+    break;
+  }
+
+  case T_IO_THREAD_POWER_OF_TWO_CHOICES:
+    if (numThreads > 1) {
+      size_t first = ioThreadRandom_() % numThreads;
+      size_t second = (first + 1 + ioThreadRandom_() % (numThreads - 1)) % numThreads;
+      selected = ioThreads_[second]->getNumConnections() < ioThreads_[first]->getNumConnections()
+                     ? second
+                     : first;
+    }
+    break;
+  }
+
+  nextIOThread_ = static_cast<uint32_t>((selected + 1) % numThreads);
+  return ioThreads_[selected].get();
+}
+
+size_t TNonblockingServer::getNumIOThreadConnections(size_t id) const {
+  if (id >= ioThreads_.size()) {
+    return 0;
+  }
+  return ioThreads_[id]->getNumConnections();
+}
+
 /**
  * Returns a connection to the stack
  */
@@ -952,15 +1205,22 @@ void TNonblockingServer::returnConnection(TConnection* connection) {
  * Server socket had something happen.  We accept all waiting client
  * connections on fd and assign TConnection objects to handle those requests.
  */
-void TNonblockingServer::handleEvent(THRIFT_SOCKET fd, short which) {
+void TNonblockingServer::handleEvent(TNonblockingIOThread* acceptor,
+                                     THRIFT_SOCKET fd,
+                                     short which) {
   (void)which;
+  std::shared_ptr<TNonblockingServerTransport> transport = acceptor->getListenTransport();
+  if (!transport) {
+    transport = serverTransport_;
+  }
   // Make sure that libevent didn't mess up the socket handles
-  assert(fd == serverSocket_);
+  assert(fd == transport->getSocketFD());
+  (void)fd;
 
   // Going to accept a new client socket
   std::shared_ptr<TSocket> clientSocket;
 
-  clientSocket = serverTransport_->accept();
+  clientSocket = transport->accept();
   if (clientSocket) {
     // If we're overloaded, take action here
     if (overloadAction_ != T_OVERLOAD_NO_ACTION && serverOverloaded()) {
@@ -980,7 +1240,8 @@ void TNonblockingServer::handleEvent(THRIFT_SOCKET fd, short which) {
     }
 
     // Create a new TConnection for this client socket.
-    TConnection* clientConnection = createConnection(clientSocket);
+    TConnection* clientConnection
+        = createConnection(clientSocket, reusePortAcceptors_ ? acceptor : nullptr);
 
     // Fail fast if we could not create a TConnection object
     if (clientConnection == nullptr) {
@@ -993,15 +1254,8 @@ void TNonblockingServer::handleEvent(THRIFT_SOCKET fd, short which) {
      * Either notify the ioThread that is assigned this connection to
      * start processing, or if it is us, we'll just ask this
      * connection to do its initial state change here.
-     *
-     * (We need to avoid writing to our own notification pipe, to
-     * avoid possible deadlocks if the pipe is full.)
-     *
-     * The IO thread #0 is the only one that handles these listen
-     * events, so unless the connection has been assigned to thread #0
-     * we know it's not on our thread.
      */
-    if (clientConnection->getIOThreadNumber() == 0) {
+    if (clientConnection->getIOThreadNumber() == acceptor->getThreadNumber()) {
       clientConnection->transition();
     } else {
       if (!clientConnection->notifyIOThread()) {
@@ -1034,6 +1288,18 @@ void TNonblockingServer::setThreadManager(std::shared_ptr<ThreadManager> threadM
   }
 }
 
+void TNonblockingServer::setIOThreadThreadManagers(
+    const std::vector<std::shared_ptr<ThreadManager> >& threadManagers) {
+  ioThreadThreadManagers_ = threadManagers;
+  for (const auto& threadManager : threadManagers) {
+    threadManager->setExpireCallback(
+        std::bind(&TNonblockingServer::expireClose, this, std::placeholders::_1));
+  }
+  if (!threadManagers.empty()) {
+    setThreadManager(threadManagers.front());
+  }
+}
+
 bool TNonblockingServer::serverOverloaded() {
   size_t activeConnections = numTConnections_ - connectionStack_.size();
   if (numActiveProcessors_ > maxActiveProcessors_ || activeConnections > maxConnections_) {
@@ -1058,8 +1324,15 @@ bool TNonblockingServer::serverOverloaded() {
 }
 
 bool TNonblockingServer::drainPendingTask() {
-  if (threadManager_) {
-    std::shared_ptr<Runnable> task = threadManager_->removeNextPending();
+  std::vector<std::shared_ptr<ThreadManager> > threadManagers = ioThreadThreadManagers_;
+  if (threadManagers.empty()) {
+    threadManagers.push_back(threadManager_);
+  }
+  for (const auto& threadManager : threadManagers) {
+    if (!threadManager) {
+      continue;
+    }
+    std::shared_ptr<Runnable> task = threadManager->removeNextPending();
     if (task) {
       TConnection* connection = static_cast<TConnection::Task*>(task.get())->getTConnection();
       assert(connection && connection->getServer() && connection->getState() == APP_WAIT_TASK);
@@ -1070,6 +1343,16 @@ bool TNonblockingServer::drainPendingTask() {
   return false;
 }
 
+TBufferPoolStats TNonblockingServer::getBufferPoolStats() const {
+  TBufferPoolStats stats;
+  for (const auto& ioThread : ioThreads_) {
+    if (ioThread->getBufferPool()) {
+      stats += ioThread->getBufferPool()->getStats();
+    }
+  }
+  return stats;
+}
+
 void TNonblockingServer::expireClose(std::shared_ptr<Runnable> task) {
   TConnection* connection = static_cast<TConnection::Task*>(task.get())->getTConnection();
   assert(connection && connection->getServer() && connection->getState() == APP_WAIT_TASK);
@@ -1099,11 +1382,22 @@ void TNonblockingServer::registerEvents(event_base* user_event_base) {
   assert(numIOThreads_ == 1 || !userEventBase_);
 
   for (uint32_t id = 0; id < numIOThreads_; ++id) {
-    // the first IO thread also does the listening on server socket
+    // the first IO thread also does the listening on server socket, and in
+    // SO_REUSEPORT mode the others listen on sockets of their own
     THRIFT_SOCKET listenFd = (id == 0 ? serverSocket_ : THRIFT_INVALID_SOCKET);
+    shared_ptr<TNonblockingServerTransport> listenTransport;
+    if (id > 0 && reusePortAcceptors_) {
+      listenTransport = serverTransport_->createReusePortPeer();
+      if (!listenTransport) {
+        throw TException(
+            "TNonblockingServer::registerEvents(): "
+            "server transport cannot create SO_REUSEPORT listeners");
+      }
+      listenFd = listenTransport->getSocketFD();
+    }
 
     shared_ptr<TNonblockingIOThread> thread(
-        new TNonblockingIOThread(this, id, listenFd, useHighPriorityIOThreads_));
+        new TNonblockingIOThread(this, id, listenFd, useHighPriorityIOThreads_, listenTransport));
     ioThreads_.push_back(thread);
   }
 
@@ -1163,29 +1457,39 @@ void TNonblockingServer::serve() {
 TNonblockingIOThread::TNonblockingIOThread(TNonblockingServer* server,
                                            int number,
                                            THRIFT_SOCKET listenSocket,
-                                           bool useHighPriority)
+                                           bool useHighPriority,
+                                           shared_ptr<TNonblockingServerTransport> listenTransport)
   : server_(server),
     number_(number),
     threadId_{},
     listenSocket_(listenSocket),
+    listenTransport_(listenTransport),
     useHighPriority_(useHighPriority),
-    eventBase_(nullptr),
-    ownEventBase_(false),
-    serverEvent_{},
-    notificationEvent_{} {
+    completed_(nullptr),
+    numConnections_(0),
+    recentBytes_(0),
+    recentBytesTime_(0),
+    stopRequested_(false) {
   notificationPipeFDs_[0] = -1;
   notificationPipeFDs_[1] = -1;
+  if (server->getBufferPoolLimit() > 0) {
+    bufferPool_.reset(new TBufferPool(server->getBufferPoolLimit()));
+  }
+  // Created up front: the listening thread may hand us a connection before
+  // our own thread has got round to registerEvents().
+  createNotificationPipe();
 }
 
 TNonblockingIOThread::~TNonblockingIOThread() {
   // make sure our associated thread is fully finished
   join();
 
-  if (eventBase_ && ownEventBase_) {
-    event_base_free(eventBase_);
-    ownEventBase_ = false;
-  }
+  eventLoop_.reset();
 
+  if (listenTransport_) {
+    listenTransport_->close();
+    listenSocket_ = THRIFT_INVALID_SOCKET;
+  }
   if (listenSocket_ != THRIFT_INVALID_SOCKET) {
     if (0 != ::THRIFT_CLOSESOCKET(listenSocket_)) {
       GlobalOutput.perror("TNonblockingIOThread listenSocket_ close(): ", THRIFT_GET_SOCKET_ERROR);
@@ -1193,6 +1497,10 @@ TNonblockingIOThread::~TNonblockingIOThread() {
     listenSocket_ = THRIFT_INVALID_SOCKET;
   }
 
+  if (notificationPipeFDs_[1] == notificationPipeFDs_[0]) {
+    // an eventfd, closed once
+    notificationPipeFDs_[1] = THRIFT_INVALID_SOCKET;
+  }
   for (auto notificationPipeFD : notificationPipeFDs_) {
     if (notificationPipeFD >= 0) {
       if (0 != ::THRIFT_CLOSESOCKET(notificationPipeFD)) {
@@ -1205,6 +1513,15 @@ TNonblockingIOThread::~TNonblockingIOThread() {
 }
 
 void TNonblockingIOThread::createNotificationPipe() {
+#ifdef HAVE_SYS_EVENTFD_H
+  int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (fd < 0) {
+    GlobalOutput.perror("TNonblockingServer::createNotificationPipe eventfd ", errno);
+    throw TException("can't create notification eventfd");
+  }
+  notificationPipeFDs_[0] = fd;
+  notificationPipeFDs_[1] = fd;
+#else
   if (evutil_socketpair(AF_LOCAL, SOCK_STREAM, 0, notificationPipeFDs_) == -1) {
     GlobalOutput.perror("TNonblockingServer::createNotificationPipe ", EVUTIL_SOCKET_ERROR());
     throw TException("can't create notification pipe");
@@ -1230,6 +1547,7 @@ void TNonblockingIOThread::createNotificationPipe() {
           "FD_CLOEXEC");
     }
   }
+#endif
 }
 
 /**
@@ -1238,178 +1556,175 @@ void TNonblockingIOThread::createNotificationPipe() {
 void TNonblockingIOThread::registerEvents() {
   threadId_ = Thread::get_current();
 
-  assert(eventBase_ == nullptr);
-  eventBase_ = getServer()->getUserEventBase();
-  if (eventBase_ == nullptr) {
-    eventBase_ = event_base_new();
-    ownEventBase_ = true;
-  }
+  assert(!eventLoop_);
+  eventLoop_ = TEventLoop::create(server_->getEventLoopType(), server_->getUserEventBase());
 
-  // Print some libevent stats
+  // Print some event loop stats
   if (number_ == 0) {
-    GlobalOutput.printf("TNonblockingServer: using libevent %s method %s",
-                        event_get_version(),
-                        event_base_get_method(eventBase_));
+    GlobalOutput.printf("TNonblockingServer: using %s", eventLoop_->getMethod().c_str());
   }
 
   if (listenSocket_ != THRIFT_INVALID_SOCKET) {
     // Register the server event
-    event_set(&serverEvent_,
-              listenSocket_,
-              EV_READ | EV_PERSIST,
-              TNonblockingIOThread::listenHandler,
-              server_);
-    event_base_set(eventBase_, &serverEvent_);
+    serverEvent_.set(listenSocket_, TNonblockingIOThread::listenHandler, this);
 
     // Add the event and start up the server
-    if (-1 == event_add(&serverEvent_, nullptr)) {
+    if (!eventLoop_->update(&serverEvent_, TEventLoop::READ)) {
       throw TException(
           "TNonblockingServer::serve(): "
-          "event_add() failed on server listen event");
+          "could not watch server listen socket");
     }
     GlobalOutput.printf("TNonblocking: IO thread #%d registered for listen.", number_);
   }
 
-  createNotificationPipe();
-
   // Create an event to be notified when a task finishes
-  event_set(&notificationEvent_,
-            getNotificationRecvFD(),
-            EV_READ | EV_PERSIST,
-            TNonblockingIOThread::notifyHandler,
-            this);
-
-  // Attach to the base
-  event_base_set(eventBase_, &notificationEvent_);
+  notificationEvent_.set(getNotificationRecvFD(), TNonblockingIOThread::notifyHandler, this);
 
   // Add the event and start up the server
-  if (-1 == event_add(&notificationEvent_, nullptr)) {
+  if (!eventLoop_->update(&notificationEvent_, TEventLoop::READ)) {
     throw TException(
         "TNonblockingServer::serve(): "
-        "event_add() failed on task-done notification event");
+        "could not watch task-done notification descriptor");
   }
   GlobalOutput.printf("TNonblocking: IO thread #%d registered for notify.", number_);
 }
 
 bool TNonblockingIOThread::notify(TNonblockingServer::TConnection* conn) {
-  auto fd = getNotificationSendFD();
-  if (fd < 0) {
+  if (getNotificationSendFD() < 0) {
     return false;
   }
 
-  int ret = -1;
-  long kSize = sizeof(conn);
-  const char * pos = (const char *)const_cast_sockopt(&conn);
+  if (conn == nullptr) {
+    stopRequested_ = true;
+    return wakeUp();
+  }
 
-#if defined(HAVE_POLL_H) || defined(HAVE_SYS_POLL_H)
-  struct pollfd pfd = {fd, POLLOUT, 0};
+  TNonblockingServer::TConnection* head = completed_.load(std::memory_order_relaxed);
+  do {
+    conn->nextCompleted_ = head;
+  } while (!completed_.compare_exchange_weak(head,
+                                             conn,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed));
+
+  // Only the completion that finds the queue empty has to wake the IO
+  // thread; the rest are picked up by the same pass of notifyHandler().
+  // Once queued the connection belongs to the IO thread, so a failed
+  // wake-up is reported here rather than to the caller.
+  if (head == nullptr && !wakeUp()) {
+    GlobalOutput.perror("TNonblockingIOThread::notify() wake-up failed: ",
+                        THRIFT_GET_SOCKET_ERROR);
+  }
+  return true;
+}
 
-  while (kSize > 0) {
-    pfd.revents = 0;
-    ret = poll(&pfd, 1, -1);
-    if (ret < 0) {
-      return false;
-    } else if (ret == 0) {
-      continue;
-    }
+namespace {
 
-    if (pfd.revents & POLLHUP || pfd.revents & POLLERR) {
-      ::THRIFT_CLOSESOCKET(fd);
-      return false;
-    }
+int64_t monotonicMillis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+}
 
-    if (pfd.revents & POLLOUT) {
-      ret = send(fd, pos, kSize, 0);
-      if (ret < 0) {
-        if (errno == EAGAIN) {
-          continue;
-        }
+uint64_t decayBytes(uint64_t bytes, int64_t halfLives) {
+  return halfLives >= 64 ? 0 : bytes >> halfLives;
+}
+}
 
-        ::THRIFT_CLOSESOCKET(fd);
-        return false;
-      }
+uint64_t TNonblockingIOThread::getRecentBytes() const {
+  int64_t elapsed = monotonicMillis() - recentBytesTime_.load(std::memory_order_relaxed);
+  return decayBytes(recentBytes_.load(std::memory_order_relaxed),
+                    std::max<int64_t>(elapsed, 0) / RECENT_BYTES_HALF_LIFE_MS);
+}
 
-      kSize -= ret;
-      pos += ret;
-    }
+void TNonblockingIOThread::addRecentBytes(uint32_t bytes) {
+  uint64_t recent = recentBytes_.load(std::memory_order_relaxed);
+  int64_t since = recentBytesTime_.load(std::memory_order_relaxed);
+  int64_t halfLives = (monotonicMillis() - since) / RECENT_BYTES_HALF_LIFE_MS;
+  if (halfLives > 0) {
+    recent = decayBytes(recent, halfLives);
+    recentBytesTime_.store(since + halfLives * RECENT_BYTES_HALF_LIFE_MS,
+                           std::memory_order_relaxed);
   }
+  recentBytes_.store(recent + bytes, std::memory_order_relaxed);
+}
+
+bool TNonblockingIOThread::wakeUp() {
+#ifdef HAVE_SYS_EVENTFD_H
+  uint64_t one = 1;
+  // EAGAIN means the counter is saturated, which still wakes the reader
+  return ::write(getNotificationSendFD(), &one, sizeof(one)) == sizeof(one) || errno == EAGAIN;
 #else
-  fd_set wfds, efds;
-
-  while (kSize > 0) {
-    FD_ZERO(&wfds);
-    FD_ZERO(&efds);
-    FD_SET(fd, &wfds);
-    FD_SET(fd, &efds);
-    ret = select(static_cast<int>(fd + 1), nullptr, &wfds, &efds, nullptr);
-    if (ret < 0) {
-      return false;
-    } else if (ret == 0) {
-      continue;
-    }
+  char one = 1;
+  // a full pipe already has a wake-up pending
+  return send(getNotificationSendFD(), &one, sizeof(one), 0) == sizeof(one)
+         || THRIFT_GET_SOCKET_ERROR == THRIFT_EWOULDBLOCK
+         || THRIFT_GET_SOCKET_ERROR == THRIFT_EAGAIN;
+#endif
+}
 
-    if (FD_ISSET(fd, &efds)) {
-      ::THRIFT_CLOSESOCKET(fd);
+bool TNonblockingIOThread::clearWakeUp() {
+#ifdef HAVE_SYS_EVENTFD_H
+  uint64_t count;
+  if (::read(getNotificationRecvFD(), &count, sizeof(count)) < 0 && errno != EAGAIN) {
+    GlobalOutput.perror("TNonblocking: notifyHandler read() failed: ", errno);
+    breakLoop(true);
+  }
+  return true;
+#else
+  char buf[64];
+  for (;;) {
+    long nBytes = recv(getNotificationRecvFD(), buf, sizeof(buf), 0);
+    if (nBytes == 0) {
+      GlobalOutput.printf("notifyHandler: Notify socket closed!");
       return false;
-    }
-
-    if (FD_ISSET(fd, &wfds)) {
-      ret = send(fd, pos, kSize, 0);
-      if (ret < 0) {
-        if (errno == EAGAIN) {
-          continue;
-        }
-
-        ::THRIFT_CLOSESOCKET(fd);
-        return false;
+    } else if (nBytes < 0) {
+      if (THRIFT_GET_SOCKET_ERROR != THRIFT_EWOULDBLOCK
+          && THRIFT_GET_SOCKET_ERROR != THRIFT_EAGAIN) {
+        GlobalOutput.perror("TNonblocking: notifyHandler read() failed: ", THRIFT_GET_SOCKET_ERROR);
+        breakLoop(true);
       }
-
-      kSize -= ret;
-      pos += ret;
+      return true;
     }
   }
 #endif
-
-  return true;
 }
 
 /* static */
-void TNonblockingIOThread::notifyHandler(evutil_socket_t fd, short which, void* v) {
+void TNonblockingIOThread::notifyHandler(THRIFT_SOCKET fd, short which, void* v) {
   auto* ioThread = (TNonblockingIOThread*)v;
   assert(ioThread);
+  (void)fd;
   (void)which;
 
-  while (true) {
-    TNonblockingServer::TConnection* connection = nullptr;
-    const int kSize = sizeof(connection);
-    long nBytes = recv(fd, cast_sockopt(&connection), kSize, 0);
-    if (nBytes == kSize) {
-      if (connection == nullptr) {
-        // this is the command to stop our thread, exit the handler!
-        ioThread->breakLoop(false);
-        return;
-      }
-      connection->transition();
-    } else if (nBytes > 0) {
-      // throw away these bytes and hope that next time we get a solid read
-      GlobalOutput.printf("notifyHandler: Bad read of %d bytes, wanted %d", nBytes, kSize);
-      ioThread->breakLoop(true);
-      return;
-    } else if (nBytes == 0) {
-      GlobalOutput.printf("notifyHandler: Notify socket closed!");
-      ioThread->breakLoop(false);
-      // exit the loop
-      break;
-    } else { // nBytes < 0
-      if (THRIFT_GET_SOCKET_ERROR != THRIFT_EWOULDBLOCK
-          && THRIFT_GET_SOCKET_ERROR != THRIFT_EAGAIN) {
-        GlobalOutput.perror("TNonblocking: notifyHandler read() failed: ", THRIFT_GET_SOCKET_ERROR);
-        ioThread->breakLoop(true);
-        return;
-      }
-      // exit the loop
-      break;
-    }
+  // Clear the signal before taking the queue: a completion queued after
+  // the exchange below finds the queue empty and signals again.
+  if (!ioThread->clearWakeUp()) {
+    ioThread->breakLoop(false);
+    return;
+  }
+
+  // Take everything queued so far and put it back in completion order
+  TNonblockingServer::TConnection* connection = ioThread->completed_.exchange(
+      nullptr, std::memory_order_acquire);
+  TNonblockingServer::TConnection* ordered = nullptr;
+  while (connection != nullptr) {
+    TNonblockingServer::TConnection* next = connection->nextCompleted_;
+    connection->nextCompleted_ = ordered;
+    ordered = connection;
+    connection = next;
+  }
+
+  while (ordered != nullptr) {
+    // transition() may recycle the connection, so step past it first
+    connection = ordered;
+    ordered = ordered->nextCompleted_;
+    connection->nextCompleted_ = nullptr;
+    connection->transition();
+  }
+
+  if (ioThread->stopRequested_) {
+    // this is the command to stop our thread, exit the handler!
+    ioThread->breakLoop(false);
   }
 }
 
@@ -1430,7 +1745,7 @@ void TNonblockingIOThread::breakLoop(bool error) {
     notify(nullptr);
   } else {
     // cause the loop to stop ASAP - even if it has things to do in it
-    event_base_loopbreak(eventBase_);
+    eventLoop_->breakLoop();
   }
 }
 
@@ -1464,18 +1779,29 @@ void TNonblockingIOThread::setCurrentThreadHighPriority(bool value) {
 }
 
 void TNonblockingIOThread::run() {
-  if (eventBase_ == nullptr) {
+  const std::vector<AffinityThreadFactory::CpuSet>& cpuSets = server_->getIOThreadCpuSets();
+  if (!cpuSets.empty()) {
+    // before registerEvents(), so what it allocates is local to the CPUs
+    if (AffinityThreadFactory::setCurrentThreadAffinity(cpuSets[number_ % cpuSets.size()])) {
+      GlobalOutput.printf("TNonblocking: IO Thread #%d pinned to CPU set %d",
+                          number_,
+                          static_cast<int>(number_ % cpuSets.size()));
+    } else {
+      GlobalOutput.printf("TNonblocking: IO Thread #%d could not be pinned", number_);
+    }
+  }
+  if (!eventLoop_) {
     registerEvents();
   }
   if (useHighPriority_) {
     setCurrentThreadHighPriority(true);
   }
 
-  if (eventBase_ != nullptr)
+  if (eventLoop_)
   {
     GlobalOutput.printf("TNonblockingServer: IO thread #%d entering loop...", number_);
-    // Run libevent engine, never returns, invokes calls to eventHandler
-    event_base_loop(eventBase_, 0);
+    // Run the event loop until breakLoop(), invokes calls to eventHandler
+    eventLoop_->loop();
 
     if (useHighPriority_) {
       setCurrentThreadHighPriority(false);
@@ -1491,12 +1817,10 @@ void TNonblockingIOThread::run() {
 void TNonblockingIOThread::cleanupEvents() {
   // stop the listen socket, if any
   if (listenSocket_ != THRIFT_INVALID_SOCKET) {
-    if (event_del(&serverEvent_) == -1) {
-      GlobalOutput.perror("TNonblockingIOThread::stop() event_del: ", THRIFT_GET_SOCKET_ERROR);
-    }
+    eventLoop_->update(&serverEvent_, 0);
   }
 
-  event_del(&notificationEvent_);
+  eventLoop_->update(&notificationEvent_, 0);
 }
 
 void TNonblockingIOThread::stop() {
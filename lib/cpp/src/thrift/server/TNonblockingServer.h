@@ -21,12 +21,20 @@
 #define _THRIFT_SERVER_TNONBLOCKINGSERVER_H_ 1
 
 #include <thrift/Thrift.h>
+#include <thrift/TArena.h>
+#include <thrift/async/TAsyncProcessor.h>
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <random>
+#include <thrift/server/TBufferPool.h>
+#include <thrift/server/TEventLoop.h>
 #include <thrift/server/TServer.h>
 #include <thrift/transport/PlatformSocket.h>
 #include <thrift/transport/TBufferTransports.h>
 #include <thrift/transport/TSocket.h>
 #include <thrift/transport/TNonblockingServerTransport.h>
+#include <thrift/concurrency/AffinityThreadFactory.h>
 #include <thrift/concurrency/ThreadManager.h>
 #include <climits>
 #include <thrift/concurrency/Thread.h>
@@ -54,6 +62,7 @@ using apache::thrift::protocol::TProtocol;
 using apache::thrift::concurrency::Runnable;
 using apache::thrift::concurrency::ThreadManager;
 using apache::thrift::concurrency::ThreadFactory;
+using apache::thrift::concurrency::AffinityThreadFactory;
 using apache::thrift::concurrency::Thread;
 using apache::thrift::concurrency::Mutex;
 using apache::thrift::concurrency::Guard;
@@ -107,9 +116,21 @@ enum TOverloadAction {
   T_OVERLOAD_DRAIN_TASK_QUEUE ///< Drop some tasks from head of task queue */
 };
 
+/// How new connections are assigned to IO threads.
+enum TIOThreadAssignment {
+  T_IO_THREAD_ROUND_ROBIN,          ///< Each IO thread in turn */
+  T_IO_THREAD_LEAST_CONNECTIONS,    ///< The thread serving the fewest connections */
+  T_IO_THREAD_LEAST_RECENT_BYTES,   ///< The thread that moved the fewest bytes lately */
+  T_IO_THREAD_POWER_OF_TWO_CHOICES  ///< The less busy of two threads picked at random */
+};
+
 class TNonblockingIOThread;
 
 class TNonblockingServer : public TServer {
+public:
+  /// Returns the thread manager priority lane for a call to the named method.
+  typedef std::function<size_t(const std::string& name)> TaskLaneSelector;
+
 private:
   class TConnection;
 
@@ -158,9 +179,18 @@ private:
   /// The optional user-provided event-base (for single-thread servers)
   event_base* userEventBase_;
 
+  /// The event loop implementation the IO threads run
+  TEventLoopType eventLoopType_;
+
   /// For processing via thread pool, may be nullptr
   std::shared_ptr<ThreadManager> threadManager_;
 
+  /// Thread managers that IO threads hand calls to in turn, if not all to threadManager_
+  std::vector<std::shared_ptr<ThreadManager> > ioThreadThreadManagers_;
+
+  /// CPUs that IO threads are pinned to in turn, if any
+  std::vector<AffinityThreadFactory::CpuSet> ioThreadCpuSets_;
+
   /// Is thread pool processing?
   bool threadPoolProcessing_;
 
@@ -173,6 +203,12 @@ private:
   // Index of next IO Thread to be used (for round-robin)
   uint32_t nextIOThread_;
 
+  /// How connections are spread over the IO threads
+  TIOThreadAssignment ioThreadAssignment_;
+
+  /// Picks the candidates for T_IO_THREAD_POWER_OF_TWO_CHOICES
+  std::minstd_rand ioThreadRandom_;
+
   // Synchronizes access to connection stack and similar data
   Mutex connMutex_;
 
@@ -197,6 +233,9 @@ private:
   /// Time in milliseconds before an unperformed task expires (0 == infinite).
   int64_t taskExpireTime_;
 
+  /// Picks the thread manager priority lane of each call, if set
+  TaskLaneSelector taskLaneSelector_;
+
   /**
    * Hysteresis for overload state.  This is the fraction of the overload
    * value that needs to be reached before the overload state is cleared;
@@ -236,6 +275,12 @@ private:
    */
   int32_t resizeBufferEveryN_;
 
+  /// Block size of per-connection request arenas, 0 if disabled.
+  size_t arenaBlockSize_;
+
+  /// Bytes each IO thread's TBufferPool may park, 0 if pooling is disabled.
+  size_t bufferPoolLimit_;
+
   /// Set if we are currently in an overloaded state.
   bool overloaded_;
 
@@ -265,21 +310,30 @@ private:
   */
   std::shared_ptr<TNonblockingServerTransport> serverTransport_;
 
+  /// For processing calls asynchronously on the IO threads, may be nullptr
+  std::shared_ptr<async::TAsyncProcessorFactory> asyncProcessorFactory_;
+
+  /// Whether every IO thread accepts on its own SO_REUSEPORT socket
+  bool reusePortAcceptors_;
+
   /**
-   * Called when server socket had something happen.  We accept all waiting
+   * Called when a listen socket had something happen.  We accept all waiting
    * client connections on listen socket fd and assign TConnection objects
    * to handle those requests.
    *
+   * @param acceptor the IO thread that owns the listen socket.
    * @param which the event flag that triggered the handler.
    */
-  void handleEvent(THRIFT_SOCKET fd, short which);
+  void handleEvent(TNonblockingIOThread* acceptor, THRIFT_SOCKET fd, short which);
 
   void init() {
     serverSocket_ = THRIFT_INVALID_SOCKET;
     numIOThreads_ = DEFAULT_IO_THREADS;
     nextIOThread_ = 0;
+    ioThreadAssignment_ = T_IO_THREAD_ROUND_ROBIN;
     useHighPriorityIOThreads_ = false;
     userEventBase_ = nullptr;
+    eventLoopType_ = T_EVENT_LOOP_LIBEVENT;
     threadPoolProcessing_ = false;
     numTConnections_ = 0;
     numActiveProcessors_ = 0;
@@ -294,6 +348,9 @@ private:
     idleReadBufferLimit_ = IDLE_READ_BUFFER_LIMIT;
     idleWriteBufferLimit_ = IDLE_WRITE_BUFFER_LIMIT;
     resizeBufferEveryN_ = RESIZE_BUFFER_EVERY_N;
+    arenaBlockSize_ = 0;
+    bufferPoolLimit_ = 0;
+    reusePortAcceptors_ = false;
     overloaded_ = false;
     nConnectionsDropped_ = 0;
     nTotalConnectionsDropped_ = 0;
@@ -375,6 +432,37 @@ public:
     setThreadManager(threadManager);
   }
 
+  /**
+   * Serves calls with an async processor, such as a generated cob_style
+   * FooAsyncProcessor: the IO thread that read a call starts it and sends
+   * the reply once the processor's callback runs, in whichever thread that
+   * is, so the server has no thread pool and a call waiting on other work
+   * holds no thread.  Handlers must not block.
+   */
+  TNonblockingServer(const std::shared_ptr<async::TAsyncProcessorFactory>& asyncProcessorFactory,
+                     const std::shared_ptr<TProtocolFactory>& protocolFactory,
+                     const std::shared_ptr<apache::thrift::transport::TNonblockingServerTransport>& serverTransport)
+    : TServer(std::shared_ptr<TProcessorFactory>()),
+      serverTransport_(serverTransport),
+      asyncProcessorFactory_(asyncProcessorFactory) {
+    init();
+
+    setInputProtocolFactory(protocolFactory);
+    setOutputProtocolFactory(protocolFactory);
+  }
+
+  TNonblockingServer(const std::shared_ptr<async::TAsyncProcessor>& asyncProcessor,
+                     const std::shared_ptr<TProtocolFactory>& protocolFactory,
+                     const std::shared_ptr<apache::thrift::transport::TNonblockingServerTransport>& serverTransport)
+    : TServer(std::shared_ptr<TProcessorFactory>()),
+      serverTransport_(serverTransport),
+      asyncProcessorFactory_(std::make_shared<async::TAsyncSingletonProcessorFactory>(asyncProcessor)) {
+    init();
+
+    setInputProtocolFactory(protocolFactory);
+    setOutputProtocolFactory(protocolFactory);
+  }
+
   ~TNonblockingServer() override;
 
   void setThreadManager(std::shared_ptr<ThreadManager> threadManager);
@@ -383,6 +471,41 @@ public:
 
   std::shared_ptr<ThreadManager> getThreadManager() { return threadManager_; }
 
+  /**
+   * Set a thread manager for each IO thread: IO thread i hands its calls to
+   * threadManagers[i % threadManagers.size()].  With one thread manager per
+   * NUMA node, each with an AffinityThreadFactory for that node, and the IO
+   * threads pinned to the same nodes in the same order by
+   * setIOThreadCpuSets(), a call is read and run on the same node.
+   *
+   * The first thread manager also becomes getThreadManager().  An empty
+   * vector hands all calls back to that one.
+   */
+  void setIOThreadThreadManagers(const std::vector<std::shared_ptr<ThreadManager> >& threadManagers);
+
+  const std::vector<std::shared_ptr<ThreadManager> >& getIOThreadThreadManagers() const {
+    return ioThreadThreadManagers_;
+  }
+
+  /**
+   * Set the CPUs to pin IO threads to: IO thread i is pinned to
+   * cpuSets[i % cpuSets.size()] when it starts, before it allocates its
+   * buffers, so those are placed on its node.  IO thread 0 runs on the
+   * thread that calls serve(), which stays pinned.  Use
+   * AffinityThreadFactory::getNumaNodes() for one set per node.  Must be
+   * called before serve().
+   *
+   * @param cpuSets the CPUs for each IO thread in turn, or empty to leave
+   * them unpinned.
+   */
+  void setIOThreadCpuSets(const std::vector<AffinityThreadFactory::CpuSet>& cpuSets) {
+    ioThreadCpuSets_ = cpuSets;
+  }
+
+  const std::vector<AffinityThreadFactory::CpuSet>& getIOThreadCpuSets() const {
+    return ioThreadCpuSets_;
+  }
+
   /**
    * Sets the number of IO threads used by this server. Can only be used before
    * the call to serve() and has no effect afterwards.
@@ -393,6 +516,52 @@ public:
     assert(numIOThreads_ <= 1 || !userEventBase_);
   }
 
+  /** Return whether each IO thread accepts its own connections. */
+  bool getReusePortAcceptors() const { return reusePortAcceptors_; }
+
+  /**
+   * Give every IO thread its own listening socket on the server port, bound
+   * with SO_REUSEPORT, and have it serve the connections it accepts itself.
+   * The kernel then spreads new connections over the IO threads and no
+   * thread hands connections to another.  The server transport must support
+   * TNonblockingServerTransport::createReusePortPeer(), e.g. a
+   * TNonblockingServerSocket with setReusePort(true).  Can only be used
+   * before the call to serve().
+   */
+  void setReusePortAcceptors(bool val) { reusePortAcceptors_ = val; }
+
+  /** Return how new connections are assigned to IO threads. */
+  TIOThreadAssignment getIOThreadAssignment() const { return ioThreadAssignment_; }
+
+  /**
+   * Set how new connections are assigned to IO threads.  Round robin, the
+   * default, ignores load, so a few long-lived busy clients can end up
+   * sharing one thread.  The other policies look at the number of
+   * connections each thread serves or the bytes it has moved lately, and
+   * break ties round robin.  Has no effect with setReusePortAcceptors(),
+   * where each thread serves what it accepts.
+   */
+  void setIOThreadAssignment(TIOThreadAssignment assignment) { ioThreadAssignment_ = assignment; }
+
+  /**
+   * Return the number of connections IO thread id is serving, or 0 if there
+   * is no such thread (yet).
+   */
+  size_t getNumIOThreadConnections(size_t id) const;
+
+  /** Return the event loop implementation the IO threads run. */
+  TEventLoopType getEventLoopType() const { return eventLoopType_; }
+
+  /**
+   * Set the event loop implementation the IO threads run.  The default is
+   * libevent; T_EVENT_LOOP_EPOLL drives epoll directly, which saves the
+   * libevent bookkeeping around every change of a connection's interest.
+   * serve() throws TException if the type is not available on this
+   * platform.  A user-provided event base always uses libevent.  Can only
+   * be used before the call to serve().
+   */
+  void setEventLoopType(TEventLoopType type) { eventLoopType_ = type; }
+
   /** Return whether the IO threads will get high scheduling priority */
   bool useHighPriorityIOThreads() const { return useHighPriorityIOThreads_; }
 
@@ -418,8 +587,26 @@ public:
 
   bool isThreadPoolProcessing() const { return threadPoolProcessing_; }
 
-  void addTask(std::shared_ptr<Runnable> task) {
-    threadManager_->add(task, 0LL, taskExpireTime_);
+  /// Whether calls go to an async processor rather than a TProcessor.
+  bool isAsyncProcessing() const { return asyncProcessorFactory_ != nullptr; }
+
+  std::shared_ptr<async::TAsyncProcessor> getAsyncProcessor(std::shared_ptr<TProtocol> inputProtocol,
+                                                            std::shared_ptr<TProtocol> outputProtocol,
+                                                            std::shared_ptr<TTransport> transport) {
+    TConnectionInfo connInfo;
+    connInfo.input = inputProtocol;
+    connInfo.output = outputProtocol;
+    connInfo.transport = transport;
+    return asyncProcessorFactory_->getProcessor(connInfo);
+  }
+
+  void addTask(std::shared_ptr<Runnable> task, size_t lane = 0, int ioThreadNumber = 0) {
+    ThreadManager* threadManager = threadManager_.get();
+    if (!ioThreadThreadManagers_.empty()) {
+      threadManager
+          = ioThreadThreadManagers_[ioThreadNumber % ioThreadThreadManagers_.size()].get();
+    }
+    threadManager->addToLane(lane, task, 0LL, taskExpireTime_);
   }
 
   /**
@@ -561,6 +748,30 @@ public:
    */
   void setTaskExpireTime(int64_t taskExpireTime) { taskExpireTime_ = taskExpireTime; }
 
+  /**
+   * Get the function that picks the priority lane of each call.
+   *
+   * @return the selector, empty if calls all go to lane 0.
+   */
+  const TaskLaneSelector& getTaskLaneSelector() const { return taskLaneSelector_; }
+
+  /**
+   * Set a function that is given the method name of each call and returns
+   * the thread manager priority lane to run it in, so that, for instance,
+   * cheap calls are not stuck behind a backlog of expensive ones.  The
+   * thread manager must have been given that many lanes with
+   * ThreadManager::setPriorityLanes().
+   *
+   * The name is read from the start of the frame with the input protocol
+   * before the call is queued; calls that cannot be read that way, and all
+   * calls when the header transport is in use, go to lane 0.
+   *
+   * @param taskLaneSelector the selector, or empty for lane 0 always.
+   */
+  void setTaskLaneSelector(TaskLaneSelector taskLaneSelector) {
+    taskLaneSelector_ = std::move(taskLaneSelector);
+  }
+
   /**
    * Determine if the server is currently overloaded.
    * This function checks the maximums for open connections and connections
@@ -664,6 +875,51 @@ public:
    */
   void setResizeBufferEveryN(int32_t count) { resizeBufferEveryN_ = count; }
 
+  /**
+   * Get the block size of per-connection request arenas.  0 means disabled.
+   *
+   * @return the arena block size in bytes.
+   */
+  size_t getRequestArenaBlockSize() const { return arenaBlockSize_; }
+
+  /**
+   * Give each connection a TArena that is current while its requests are
+   * processed and reset before each one, so that types generated with
+   * cpp:arena are allocated from it.  The arena is freed when the connection
+   * closes.  Only affects connections opened after the call.
+   *
+   * @param blockSize the arena block size in bytes, or 0 to disable
+   */
+  void setRequestArenaBlockSize(size_t blockSize) { arenaBlockSize_ = blockSize; }
+
+  /**
+   * Get the number of bytes each IO thread's buffer pool may hold.  0 means
+   * pooling is disabled.
+   *
+   * @return the per-thread pool limit in bytes.
+   */
+  size_t getBufferPoolLimit() const { return bufferPoolLimit_; }
+
+  /**
+   * Have connections borrow their read and write buffers from a per-IO-thread
+   * TBufferPool while a request is in flight, and give them back once the
+   * response has been sent, so that idle connections hold no buffers.  The
+   * idle buffer limits and resize checks do not apply to pooled connections.
+   * Must be called before serve().
+   *
+   * @param limit bytes of idle buffers each IO thread may keep, or 0 to
+   *              give every connection buffers of its own
+   */
+  void setBufferPoolLimit(size_t limit) { bufferPoolLimit_ = limit; }
+
+  /**
+   * Return the occupancy of the IO threads' buffer pools, summed.  Empty if
+   * pooling is disabled or the server is not running.
+   *
+   * @return the combined pool statistics.
+   */
+  TBufferPoolStats getBufferPoolStats() const;
+
   /**
    * Main workhorse function, starts up the server listening on a port and
    * loops over the libevent handler.
@@ -714,11 +970,12 @@ private:
    * and flags.
    *
    * @param socket FD of socket associated with this connection.
-   * @param addr the sockaddr of the client
-   * @param addrLen the length of addr
+   * @param ioThread the IO thread to serve the connection, or nullptr to
+   *                 assign one round robin.
    * @return pointer to initialized TConnection object.
    */
-  TConnection* createConnection(std::shared_ptr<TSocket> socket);
+  TConnection* createConnection(std::shared_ptr<TSocket> socket,
+                                TNonblockingIOThread* ioThread);
 
   /**
    * Returns a connection to pool or deletion.  If the connection pool
@@ -728,22 +985,37 @@ private:
    * @param connection the TConection being returned.
    */
   void returnConnection(TConnection* connection);
+
+  /**
+   * Chooses the IO thread for a new connection according to
+   * ioThreadAssignment_.  Called with connMutex_ held.
+   */
+  TNonblockingIOThread* selectIOThread();
 };
 
 class TNonblockingIOThread : public Runnable {
 public:
   // Creates an IO thread and sets up the event base.  The listenSocket should
   // be a valid FD on which listen() has already been called.  If the
-  // listenSocket is < 0, accepting will not be done.
+  // listenSocket is < 0, accepting will not be done.  A listenTransport
+  // owns listenSocket and accepts on it instead of the server's transport.
   TNonblockingIOThread(TNonblockingServer* server,
                        int number,
                        THRIFT_SOCKET listenSocket,
-                       bool useHighPriority);
+                       bool useHighPriority,
+                       std::shared_ptr<TNonblockingServerTransport> listenTransport
+                       = std::shared_ptr<TNonblockingServerTransport>());
 
   ~TNonblockingIOThread() override;
 
   // Returns the event-base for this thread.
-  event_base* getEventBase() const { return eventBase_; }
+  event_base* getEventBase() const {
+    return eventLoop_ ? eventLoop_->getEventBase() : nullptr;
+  }
+
+  // Returns the event loop for this thread, or nullptr before
+  // registerEvents().
+  TEventLoop* getEventLoop() const { return eventLoop_.get(); }
 
   // Returns the server for this thread.
   TNonblockingServer* getServer() const { return server_; }
@@ -761,13 +1033,42 @@ public:
   // Returns the read-fd for task complete notifications.
   evutil_socket_t getNotificationRecvFD() const { return notificationPipeFDs_[0]; }
 
+  // Returns the pool connections on this thread borrow buffers from, or
+  // nullptr if pooling is disabled.
+  TBufferPool* getBufferPool() const { return bufferPool_.get(); }
+
+  // Returns the transport this thread accepts on, or nullptr if it uses the
+  // server's (or does not accept).
+  std::shared_ptr<TNonblockingServerTransport> getListenTransport() const {
+    return listenTransport_;
+  }
+
+  // Returns the number of connections this thread is serving.
+  uint32_t getNumConnections() const { return numConnections_.load(std::memory_order_relaxed); }
+
+  // Returns the bytes this thread's connections have read and written,
+  // halved for every RECENT_BYTES_HALF_LIFE_MS that has passed.
+  uint64_t getRecentBytes() const;
+
+  // Used by TConnection objects as they are assigned to this thread and
+  // leave it again.
+  void addConnection() { numConnections_.fetch_add(1, std::memory_order_relaxed); }
+  void removeConnection() { numConnections_.fetch_sub(1, std::memory_order_relaxed); }
+
+  // Used by TConnection objects to account for data they move.  Only
+  // called from this IO thread.
+  void addRecentBytes(uint32_t bytes);
+
   // Returns the actual thread object associated with this IO thread.
   std::shared_ptr<Thread> getThread() const { return thread_; }
 
   // Sets the actual thread object associated with this IO thread.
   void setThread(const std::shared_ptr<Thread>& t) { thread_ = t; }
 
-  // Used by TConnection objects to indicate processing has finished.
+  // Used by TConnection objects to indicate processing has finished.  The
+  // connection is queued and the IO thread woken if the queue was empty.
+  // Passing nullptr asks the thread to stop.  Returns false if the thread
+  // is not accepting notifications yet.
   bool notify(TNonblockingServer::TConnection* conn);
 
   // Enters the event loop and does not return until a call to stop().
@@ -785,13 +1086,13 @@ public:
 private:
   /**
    * C-callable event handler for signaling task completion.  Provides a
-   * callback that libevent can understand that will read a connection
-   * object's address from a pipe and call connection->transition() for
-   * that object.
+   * callback that libevent can understand that will clear the wake-up
+   * descriptor, take every connection queued by notify() and call
+   * connection->transition() on each, in the order they completed.
    *
    * @param fd the descriptor the event occurred on.
    */
-  static void notifyHandler(evutil_socket_t fd, short which, void* v);
+  static void notifyHandler(THRIFT_SOCKET fd, short which, void* v);
 
   /**
    * C-callable event handler for listener events.  Provides a callback
@@ -799,18 +1100,27 @@ private:
    *
    * @param fd the descriptor the event occurred on.
    * @param which the flags associated with the event.
-   * @param v void* callback arg where we placed TNonblockingServer's "this".
+   * @param v void* callback arg where we placed TNonblockingIOThread's "this".
    */
-  static void listenHandler(evutil_socket_t fd, short which, void* v) {
-    ((TNonblockingServer*)v)->handleEvent(fd, which);
+  static void listenHandler(THRIFT_SOCKET fd, short which, void* v) {
+    auto* ioThread = (TNonblockingIOThread*)v;
+    ioThread->server_->handleEvent(ioThread, fd, which);
   }
 
   /// Exits the loop ASAP in case of shutdown or error.
   void breakLoop(bool error);
 
-  /// Create the pipe used to notify I/O process of task completion.
+  /// Create the eventfd (or pipe, where there is none) that wakes the
+  /// I/O thread when completed connections are queued.
   void createNotificationPipe();
 
+  /// Signal the notification descriptor.
+  bool wakeUp();
+
+  /// Consume pending signals on the notification descriptor.  Returns false
+  /// if it has been closed.
+  bool clearWakeUp();
+
   /// Unregisters our events for notification and listen sockets.
   void cleanupEvents();
 
@@ -818,6 +1128,9 @@ private:
   void setCurrentThreadHighPriority(bool value);
 
 private:
+  /// How quickly getRecentBytes() forgets old traffic
+  static const int64_t RECENT_BYTES_HALF_LIFE_MS = 1000;
+
   /// associated server
   TNonblockingServer* server_;
 
@@ -830,25 +1143,44 @@ private:
   /// If listenSocket_ >= 0, adds an event on the event_base to accept conns
   THRIFT_SOCKET listenSocket_;
 
+  /// Owner of listenSocket_ when it is not the server's transport
+  std::shared_ptr<TNonblockingServerTransport> listenTransport_;
+
   /// Sets a high scheduling priority when running
   bool useHighPriority_;
 
-  /// pointer to eventbase to be used for looping
-  event_base* eventBase_;
-
-  /// Set to true if this class is responsible for freeing the event base
-  /// memory.
-  bool ownEventBase_;
+  /// the loop this thread runs, created by registerEvents()
+  std::unique_ptr<TEventLoop> eventLoop_;
 
-  /// Used with eventBase_ for connection events (only in listener thread)
-  struct event serverEvent_;
+  /// Used with eventLoop_ for connection events (only in listening threads)
+  TEventWatch serverEvent_;
 
-  /// Used with eventBase_ for task completion notification
-  struct event notificationEvent_;
+  /// Used with eventLoop_ for task completion notification
+  TEventWatch notificationEvent_;
 
-  /// File descriptors for pipe used for task completion notification.
+  /// File descriptors for pipe used for task completion notification.  Both
+  /// hold the same eventfd where that is available.
   evutil_socket_t notificationPipeFDs_[2];
 
+  /// Connections whose processing has finished, most recent first, linked
+  /// through TConnection::nextCompleted_.  Pushed to by any thread, taken
+  /// as a whole by the IO thread.
+  std::atomic<TNonblockingServer::TConnection*> completed_;
+
+  /// Connections assigned to this thread and not yet closed
+  std::atomic<uint32_t> numConnections_;
+
+  /// Bytes moved since recentBytesTime_, decayed as of recentBytesTime_.
+  /// Written only by this thread, read by the one assigning connections.
+  std::atomic<uint64_t> recentBytes_;
+  std::atomic<int64_t> recentBytesTime_;
+
+  /// Set by notify(nullptr)
+  std::atomic<bool> stopRequested_;
+
+  /// Buffers for this thread's connections, if pooling is enabled
+  std::unique_ptr<TBufferPool> bufferPool_;
+
   /// Actual IO Thread
   std::shared_ptr<Thread> thread_;
 };
@@ -121,6 +121,21 @@ public:
    */
   virtual void setConcurrentClientLimit(int64_t newLimit);
 
+  /**
+   * Get the block size of the per-connection request arena.
+   * \returns the block size in bytes, or 0 if request arenas are disabled
+   */
+  size_t getRequestArenaBlockSize() const { return arenaBlockSize_; }
+
+  /**
+   * Give each connected client a TArena that is current while a request is
+   * processed and reset before the next one, so that types generated with
+   * cpp:arena are allocated from it.  Only affects clients accepted after
+   * the call.  The default of 0 disables request arenas.
+   * \param[in]  blockSize  the arena block size in bytes, or 0
+   */
+  void setRequestArenaBlockSize(size_t blockSize) { arenaBlockSize_ = blockSize; }
+
 protected:
   /**
    * A client has connected.  The implementation is responsible for managing the
@@ -176,6 +191,11 @@ private:
    * The limit on the number of concurrent clients.
    */
   int64_t limit_;
+
+  /**
+   * The block size of per-connection request arenas, 0 if disabled.
+   */
+  size_t arenaBlockSize_;
 };
 }
 }
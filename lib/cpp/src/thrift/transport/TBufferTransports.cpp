@@ -87,12 +87,20 @@ void TBufferedTransport::writeSlow(const uint8_t* buf, uint32_t len) {
   // This case also covers the case where the buffer is empty,
   // but it is clearer (I think) to think of it as two separate cases.
   if ((have_bytes + len >= 2 * wBufSize_) || (have_bytes == 0)) {
-    // TODO(dreiss): writev
+    // Reset wBase_ first so the buffer is sane if the write throws.
+    wBase_ = wBuf_.get();
     if (have_bytes > 0) {
-      transport_->write(wBuf_.get(), have_bytes);
+      // Hand both pieces to the underlying transport at once so that
+      // descriptor-backed transports can send them with a single writev.
+      TIOVec iov[2];
+      iov[0].base = wBuf_.get();
+      iov[0].len = have_bytes;
+      iov[1].base = buf;
+      iov[1].len = len;
+      transport_->writev(iov, 2);
+    } else {
+      transport_->write(buf, len);
     }
-    transport_->write(buf, len);
-    wBase_ = wBuf_.get();
     return;
   }
 
@@ -148,6 +156,7 @@ uint32_t TFramedTransport::readSlow(uint8_t* buf, uint32_t len) {
   if (have > 0) {
     memcpy(buf, rBase_, have);
     setReadBuffer(rBuf_.get(), 0);
+    raFrame_ = nullptr;
     return have;
   }
 
@@ -169,8 +178,9 @@ uint32_t TFramedTransport::readSlow(uint8_t* buf, uint32_t len) {
 }
 
 bool TFramedTransport::readFrame() {
-  // TODO(dreiss): Think about using readv here, even though it would
-  // result in (gasp) read-ahead.
+  if (raBufSize_ > 0) {
+    return readFrameFromReadAhead();
+  }
 
   // Read the size of the next frame.
   // We can't use readAll(&sz, sizeof(sz)), since that always throws an
@@ -216,6 +226,108 @@ bool TFramedTransport::readFrame() {
   return true;
 }
 
+void TFramedTransport::setReadAheadBufferSize(uint32_t size) {
+  if (size > 0 && size <= sizeof(int32_t)) {
+    throw TTransportException(TTransportException::BAD_ARGS,
+                              "Read-ahead buffer must be larger than a frame header.");
+  }
+  if (raStart_ < raEnd_) {
+    throw TTransportException(TTransportException::BAD_ARGS,
+                              "Cannot resize read-ahead buffer holding unread data.");
+  }
+  if (raFrame_ != nullptr) {
+    // The current frame lives in the old read-ahead buffer.  Move what is
+    // left of it into rBuf_ so it survives the resize.
+    auto have = static_cast<uint32_t>(rBound_ - rBase_);
+    if (have > rBufSize_) {
+      rBuf_.reset(new uint8_t[have]);
+      rBufSize_ = have;
+    }
+    if (have > 0) {
+      memcpy(rBuf_.get(), rBase_, have);
+    }
+    setReadBuffer(rBuf_.get(), have);
+    raFrame_ = nullptr;
+  }
+  raBuf_.reset(size > 0 ? new uint8_t[size] : nullptr);
+  raBufSize_ = size;
+  raStart_ = 0;
+  raEnd_ = 0;
+}
+
+bool TFramedTransport::fillReadAhead() {
+  // Slide any partial frame down to the front of the buffer.  Only the tail
+  // end of a batch is ever moved, so this is cheap.
+  if (raStart_ > 0) {
+    memmove(raBuf_.get(), raBuf_.get() + raStart_, raEnd_ - raStart_);
+    raEnd_ -= raStart_;
+    raStart_ = 0;
+  }
+  uint32_t got = transport_->read(raBuf_.get() + raEnd_, raBufSize_ - raEnd_);
+  raEnd_ += got;
+  return got > 0;
+}
+
+bool TFramedTransport::readFrameFromReadAhead() {
+  // The previous frame, if it came from raBuf_, has been fully consumed.
+  raFrame_ = nullptr;
+
+  int32_t sz = -1;
+  while (raEnd_ - raStart_ < sizeof(sz)) {
+    if (!fillReadAhead()) {
+      if (raEnd_ == raStart_) {
+        // EOF before any data was read.
+        return false;
+      }
+      // EOF after a partial frame header.  Raise an exception.
+      throw TTransportException(TTransportException::END_OF_FILE,
+                                "No more data to read after "
+                                "partial frame header.");
+    }
+  }
+
+  memcpy(&sz, raBuf_.get() + raStart_, sizeof(sz));
+  sz = ntohl(sz);
+
+  if (sz < 0) {
+    throw TTransportException("Frame size has negative value");
+  }
+
+  // Check for oversized frame
+  if (sz > static_cast<int32_t>(maxFrameSize_))
+    throw TTransportException(TTransportException::CORRUPTED_DATA, "Received an oversized frame");
+
+  auto frameSize = static_cast<uint32_t>(sz);
+  if (frameSize <= raBufSize_ - sizeof(sz)) {
+    // The frame fits in the read-ahead buffer: serve it from there.
+    while (raEnd_ - raStart_ < sizeof(sz) + frameSize) {
+      if (!fillReadAhead()) {
+        throw TTransportException(TTransportException::END_OF_FILE,
+                                  "No more data to read after "
+                                  "partial frame.");
+      }
+    }
+    raFrame_ = raBuf_.get() + raStart_ + sizeof(sz);
+    raStart_ += static_cast<uint32_t>(sizeof(sz)) + frameSize;
+    setReadBuffer(raFrame_, frameSize);
+    return true;
+  }
+
+  // Too big for read-ahead.  Take what is already buffered and read the
+  // rest of the payload directly.
+  raStart_ += static_cast<uint32_t>(sizeof(sz));
+  if (frameSize > rBufSize_) {
+    rBuf_.reset(new uint8_t[frameSize]);
+    rBufSize_ = frameSize;
+  }
+  uint32_t have = raEnd_ - raStart_;
+  memcpy(rBuf_.get(), raBuf_.get() + raStart_, have);
+  raStart_ = raEnd_ = 0;
+  transport_->readAll(rBuf_.get() + have, frameSize - have);
+  setReadBuffer(rBuf_.get(), frameSize);
+  return true;
+}
+
 void TFramedTransport::writeSlow(const uint8_t* buf, uint32_t len) {
   // Double buffer size until sufficient.
   auto have = static_cast<uint32_t>(wBase_ - wBuf_.get());
@@ -299,12 +411,15 @@ const uint8_t* TFramedTransport::borrowSlow(uint8_t* buf, uint32_t* len) {
 
 uint32_t TFramedTransport::readEnd() {
   // include framing bytes
-  auto bytes_read = static_cast<uint32_t>(rBound_ - rBuf_.get() + sizeof(uint32_t));
+  const uint8_t* frame = raFrame_ != nullptr ? raFrame_ : rBuf_.get();
+  auto bytes_read = static_cast<uint32_t>(rBound_ - frame + sizeof(uint32_t));
 
   if (rBufSize_ > bufReclaimThresh_) {
     rBufSize_ = 0;
     rBuf_.reset();
-    setReadBuffer(rBuf_.get(), rBufSize_);
+    if (raFrame_ == nullptr) {
+      setReadBuffer(rBuf_.get(), rBufSize_);
+    }
   }
 
   return bytes_read;
@@ -323,7 +323,11 @@ public:
       wBufSize_(DEFAULT_BUFFER_SIZE),
       rBuf_(),
       wBuf_(new uint8_t[wBufSize_]),
-      bufReclaimThresh_((std::numeric_limits<uint32_t>::max)()) {
+      bufReclaimThresh_((std::numeric_limits<uint32_t>::max)()),
+      raBufSize_(0),
+      raStart_(0),
+      raEnd_(0),
+      raFrame_(nullptr) {
     initPointers();
   }
 
@@ -335,7 +339,11 @@ public:
       rBuf_(),
       wBuf_(new uint8_t[wBufSize_]),
       bufReclaimThresh_((std::numeric_limits<uint32_t>::max)()),
-      maxFrameSize_(configuration_->getMaxFrameSize()) {
+      maxFrameSize_(configuration_->getMaxFrameSize()),
+      raBufSize_(0),
+      raStart_(0),
+      raEnd_(0),
+      raFrame_(nullptr) {
     initPointers();
   }
 
@@ -350,7 +358,11 @@ public:
       rBuf_(),
       wBuf_(new uint8_t[wBufSize_]),
       bufReclaimThresh_(bufReclaimThresh),
-      maxFrameSize_(configuration_->getMaxFrameSize()) {
+      maxFrameSize_(configuration_->getMaxFrameSize()),
+      raBufSize_(0),
+      raStart_(0),
+      raEnd_(0),
+      raFrame_(nullptr) {
     initPointers();
   }
 
@@ -358,7 +370,9 @@ public:
 
   bool isOpen() const override { return transport_->isOpen(); }
 
-  bool peek() override { return (rBase_ < rBound_) || transport_->peek(); }
+  bool peek() override {
+    return (rBase_ < rBound_) || (raStart_ < raEnd_) || transport_->peek();
+  }
 
   void close() override {
     flush();
@@ -377,6 +391,14 @@ public:
 
   const uint8_t* borrowSlow(uint8_t* buf, uint32_t* len) override;
 
+  /**
+   * A frame stays in the read buffer until the next one is read, unless
+   * readEnd() may reclaim the buffer.
+   */
+  bool canLendReadBuffer() const override {
+    return bufReclaimThresh_ == (std::numeric_limits<uint32_t>::max)();
+  }
+
   std::shared_ptr<TTransport> getUnderlyingTransport() { return transport_; }
 
   /*
@@ -400,6 +422,27 @@ public:
    */
   uint32_t getMaxFrameSize() { return maxFrameSize_; }
 
+  /**
+   * Enable read-ahead framing with a buffer of the given size, or disable it
+   * with a size of 0.
+   *
+   * By default each frame costs two reads on the underlying transport: one
+   * for the length and one for the payload.  With read-ahead enabled the
+   * transport instead reads as much as the underlying transport will give it
+   * into the read-ahead buffer and carves successive frames out of that, so
+   * a client pipelining many small frames costs one read per batch.  Frames
+   * that do not fit in the buffer are read directly as before.
+   *
+   * Only use this when the underlying transport returns whatever is
+   * available from read() without waiting for the full request, as sockets
+   * do.
+   *
+   * @throws TTransportException(BAD_ARGS) if read-ahead data would be lost
+   */
+  void setReadAheadBufferSize(uint32_t size);
+
+  uint32_t getReadAheadBufferSize() const { return raBufSize_; }
+
 protected:
   /**
    * Reads a frame of input from the underlying stream.
@@ -409,6 +452,17 @@ protected:
    */
   virtual bool readFrame();
 
+  /**
+   * readFrame() implementation used when read-ahead is enabled.
+   */
+  bool readFrameFromReadAhead();
+
+  /**
+   * Makes room at the end of the read-ahead buffer and reads into it once.
+   * Returns false on EOF.
+   */
+  bool fillReadAhead();
+
   void initPointers() {
     setReadBuffer(nullptr, 0);
     setWriteBuffer(wBuf_.get(), wBufSize_);
@@ -426,6 +480,14 @@ protected:
   boost::scoped_array<uint8_t> wBuf_;
   uint32_t bufReclaimThresh_;
   uint32_t maxFrameSize_;
+
+  // Read-ahead buffer; unread bytes are [raStart_, raEnd_).
+  boost::scoped_array<uint8_t> raBuf_;
+  uint32_t raBufSize_;
+  uint32_t raStart_;
+  uint32_t raEnd_;
+  // Start of the current frame if it is being served from raBuf_.
+  uint8_t* raFrame_;
 };
 
 /**
@@ -434,7 +496,15 @@ protected:
  */
 class TFramedTransportFactory : public TTransportFactory {
 public:
-  TFramedTransportFactory() = default;
+  TFramedTransportFactory() : readAheadBufferSize_(0) {}
+
+  /**
+   * Creates framed transports with read-ahead enabled.
+   *
+   * @see TFramedTransport::setReadAheadBufferSize()
+   */
+  explicit TFramedTransportFactory(uint32_t readAheadBufferSize)
+    : readAheadBufferSize_(readAheadBufferSize) {}
 
   ~TFramedTransportFactory() override = default;
 
@@ -442,8 +512,15 @@ public:
    * Wraps the transport into a framed one.
    */
   std::shared_ptr<TTransport> getTransport(std::shared_ptr<TTransport> trans) override {
-    return std::shared_ptr<TTransport>(new TFramedTransport(trans));
+    std::shared_ptr<TFramedTransport> framed(new TFramedTransport(trans));
+    if (readAheadBufferSize_ > 0) {
+      framed->setReadAheadBufferSize(readAheadBufferSize_);
+    }
+    return framed;
   }
+
+private:
+  uint32_t readAheadBufferSize_;
 };
 
 /**
@@ -576,6 +653,12 @@ public:
 
   void close() override {}
 
+  /**
+   * Read data stays where it is until the buffer is written to, reset or
+   * destroyed.
+   */
+  bool canLendReadBuffer() const override { return true; }
+
   // TODO(dreiss): Make bufPtr const.
   void getBuffer(uint8_t** bufPtr, uint32_t* sz) {
     *bufPtr = rBase_;
@@ -615,6 +698,22 @@ public:
 
   /// See constructor documentation.
   void resetBuffer(uint8_t* buf, uint32_t sz, MemoryPolicy policy = OBSERVE) {
+    if (policy == OBSERVE) {
+      // Observing needs no storage of our own, so switch over in place
+      // rather than construct a temporary, which allocates its TConfiguration.
+      if (buf == nullptr && sz != 0) {
+        throw TTransportException(TTransportException::BAD_ARGS,
+                                  "TMemoryBuffer given null buffer with non-zero size.");
+      }
+      if (owner_) {
+        std::free(buffer_);
+      }
+      uint32_t maxBufferSize = maxBufferSize_;
+      initCommon(buf, sz, false, sz);
+      maxBufferSize_ = maxBufferSize;
+      return;
+    }
+
     // Use a variant of the copy-and-swap trick for assignment operators.
     // This is sub-optimal in terms of performance for two reasons:
     //   1/ The constructing and swapping of the (small) values
@@ -643,6 +742,21 @@ public:
     // Our old self gets destroyed.
   }
 
+  /**
+   * Detaches the storage from this buffer, leaving it empty as if by
+   * resetBuffer(0).  If the storage was owned, the caller takes over
+   * freeing it with std::free(); otherwise nullptr is returned.
+   *
+   * @param sz receives the capacity of the returned storage.
+   */
+  uint8_t* releaseBuffer(uint32_t* sz) {
+    uint8_t* buf = owner_ ? buffer_ : nullptr;
+    *sz = owner_ ? bufferSize_ : 0;
+    owner_ = false;
+    resetBuffer(0);
+    return buf;
+  }
+
   std::string readAsString(uint32_t len) {
     std::string str;
     (void)readAppendToString(str, len);
@@ -0,0 +1,237 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include <thrift/transport/TChainedMemoryBuffer.h>
+
+using apache::thrift::concurrency::Guard;
+
+namespace apache {
+namespace thrift {
+namespace transport {
+
+TBufferSegmentPool::TBufferSegmentPool(uint32_t segmentSize, uint32_t maxFreeSegments)
+  : segmentSize_(segmentSize), maxFreeSegments_(maxFreeSegments) {
+  if (segmentSize_ == 0) {
+    throw TTransportException(TTransportException::BAD_ARGS,
+                              "TBufferSegmentPool segment size must be non-zero");
+  }
+}
+
+TBufferSegmentPool::~TBufferSegmentPool() {
+  for (auto segment : free_) {
+    delete[] segment;
+  }
+}
+
+uint8_t* TBufferSegmentPool::allocate() {
+  {
+    Guard g(mutex_);
+    if (!free_.empty()) {
+      uint8_t* segment = free_.back();
+      free_.pop_back();
+      return segment;
+    }
+  }
+  return new uint8_t[segmentSize_];
+}
+
+void TBufferSegmentPool::release(uint8_t* segment) {
+  {
+    Guard g(mutex_);
+    if (free_.size() < maxFreeSegments_) {
+      free_.push_back(segment);
+      return;
+    }
+  }
+  delete[] segment;
+}
+
+size_t TBufferSegmentPool::getFreeSegmentCount() const {
+  Guard g(mutex_);
+  return free_.size();
+}
+
+TChainedMemoryBuffer::TChainedMemoryBuffer(std::shared_ptr<TConfiguration> config)
+  : TVirtualTransport(config), pool_(std::make_shared<TBufferSegmentPool>()) {
+  initCommon();
+}
+
+TChainedMemoryBuffer::TChainedMemoryBuffer(std::shared_ptr<TBufferSegmentPool> pool,
+                                           std::shared_ptr<TConfiguration> config)
+  : TVirtualTransport(config), pool_(pool) {
+  if (!pool_) {
+    throw TTransportException(TTransportException::BAD_ARGS,
+                              "TChainedMemoryBuffer given null segment pool.");
+  }
+  initCommon();
+}
+
+TChainedMemoryBuffer::~TChainedMemoryBuffer() {
+  for (auto& segment : segments_) {
+    pool_->release(segment.data);
+  }
+}
+
+void TChainedMemoryBuffer::initCommon() {
+  releasedBytes_ = 0;
+  appendSegment();
+  setReadBuffer(segments_.front().data, 0);
+}
+
+void TChainedMemoryBuffer::appendSegment() {
+  if (!segments_.empty()) {
+    segments_.back().len = static_cast<uint32_t>(wBase_ - segments_.back().data);
+  }
+  Segment segment;
+  segment.data = pool_->allocate();
+  segment.len = 0;
+  segments_.push_back(segment);
+  setWriteBuffer(segment.data, pool_->getSegmentSize());
+}
+
+void TChainedMemoryBuffer::advanceReadSegment() {
+  for (;;) {
+    rBound_ = segmentEnd(0);
+    if (rBase_ < rBound_ || segments_.size() == 1) {
+      return;
+    }
+    releasedBytes_ += segments_.front().len;
+    pool_->release(segments_.front().data);
+    segments_.pop_front();
+    rBase_ = segments_.front().data;
+  }
+}
+
+void TChainedMemoryBuffer::resetBuffer() {
+  while (segments_.size() > 1) {
+    pool_->release(segments_.back().data);
+    segments_.pop_back();
+  }
+  releasedBytes_ = 0;
+  segments_.front().len = 0;
+  setReadBuffer(segments_.front().data, 0);
+  setWriteBuffer(segments_.front().data, pool_->getSegmentSize());
+}
+
+uint32_t TChainedMemoryBuffer::available_read() const {
+  uint64_t have = segmentEnd(0) - rBase_;
+  for (size_t i = 1; i < segments_.size(); ++i) {
+    have += segmentEnd(i) - segments_[i].data;
+  }
+  return static_cast<uint32_t>(have);
+}
+
+void TChainedMemoryBuffer::getReadableSegments(std::vector<TIOVec>& iov) const {
+  for (size_t i = 0; i < segments_.size(); ++i) {
+    const uint8_t* start = (i == 0) ? rBase_ : segments_[i].data;
+    const uint8_t* end = segmentEnd(i);
+    if (end > start) {
+      TIOVec v;
+      v.base = start;
+      v.len = static_cast<uint32_t>(end - start);
+      iov.push_back(v);
+    }
+  }
+}
+
+std::string TChainedMemoryBuffer::getBufferAsString() const {
+  std::string str;
+  appendBufferToString(str);
+  return str;
+}
+
+void TChainedMemoryBuffer::appendBufferToString(std::string& str) const {
+  std::vector<TIOVec> iov;
+  getReadableSegments(iov);
+  str.reserve(str.size() + available_read());
+  for (auto& v : iov) {
+    str.append(reinterpret_cast<const char*>(v.base), v.len);
+  }
+}
+
+void TChainedMemoryBuffer::writeTo(TTransport& trans) {
+  std::vector<TIOVec> iov;
+  getReadableSegments(iov);
+  if (!iov.empty()) {
+    trans.writev(&iov[0], static_cast<uint32_t>(iov.size()));
+  }
+  resetBuffer();
+}
+
+uint32_t TChainedMemoryBuffer::readSlow(uint8_t* buf, uint32_t len) {
+  uint32_t got = 0;
+  while (got < len) {
+    advanceReadSegment();
+    uint32_t give = (std::min)(len - got, static_cast<uint32_t>(rBound_ - rBase_));
+    if (give == 0) {
+      break;
+    }
+    std::memcpy(buf + got, rBase_, give);
+    rBase_ += give;
+    got += give;
+  }
+  return got;
+}
+
+void TChainedMemoryBuffer::writeSlow(const uint8_t* buf, uint32_t len) {
+  while (len > 0) {
+    if (wBase_ == wBound_) {
+      appendSegment();
+    }
+    uint32_t give = (std::min)(len, static_cast<uint32_t>(wBound_ - wBase_));
+    std::memcpy(wBase_, buf, give);
+    wBase_ += give;
+    buf += give;
+    len -= give;
+  }
+}
+
+const uint8_t* TChainedMemoryBuffer::borrowSlow(uint8_t* buf, uint32_t* len) {
+  (void)buf;
+  advanceReadSegment();
+  if (static_cast<ptrdiff_t>(*len) <= rBound_ - rBase_) {
+    *len = static_cast<uint32_t>(rBound_ - rBase_);
+    return rBase_;
+  }
+  // The bytes span a segment boundary.  Let the protocol use its slow path.
+  return nullptr;
+}
+
+uint32_t TChainedMemoryBuffer::readEnd() {
+  auto bytes = static_cast<uint32_t>(releasedBytes_ + (rBase_ - segments_.front().data));
+  if (available_read() == 0) {
+    resetBuffer();
+  }
+  resetConsumedMessageSize();
+  return bytes;
+}
+
+uint32_t TChainedMemoryBuffer::writeEnd() {
+  uint64_t bytes = releasedBytes_;
+  for (size_t i = 0; i < segments_.size(); ++i) {
+    bytes += segmentEnd(i) - segments_[i].data;
+  }
+  return static_cast<uint32_t>(bytes);
+}
+}
+}
+} // apache::thrift::transport
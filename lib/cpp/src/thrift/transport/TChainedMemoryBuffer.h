@@ -0,0 +1,209 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _THRIFT_TRANSPORT_TCHAINEDMEMORYBUFFER_H_
+#define _THRIFT_TRANSPORT_TCHAINEDMEMORYBUFFER_H_ 1
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <thrift/concurrency/Mutex.h>
+#include <thrift/transport/TBufferTransports.h>
+
+namespace apache {
+namespace thrift {
+namespace transport {
+
+/**
+ * A thread-safe free list of fixed-size memory segments.
+ *
+ * Segments handed back with release() are kept for reuse, up to
+ * maxFreeSegments of them; anything beyond that is returned to the heap.
+ * A single pool may be shared by any number of TChainedMemoryBuffers.
+ */
+class TBufferSegmentPool {
+public:
+  static const uint32_t DEFAULT_SEGMENT_SIZE = 16 * 1024;
+  static const uint32_t DEFAULT_MAX_FREE_SEGMENTS = 256;
+
+  TBufferSegmentPool(uint32_t segmentSize = DEFAULT_SEGMENT_SIZE,
+                     uint32_t maxFreeSegments = DEFAULT_MAX_FREE_SEGMENTS);
+
+  ~TBufferSegmentPool();
+
+  /**
+   * Returns a segment of getSegmentSize() bytes, reusing a free one if
+   * possible.  The contents are undefined.
+   */
+  uint8_t* allocate();
+
+  /**
+   * Gives a segment obtained from allocate() back to the pool.
+   */
+  void release(uint8_t* segment);
+
+  uint32_t getSegmentSize() const { return segmentSize_; }
+
+  uint32_t getMaxFreeSegments() const { return maxFreeSegments_; }
+
+  /**
+   * Returns the number of segments currently held for reuse.
+   */
+  size_t getFreeSegmentCount() const;
+
+private:
+  const uint32_t segmentSize_;
+  const uint32_t maxFreeSegments_;
+  std::vector<uint8_t*> free_;
+  concurrency::Mutex mutex_;
+};
+
+/**
+ * A memory buffer that stores its contents as a chain of fixed-size
+ * segments drawn from a TBufferSegmentPool, instead of one contiguous
+ * allocation.
+ *
+ * Unlike TMemoryBuffer, growing the buffer never moves bytes that have
+ * already been written: when the tail segment fills up another one is
+ * appended.  Reads release segments back to the pool as soon as they have
+ * been consumed.  The readable contents can be handed to a transport with
+ * writeTo(), which passes every segment to TTransport::writev() so a large
+ * payload never needs to be made contiguous.
+ *
+ * Reads and writes within a segment take the TBufferBase fast path.  borrow()
+ * only succeeds when the requested bytes lie in a single segment; protocols
+ * fall back to read() otherwise.
+ */
+class TChainedMemoryBuffer : public TVirtualTransport<TChainedMemoryBuffer, TBufferBase> {
+public:
+  /**
+   * Construct a buffer drawing segments from a private pool with the
+   * default segment size.
+   */
+  TChainedMemoryBuffer(std::shared_ptr<TConfiguration> config = nullptr);
+
+  /**
+   * Construct a buffer drawing segments from a shared pool.
+   *
+   * @param pool  The pool to allocate segments from.
+   */
+  TChainedMemoryBuffer(std::shared_ptr<TBufferSegmentPool> pool,
+                       std::shared_ptr<TConfiguration> config = nullptr);
+
+  ~TChainedMemoryBuffer() override;
+
+  bool isOpen() const override { return true; }
+
+  bool peek() override { return available_read() > 0; }
+
+  void open() override {}
+
+  void close() override {}
+
+  /**
+   * Discards all buffered data and returns every segment but one to the pool.
+   */
+  void resetBuffer();
+
+  /**
+   * Copies the readable contents into a string.  Does not consume them.
+   */
+  std::string getBufferAsString() const;
+
+  /**
+   * Appends the readable contents to str.  Does not consume them.
+   */
+  void appendBufferToString(std::string& str) const;
+
+  /**
+   * Appends one TIOVec per segment holding readable data to iov.  The
+   * pointers remain valid until the data is consumed or the buffer is
+   * written to again.
+   */
+  void getReadableSegments(std::vector<TIOVec>& iov) const;
+
+  /**
+   * Writes the readable contents to trans with a single writev() call and
+   * consumes them.
+   */
+  void writeTo(TTransport& trans);
+
+  uint32_t available_read() const;
+
+  /**
+   * Returns the number of segments currently held by this buffer.
+   */
+  size_t getSegmentCount() const { return segments_.size(); }
+
+  std::shared_ptr<TBufferSegmentPool> getSegmentPool() const { return pool_; }
+
+  // return number of bytes read
+  uint32_t readEnd() override;
+
+  // Return number of bytes written
+  uint32_t writeEnd() override;
+
+  /*
+   * TVirtualTransport provides a default implementation of readAll().
+   * We want to use the TBufferBase version instead.
+   */
+  uint32_t readAll(uint8_t* buf, uint32_t len) { return TBufferBase::readAll(buf, len); }
+
+protected:
+  uint32_t readSlow(uint8_t* buf, uint32_t len) override;
+
+  void writeSlow(const uint8_t* buf, uint32_t len) override;
+
+  const uint8_t* borrowSlow(uint8_t* buf, uint32_t* len) override;
+
+private:
+  struct Segment {
+    uint8_t* data;
+    // Bytes written to the segment.  Not maintained for the tail segment,
+    // whose end is always wBase_.
+    uint32_t len;
+  };
+
+  void initCommon();
+
+  // Returns one past the last readable byte of segments_[idx].
+  uint8_t* segmentEnd(size_t idx) const {
+    return idx + 1 == segments_.size() ? wBase_ : segments_[idx].data + segments_[idx].len;
+  }
+
+  // Drops fully consumed segments from the front of the chain and points the
+  // read pointers at the first unread byte.
+  void advanceReadSegment();
+
+  // Appends a fresh tail segment and points the write pointers at it.
+  void appendSegment();
+
+  std::shared_ptr<TBufferSegmentPool> pool_;
+  std::deque<Segment> segments_;
+
+  // Bytes that lived in segments already released back to the pool.
+  uint64_t releasedBytes_;
+};
+}
+}
+} // apache::thrift::transport
+
+#endif // #ifndef _THRIFT_TRANSPORT_TCHAINEDMEMORYBUFFER_H_
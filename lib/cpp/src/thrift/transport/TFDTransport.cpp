@@ -23,9 +23,14 @@
 #include <thrift/transport/TFDTransport.h>
 #include <thrift/transport/PlatformSocket.h>
 
+#include <algorithm>
+
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
 
 #ifdef _WIN32
 #include <io.h>
@@ -89,6 +94,44 @@ void TFDTransport::write(const uint8_t* buf, uint32_t len) {
     len -= static_cast<uint32_t>(rv);
   }
 }
+
+void TFDTransport::writev(const TIOVec* iov, uint32_t iovcnt) {
+#ifdef _WIN32
+  for (uint32_t i = 0; i < iovcnt; ++i) {
+    write(iov[i].base, iov[i].len);
+  }
+#else
+  const uint32_t batch = 64;
+  TIOVec pending[batch];
+  struct iovec bufs[batch];
+
+  while (iovcnt > 0) {
+    uint32_t n = (std::min)(iovcnt, batch);
+    std::copy(iov, iov + n, pending);
+    iov += n;
+    iovcnt -= n;
+
+    TIOVec* cur = pending;
+    n = consumeIOVec(cur, n, 0);
+    while (n > 0) {
+      for (uint32_t i = 0; i < n; ++i) {
+        bufs[i].iov_base = const_cast<uint8_t*>(cur[i].base);
+        bufs[i].iov_len = cur[i].len;
+      }
+      THRIFT_SSIZET rv = ::writev(fd_, bufs, static_cast<int>(n));
+
+      if (rv < 0) {
+        int errno_copy = THRIFT_ERRNO;
+        throw TTransportException(TTransportException::UNKNOWN, "TFDTransport::writev()", errno_copy);
+      } else if (rv == 0) {
+        throw TTransportException(TTransportException::END_OF_FILE, "TFDTransport::writev()");
+      }
+
+      n = consumeIOVec(cur, n, static_cast<uint32_t>(rv));
+    }
+  }
+#endif
+}
 }
 }
 } // apache::thrift::transport
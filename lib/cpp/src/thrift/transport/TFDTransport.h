@@ -65,6 +65,8 @@ public:
 
   void write(const uint8_t* buf, uint32_t len);
 
+  void writev(const TIOVec* iov, uint32_t iovcnt);
+
   void setFD(int fd) { fd_ = fd; }
   int getFD() { return fd_; }
 
@@ -524,14 +524,22 @@ void THeaderTransport::flush() {
     szNbo = htonl(szHbo);
     memcpy(pktStart, &szNbo, sizeof(szNbo));
 
-    outTransport_->write(pktStart, szHbo - haveBytes + 4);
-    outTransport_->write(wBuf_.get(), haveBytes);
+    TIOVec iov[2];
+    iov[0].base = pktStart;
+    iov[0].len = szHbo - haveBytes + 4;
+    iov[1].base = wBuf_.get();
+    iov[1].len = haveBytes;
+    outTransport_->writev(iov, 2);
   } else if (clientType == THRIFT_FRAMED_BINARY || clientType == THRIFT_FRAMED_COMPACT) {
     auto szHbo = (uint32_t)haveBytes;
     uint32_t szNbo = htonl(szHbo);
 
-    outTransport_->write(reinterpret_cast<uint8_t*>(&szNbo), 4);
-    outTransport_->write(wBuf_.get(), haveBytes);
+    TIOVec iov[2];
+    iov[0].base = reinterpret_cast<uint8_t*>(&szNbo);
+    iov[0].len = 4;
+    iov[1].base = wBuf_.get();
+    iov[1].len = haveBytes;
+    outTransport_->writev(iov, 2);
   } else if (clientType == THRIFT_UNFRAMED_BINARY || clientType == THRIFT_UNFRAMED_COMPACT) {
     outTransport_->write(wBuf_.get(), haveBytes);
   } else {
@@ -107,6 +107,9 @@ public:
   uint32_t readSlow(uint8_t* buf, uint32_t len) override;
   void flush() override;
 
+  // Unframed clients are read through a refilling buffer.
+  bool canLendReadBuffer() const override { return false; }
+
   void resizeTransformBuffer(uint32_t additionalSize = 0);
 
   uint16_t getProtocolId() const;
@@ -53,6 +53,12 @@ std::shared_ptr<TSocket> TNonblockingSSLServerSocket::createSocket(THRIFT_SOCKET
   tSSLSocket->setLibeventSafe();
   return tSSLSocket;
 }
+
+std::shared_ptr<TNonblockingServerSocket> TNonblockingSSLServerSocket::createPeer(
+    const std::string& address,
+    int port) {
+  return std::make_shared<TNonblockingSSLServerSocket>(address, port, factory_);
+}
 }
 }
 }
@@ -91,6 +91,7 @@ TNonblockingServerSocket::TNonblockingServerSocket(int port)
     tcpSendBuffer_(0),
     tcpRecvBuffer_(0),
     keepAlive_(false),
+    reusePort_(false),
     listening_(false) {
 }
 
@@ -106,6 +107,7 @@ TNonblockingServerSocket::TNonblockingServerSocket(int port, int sendTimeout, in
     tcpSendBuffer_(0),
     tcpRecvBuffer_(0),
     keepAlive_(false),
+    reusePort_(false),
     listening_(false) {
 }
 
@@ -122,6 +124,7 @@ TNonblockingServerSocket::TNonblockingServerSocket(const string& address, int po
     tcpSendBuffer_(0),
     tcpRecvBuffer_(0),
     keepAlive_(false),
+    reusePort_(false),
     listening_(false) {
 }
 
@@ -138,6 +141,7 @@ TNonblockingServerSocket::TNonblockingServerSocket(const string& path)
     tcpSendBuffer_(0),
     tcpRecvBuffer_(0),
     keepAlive_(false),
+    reusePort_(false),
     listening_(false) {
 }
 
@@ -227,6 +231,23 @@ void TNonblockingServerSocket::_setup_sockopts() {
     }
   }
 
+  if (reusePort_) {
+#ifdef SO_REUSEPORT
+    if (-1 == setsockopt(serverSocket_, SOL_SOCKET, SO_REUSEPORT, cast_sockopt(&one), sizeof(one))) {
+      int errno_copy = THRIFT_GET_SOCKET_ERROR;
+      GlobalOutput.perror("TNonblockingServerSocket::listen() setsockopt() SO_REUSEPORT ", errno_copy);
+      close();
+      throw TTransportException(TTransportException::NOT_OPEN,
+                                "Could not set SO_REUSEPORT",
+                                errno_copy);
+    }
+#else
+    close();
+    throw TTransportException(TTransportException::NOT_OPEN,
+                              "SO_REUSEPORT is not supported on this platform");
+#endif
+  }
+
   // Turn linger off, don't want to block on calls to close
   struct linger ling = {0, 0};
   if (-1 == setsockopt(serverSocket_, SOL_SOCKET, SO_LINGER, cast_sockopt(&ling), sizeof(ling))) {
@@ -545,6 +566,33 @@ shared_ptr<TSocket> TNonblockingServerSocket::createSocket(THRIFT_SOCKET clientS
   return std::make_shared<TSocket>(clientSocket);
 }
 
+shared_ptr<TNonblockingServerSocket> TNonblockingServerSocket::createPeer(const string& address,
+                                                                         int port) {
+  return std::make_shared<TNonblockingServerSocket>(address, port);
+}
+
+shared_ptr<TNonblockingServerTransport> TNonblockingServerSocket::createReusePortPeer() {
+  if (!reusePort_ || !listening_ || !path_.empty()) {
+    return shared_ptr<TNonblockingServerTransport>();
+  }
+
+  // Bind the port we actually got, in case we were asked for port 0
+  shared_ptr<TNonblockingServerSocket> peer = createPeer(address_, listenPort_);
+  peer->acceptBacklog_ = acceptBacklog_;
+  peer->sendTimeout_ = sendTimeout_;
+  peer->recvTimeout_ = recvTimeout_;
+  peer->retryLimit_ = retryLimit_;
+  peer->retryDelay_ = retryDelay_;
+  peer->tcpSendBuffer_ = tcpSendBuffer_;
+  peer->tcpRecvBuffer_ = tcpRecvBuffer_;
+  peer->keepAlive_ = keepAlive_;
+  peer->reusePort_ = true;
+  peer->listenCallback_ = listenCallback_;
+  peer->acceptCallback_ = acceptCallback_;
+  peer->listen();
+  return peer;
+}
+
 void TNonblockingServerSocket::close() {
   if (serverSocket_ != THRIFT_INVALID_SOCKET) {
     shutdown(serverSocket_, THRIFT_SHUT_RDWR);
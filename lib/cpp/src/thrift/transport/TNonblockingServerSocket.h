@@ -83,6 +83,11 @@ public:
 
   void setKeepAlive(bool keepAlive) { keepAlive_ = keepAlive; }
 
+  // Sets SO_REUSEPORT on the listening socket, allowing createReusePortPeer()
+  // (and other processes) to bind the same port.  Must be called before
+  // listen(), which throws if the platform has no SO_REUSEPORT.
+  void setReusePort(bool reusePort) { reusePort_ = reusePort; }
+
   void setTcpSendBuffer(int tcpSendBuffer);
   void setTcpRecvBuffer(int tcpRecvBuffer);
 
@@ -106,10 +111,19 @@ public:
   void listen() override;
   void close() override;
 
+  // Returns a listening socket with the same settings, address and port, or
+  // nullptr unless this is a listening TCP socket with setReusePort(true).
+  std::shared_ptr<TNonblockingServerTransport> createReusePortPeer() override;
+
 protected:
   std::shared_ptr<TSocket> acceptImpl() override;
   virtual std::shared_ptr<TSocket> createSocket(THRIFT_SOCKET client);
 
+  // Creates an unconfigured server socket of the same kind as this one, for
+  // createReusePortPeer().
+  virtual std::shared_ptr<TNonblockingServerSocket> createPeer(const std::string& address,
+                                                               int port);
+
 private:
   int port_;
   int listenPort_;
@@ -124,6 +138,7 @@ private:
   int tcpSendBuffer_;
   int tcpRecvBuffer_;
   bool keepAlive_;
+  bool reusePort_;
   bool listening_;
 
   socket_func_t listenCallback_;
@@ -76,6 +76,17 @@ public:
 
   virtual int getListenPort() = 0;
 
+  /**
+   * Returns a new transport, already listening, that shares this one's
+   * address through SO_REUSEPORT so that the kernel spreads incoming
+   * connections across both.  Only valid after listen().
+   *
+   * @return the new transport, or nullptr if this transport cannot share
+   *         its address
+   * @throw TTransportException if the new transport could not listen
+   */
+  virtual std::shared_ptr<TNonblockingServerTransport> createReusePortPeer() { return nullptr; }
+
   /**
    * Closes this transport such that future calls to accept will do nothing.
    */
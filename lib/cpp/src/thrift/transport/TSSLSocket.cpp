@@ -556,6 +556,30 @@ uint32_t TSSLSocket::write_partial(const uint8_t* buf, uint32_t len) {
   return written;
 }
 
+void TSSLSocket::writev(const TIOVec* iov, uint32_t iovcnt) {
+  // OpenSSL has no gather write.  Pack small buffers together so that a
+  // frame header and its payload go out as one TLS record, and one send,
+  // rather than one per buffer.  Anything at least a full record in size is
+  // handed to SSL_write directly since it gets its own record anyway.
+  uint8_t stage[16384];
+  uint32_t staged = 0;
+  for (uint32_t i = 0; i < iovcnt; ++i) {
+    if (iov[i].len > sizeof(stage) - staged && staged > 0) {
+      write(stage, staged);
+      staged = 0;
+    }
+    if (iov[i].len >= sizeof(stage)) {
+      write(iov[i].base, iov[i].len);
+    } else {
+      memcpy(stage + staged, iov[i].base, iov[i].len);
+      staged += iov[i].len;
+    }
+  }
+  if (staged > 0) {
+    write(stage, staged);
+  }
+}
+
 void TSSLSocket::flush() {
   resetConsumedMessageSize();
   // Don't throw exception if not open. Thrift servers close socket twice.
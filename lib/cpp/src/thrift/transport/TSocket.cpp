@@ -19,6 +19,7 @@
 
 #include <thrift/thrift-config.h>
 
+#include <algorithm>
 #include <cstring>
 #include <sstream>
 #ifdef HAVE_SYS_IOCTL_H
@@ -688,6 +689,91 @@ uint32_t TSocket::write_partial(const uint8_t* buf, uint32_t len) {
   return b;
 }
 
+void TSocket::writev(const TIOVec* iov, uint32_t iovcnt) {
+  // Gather writes may be partial, so keep a private copy of the vector that
+  // can be advanced past whatever the kernel has already taken.
+  const uint32_t batch = 64;
+  TIOVec pending[batch];
+
+  while (iovcnt > 0) {
+    uint32_t n = (std::min)(iovcnt, batch);
+    std::copy(iov, iov + n, pending);
+    iov += n;
+    iovcnt -= n;
+
+    TIOVec* cur = pending;
+    n = consumeIOVec(cur, n, 0);
+    while (n > 0) {
+      uint32_t b = writev_partial(cur, n);
+      if (b == 0) {
+        // This should only happen if the timeout set with SO_SNDTIMEO expired.
+        // Raise an exception.
+        throw TTransportException(TTransportException::TIMED_OUT, "send timeout expired");
+      }
+      n = consumeIOVec(cur, n, b);
+    }
+  }
+}
+
+uint32_t TSocket::writev_partial(const TIOVec* iov, uint32_t iovcnt) {
+  if (socket_ == THRIFT_INVALID_SOCKET) {
+    throw TTransportException(TTransportException::NOT_OPEN, "Called write on non-open socket");
+  }
+
+  const uint32_t batch = 64;
+  uint32_t n = (std::min)(iovcnt, batch);
+
+#ifdef _WIN32
+  WSABUF bufs[batch];
+  for (uint32_t i = 0; i < n; ++i) {
+    bufs[i].buf = reinterpret_cast<CHAR*>(const_cast<uint8_t*>(iov[i].base));
+    bufs[i].len = iov[i].len;
+  }
+  DWORD sent = 0;
+  int b = WSASend(socket_, bufs, n, &sent, 0, nullptr, nullptr) == 0 ? static_cast<int>(sent) : -1;
+#else
+  struct iovec bufs[batch];
+  for (uint32_t i = 0; i < n; ++i) {
+    bufs[i].iov_base = const_cast<uint8_t*>(iov[i].base);
+    bufs[i].iov_len = iov[i].len;
+  }
+  struct msghdr msg;
+  std::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = bufs;
+  msg.msg_iovlen = n;
+
+  int flags = 0;
+#ifdef MSG_NOSIGNAL
+  // See write_partial() for why SIGPIPE is suppressed.
+  flags |= MSG_NOSIGNAL;
+#endif // ifdef MSG_NOSIGNAL
+
+  int b = static_cast<int>(sendmsg(socket_, &msg, flags));
+#endif // _WIN32
+
+  if (b < 0) {
+    if (THRIFT_GET_SOCKET_ERROR == THRIFT_EWOULDBLOCK || THRIFT_GET_SOCKET_ERROR == THRIFT_EAGAIN) {
+      return 0;
+    }
+    // Fail on a send error
+    int errno_copy = THRIFT_GET_SOCKET_ERROR;
+    GlobalOutput.perror("TSocket::writev_partial() sendmsg() " + getSocketInfo(), errno_copy);
+
+    if (errno_copy == THRIFT_EPIPE || errno_copy == THRIFT_ECONNRESET
+        || errno_copy == THRIFT_ENOTCONN) {
+      throw TTransportException(TTransportException::NOT_OPEN, "writev() sendmsg()", errno_copy);
+    }
+
+    throw TTransportException(TTransportException::UNKNOWN, "writev() sendmsg()", errno_copy);
+  }
+
+  // Fail on blocked send
+  if (b == 0) {
+    throw TTransportException(TTransportException::NOT_OPEN, "Socket send returned 0.");
+  }
+  return b;
+}
+
 std::string TSocket::getHost() {
   return host_;
 }
@@ -136,6 +136,18 @@ public:
    */
   virtual uint32_t write_partial(const uint8_t* buf, uint32_t len);
 
+  /**
+   * Writes a sequence of buffers to the underlying socket using gather
+   * writes.  Loops until done or fail.
+   */
+  virtual void writev(const TIOVec* iov, uint32_t iovcnt);
+
+  /**
+   * Does a single gather write of as many of the buffers as the socket will
+   * take and returns the number of bytes sent.
+   */
+  virtual uint32_t writev_partial(const TIOVec* iov, uint32_t iovcnt);
+
   /**
    * Get the host that the socket is connected to
    *
@@ -49,6 +49,32 @@ uint32_t readAll(Transport_& trans, uint8_t* buf, uint32_t len) {
   return have;
 }
 
+/**
+ * One contiguous region of a gather write, see TTransport::writev().
+ */
+struct TIOVec {
+  const uint8_t* base;
+  uint32_t len;
+};
+
+/**
+ * Drops the first len bytes from a TIOVec array after a partial gather
+ * write.  Advances iov past fully written entries, trims the first partially
+ * written one and returns the number of entries left.
+ */
+inline uint32_t consumeIOVec(TIOVec*& iov, uint32_t iovcnt, uint32_t len) {
+  while (iovcnt > 0 && len >= iov->len) {
+    len -= iov->len;
+    ++iov;
+    --iovcnt;
+  }
+  if (iovcnt > 0) {
+    iov->base += len;
+    iov->len -= len;
+  }
+  return iovcnt;
+}
+
 /**
  * Generic interface for a method of transporting data. A TTransport may be
  * capable of either reading or writing, but not necessarily both.
@@ -166,6 +192,26 @@ public:
     throw TTransportException(TTransportException::NOT_OPEN, "Base TTransport cannot write.");
   }
 
+  /**
+   * Writes a sequence of buffers, in order, as if write() had been called on
+   * each of them.  Transports backed by a descriptor override this to hand
+   * all of the buffers to the kernel in a single gather write rather than
+   * copying them together first.
+   *
+   * @param iov     The buffers to write out
+   * @param iovcnt  How many entries of iov to write
+   * @throws TTransportException if an error occurs
+   */
+  void writev(const TIOVec* iov, uint32_t iovcnt) {
+    T_VIRTUAL_CALL();
+    writev_virt(iov, iovcnt);
+  }
+  virtual void writev_virt(const TIOVec* iov, uint32_t iovcnt) {
+    for (uint32_t i = 0; i < iovcnt; ++i) {
+      write(iov[i].base, iov[i].len);
+    }
+  }
+
   /**
    * Called when write is completed.
    * This can be over-ridden to perform a transport-specific action
@@ -238,6 +284,14 @@ public:
     throw TTransportException(TTransportException::NOT_OPEN, "Base TTransport cannot consume.");
   }
 
+  /**
+   * Returns true if memory handed out by borrow() stays valid and unchanged
+   * after it has been consumed, until the transport starts reading its next
+   * message or is written to.  Protocols only hand out views into the
+   * transport's buffer (see TProtocol::readStringView()) when this is true.
+   */
+  virtual bool canLendReadBuffer() const { return false; }
+
   /**
    * Returns the origin of the transports call. The value depends on the
    * transport used. An IP based transport for example will return the
@@ -21,6 +21,7 @@
 #define _THRIFT_TEST_GENERICPROTOCOLTEST_TCC_ 1
 
 #include <limits>
+#include <vector>
 
 #include <thrift/protocol/TBinaryProtocol.h>
 #include <thrift/transport/TBufferTransports.h>
@@ -94,6 +95,77 @@ void testField(const Val val) {
   protocol->readStructEnd();
 }
 
+// Arrays must go on the wire just as their values do one at a time, and read
+// back either way, including through a read buffer smaller than the array.
+template <typename TProto, typename Val>
+void testArray(const std::vector<Val>& vals) {
+  const auto count = static_cast<uint32_t>(vals.size());
+  shared_ptr<TMemoryBuffer> single(new TMemoryBuffer());
+  shared_ptr<TMemoryBuffer> bulk(new TMemoryBuffer());
+  shared_ptr<TProtocol> singleProtocol(new TProto(single));
+  shared_ptr<TProtocol> bulkProtocol(new TProto(bulk));
+
+  uint32_t wsize = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    wsize += GenericIO::write(singleProtocol, vals[i]);
+  }
+  if (GenericIO::writeArray(bulkProtocol, vals.data(), count) != wsize
+      || bulk->getBufferAsString() != single->getBufferAsString()) {
+    THRIFT_SNPRINTF(errorMessage, ERR_LEN, "Invalid array written (type: %s, count: %u)",
+                    ClassNames::getName<Val>(), count);
+    throw TException(errorMessage);
+  }
+
+  std::vector<Val> out(count);
+  if (GenericIO::readArray(singleProtocol, out.data(), count) != wsize || out != vals) {
+    THRIFT_SNPRINTF(errorMessage, ERR_LEN, "Invalid array read (type: %s, count: %u)",
+                    ClassNames::getName<Val>(), count);
+    throw TException(errorMessage);
+  }
+
+  shared_ptr<TTransport> buffered(new TBufferedTransport(bulk, 7));
+  shared_ptr<TProtocol> bufferedProtocol(new TProto(buffered));
+  std::vector<Val> outBuffered(count);
+  if (GenericIO::readArray(bufferedProtocol, outBuffered.data(), count) != wsize
+      || outBuffered != vals) {
+    THRIFT_SNPRINTF(errorMessage, ERR_LEN, "Invalid buffered array read (type: %s, count: %u)",
+                    ClassNames::getName<Val>(), count);
+    throw TException(errorMessage);
+  }
+}
+
+// Runs of small values (one varint byte) and large ones, at lengths around
+// the block sizes of the compact protocol's varint kernels and of the byte
+// swapping in the binary protocol.
+template <typename TProto, typename Val>
+void testArrays() {
+  const Val lo = (std::numeric_limits<Val>::min)();
+  const Val hi = (std::numeric_limits<Val>::max)();
+  const uint32_t lengths[] = {0, 1, 7, 8, 9, 15, 16, 17, 33, 1000};
+  for (uint32_t length : lengths) {
+    std::vector<Val> small, mixed;
+    for (uint32_t i = 0; i < length; ++i) {
+      small.push_back(static_cast<Val>(static_cast<int>(i % 128) - 64));
+      switch (i % 37) {
+      case 3:
+        mixed.push_back(lo);
+        break;
+      case 11:
+        mixed.push_back(hi);
+        break;
+      case 20:
+      case 21:
+        mixed.push_back(static_cast<Val>(-1000 - static_cast<int>(i)));
+        break;
+      default:
+        mixed.push_back(static_cast<Val>(i % 50));
+      }
+    }
+    testArray<TProto>(small);
+    testArray<TProto>(mixed);
+  }
+}
+
 template <typename TProto>
 void testMessage() {
   struct TMessage {
@@ -213,6 +285,12 @@ void testProtocol(const char* protoname) {
     testField<TProto, T_STRING, std::string>("borderlinetiny");
     testField<TProto, T_STRING, std::string>("a bit longer than the smallest possible");
 
+    testArrays<TProto, int8_t>();
+    testArrays<TProto, int16_t>();
+    testArrays<TProto, int32_t>();
+    testArrays<TProto, int64_t>();
+    testArrays<TProto, double>();
+
     testMessage<TProto>();
 
     printf("%s => OK\n", protoname);
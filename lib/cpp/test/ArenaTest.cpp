@@ -0,0 +1,216 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <memory>
+#include <string>
+#include <thrift/TArena.h>
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/protocol/TCompactProtocol.h>
+#include <thrift/protocol/TJSONProtocol.h>
+#include <thrift/transport/TBufferTransports.h>
+
+#include "gen-cpp/ArenaTest_types.h"
+
+BOOST_AUTO_TEST_SUITE(ArenaTest)
+
+using apache::thrift::TArena;
+using apache::thrift::TArenaScope;
+using apache::thrift::protocol::TBinaryProtocol;
+using apache::thrift::protocol::TCompactProtocol;
+using apache::thrift::protocol::TJSONProtocol;
+using apache::thrift::transport::TMemoryBuffer;
+using arenatest::Item;
+using arenatest::Request;
+using std::shared_ptr;
+using std::string;
+
+static Request makeRequest() {
+  Request r;
+  r.name = "request";
+  Item item;
+  item.name = "a fairly long item name that does not fit in the small string buffer";
+  item.blob.assign("\0\1\2", 3);
+  r.items.push_back(item);
+  r.items.push_back(item);
+  r.tags.insert("x");
+  r.tags.insert("y");
+  r.counts["c"].push_back(1);
+  r.counts["c"].push_back(2);
+  r.copied = "owned";
+  r.__set_note("note");
+  return r;
+}
+
+template <class Protocol_>
+static void roundTrip() {
+  shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer());
+  Protocol_ proto(buf);
+  makeRequest().write(&proto);
+
+  TArena arena;
+  Request copy;
+  {
+    TArenaScope scope(&arena);
+    Request in;
+    in.read(&proto);
+    BOOST_CHECK(arena.getBytesAllocated() > 0);
+    BOOST_CHECK(in == makeRequest());
+    BOOST_CHECK(in.items[0].name.get_allocator().getArena() == &arena);
+    BOOST_CHECK(in.counts.at("c").get_allocator().getArena() == &arena);
+
+    // Assignment keeps the destination's heap allocator; the elements it
+    // constructs take the current arena, so leave it first.
+    TArenaScope heap(nullptr);
+    copy = in;
+  }
+  BOOST_CHECK(copy.name.get_allocator().getArena() == nullptr);
+  BOOST_CHECK(copy.items.get_allocator().getArena() == nullptr);
+  BOOST_CHECK(copy.items[0].name.get_allocator().getArena() == nullptr);
+  BOOST_CHECK(copy.counts.at("c").get_allocator().getArena() == nullptr);
+  arena.reset();
+  BOOST_CHECK_EQUAL(0u, arena.getBytesAllocated());
+  BOOST_CHECK(copy == makeRequest());
+}
+
+BOOST_AUTO_TEST_CASE(test_allocate_aligned) {
+  TArena arena(256);
+  void* a = arena.allocate(1, 1);
+  void* b = arena.allocate(8, 8);
+  void* c = arena.allocate(3, 2);
+  BOOST_CHECK(a != b && b != c);
+  BOOST_CHECK_EQUAL(0u, reinterpret_cast<uintptr_t>(b) % 8);
+  BOOST_CHECK_EQUAL(0u, reinterpret_cast<uintptr_t>(c) % 2);
+  BOOST_CHECK_EQUAL(1u, arena.getBlockCount());
+}
+
+BOOST_AUTO_TEST_CASE(test_allocate_after_unaligned_block) {
+  // The oversized first block ends off alignment; the next allocation must
+  // not be placed past its end.
+  TArena arena;
+  arena.allocate(4097, 1);
+  void* p = arena.allocate(8, 8);
+  BOOST_CHECK_EQUAL(0u, reinterpret_cast<uintptr_t>(p) % 8);
+  BOOST_CHECK_EQUAL(2u, arena.getBlockCount());
+}
+
+BOOST_AUTO_TEST_CASE(test_reset_keeps_one_block) {
+  TArena arena(256);
+  for (int i = 0; i < 100; ++i) {
+    arena.allocate(32, 8);
+  }
+  arena.allocate(4096, 8);
+  BOOST_CHECK(arena.getBlockCount() > 2);
+  BOOST_CHECK(arena.getBytesAllocated() >= 100 * 32 + 4096);
+
+  arena.reset();
+  BOOST_CHECK_EQUAL(1u, arena.getBlockCount());
+  BOOST_CHECK_EQUAL(0u, arena.getBytesAllocated());
+
+  // The retained block is reused rather than a new one being allocated.
+  arena.allocate(32, 8);
+  BOOST_CHECK_EQUAL(1u, arena.getBlockCount());
+}
+
+BOOST_AUTO_TEST_CASE(test_scope_nesting) {
+  BOOST_CHECK(TArena::current() == nullptr);
+  TArena outer;
+  TArena inner;
+  {
+    TArenaScope a(&outer);
+    BOOST_CHECK(TArena::current() == &outer);
+    {
+      TArenaScope b(&inner);
+      BOOST_CHECK(TArena::current() == &inner);
+      {
+        TArenaScope c(nullptr);
+        BOOST_CHECK(TArena::current() == nullptr);
+      }
+      BOOST_CHECK(TArena::current() == &inner);
+    }
+    BOOST_CHECK(TArena::current() == &outer);
+  }
+  BOOST_CHECK(TArena::current() == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(test_copy_construct_leaves_arena) {
+  TArena arena;
+  shared_ptr<Request> saved;
+  {
+    TArenaScope scope(&arena);
+    Request in = makeRequest();
+    BOOST_CHECK(in.name.get_allocator().getArena() == &arena);
+    {
+      TArenaScope heap(nullptr);
+      saved.reset(new Request(in));
+    }
+  }
+  arena.reset();
+  BOOST_CHECK(saved->items.get_allocator().getArena() == nullptr);
+  BOOST_CHECK(saved->items[1].name.get_allocator().getArena() == nullptr);
+  BOOST_CHECK(*saved == makeRequest());
+}
+
+BOOST_AUTO_TEST_CASE(test_copy_to_heap) {
+  TArena arena;
+  shared_ptr<Request> saved;
+  {
+    TArenaScope scope(&arena);
+    Request in = makeRequest();
+    BOOST_CHECK(in.items[1].name.get_allocator().getArena() == &arena);
+
+    // A plain copy made here lands in the arena, nested members and all.
+    Request copy(in);
+    BOOST_CHECK(copy.items[1].name.get_allocator().getArena() == &arena);
+
+    saved = apache::thrift::copyToHeap(in);
+  }
+  arena.reset();
+  BOOST_CHECK(saved->name.get_allocator().getArena() == nullptr);
+  BOOST_CHECK(saved->items.get_allocator().getArena() == nullptr);
+  BOOST_CHECK(saved->items[1].name.get_allocator().getArena() == nullptr);
+  BOOST_CHECK(saved->items[1].blob.get_allocator().getArena() == nullptr);
+  BOOST_CHECK(saved->counts.at("c").get_allocator().getArena() == nullptr);
+  BOOST_CHECK(*saved == makeRequest());
+}
+
+BOOST_AUTO_TEST_CASE(test_binary_round_trip) {
+  roundTrip<TBinaryProtocol>();
+}
+
+BOOST_AUTO_TEST_CASE(test_compact_round_trip) {
+  roundTrip<TCompactProtocol>();
+}
+
+BOOST_AUTO_TEST_CASE(test_json_round_trip) {
+  roundTrip<TJSONProtocol>();
+}
+
+BOOST_AUTO_TEST_CASE(test_read_without_arena) {
+  shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer());
+  TCompactProtocol proto(buf);
+  makeRequest().write(&proto);
+
+  Request in;
+  in.read(&proto);
+  BOOST_CHECK(in.name.get_allocator().getArena() == nullptr);
+  BOOST_CHECK(in == makeRequest());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -24,7 +24,9 @@
 #define _USE_MATH_DEFINES
 #include <math.h>
 #include <memory>
+#include <vector>
 #include "thrift/protocol/TBinaryProtocol.h"
+#include "thrift/protocol/TCompactProtocol.h"
 #include "thrift/transport/TBufferTransports.h"
 #include "gen-cpp/DebugProtoTest_types.h"
 
@@ -239,6 +241,105 @@ int main() {
     cout << " Double read big endian: " << num / (1000 * elapsed) << " kHz" << endl;
   }
 
+  // A 1M element list<double> through TProtocol as generated code sees it,
+  // one writeDouble()/readDouble() call per element against the array calls
+  // the generated code now makes.
+  num = 1000000;
+
+  ListDoublePerf listDoubleMillion;
+  listDoubleMillion.field.reserve(num);
+  for (int x = 0; x < num; ++x)
+    listDoubleMillion.field.push_back(double(x) / 3);
+
+  {
+    buf->resetBuffer();
+    std::shared_ptr<TProtocol> prot(new TBinaryProtocol(buf));
+    double elapsed = 0.0;
+    Timer timer;
+
+    prot->writeListBegin(T_DOUBLE, num);
+    for (int x = 0; x < num; ++x)
+      prot->writeDouble(listDoubleMillion.field[x]);
+    prot->writeListEnd();
+    elapsed = timer.frame();
+    cout << "1M double write per element: " << num / (1000 * elapsed) << " kHz" << endl;
+  }
+
+  {
+    buf->resetBuffer();
+    std::shared_ptr<TProtocol> prot(new TBinaryProtocol(buf));
+    double elapsed = 0.0;
+    Timer timer;
+
+    prot->writeListBegin(T_DOUBLE, num);
+    prot->writeDoubleArray(listDoubleMillion.field.data(), num);
+    prot->writeListEnd();
+    elapsed = timer.frame();
+    cout << "1M double write array: " << num / (1000 * elapsed) << " kHz" << endl;
+  }
+
+  buf->getBuffer(&data, &datasize);
+
+  {
+    std::shared_ptr<TMemoryBuffer> buf2(new TMemoryBuffer(data, datasize));
+    std::shared_ptr<TProtocol> prot(new TBinaryProtocol(buf2));
+    std::vector<double> values;
+    double elapsed = 0.0;
+    Timer timer;
+
+    TType elemType;
+    uint32_t size;
+    prot->readListBegin(elemType, size);
+    values.resize(size);
+    for (uint32_t x = 0; x < size; ++x)
+      prot->readDouble(values[x]);
+    prot->readListEnd();
+    elapsed = timer.frame();
+    cout << " 1M double read per element: " << num / (1000 * elapsed) << " kHz" << endl;
+  }
+
+  {
+    std::shared_ptr<TMemoryBuffer> buf2(new TMemoryBuffer(data, datasize));
+    std::shared_ptr<TProtocol> prot(new TBinaryProtocol(buf2));
+    std::vector<double> values;
+    double elapsed = 0.0;
+    Timer timer;
+
+    TType elemType;
+    uint32_t size;
+    prot->readListBegin(elemType, size);
+    values.resize(size);
+    prot->readDoubleArray(values.data(), size);
+    prot->readListEnd();
+    elapsed = timer.frame();
+    cout << " 1M double read array: " << num / (1000 * elapsed) << " kHz" << endl;
+  }
+
+  {
+    buf->resetBuffer();
+    std::shared_ptr<TProtocol> prot(new TCompactProtocol(buf));
+    double elapsed = 0.0;
+    Timer timer;
+
+    listDoubleMillion.write(prot.get());
+    elapsed = timer.frame();
+    cout << "1M double write compact: " << num / (1000 * elapsed) << " kHz" << endl;
+  }
+
+  buf->getBuffer(&data, &datasize);
+
+  {
+    std::shared_ptr<TMemoryBuffer> buf2(new TMemoryBuffer(data, datasize));
+    std::shared_ptr<TProtocol> prot(new TCompactProtocol(buf2));
+    ListDoublePerf listDoubleMillion2;
+    double elapsed = 0.0;
+    Timer timer;
+
+    listDoubleMillion2.read(prot.get());
+    elapsed = timer.frame();
+    cout << " 1M double read compact: " << num / (1000 * elapsed) << " kHz" << endl;
+  }
+
 
   return 0;
 }
@@ -0,0 +1,375 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#define BOOST_TEST_MODULE CoroutineTest
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <thrift/async/TConcurrentClientChannel.h>
+#include <thrift/async/TCoroutine.h>
+#include <thrift/concurrency/Monitor.h>
+#include <thrift/concurrency/ThreadFactory.h>
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/server/TNonblockingServer.h>
+#include <thrift/transport/TBufferTransports.h>
+#include <thrift/transport/TNonblockingServerSocket.h>
+#include <thrift/transport/TSocket.h>
+
+#include "gen-cpp/BackendService.h"
+#include "gen-cpp/FrontendService.h"
+
+#ifdef THRIFT_HAS_COROUTINES
+
+using apache::thrift::TApplicationException;
+using apache::thrift::async::TConcurrentClientChannel;
+using apache::thrift::async::TTask;
+using apache::thrift::async::awaitCallback;
+using apache::thrift::async::syncWait;
+using apache::thrift::async::whenAll;
+using apache::thrift::concurrency::Guard;
+using apache::thrift::concurrency::Monitor;
+using apache::thrift::concurrency::Mutex;
+using apache::thrift::concurrency::Runnable;
+using apache::thrift::concurrency::Synchronized;
+using apache::thrift::concurrency::Thread;
+using apache::thrift::concurrency::ThreadFactory;
+using apache::thrift::protocol::TBinaryProtocol;
+using apache::thrift::protocol::TBinaryProtocolFactory;
+using apache::thrift::protocol::TProtocol;
+using apache::thrift::server::TNonblockingServer;
+using apache::thrift::server::TServerEventHandler;
+using apache::thrift::transport::TFramedTransport;
+using apache::thrift::transport::TNonblockingServerSocket;
+using apache::thrift::transport::TSocket;
+using corotest::BackendServiceAsyncProcessor;
+using corotest::BackendServiceClient;
+using corotest::BackendServiceCoroClient;
+using corotest::BackendServiceCoroIf;
+using corotest::BackendServiceCoroSvIfAdapter;
+using corotest::FrontendServiceAsyncProcessor;
+using corotest::FrontendServiceClient;
+using corotest::FrontendServiceCoroIf;
+using corotest::FrontendServiceCoroSvIfAdapter;
+using corotest::MyError;
+using std::make_shared;
+using std::shared_ptr;
+
+/**
+ * Holds back everyone who waits on it until count of them are waiting.
+ */
+class Latch {
+public:
+  explicit Latch(size_t count) : count_(count) {}
+
+  auto arriveAndWait() {
+    return awaitCallback([this](std::function<void()> done) {
+      std::vector<std::function<void()> > release;
+      {
+        Guard g(mutex_);
+        waiting_.push_back(done);
+        if (waiting_.size() == count_) {
+          release.swap(waiting_);
+        }
+      }
+      for (auto& waiter : release) {
+        waiter();
+      }
+    });
+  }
+
+private:
+  size_t count_;
+  Mutex mutex_;
+  std::vector<std::function<void()> > waiting_;
+};
+
+/**
+ * The back end, a coroutine handler that never waits on anything but the
+ * latch.
+ */
+class BackendHandler : public BackendServiceCoroIf {
+public:
+  BackendHandler() : generation_(0), value_(0), latch_(4) {}
+
+  TTask<int32_t> incrementGeneration() override { co_return ++generation_; }
+  TTask<int32_t> getGeneration() override { co_return generation_.load(); }
+  TTask<void> addString(std::string s) override {
+    Guard g(mutex_);
+    strings_.push_back(s);
+    co_return;
+  }
+  TTask<std::vector<std::string> > getStrings() override {
+    Guard g(mutex_);
+    co_return strings_;
+  }
+  TTask<std::string> getDataWait(int32_t length) override {
+    // only answers once four calls are in at once
+    co_await latch_.arriveAndWait();
+    co_return std::string(length, 'x');
+  }
+  TTask<void> onewayWait() override { co_return; }
+  TTask<void> exceptionWait(std::string message) override {
+    MyError error;
+    error.message = message;
+    throw error;
+    co_return;
+  }
+  TTask<void> unexpectedExceptionWait(std::string message) override {
+    throw std::runtime_error(message);
+    co_return;
+  }
+  TTask<int32_t> setValue(int32_t value) override {
+    int32_t old = value_.exchange(value);
+    co_return old;
+  }
+  TTask<int32_t> getValue() override { co_return value_.load(); }
+
+private:
+  std::atomic<int32_t> generation_;
+  std::atomic<int32_t> value_;
+  Latch latch_;
+  Mutex mutex_;
+  std::vector<std::string> strings_;
+};
+
+/**
+ * The front end, which answers by calling the back end through a channel
+ * per shard.
+ */
+class FrontendHandler : public FrontendServiceCoroIf {
+public:
+  FrontendHandler(std::vector<shared_ptr<BackendServiceCoroClient> > shards) : shards_(shards) {}
+
+  TTask<int32_t> incrementGeneration() override {
+    size_t shard = next_++ % shards_.size();
+    co_return co_await shards_[shard]->incrementGeneration();
+  }
+  TTask<int32_t> getGeneration() override { co_return co_await shards_[0]->getGeneration(); }
+  TTask<void> addString(std::string s) override { co_await shards_[0]->addString(s); }
+  TTask<std::vector<std::string> > getStrings() override {
+    co_return co_await shards_[0]->getStrings();
+  }
+  TTask<std::string> getDataWait(int32_t length) override {
+    // the back end holds each call until all four are in
+    std::vector<TTask<std::string> > calls;
+    for (auto& shard : shards_) {
+      calls.push_back(shard->getDataWait(length));
+    }
+    std::string data;
+    for (std::string& part : co_await whenAll(std::move(calls))) {
+      data += part;
+    }
+    co_return data;
+  }
+  TTask<void> onewayWait() override { co_await shards_[0]->onewayWait(); }
+  TTask<void> exceptionWait(std::string message) override {
+    co_await shards_[0]->exceptionWait(message);
+  }
+  TTask<void> unexpectedExceptionWait(std::string message) override {
+    co_await shards_[0]->unexpectedExceptionWait(message);
+  }
+
+private:
+  std::vector<shared_ptr<BackendServiceCoroClient> > shards_;
+  std::atomic<size_t> next_{0};
+};
+
+class ServerThread {
+  struct ReadyHandler : public TServerEventHandler {
+    ReadyHandler() : ready(false) {}
+    void preServe() override {
+      Synchronized s(monitor);
+      ready = true;
+      monitor.notifyAll();
+    }
+    Monitor monitor;
+    bool ready;
+  };
+
+  struct Runner : public Runnable {
+    Runner(shared_ptr<TNonblockingServer> server) : server(server) {}
+    void run() override { server->serve(); }
+    shared_ptr<TNonblockingServer> server;
+  };
+
+public:
+  ServerThread(shared_ptr<apache::thrift::async::TAsyncProcessor> processor)
+    : ready_(make_shared<ReadyHandler>()) {
+    server_ = make_shared<TNonblockingServer>(processor,
+                                              make_shared<TBinaryProtocolFactory>(),
+                                              make_shared<TNonblockingServerSocket>(0));
+    server_->setServerEventHandler(ready_);
+    thread_ = ThreadFactory(false).newThread(make_shared<Runner>(server_));
+    thread_->start();
+    Synchronized s(ready_->monitor);
+    while (!ready_->ready) {
+      ready_->monitor.wait();
+    }
+  }
+
+  ~ServerThread() {
+    server_->stop();
+    thread_->join();
+  }
+
+  int getPort() { return server_->getListenPort(); }
+
+private:
+  shared_ptr<ReadyHandler> ready_;
+  shared_ptr<TNonblockingServer> server_;
+  shared_ptr<Thread> thread_;
+};
+
+template <class Client_>
+shared_ptr<Client_> connect(int port) {
+  auto socket = make_shared<TSocket>("localhost", port);
+  auto transport = make_shared<TFramedTransport>(socket);
+  transport->open();
+  return make_shared<Client_>(make_shared<TBinaryProtocol>(transport));
+}
+
+struct Fixture {
+  Fixture()
+    : backend(make_shared<BackendServiceAsyncProcessor>(
+          make_shared<BackendServiceCoroSvIfAdapter>(make_shared<BackendHandler>()))),
+      protocolFactory(make_shared<TBinaryProtocolFactory>()) {}
+
+  shared_ptr<TConcurrentClientChannel> channel() {
+    return make_shared<TConcurrentClientChannel>(make_shared<TSocket>("localhost",
+                                                                      backend.getPort()),
+                                                 protocolFactory);
+  }
+
+  ServerThread backend;
+  shared_ptr<TBinaryProtocolFactory> protocolFactory;
+};
+
+BOOST_AUTO_TEST_SUITE(CoroutineTest)
+
+BOOST_FIXTURE_TEST_CASE(test_coroutine_server, Fixture) {
+  shared_ptr<BackendServiceClient> client = connect<BackendServiceClient>(backend.getPort());
+  BOOST_CHECK_EQUAL(1, client->incrementGeneration());
+  BOOST_CHECK_EQUAL(0, client->setValue(5));
+  BOOST_CHECK_EQUAL(5, client->getValue());
+  client->addString("foo");
+  std::vector<std::string> strings;
+  client->getStrings(strings);
+  BOOST_REQUIRE_EQUAL(1u, strings.size());
+  BOOST_CHECK_EQUAL("foo", strings[0]);
+  client->onewayWait();
+
+  // declared exceptions are returned as such, and others as
+  // TApplicationExceptions
+  try {
+    client->exceptionWait("declared");
+    BOOST_ERROR("exceptionWait did not throw");
+  } catch (const MyError& error) {
+    BOOST_CHECK_EQUAL("declared", error.message);
+  }
+  BOOST_CHECK_THROW(client->unexpectedExceptionWait("undeclared"), TApplicationException);
+  BOOST_CHECK_EQUAL(1, client->getGeneration());
+}
+
+BOOST_FIXTURE_TEST_CASE(test_coroutine_client, Fixture) {
+  BackendServiceCoroClient client(channel(), protocolFactory.get());
+  BOOST_CHECK_EQUAL(1, syncWait(client.incrementGeneration()));
+  BOOST_CHECK_EQUAL(0, syncWait(client.setValue(7)));
+  syncWait(client.addString("bar"));
+  std::vector<std::string> strings = syncWait(client.getStrings());
+  BOOST_REQUIRE_EQUAL(1u, strings.size());
+  BOOST_CHECK_EQUAL("bar", strings[0]);
+  syncWait(client.onewayWait());
+  BOOST_CHECK_THROW(syncWait(client.exceptionWait("declared")), MyError);
+  BOOST_CHECK_THROW(syncWait(client.unexpectedExceptionWait("undeclared")),
+                    TApplicationException);
+
+  // four calls in flight on one channel at once
+  std::vector<TTask<int32_t> > calls;
+  for (int i = 0; i < 4; ++i) {
+    calls.push_back(client.incrementGeneration());
+  }
+  std::vector<int32_t> generations = syncWait(whenAll(std::move(calls)));
+  BOOST_REQUIRE_EQUAL(4u, generations.size());
+  BOOST_CHECK_EQUAL(5, syncWait(client.getGeneration()));
+}
+
+BOOST_FIXTURE_TEST_CASE(test_fan_out, Fixture) {
+  // a front end with one IO thread and no thread pool, whose calls each wait
+  // on the back end
+  std::vector<shared_ptr<BackendServiceCoroClient> > shards;
+  for (int i = 0; i < 4; ++i) {
+    shards.push_back(make_shared<BackendServiceCoroClient>(channel(), protocolFactory.get()));
+  }
+  ServerThread frontend(make_shared<FrontendServiceAsyncProcessor>(
+      make_shared<FrontendServiceCoroSvIfAdapter>(make_shared<FrontendHandler>(shards))));
+
+  shared_ptr<FrontendServiceClient> client = connect<FrontendServiceClient>(frontend.getPort());
+  std::string data;
+  client->getDataWait(data, 3);
+  BOOST_CHECK_EQUAL(std::string(12, 'x'), data);
+  BOOST_CHECK_THROW(client->exceptionWait("declared"), MyError);
+  BOOST_CHECK_THROW(client->unexpectedExceptionWait("undeclared"), TApplicationException);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.push_back(std::thread([&frontend] {
+      shared_ptr<FrontendServiceClient> client = connect<FrontendServiceClient>(frontend.getPort());
+      for (int i = 0; i < 50; ++i) {
+        client->incrementGeneration();
+      }
+    }));
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  BOOST_CHECK_EQUAL(400, client->getGeneration());
+}
+
+BOOST_AUTO_TEST_CASE(test_lost_connection) {
+  std::unique_ptr<Fixture> fixture(new Fixture);
+  BackendServiceCoroClient client(fixture->channel(), fixture->protocolFactory.get());
+  BOOST_CHECK_EQUAL(1, syncWait(client.incrementGeneration()));
+
+  // a call waiting on the latch is failed when the back end goes away
+  auto call = client.getDataWait(1);
+  std::thread stopper([&fixture] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    fixture.reset();
+  });
+  BOOST_CHECK_THROW(syncWait(std::move(call)), apache::thrift::TException);
+  stopper.join();
+  BOOST_CHECK(client.getChannel()->error());
+  BOOST_CHECK_THROW(syncWait(client.getValue()), apache::thrift::TException);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#else
+
+BOOST_AUTO_TEST_CASE(test_coroutines_unsupported) {
+  BOOST_TEST_MESSAGE("compiled without C++20 coroutines; nothing to test");
+}
+
+#endif // THRIFT_HAS_COROUTINES
@@ -0,0 +1,226 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/protocol/TCompactProtocol.h>
+#include <thrift/protocol/TFieldPath.h>
+#include <thrift/transport/TBufferTransports.h>
+
+#include "gen-cpp/DebugProtoTest_types.h"
+
+BOOST_AUTO_TEST_SUITE(FieldPathTest)
+
+using apache::thrift::TStringView;
+using apache::thrift::protocol::TBinaryProtocol;
+using apache::thrift::protocol::TBinaryProtocolT;
+using apache::thrift::protocol::TCompactProtocol;
+using apache::thrift::protocol::TCompactProtocolT;
+using apache::thrift::protocol::TFieldPath;
+using apache::thrift::protocol::TProtocol;
+using apache::thrift::protocol::readFieldPath;
+using apache::thrift::transport::TMemoryBuffer;
+using std::shared_ptr;
+using std::string;
+using thrift::test::debug::Bonk;
+using thrift::test::debug::CompactProtoTestStruct;
+using thrift::test::debug::Empty;
+using thrift::test::debug::Nesting;
+
+static Nesting makeNesting() {
+  Nesting n;
+  n.my_bonk.type = 31337;
+  n.my_bonk.message = "I am a bonk... xor!";
+  n.my_ooe.im_true = true;
+  n.my_ooe.im_false = false;
+  n.my_ooe.integer32 = -7;
+  n.my_ooe.some_characters = "Debug THIS!";
+  n.my_ooe.zomg_unicode = "\xd7\n\a\t";
+  n.my_ooe.what_who = true;
+  return n;
+}
+
+// Every kind of field to skip, in front of the ones the paths lead to.
+static CompactProtoTestStruct makeCompactProtoTestStruct() {
+  CompactProtoTestStruct s;
+  s.a_byte = 127;
+  s.a_i16 = 32000;
+  s.a_i32 = 1000000000;
+  s.a_i64 = 0xffffffffffLL;
+  s.a_double = 5.6789;
+  s.a_string = "my string";
+  s.true_field = true;
+  s.false_field = false;
+  for (int i = 0; i < 100; ++i) {
+    s.byte_list.push_back(static_cast<int8_t>(i));
+    s.i16_list.push_back(static_cast<int16_t>(i * -300));
+    s.i32_list.push_back(i * 100000);
+    s.i64_list.push_back(static_cast<int64_t>(i) << 40);
+    s.double_list.push_back(i / 3.0);
+    s.string_list.push_back("string");
+    s.boolean_list.push_back(i % 3 == 0);
+    s.i64_set.insert(-i);
+    s.i16_byte_map[static_cast<int16_t>(i)] = 1;
+    s.byte_i64_map[static_cast<int8_t>(i)] = -i;
+    s.byte_double_map[static_cast<int8_t>(i)] = i * 0.5;
+    s.string_byte_map["key" + std::to_string(i)] = 2;
+  }
+  s.struct_list.resize(3);
+  s.byte_list_map[1].push_back(2);
+  s.byte_map_map[3][4] = 5;
+  s.field500 = 500;
+  s.field5000 = 5000;
+  s.field20000 = 20000;
+  return s;
+}
+
+template <class Struct_, class Protocol_>
+static shared_ptr<TMemoryBuffer> serialize(const Struct_& s) {
+  shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer());
+  Protocol_ proto(buf);
+  s.write(&proto);
+  return buf;
+}
+
+template <class Protocol_>
+static void testNesting() {
+  shared_ptr<TMemoryBuffer> buf = serialize<Nesting, Protocol_>(makeNesting());
+  string bytes = buf->getBufferAsString();
+  Protocol_ proto(buf);
+
+  string chars;
+  BOOST_CHECK(readFieldPath(proto, TFieldPath::parse("2.8"), chars));
+  BOOST_CHECK_EQUAL(chars, "Debug THIS!");
+  // The rest of the struct is read too.
+  BOOST_CHECK_EQUAL(buf->available_read(), 0u);
+
+  buf->resetBuffer(reinterpret_cast<uint8_t*>(&bytes[0]), static_cast<uint32_t>(bytes.size()));
+  bool what = false;
+  BOOST_CHECK(readFieldPath(proto, TFieldPath({2, 10}), what));
+  BOOST_CHECK(what);
+
+  buf->resetBuffer(reinterpret_cast<uint8_t*>(&bytes[0]), static_cast<uint32_t>(bytes.size()));
+  int32_t i32 = 0;
+  BOOST_CHECK(readFieldPath(proto, TFieldPath({2, 5}), i32));
+  BOOST_CHECK_EQUAL(i32, -7);
+
+  buf->resetBuffer(reinterpret_cast<uint8_t*>(&bytes[0]), static_cast<uint32_t>(bytes.size()));
+  Bonk bonk;
+  BOOST_CHECK(readFieldPath(proto, TFieldPath({1}), bonk));
+  BOOST_CHECK(bonk == makeNesting().my_bonk);
+
+  buf->resetBuffer(reinterpret_cast<uint8_t*>(&bytes[0]), static_cast<uint32_t>(bytes.size()));
+  Nesting whole;
+  BOOST_CHECK(readFieldPath(proto, TFieldPath(), whole));
+  BOOST_CHECK(whole == makeNesting());
+
+  buf->resetBuffer(reinterpret_cast<uint8_t*>(&bytes[0]), static_cast<uint32_t>(bytes.size()));
+  TStringView view;
+  BOOST_CHECK(readFieldPath(proto, TFieldPath({1, 2}), view));
+  BOOST_CHECK_EQUAL(view.str(), "I am a bonk... xor!");
+
+  // Missing fields, mismatched types and paths through non-structs
+  buf->resetBuffer(reinterpret_cast<uint8_t*>(&bytes[0]), static_cast<uint32_t>(bytes.size()));
+  BOOST_CHECK(!readFieldPath(proto, TFieldPath({2, 99}), i32));
+  buf->resetBuffer(reinterpret_cast<uint8_t*>(&bytes[0]), static_cast<uint32_t>(bytes.size()));
+  BOOST_CHECK(!readFieldPath(proto, TFieldPath({2, 8}), i32));
+  buf->resetBuffer(reinterpret_cast<uint8_t*>(&bytes[0]), static_cast<uint32_t>(bytes.size()));
+  BOOST_CHECK(!readFieldPath(proto, TFieldPath({2, 5, 1}), i32));
+  BOOST_CHECK_EQUAL(i32, -7);
+  BOOST_CHECK_EQUAL(buf->available_read(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(test_nesting_binary_memory_buffer) {
+  testNesting<TBinaryProtocolT<TMemoryBuffer> >();
+}
+
+BOOST_AUTO_TEST_CASE(test_nesting_compact_memory_buffer) {
+  testNesting<TCompactProtocolT<TMemoryBuffer> >();
+}
+
+BOOST_AUTO_TEST_CASE(test_nesting_binary) {
+  testNesting<TBinaryProtocol>();
+}
+
+BOOST_AUTO_TEST_CASE(test_nesting_compact) {
+  testNesting<TCompactProtocol>();
+}
+
+template <class Protocol_>
+static void testSkip() {
+  CompactProtoTestStruct s = makeCompactProtoTestStruct();
+
+  // Two structs back to back, as in a log: each read leaves the next in place.
+  shared_ptr<TMemoryBuffer> buf = serialize<CompactProtoTestStruct, Protocol_>(s);
+  Protocol_ writer(buf);
+  s.field20000 = -1;
+  s.write(&writer);
+
+  Protocol_ proto(buf);
+  int64_t value = 0;
+  BOOST_CHECK(readFieldPath(proto, TFieldPath({20000}), value));
+  BOOST_CHECK_EQUAL(value, 20000);
+  BOOST_CHECK(readFieldPath(proto, TFieldPath({20000}), value));
+  BOOST_CHECK_EQUAL(value, -1);
+  BOOST_CHECK_EQUAL(buf->available_read(), 0u);
+
+  // The same through TProtocol, which skips with TProtocol::skip()
+  buf = serialize<CompactProtoTestStruct, Protocol_>(s);
+  shared_ptr<TProtocol> generic(new Protocol_(buf));
+  BOOST_CHECK(readFieldPath(*generic, TFieldPath({5000}), value));
+  BOOST_CHECK_EQUAL(value, 5000);
+  BOOST_CHECK_EQUAL(buf->available_read(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(test_skip_binary) {
+  testSkip<TBinaryProtocolT<TMemoryBuffer> >();
+}
+
+BOOST_AUTO_TEST_CASE(test_skip_compact) {
+  testSkip<TCompactProtocolT<TMemoryBuffer> >();
+}
+
+BOOST_AUTO_TEST_CASE(test_truncated) {
+  shared_ptr<TMemoryBuffer> buf
+      = serialize<CompactProtoTestStruct, TCompactProtocolT<TMemoryBuffer> >(
+          makeCompactProtoTestStruct());
+  string bytes = buf->getBufferAsString();
+  bytes.resize(bytes.size() / 2);
+  buf->resetBuffer(reinterpret_cast<uint8_t*>(&bytes[0]), static_cast<uint32_t>(bytes.size()));
+  TCompactProtocolT<TMemoryBuffer> proto(buf);
+  int64_t value = 0;
+  BOOST_CHECK_THROW(readFieldPath(proto, TFieldPath({20000}), value),
+                    apache::thrift::transport::TTransportException);
+}
+
+BOOST_AUTO_TEST_CASE(test_parse) {
+  BOOST_CHECK(TFieldPath::parse("").empty());
+  BOOST_CHECK(TFieldPath::parse("7").getIds() == std::vector<int16_t>({7}));
+  BOOST_CHECK(TFieldPath::parse("1.3.-2").getIds() == std::vector<int16_t>({1, 3, -2}));
+  BOOST_CHECK_THROW(TFieldPath::parse("1..2"), std::invalid_argument);
+  BOOST_CHECK_THROW(TFieldPath::parse("1."), std::invalid_argument);
+  BOOST_CHECK_THROW(TFieldPath::parse("a"), std::invalid_argument);
+  BOOST_CHECK_THROW(TFieldPath::parse(" 1"), std::invalid_argument);
+  BOOST_CHECK_THROW(TFieldPath::parse("40000"), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
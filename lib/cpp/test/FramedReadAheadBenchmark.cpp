@@ -0,0 +1,126 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Measures how many reads TFramedTransport issues on its underlying socket
+ * per frame when a client pipelines many small frames, with and without
+ * read-ahead framing.
+ */
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <thrift/transport/PlatformSocket.h>
+#include <thrift/transport/TBufferTransports.h>
+#include <thrift/transport/TSocket.h>
+
+using namespace apache::thrift::transport;
+
+/**
+ * Passes everything through to a socket, counting the read() calls that
+ * reach it.  Each one is a recv() syscall.
+ */
+class TCountingSocket : public TVirtualTransport<TCountingSocket> {
+public:
+  TCountingSocket(std::shared_ptr<TSocket> socket) : socket_(socket), reads_(0) {}
+
+  bool isOpen() const override { return socket_->isOpen(); }
+  bool peek() override { return socket_->peek(); }
+  void open() override { socket_->open(); }
+  void close() override { socket_->close(); }
+
+  uint32_t read(uint8_t* buf, uint32_t len) {
+    ++reads_;
+    return socket_->read(buf, len);
+  }
+
+  void write(const uint8_t* buf, uint32_t len) { socket_->write(buf, len); }
+
+  uint64_t getReads() const { return reads_; }
+
+private:
+  std::shared_ptr<TSocket> socket_;
+  uint64_t reads_;
+};
+
+static void run(uint32_t readAheadSize, uint32_t frameSize) {
+  const int rounds = 1000;
+  const int framesPerRound = 64;
+
+  THRIFT_SOCKET sv[2];
+  if (THRIFT_SOCKETPAIR(PF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+    std::cerr << "socketpair() failed" << std::endl;
+    return;
+  }
+  std::shared_ptr<TSocket> clientSocket(new TSocket(sv[0]));
+  std::shared_ptr<TCountingSocket> serverSocket(
+      new TCountingSocket(std::shared_ptr<TSocket>(new TSocket(sv[1]))));
+
+  TFramedTransport client(clientSocket);
+  TFramedTransport server(serverSocket);
+  if (readAheadSize > 0) {
+    server.setReadAheadBufferSize(readAheadSize);
+  }
+
+  std::vector<uint8_t> payload(frameSize, 'x');
+  std::vector<uint8_t> out(frameSize);
+
+  // A pipelining client writes every batch back to back on its own thread,
+  // so it never waits for a response and can run ahead of the server.  It
+  // blocks only once the socket buffer is full, until the server drains it.
+  std::thread writer([&client, &payload, frameSize, rounds, framesPerRound]() {
+    for (int r = 0; r < rounds; ++r) {
+      for (int f = 0; f < framesPerRound; ++f) {
+        client.write(&payload[0], frameSize);
+        client.flush();
+      }
+    }
+  });
+
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    for (int f = 0; f < framesPerRound; ++f) {
+      server.readAll(&out[0], frameSize);
+      server.readEnd();
+    }
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  writer.join();
+
+  const double frames = static_cast<double>(rounds) * framesPerRound;
+  std::cout << "  frame " << frameSize << "B, read-ahead "
+            << (readAheadSize > 0 ? std::to_string(readAheadSize) + "B" : std::string("off"))
+            << ": " << serverSocket->getReads() / frames << " reads/frame, "
+            << std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / frames
+            << " ns/frame" << std::endl;
+}
+
+int main() {
+  std::cout << "TFramedTransport pipelined read cost" << std::endl;
+  uint32_t frameSizes[] = {16, 128, 1024};
+  for (uint32_t frameSize : frameSizes) {
+    run(0, frameSize);
+    run(16 * 1024, frameSize);
+    run(64 * 1024, frameSize);
+  }
+  return 0;
+}
@@ -102,6 +102,48 @@ public:
   static uint32_t read(std::shared_ptr<apache::thrift::protocol::TProtocol> proto, std::string& val) {
     return proto->readString(val);
   }
+
+  /* Array functions */
+
+  static uint32_t writeArray(std::shared_ptr<apache::thrift::protocol::TProtocol> proto, const int8_t* vals, uint32_t count) {
+    return proto->writeByteArray(vals, count);
+  }
+
+  static uint32_t writeArray(std::shared_ptr<apache::thrift::protocol::TProtocol> proto, const int16_t* vals, uint32_t count) {
+    return proto->writeI16Array(vals, count);
+  }
+
+  static uint32_t writeArray(std::shared_ptr<apache::thrift::protocol::TProtocol> proto, const int32_t* vals, uint32_t count) {
+    return proto->writeI32Array(vals, count);
+  }
+
+  static uint32_t writeArray(std::shared_ptr<apache::thrift::protocol::TProtocol> proto, const int64_t* vals, uint32_t count) {
+    return proto->writeI64Array(vals, count);
+  }
+
+  static uint32_t writeArray(std::shared_ptr<apache::thrift::protocol::TProtocol> proto, const double* vals, uint32_t count) {
+    return proto->writeDoubleArray(vals, count);
+  }
+
+  static uint32_t readArray(std::shared_ptr<apache::thrift::protocol::TProtocol> proto, int8_t* vals, uint32_t count) {
+    return proto->readByteArray(vals, count);
+  }
+
+  static uint32_t readArray(std::shared_ptr<apache::thrift::protocol::TProtocol> proto, int16_t* vals, uint32_t count) {
+    return proto->readI16Array(vals, count);
+  }
+
+  static uint32_t readArray(std::shared_ptr<apache::thrift::protocol::TProtocol> proto, int32_t* vals, uint32_t count) {
+    return proto->readI32Array(vals, count);
+  }
+
+  static uint32_t readArray(std::shared_ptr<apache::thrift::protocol::TProtocol> proto, int64_t* vals, uint32_t count) {
+    return proto->readI64Array(vals, count);
+  }
+
+  static uint32_t readArray(std::shared_ptr<apache::thrift::protocol::TProtocol> proto, double* vals, uint32_t count) {
+    return proto->readDoubleArray(vals, count);
+  }
 };
 
 #endif
@@ -56,7 +56,7 @@ BOOST_AUTO_TEST_CASE(test_json_proto_1) {
   const std::string expected_result(
   "{\"1\":{\"tf\":1},\"2\":{\"tf\":0},\"3\":{\"i8\":127},\"4\":{\"i16\":27000},"
   "\"5\":{\"i32\":16777216},\"6\":{\"i64\":6000000000},\"7\":{\"dbl\":3.1415926"
-  "535897931},\"8\":{\"str\":\"JSON THIS! \\\"\\u0001\"},\"9\":{\"str\":\"\xd7\\"
+  "53589793},\"8\":{\"str\":\"JSON THIS! \\\"\\u0001\"},\"9\":{\"str\":\"\xd7\\"
   "n\\u0007\\t\"},\"10\":{\"tf\":0},\"11\":{\"str\":\"AQIDrQ\"},\"12\":{\"lst\""
   ":[\"i8\",3,1,2,3]},\"13\":{\"lst\":[\"i16\",3,1,2,3]},\"14\":{\"lst\":[\"i64"
   "\",3,1,2,3]}}");
@@ -95,7 +95,7 @@ BOOST_AUTO_TEST_CASE(test_json_proto_2) {
     "{\"1\":{\"rec\":{\"1\":{\"i32\":31337},\"2\":{\"str\":\"I am a bonk... xor"
     "!\"}}},\"2\":{\"rec\":{\"1\":{\"tf\":1},\"2\":{\"tf\":0},\"3\":{\"i8\":127"
     "},\"4\":{\"i16\":16},\"5\":{\"i32\":32},\"6\":{\"i64\":64},\"7\":{\"dbl\":"
-    "1.6180339887498949},\"8\":{\"str\":\":R (me going \\\"rrrr\\\")\"},\"9\":{"
+    "1.618033988749895},\"8\":{\"str\":\":R (me going \\\"rrrr\\\")\"},\"9\":{"
     "\"str\":\"ӀⅮΝ Нοⅿоɡгаρℎ Αttαⅽκǃ‼\"},\"10\":{\"tf\":0},\"11\":{\"str\":\""
     "AQIDrQ\"},\"12\":{\"lst\":[\"i8\",3,1,2,3]},\"13\":{\"lst\":[\"i16\",3,1,2"
     ",3]},\"14\":{\"lst\":[\"i64\",3,1,2,3]}}}}"
@@ -159,12 +159,12 @@ BOOST_AUTO_TEST_CASE(test_json_proto_3) {
   const std::string expected_result(
   "{\"1\":{\"lst\":[\"rec\",2,{\"1\":{\"tf\":1},\"2\":{\"tf\":0},\"3\":{\"i8\":"
   "34},\"4\":{\"i16\":27000},\"5\":{\"i32\":16777216},\"6\":{\"i64\":6000000000"
-  "},\"7\":{\"dbl\":3.1415926535897931},\"8\":{\"str\":\"JSON THIS! \\\"\\u0001"
+  "},\"7\":{\"dbl\":3.141592653589793},\"8\":{\"str\":\"JSON THIS! \\\"\\u0001"
   "\"},\"9\":{\"str\":\"\xd7\\n\\u0007\\t\"},\"10\":{\"tf\":0},\"11\":{\"str\":"
   "\"AQIDrQ\"},\"12\":{\"lst\":[\"i8\",3,1,2,3]},\"13\":{\"lst\":[\"i16\",3,1,2"
   ",3]},\"14\":{\"lst\":[\"i64\",3,1,2,3]}},{\"1\":{\"tf\":1},\"2\":{\"tf\":0},"
   "\"3\":{\"i8\":51},\"4\":{\"i16\":16},\"5\":{\"i32\":32},\"6\":{\"i64\":64},"
-  "\"7\":{\"dbl\":1.6180339887498949},\"8\":{\"str\":\":R (me going \\\"rrrr\\\""
+  "\"7\":{\"dbl\":1.618033988749895},\"8\":{\"str\":\":R (me going \\\"rrrr\\\""
   ")\"},\"9\":{\"str\":\"ӀⅮΝ Нοⅿоɡгаρℎ Αttαⅽκǃ‼\"},\"10\":{\"tf\":0},\"11\":{"
   "\"str\":\"AQIDrQ\"},\"12\":{\"lst\":[\"i8\",3,1,2,3]},\"13\":{\"lst\":[\"i16"
   "\",3,1,2,3]},\"14\":{\"lst\":[\"i64\",3,1,2,3]}}]},\"2\":{\"set\":[\"lst\",3"
@@ -225,8 +225,8 @@ BOOST_AUTO_TEST_CASE(test_json_proto_6) {
 
   const std::string expected_result(
   "{\"1\":{\"dbl\":\"NaN\"},\"2\":{\"dbl\":\"Infinity\"},\"3\":{\"dbl\":\"-Infi"
-  "nity\"},\"4\":{\"dbl\":3.3333333333333335},\"5\":{\"dbl\":9.9999999999999994e+"
-  "304},\"6\":{\"dbl\":1e-305},\"7\":{\"dbl\":0},\"8\":{\"dbl\":-0}}"
+  "nity\"},\"4\":{\"dbl\":3.3333333333333335},\"5\":{\"dbl\":1e+305"
+  "},\"6\":{\"dbl\":1e-305},\"7\":{\"dbl\":0},\"8\":{\"dbl\":-0}}"
   );
 
   std::shared_ptr<TMemoryBuffer> buffer(new TMemoryBuffer());
@@ -350,3 +350,61 @@ BOOST_AUTO_TEST_CASE(test_json_unicode_escaped_missing_hi_surrogate) {
   BOOST_CHECK_THROW(ooe2.read(proto.get()),
     apache::thrift::protocol::TProtocolException);
 }
+
+BOOST_AUTO_TEST_CASE(test_json_shortest_doubles) {
+  // written with as few digits as read back exactly, whatever the field names
+  Doubles dub;
+  dub.nan = 0.1;
+  dub.inf = 1E+16;
+  dub.neginf = -1E+17;
+  dub.repeating = 5E-324;
+  dub.big = 1.7976931348623157E+308;
+  dub.tiny = 0.0001;
+  dub.zero = 1E-5;
+  dub.negzero = -123.456;
+
+  const std::string expected_result(
+  "{\"1\":{\"dbl\":0.1},\"2\":{\"dbl\":10000000000000000},\"3\":{\"dbl\":-1e+1"
+  "7},\"4\":{\"dbl\":5e-324},\"5\":{\"dbl\":1.7976931348623157e+308},\"6\":{\"d"
+  "bl\":0.0001},\"7\":{\"dbl\":1e-05},\"8\":{\"dbl\":-123.456}}"
+  );
+
+  std::shared_ptr<TMemoryBuffer> buffer(new TMemoryBuffer());
+  std::shared_ptr<TJSONProtocol> proto(new TJSONProtocol(buffer));
+  dub.write(proto.get());
+  BOOST_CHECK_MESSAGE(!expected_result.compare(buffer->getBufferAsString()),
+    "Expected:\n" << expected_result << "\nGotten:\n"
+                  << buffer->getBufferAsString());
+
+  Doubles dub_1;
+  dub_1.read(proto.get());
+  BOOST_CHECK(dub == dub_1);
+}
+
+BOOST_AUTO_TEST_CASE(test_json_long_strings) {
+  // long enough to be scanned in blocks, with escapes at every offset in a
+  // block and a run of non-ASCII characters
+  std::string chars;
+  for (int i = 0; i < 40; ++i) {
+    chars += std::string(i, 'x') + "\"\\\n\x01\x1f/";
+  }
+  chars += "\xd7\x90\xd7\x91\xd7\x92";
+
+  std::shared_ptr<TMemoryBuffer> buffer(new TMemoryBuffer());
+  std::shared_ptr<TJSONProtocol> proto(new TJSONProtocol(buffer));
+  OneOfEach ooe2;
+  ooe2.some_characters = chars;
+  ooe2.zomg_unicode = chars;
+  ooe2.write(proto.get());
+
+  const std::string written = buffer->getBufferAsString();
+  BOOST_CHECK(written.find("x\\\"\\\\\\n\\u0001\\u001f/x") != std::string::npos);
+
+  // read it back through a transport that lends a few bytes at a time
+  std::shared_ptr<transport::TBufferedTransport> trans(
+    new transport::TBufferedTransport(buffer, 7));
+  std::shared_ptr<TJSONProtocol> proto2(new TJSONProtocol(trans));
+  OneOfEach ooe3;
+  ooe3.read(proto2.get());
+  BOOST_CHECK(ooe2 == ooe3);
+}
@@ -0,0 +1,205 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <memory>
+#include <string>
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/protocol/TCompactProtocol.h>
+#include <thrift/protocol/TJSONProtocol.h>
+#include <thrift/transport/TBufferTransports.h>
+
+#include "gen-cpp/LazyFieldTest_types.h"
+
+BOOST_AUTO_TEST_SUITE(LazyFieldTest)
+
+using apache::thrift::protocol::TBinaryProtocol;
+using apache::thrift::protocol::TCompactProtocol;
+using apache::thrift::protocol::TJSONProtocol;
+using apache::thrift::protocol::TProtocol;
+using apache::thrift::protocol::TProtocolException;
+using apache::thrift::transport::TBufferedTransport;
+using apache::thrift::transport::TMemoryBuffer;
+using lazytest::Envelope;
+using lazytest::Payload;
+using std::shared_ptr;
+using std::string;
+
+static Payload makePayload(const string& name) {
+  Payload p;
+  p.name = name;
+  for (int64_t i = 0; i < 100; ++i) {
+    p.values.push_back(i * 1000003);
+  }
+  p.weights["w"] = 0.5;
+  return p;
+}
+
+static Envelope makeEnvelope() {
+  Envelope e;
+  e.id = 7;
+  e.payload = makePayload("payload");
+  e.history.mutate().push_back(makePayload("first"));
+  e.history.mutate().push_back(makePayload("second"));
+  e.__set_extra(makePayload("extra"));
+  e.counts.mutate()["b"] = 2;
+  e.note = "note";
+  return e;
+}
+
+template <class Protocol_>
+static string serialize(const Envelope& e) {
+  shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer());
+  Protocol_ proto(buf);
+  e.write(&proto);
+  return buf->getBufferAsString();
+}
+
+template <class Protocol_>
+static Envelope deserialize(const string& bytes) {
+  shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer());
+  buf->write(reinterpret_cast<const uint8_t*>(bytes.data()), static_cast<uint32_t>(bytes.size()));
+  Protocol_ proto(buf);
+  Envelope e;
+  e.read(&proto);
+  return e;
+}
+
+BOOST_AUTO_TEST_CASE(test_defaults) {
+  Envelope e;
+  BOOST_CHECK(!e.payload.isPending());
+  BOOST_CHECK_EQUAL(e.counts->size(), 1u);
+  BOOST_CHECK_EQUAL(e.counts->at("a"), 1);
+}
+
+template <class Protocol_>
+static void passThrough() {
+  string bytes = serialize<Protocol_>(makeEnvelope());
+  Envelope in = deserialize<Protocol_>(bytes);
+  BOOST_CHECK(in.payload.isPending());
+  BOOST_CHECK(in.history.isPending());
+  BOOST_CHECK(in.extra.isPending());
+  BOOST_CHECK(in.counts.isPending());
+
+  // Untouched fields go back out as the bytes they came in as.
+  BOOST_CHECK(serialize<Protocol_>(in) == bytes);
+  BOOST_CHECK(in.payload.isPending());
+
+  BOOST_CHECK_EQUAL(in.payload->name, "payload");
+  BOOST_CHECK(!in.payload.isPending());
+  BOOST_CHECK(in.history.isPending());
+  BOOST_CHECK(in == makeEnvelope());
+  BOOST_CHECK(serialize<Protocol_>(in) == bytes);
+}
+
+BOOST_AUTO_TEST_CASE(test_binary_pass_through) {
+  passThrough<TBinaryProtocol>();
+}
+
+BOOST_AUTO_TEST_CASE(test_compact_pass_through) {
+  passThrough<TCompactProtocol>();
+}
+
+BOOST_AUTO_TEST_CASE(test_mutate) {
+  Envelope in = deserialize<TBinaryProtocol>(serialize<TBinaryProtocol>(makeEnvelope()));
+  in.history.mutate()[1].name = "changed";
+  BOOST_CHECK(!in.history.isPending());
+
+  Envelope out = deserialize<TBinaryProtocol>(serialize<TBinaryProtocol>(in));
+  BOOST_CHECK_EQUAL(out.history->at(1).name, "changed");
+  BOOST_CHECK(out.payload.get() == makePayload("payload"));
+
+  out.payload = makePayload("assigned");
+  BOOST_CHECK(!out.payload.isPending());
+  BOOST_CHECK_EQUAL(out.payload->name, "assigned");
+}
+
+BOOST_AUTO_TEST_CASE(test_cross_protocol) {
+  // Pending bytes are re-encoded when written with a different protocol.
+  Envelope in = deserialize<TBinaryProtocol>(serialize<TBinaryProtocol>(makeEnvelope()));
+  string compact = serialize<TCompactProtocol>(in);
+  BOOST_CHECK(compact == serialize<TCompactProtocol>(makeEnvelope()));
+  BOOST_CHECK(deserialize<TCompactProtocol>(compact) == makeEnvelope());
+}
+
+BOOST_AUTO_TEST_CASE(test_eager_protocol) {
+  // TJSONProtocol cannot encode a value on its own, so fields decode at once.
+  Envelope in = deserialize<TJSONProtocol>(serialize<TJSONProtocol>(makeEnvelope()));
+  BOOST_CHECK(!in.payload.isPending());
+  BOOST_CHECK(!in.history.isPending());
+  BOOST_CHECK(in == makeEnvelope());
+}
+
+BOOST_AUTO_TEST_CASE(test_buffered_transport) {
+  // A read buffer smaller than each value makes the field copy its bytes out
+  // as they are read rather than take them from the buffer.
+  string bytes = serialize<TBinaryProtocol>(makeEnvelope());
+  shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer());
+  buf->write(reinterpret_cast<const uint8_t*>(bytes.data()), static_cast<uint32_t>(bytes.size()));
+  shared_ptr<TBufferedTransport> trans(new TBufferedTransport(buf, 16));
+  TBinaryProtocol proto(trans);
+
+  Envelope in;
+  uint32_t xfer = in.read(&proto);
+  BOOST_CHECK_EQUAL(xfer, bytes.size());
+  BOOST_CHECK(in.payload.isPending());
+  BOOST_CHECK(serialize<TBinaryProtocol>(in) == bytes);
+  BOOST_CHECK(in == makeEnvelope());
+}
+
+template <class Protocol_>
+static void readLimited(const string& bytes, int32_t stringLimit, int32_t containerLimit) {
+  shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer());
+  buf->write(reinterpret_cast<const uint8_t*>(bytes.data()), static_cast<uint32_t>(bytes.size()));
+  Protocol_ proto(buf, stringLimit, containerLimit);
+  Envelope in;
+  in.read(&proto);
+  in.payload.get();
+}
+
+static void readLimitedBinary(const string& bytes, int32_t stringLimit, int32_t containerLimit) {
+  shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer());
+  buf->write(reinterpret_cast<const uint8_t*>(bytes.data()), static_cast<uint32_t>(bytes.size()));
+  TBinaryProtocol proto(buf, stringLimit, containerLimit, false, true);
+  Envelope in;
+  in.read(&proto);
+  in.payload.get();
+}
+
+BOOST_AUTO_TEST_CASE(test_size_limits) {
+  // Lazy fields are held to the limits of the protocol they were read with,
+  // just as eagerly decoded ones are.  "payload" is 7 bytes, and each list of
+  // values 100 long.
+  string binary = serialize<TBinaryProtocol>(makeEnvelope());
+  BOOST_CHECK_NO_THROW(readLimitedBinary(binary, 7, 100));
+  BOOST_CHECK_THROW(readLimitedBinary(binary, 6, 100), TProtocolException);
+  BOOST_CHECK_THROW(readLimitedBinary(binary, 7, 99), TProtocolException);
+
+  string compact = serialize<TCompactProtocol>(makeEnvelope());
+  BOOST_CHECK_NO_THROW(readLimited<TCompactProtocol>(compact, 7, 100));
+  BOOST_CHECK_THROW(readLimited<TCompactProtocol>(compact, 6, 100), TProtocolException);
+  BOOST_CHECK_THROW(readLimited<TCompactProtocol>(compact, 7, 99), TProtocolException);
+}
+
+BOOST_AUTO_TEST_CASE(test_to_string) {
+  Envelope e = deserialize<TBinaryProtocol>(serialize<TBinaryProtocol>(makeEnvelope()));
+  BOOST_CHECK(apache::thrift::to_string(e) == apache::thrift::to_string(makeEnvelope()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,42 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+// Generated with cpp:lazy, for use in LazyFieldTest.cpp
+namespace cpp lazytest
+
+struct Payload {
+  1: string name,
+  2: list<i64> values,
+  3: map<string, double> weights
+}
+
+struct Envelope {
+  1: i32 id,
+  2: Payload payload (cpp.lazy),
+  3: list<Payload> history (cpp.lazy),
+  4: optional Payload extra (cpp.lazy),
+  5: map<string, i32> counts = {"a": 1} (cpp.lazy),
+  // Base types are never lazy
+  6: string note (cpp.lazy)
+}
+
+service LazyService {
+  Envelope echo(1: Envelope envelope)
+}
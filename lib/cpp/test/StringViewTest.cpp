@@ -0,0 +1,166 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <memory>
+#include <string>
+#include <thrift/TStringView.h>
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/protocol/TCompactProtocol.h>
+#include <thrift/protocol/TJSONProtocol.h>
+#include <thrift/transport/TBufferTransports.h>
+
+#include "gen-cpp/StringViewTest_types.h"
+
+BOOST_AUTO_TEST_SUITE(StringViewTest)
+
+using apache::thrift::TStringView;
+using apache::thrift::protocol::TBinaryProtocol;
+using apache::thrift::protocol::TCompactProtocol;
+using apache::thrift::protocol::TJSONProtocol;
+using apache::thrift::protocol::TProtocolException;
+using apache::thrift::transport::TBufferedTransport;
+using apache::thrift::transport::TFramedTransport;
+using apache::thrift::transport::TMemoryBuffer;
+using apache::thrift::transport::TTransportException;
+using std::shared_ptr;
+using std::string;
+using stringviewtest::Payload;
+
+static Payload makePayload(const string& owner) {
+  Payload p;
+  p.name = TStringView(owner.data(), 5);
+  p.blob = TStringView(owner.data() + 5, 3);
+  p.tags.push_back("a");
+  p.tags.push_back("bc");
+  p.counts["x"] = 1;
+  p.counts["yz"] = 2;
+  p.copied = "owned";
+  p.__set_note("note");
+  return p;
+}
+
+static void checkPayload(const Payload& p) {
+  BOOST_CHECK_EQUAL("hello", p.name);
+  BOOST_CHECK_EQUAL(string("\0\1\2", 3), p.blob.str());
+  BOOST_REQUIRE_EQUAL(2u, p.tags.size());
+  BOOST_CHECK_EQUAL("bc", p.tags[1]);
+  BOOST_CHECK_EQUAL(2, p.counts.at("yz"));
+  BOOST_CHECK_EQUAL("owned", p.copied);
+  BOOST_CHECK(p.__isset.note);
+  BOOST_CHECK_EQUAL("note", p.note);
+}
+
+BOOST_AUTO_TEST_CASE(test_default_value) {
+  Payload p;
+  BOOST_CHECK_EQUAL("default", p.name);
+  BOOST_CHECK(p.blob.empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_binary_memory_buffer) {
+  string owner("hello\0\1\2", 8);
+  shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer());
+  TBinaryProtocol proto(buf);
+  makePayload(owner).write(&proto);
+
+  uint8_t* start;
+  uint32_t len;
+  buf->getBuffer(&start, &len);
+  const char* begin = reinterpret_cast<const char*>(start);
+
+  Payload in;
+  in.read(&proto);
+  checkPayload(in);
+  BOOST_CHECK(in == makePayload(owner));
+
+  // Nothing was copied: the fields point into the memory buffer.
+  BOOST_CHECK(in.name.data() >= begin && in.name.data() < begin + len);
+  BOOST_CHECK(in.tags[0].data() >= begin && in.tags[0].data() < begin + len);
+}
+
+BOOST_AUTO_TEST_CASE(test_compact_framed) {
+  string owner("hello\0\1\2", 8);
+  shared_ptr<TMemoryBuffer> wire(new TMemoryBuffer());
+  shared_ptr<TFramedTransport> framed(new TFramedTransport(wire));
+  TCompactProtocol proto(framed);
+
+  makePayload(owner).write(&proto);
+  framed->flush();
+
+  Payload in;
+  in.read(&proto);
+  checkPayload(in);
+
+  // The views alias the frame buffer, not the wire they were read from.
+  wire->resetBuffer();
+  string garbage(64, 'z');
+  wire->write(reinterpret_cast<const uint8_t*>(garbage.data()),
+              static_cast<uint32_t>(garbage.size()));
+  framed->readEnd();
+  checkPayload(in);
+}
+
+BOOST_AUTO_TEST_CASE(test_buffered_transport_cannot_lend) {
+  shared_ptr<TMemoryBuffer> wire(new TMemoryBuffer());
+  shared_ptr<TBufferedTransport> buffered(new TBufferedTransport(wire));
+  TBinaryProtocol proto(buffered);
+  proto.writeString(string("abc"));
+  buffered->flush();
+
+  TStringView view;
+  BOOST_CHECK_THROW(proto.readStringView(view), TProtocolException);
+}
+
+BOOST_AUTO_TEST_CASE(test_truncated_string) {
+  shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer());
+  TCompactProtocol proto(buf);
+  proto.writeString(string("abcdef"));
+  string bytes = buf->getBufferAsString();
+  buf->resetBuffer();
+  buf->write(reinterpret_cast<const uint8_t*>(bytes.data()),
+             static_cast<uint32_t>(bytes.size() - 2));
+
+  TStringView view;
+  BOOST_CHECK_THROW(proto.readStringView(view), TTransportException);
+}
+
+BOOST_AUTO_TEST_CASE(test_other_protocols_copy_on_write) {
+  string owner("hello\0\1\2", 8);
+  shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer());
+  TJSONProtocol proto(buf);
+  makePayload(owner).write(&proto);
+  BOOST_CHECK(buf->getBufferAsString().find("\"hello\"") != string::npos);
+
+  TStringView view;
+  BOOST_CHECK_THROW(proto.readStringView(view), TProtocolException);
+}
+
+BOOST_AUTO_TEST_CASE(test_view_compare) {
+  string s("abc");
+  TStringView v(s);
+  BOOST_CHECK(v == "abc");
+  BOOST_CHECK(v == s);
+  BOOST_CHECK(v != TStringView("ab"));
+  BOOST_CHECK(TStringView("ab") < v);
+  BOOST_CHECK(v < TStringView("abd"));
+  BOOST_CHECK(TStringView() < v);
+  BOOST_CHECK_EQUAL("abc", v.str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -604,6 +604,74 @@ BOOST_AUTO_TEST_CASE( test_FramedTransport_Write_Read ) {
   }
 }
 
+BOOST_AUTO_TEST_CASE( test_FramedTransport_Read_Ahead ) {
+  init_data();
+
+  int frame_sizes[] = { 0, 1, 3, 12, 100, 511, 2000, 5000 };
+  uint32_t ra_sizes[] = { 16, 100, 512, 4096, 1<<16 };
+  double full_probs[] = { 1.0, 0.5, 0.1 };
+
+  for (uint32_t ra_size : ra_sizes) {
+    for (double full_prob : full_probs) {
+      shared_ptr<TMemoryBuffer> buffer(new TMemoryBuffer());
+      TFramedTransport writer(buffer);
+      int offset = 0;
+      for (int fsize : frame_sizes) {
+        writer.write(&data[offset], fsize);
+        writer.flush();
+        offset += fsize;
+      }
+
+      shared_ptr<TShortReadTransport> shorter(new TShortReadTransport(buffer, full_prob));
+      TFramedTransport trans(shorter);
+      trans.setReadAheadBufferSize(ra_size);
+      BOOST_CHECK_EQUAL(ra_size, trans.getReadAheadBufferSize());
+
+      offset = 0;
+      for (int fsize : frame_sizes) {
+        std::vector<uint8_t> data_out(fsize + 1);
+        if (fsize > 0) {
+          trans.readAll(&data_out[0], fsize);
+          BOOST_CHECK(!memcmp(&data[offset], &data_out[0], fsize));
+        }
+        BOOST_CHECK_EQUAL(static_cast<uint32_t>(fsize) + 4, trans.readEnd());
+        offset += fsize;
+      }
+
+      uint8_t dummy;
+      BOOST_CHECK_EQUAL(0u, trans.read(&dummy, 1));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_FramedTransport_Read_Ahead_Batches ) {
+  init_data();
+
+  shared_ptr<TMemoryBuffer> buffer(new TMemoryBuffer());
+  TFramedTransport writer(buffer);
+  for (int i = 0; i < 100; ++i) {
+    writer.write(&data[i], 20);
+    writer.flush();
+  }
+
+  TFramedTransport trans(buffer);
+  trans.setReadAheadBufferSize(4096);
+  uint8_t data_out[20];
+  trans.readAll(data_out, sizeof(data_out));
+  BOOST_CHECK(!memcmp(&data[0], data_out, sizeof(data_out)));
+
+  // The first read pulled in every pipelined frame; the rest must be served
+  // without touching the underlying transport.
+  BOOST_CHECK_EQUAL(0u, buffer->available_read());
+  BOOST_CHECK(trans.peek());
+  for (int i = 1; i < 100; ++i) {
+    trans.readEnd();
+    trans.readAll(data_out, sizeof(data_out));
+    BOOST_CHECK(!memcmp(&data[i], data_out, sizeof(data_out)));
+  }
+  BOOST_CHECK(!trans.peek());
+}
+
 BOOST_AUTO_TEST_CASE( test_FramedTransport_Empty_Flush ) {
   init_data();
 
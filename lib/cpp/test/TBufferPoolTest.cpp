@@ -0,0 +1,132 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <cstdlib>
+#include <thrift/server/TBufferPool.h>
+
+BOOST_AUTO_TEST_SUITE(TBufferPoolTest)
+
+using apache::thrift::server::TBufferPool;
+using apache::thrift::server::TBufferPoolStats;
+
+BOOST_AUTO_TEST_CASE(test_size_classes) {
+  TBufferPool pool(1024 * 1024, 500, 4096);
+  TBufferPoolStats stats = pool.getStats();
+  BOOST_REQUIRE_EQUAL(4u, stats.classes.size());
+  BOOST_CHECK_EQUAL(512u, stats.classes[0].bufferSize);
+  BOOST_CHECK_EQUAL(4096u, stats.classes[3].bufferSize);
+
+  uint32_t capacity;
+  uint8_t* buf = pool.take(1, &capacity);
+  BOOST_CHECK_EQUAL(512u, capacity);
+  pool.giveBack(buf, capacity);
+
+  buf = pool.take(513, &capacity);
+  BOOST_CHECK_EQUAL(1024u, capacity);
+  pool.giveBack(buf, capacity);
+
+  // Too big for any class: exact size, not kept on return.
+  buf = pool.take(5000, &capacity);
+  BOOST_CHECK_EQUAL(5000u, capacity);
+  pool.giveBack(buf, capacity);
+
+  stats = pool.getStats();
+  BOOST_CHECK_EQUAL(1u, stats.oversized);
+  BOOST_CHECK_EQUAL(1u, stats.discarded);
+  BOOST_CHECK_EQUAL(0u, stats.borrowed);
+  BOOST_CHECK_EQUAL(512u + 1024u, stats.pooledBytes);
+}
+
+BOOST_AUTO_TEST_CASE(test_reuse) {
+  TBufferPool pool(1024 * 1024);
+  uint32_t capacity;
+  uint8_t* first = pool.take(2000, &capacity);
+  BOOST_CHECK_EQUAL(1u, pool.getStats().borrowed);
+  pool.giveBack(first, capacity);
+
+  uint8_t* second = pool.take(1500, &capacity);
+  BOOST_CHECK(first == second);
+  BOOST_CHECK_EQUAL(2048u, capacity);
+  pool.giveBack(second, capacity);
+
+  TBufferPoolStats stats = pool.getStats();
+  BOOST_CHECK_EQUAL(1u, stats.classes[2].hits);
+  BOOST_CHECK_EQUAL(1u, stats.classes[2].misses);
+  BOOST_CHECK_EQUAL(1u, stats.classes[2].pooled);
+}
+
+BOOST_AUTO_TEST_CASE(test_grown_buffer) {
+  TBufferPool pool(1024 * 1024);
+  uint32_t capacity;
+  uint8_t* buf = pool.take(512, &capacity);
+
+  // A borrower may realloc; the buffer is filed under the class it can serve.
+  buf = static_cast<uint8_t*>(std::realloc(buf, 3000));
+  BOOST_REQUIRE(buf != nullptr);
+  pool.giveBack(buf, 3000);
+
+  TBufferPoolStats stats = pool.getStats();
+  BOOST_CHECK_EQUAL(1u, stats.classes[2].pooled);
+  BOOST_CHECK_EQUAL(2048u, stats.pooledBytes);
+
+  uint8_t* again = pool.take(2048, &capacity);
+  BOOST_CHECK(again == buf);
+  pool.giveBack(again, capacity);
+}
+
+BOOST_AUTO_TEST_CASE(test_limit) {
+  TBufferPool pool(1024);
+  uint32_t capacity;
+  uint8_t* a = pool.take(512, &capacity);
+  uint8_t* b = pool.take(512, &capacity);
+  uint8_t* c = pool.take(512, &capacity);
+  pool.giveBack(a, capacity);
+  pool.giveBack(b, capacity);
+  pool.giveBack(c, capacity);
+  pool.giveBack(nullptr, 0);
+
+  TBufferPoolStats stats = pool.getStats();
+  BOOST_CHECK_EQUAL(1024u, stats.pooledBytes);
+  BOOST_CHECK_EQUAL(1u, stats.discarded);
+  BOOST_CHECK_EQUAL(0u, stats.borrowed);
+}
+
+BOOST_AUTO_TEST_CASE(test_sum) {
+  TBufferPool small(1024 * 1024, 512, 1024);
+  TBufferPool large(1024 * 1024, 1024, 2048);
+  uint32_t capacity;
+  uint8_t* buf = small.take(1024, &capacity);
+  small.giveBack(buf, capacity);
+  buf = large.take(1024, &capacity);
+  large.giveBack(buf, capacity);
+  buf = large.take(2048, &capacity);
+  large.giveBack(buf, capacity);
+
+  TBufferPoolStats stats;
+  stats += small.getStats();
+  stats += large.getStats();
+  BOOST_REQUIRE_EQUAL(3u, stats.classes.size());
+  BOOST_CHECK_EQUAL(1024u, stats.classes[1].bufferSize);
+  BOOST_CHECK_EQUAL(2u, stats.classes[1].misses);
+  BOOST_CHECK_EQUAL(2u, stats.classes[1].pooled);
+  BOOST_CHECK_EQUAL(4096u, stats.pooledBytes);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,178 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/transport/PlatformSocket.h>
+#include <thrift/transport/TBufferTransports.h>
+#include <thrift/transport/TChainedMemoryBuffer.h>
+#include <thrift/transport/TSocket.h>
+
+BOOST_AUTO_TEST_SUITE(TChainedMemoryBufferTest)
+
+using apache::thrift::protocol::TBinaryProtocol;
+using apache::thrift::transport::TBufferSegmentPool;
+using apache::thrift::transport::TChainedMemoryBuffer;
+using apache::thrift::transport::TIOVec;
+using apache::thrift::transport::TMemoryBuffer;
+using apache::thrift::transport::TSocket;
+using std::shared_ptr;
+using std::string;
+
+static std::vector<uint8_t> pattern(uint32_t len) {
+  std::vector<uint8_t> buf(len);
+  for (uint32_t i = 0; i < len; ++i) {
+    buf[i] = static_cast<uint8_t>(i * 7 + 3);
+  }
+  return buf;
+}
+
+BOOST_AUTO_TEST_CASE(test_read_write_across_segments) {
+  shared_ptr<TBufferSegmentPool> pool(new TBufferSegmentPool(64));
+  TChainedMemoryBuffer uut(pool);
+  std::vector<uint8_t> buf = pattern(1000);
+
+  for (uint32_t i = 0; i < buf.size(); i += 10) {
+    uut.write(&buf[i], 10);
+  }
+  BOOST_CHECK_EQUAL(1000u, uut.available_read());
+  BOOST_CHECK_EQUAL(16u, uut.getSegmentCount());
+  BOOST_CHECK_EQUAL(1000u, uut.writeEnd());
+
+  std::vector<uint8_t> verify(buf.size());
+  uint32_t got = 0;
+  while (got < verify.size()) {
+    got += uut.read(&verify[got], (std::min)(37u, static_cast<uint32_t>(verify.size()) - got));
+  }
+  BOOST_CHECK(buf == verify);
+  BOOST_CHECK_EQUAL(0u, uut.available_read());
+  BOOST_CHECK_EQUAL(1000u, uut.readEnd());
+
+  // Consumed segments went back to the pool and the buffer rewound.
+  BOOST_CHECK_EQUAL(1u, uut.getSegmentCount());
+  BOOST_CHECK_EQUAL(15u, pool->getFreeSegmentCount());
+}
+
+BOOST_AUTO_TEST_CASE(test_large_write_never_copies_existing_data) {
+  shared_ptr<TBufferSegmentPool> pool(new TBufferSegmentPool(4096));
+  TChainedMemoryBuffer uut(pool);
+  uut.write(reinterpret_cast<const uint8_t*>("head"), 4);
+
+  std::vector<TIOVec> before;
+  uut.getReadableSegments(before);
+  BOOST_REQUIRE_EQUAL(1u, before.size());
+
+  std::vector<uint8_t> big = pattern(1 << 20);
+  uut.write(&big[0], static_cast<uint32_t>(big.size()));
+
+  std::vector<TIOVec> after;
+  uut.getReadableSegments(after);
+  BOOST_CHECK_EQUAL(before[0].base, after[0].base);
+  BOOST_CHECK_EQUAL(4u + big.size(), uut.available_read());
+
+  string contents = uut.getBufferAsString();
+  BOOST_CHECK_EQUAL("head", contents.substr(0, 4));
+  BOOST_CHECK(0 == std::memcmp(&big[0], contents.data() + 4, big.size()));
+}
+
+BOOST_AUTO_TEST_CASE(test_borrow_within_segment) {
+  shared_ptr<TBufferSegmentPool> pool(new TBufferSegmentPool(16));
+  TChainedMemoryBuffer uut(pool);
+  std::vector<uint8_t> buf = pattern(24);
+  uut.write(&buf[0], static_cast<uint32_t>(buf.size()));
+
+  uint32_t len = 8;
+  const uint8_t* p = uut.borrow(nullptr, &len);
+  BOOST_REQUIRE(p != nullptr);
+  BOOST_CHECK_EQUAL(16u, len);
+  uut.consume(12);
+
+  // Spans the segment boundary.
+  len = 8;
+  BOOST_CHECK(uut.borrow(nullptr, &len) == nullptr);
+
+  uint8_t verify[8];
+  BOOST_CHECK_EQUAL(8u, uut.readAll(verify, 8));
+  BOOST_CHECK(0 == std::memcmp(&buf[12], verify, 8));
+
+  len = 4;
+  p = uut.borrow(nullptr, &len);
+  BOOST_REQUIRE(p != nullptr);
+  BOOST_CHECK(0 == std::memcmp(&buf[20], p, 4));
+}
+
+BOOST_AUTO_TEST_CASE(test_protocol_roundtrip) {
+  shared_ptr<TBufferSegmentPool> pool(new TBufferSegmentPool(32));
+  shared_ptr<TChainedMemoryBuffer> trans(new TChainedMemoryBuffer(pool));
+  TBinaryProtocol proto(trans);
+  string big(500, 'x');
+
+  proto.writeI32(42);
+  proto.writeString(big);
+  proto.writeDouble(3.5);
+
+  int32_t i32;
+  string str;
+  double dub;
+  proto.readI32(i32);
+  proto.readString(str);
+  proto.readDouble(dub);
+  BOOST_CHECK_EQUAL(42, i32);
+  BOOST_CHECK_EQUAL(big, str);
+  BOOST_CHECK_EQUAL(3.5, dub);
+}
+
+BOOST_AUTO_TEST_CASE(test_write_to_transport) {
+  shared_ptr<TBufferSegmentPool> pool(new TBufferSegmentPool(100));
+  TChainedMemoryBuffer uut(pool);
+  std::vector<uint8_t> buf = pattern(1234);
+  uut.write(&buf[0], static_cast<uint32_t>(buf.size()));
+
+  TMemoryBuffer sink;
+  uut.writeTo(sink);
+  BOOST_CHECK_EQUAL(0u, uut.available_read());
+  BOOST_CHECK_EQUAL(1u, uut.getSegmentCount());
+
+  string expected(buf.begin(), buf.end());
+  BOOST_CHECK_EQUAL(expected, sink.getBufferAsString());
+}
+
+#ifndef _WIN32
+BOOST_AUTO_TEST_CASE(test_write_to_socket) {
+  THRIFT_SOCKET sv[2];
+  BOOST_REQUIRE_EQUAL(0, THRIFT_SOCKETPAIR(AF_UNIX, SOCK_STREAM, 0, sv));
+  TSocket writer(sv[0]);
+  TSocket reader(sv[1]);
+
+  shared_ptr<TBufferSegmentPool> pool(new TBufferSegmentPool(256));
+  TChainedMemoryBuffer uut(pool);
+  std::vector<uint8_t> buf = pattern(20000);
+  uut.write(&buf[0], static_cast<uint32_t>(buf.size()));
+  uut.writeTo(writer);
+
+  std::vector<uint8_t> verify(buf.size());
+  reader.readAll(&verify[0], static_cast<uint32_t>(verify.size()));
+  BOOST_CHECK(buf == verify);
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -18,10 +18,15 @@
  */
 
 #include <cstdlib>
+#include <cstring>
 #include <stdexcept>
 #include <thrift/Thrift.h>
 #include <thrift/transport/TFDTransport.h>
 
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
 #define BOOST_TEST_MODULE TFDTransportTest
 #include <boost/test/unit_test.hpp>
 
@@ -31,6 +36,7 @@
 
 using apache::thrift::transport::TTransportException;
 using apache::thrift::transport::TFDTransport;
+using apache::thrift::transport::TIOVec;
 
 BOOST_AUTO_TEST_CASE(test_tfdtransport_1) {
   BOOST_CHECK_NO_THROW(TFDTransport t(256, TFDTransport::CLOSE_ON_DESTROY));
@@ -41,6 +47,28 @@ BOOST_AUTO_TEST_CASE(test_tfdtransport_2) {
   BOOST_CHECK_THROW(t.close(), TTransportException);
 }
 
+BOOST_AUTO_TEST_CASE(test_tfdtransport_writev) {
+  int fds[2];
+  BOOST_REQUIRE_EQUAL(0, pipe(fds));
+  TFDTransport reader(fds[0], TFDTransport::CLOSE_ON_DESTROY);
+  TFDTransport writer(fds[1], TFDTransport::CLOSE_ON_DESTROY);
+
+  const uint8_t head[] = {'a', 'b', 'c'};
+  const uint8_t tail[] = {'d', 'e'};
+  TIOVec iov[3];
+  iov[0].base = head;
+  iov[0].len = sizeof(head);
+  iov[1].base = tail;
+  iov[1].len = 0;
+  iov[2].base = tail;
+  iov[2].len = sizeof(tail);
+  writer.writev(iov, 3);
+
+  uint8_t buf[5];
+  BOOST_CHECK_EQUAL(5u, reader.readAll(buf, sizeof(buf)));
+  BOOST_CHECK(0 == memcmp("abcde", buf, sizeof(buf)));
+}
+
 #else
 
 BOOST_AUTO_TEST_CASE(test_tfdtransport_dummy) {
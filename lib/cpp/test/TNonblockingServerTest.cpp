@@ -20,9 +20,13 @@
 #define BOOST_TEST_MODULE TNonblockingServerTest
 #include <boost/test/unit_test.hpp>
 #include <memory>
+#include <stdexcept>
 
+#include "thrift/concurrency/AffinityThreadFactory.h"
 #include "thrift/concurrency/Monitor.h"
 #include "thrift/concurrency/Thread.h"
+#include "thrift/concurrency/ThreadManager.h"
+#include "thrift/protocol/TJSONProtocol.h"
 #include "thrift/server/TNonblockingServer.h"
 #include "thrift/transport/TNonblockingServerSocket.h"
 
@@ -30,12 +34,15 @@
 
 #include <event.h>
 
+using apache::thrift::concurrency::AffinityThreadFactory;
 using apache::thrift::concurrency::Guard;
 using apache::thrift::concurrency::Monitor;
 using apache::thrift::concurrency::Mutex;
 using apache::thrift::concurrency::ThreadFactory;
 using apache::thrift::concurrency::Runnable;
 using apache::thrift::concurrency::Thread;
+using apache::thrift::concurrency::ThreadManager;
+using apache::thrift::concurrency::Synchronized;
 using apache::thrift::concurrency::ThreadFactory;
 using apache::thrift::server::TServerEventHandler;
 using std::make_shared;
@@ -57,6 +64,69 @@ struct Handler : public test::ParentServiceIf {
   void unexpectedExceptionWait(const std::string&) override {}
 };
 
+/**
+ * Answers every call as getGeneration, with 0, but holds each callback until
+ * the test runs it.  Throws from process() instead, once, when asked to.
+ */
+class HeldAsyncProcessor : public async::TAsyncProcessor {
+public:
+  HeldAsyncProcessor() : throwNext(false) {}
+
+  void process(std::function<void(bool)> cob,
+               shared_ptr<protocol::TProtocol> in,
+               shared_ptr<protocol::TProtocol> out) override {
+    std::string name;
+    protocol::TMessageType type;
+    int32_t seqid;
+    in->readMessageBegin(name, type, seqid);
+    in->skip(protocol::T_STRUCT);
+    in->readMessageEnd();
+    in->getTransport()->readEnd();
+
+    out->writeMessageBegin(name, protocol::T_REPLY, seqid);
+    out->writeStructBegin("result");
+    out->writeFieldBegin("success", protocol::T_I32, 0);
+    out->writeI32(0);
+    out->writeFieldEnd();
+    out->writeFieldStop();
+    out->writeStructEnd();
+    out->writeMessageEnd();
+    out->getTransport()->writeEnd();
+    out->getTransport()->flush();
+
+    Synchronized s(monitor_);
+    cobs_.push_back(cob);
+    monitor_.notifyAll();
+    if (throwNext) {
+      throwNext = false;
+      throw std::runtime_error("process() failed");
+    }
+  }
+
+  void waitForCalls(size_t count) {
+    Synchronized s(monitor_);
+    while (cobs_.size() < count) {
+      monitor_.wait();
+    }
+  }
+
+  // Runs the callback of the call'th call, counting from 1
+  void complete(size_t call) {
+    std::function<void(bool)> cob;
+    {
+      Synchronized s(monitor_);
+      cob = cobs_.at(call - 1);
+    }
+    cob(true);
+  }
+
+  bool throwNext;
+
+private:
+  Monitor monitor_;
+  std::vector<std::function<void(bool)> > cobs_;
+};
+
 class Fixture {
 private:
   struct ListenEventHandler : public TServerEventHandler {
@@ -77,13 +147,29 @@ private:
     int port;
     shared_ptr<event_base> userEventBase;
     shared_ptr<TProcessor> processor;
+    shared_ptr<async::TAsyncProcessor> asyncProcessor;
     shared_ptr<server::TNonblockingServer> server;
     shared_ptr<ListenEventHandler> listenHandler;
     shared_ptr<transport::TNonblockingServerSocket> socket;
+    size_t bufferPoolLimit;
+    size_t numIOThreads;
+    bool reusePort;
+    server::TIOThreadAssignment ioThreadAssignment;
+    server::TEventLoopType eventLoopType;
+    shared_ptr<ThreadManager> threadManager;
+    std::vector<shared_ptr<ThreadManager> > ioThreadThreadManagers;
+    std::vector<AffinityThreadFactory::CpuSet> ioThreadCpuSets;
+    shared_ptr<protocol::TProtocolFactory> protocolFactory;
+    server::TNonblockingServer::TaskLaneSelector taskLaneSelector;
     Mutex mutex_;
 
     Runner() {
       port = 0;
+      bufferPoolLimit = 0;
+      numIOThreads = 1;
+      reusePort = false;
+      ioThreadAssignment = server::T_IO_THREAD_ROUND_ROBIN;
+      eventLoopType = server::T_EVENT_LOOP_LIBEVENT;
       listenHandler.reset(new ListenEventHandler(&mutex_));
     }
 
@@ -104,8 +190,30 @@ private:
     void startServer(int retry_count) {
       try {
         socket.reset(new transport::TNonblockingServerSocket(port));
-        server.reset(new server::TNonblockingServer(processor, socket));
+        socket->setReusePort(reusePort);
+        if (asyncProcessor) {
+          server.reset(new server::TNonblockingServer(
+              asyncProcessor, make_shared<protocol::TBinaryProtocolFactory>(), socket));
+        } else {
+          server.reset(new server::TNonblockingServer(processor, socket));
+        }
+        server->setReusePortAcceptors(reusePort);
+        server->setIOThreadAssignment(ioThreadAssignment);
+        // a user-provided event base is always driven by libevent
+        server->setEventLoopType(userEventBase ? server::T_EVENT_LOOP_LIBEVENT : eventLoopType);
         server->setServerEventHandler(listenHandler);
+        server->setBufferPoolLimit(bufferPoolLimit);
+        server->setNumIOThreads(numIOThreads);
+        if (threadManager) {
+          server->setThreadManager(threadManager);
+        }
+        server->setIOThreadThreadManagers(ioThreadThreadManagers);
+        server->setIOThreadCpuSets(ioThreadCpuSets);
+        if (protocolFactory) {
+          server->setInputProtocolFactory(protocolFactory);
+          server->setOutputProtocolFactory(protocolFactory);
+        }
+        server->setTaskLaneSelector(taskLaneSelector);
         if (userEventBase) {
           server->registerEvents(userEventBase.get());
         }
@@ -126,7 +234,13 @@ private:
   };
 
 protected:
-  Fixture() : processor(new test::ParentServiceProcessor(make_shared<Handler>())) {}
+  Fixture()
+    : bufferPoolLimit(0),
+      numIOThreads(1),
+      reusePort(false),
+      ioThreadAssignment(server::T_IO_THREAD_ROUND_ROBIN),
+      eventLoopType(defaultEventLoopType()),
+      processor(new test::ParentServiceProcessor(make_shared<Handler>())) {}
 
   ~Fixture() {
     if (server) {
@@ -145,7 +259,18 @@ protected:
     shared_ptr<Runner> runner(new Runner);
     runner->port = port;
     runner->processor = processor;
+    runner->asyncProcessor = asyncProcessor;
     runner->userEventBase = userEventBase_;
+    runner->bufferPoolLimit = bufferPoolLimit;
+    runner->numIOThreads = numIOThreads;
+    runner->reusePort = reusePort;
+    runner->ioThreadAssignment = ioThreadAssignment;
+    runner->eventLoopType = eventLoopType;
+    runner->threadManager = threadManager;
+    runner->ioThreadThreadManagers = ioThreadThreadManagers;
+    runner->ioThreadCpuSets = ioThreadCpuSets;
+    runner->protocolFactory = protocolFactory;
+    runner->taskLaneSelector = taskLaneSelector;
 
     shared_ptr<ThreadFactory> threadFactory(
         new ThreadFactory(false));
@@ -157,18 +282,42 @@ protected:
     return runner->port;
   }
 
-  bool canCommunicate(int serverPort) {
+  bool canCommunicate(int serverPort, const std::string& str = "foo") {
     shared_ptr<transport::TSocket> socket(new transport::TSocket("localhost", serverPort));
     socket->open();
     test::ParentServiceClient client(make_shared<protocol::TBinaryProtocol>(
         make_shared<transport::TFramedTransport>(socket)));
-    client.addString("foo");
+    client.addString(str);
     std::vector<std::string> strings;
     client.getStrings(strings);
-    return strings.size() == 1 && !(strings[0].compare("foo"));
+    return strings.size() == 1 && strings[0] == str;
   }
 
+  size_t bufferPoolLimit;
+  size_t numIOThreads;
+  bool reusePort;
+  server::TIOThreadAssignment ioThreadAssignment;
+  server::TEventLoopType eventLoopType;
+  shared_ptr<ThreadManager> threadManager;
+  std::vector<shared_ptr<ThreadManager> > ioThreadThreadManagers;
+  std::vector<AffinityThreadFactory::CpuSet> ioThreadCpuSets;
+  shared_ptr<protocol::TProtocolFactory> protocolFactory;
+  server::TNonblockingServer::TaskLaneSelector taskLaneSelector;
+  shared_ptr<async::TAsyncProcessor> asyncProcessor;
+
 private:
+  // "TNonblockingServerTest -- epoll" runs the cases on the epoll loop
+  static server::TEventLoopType defaultEventLoopType() {
+    const boost::unit_test::master_test_suite_t& suite
+        = boost::unit_test::framework::master_test_suite();
+    for (int i = 1; i < suite.argc; ++i) {
+      if (std::string(suite.argv[i]) == "epoll") {
+        return server::T_EVENT_LOOP_EPOLL;
+      }
+    }
+    return server::T_EVENT_LOOP_LIBEVENT;
+  }
+
   shared_ptr<event_base> userEventBase_;
   shared_ptr<test::ParentServiceProcessor> processor;
 protected:
@@ -212,4 +361,241 @@ BOOST_FIXTURE_TEST_CASE(provide_event_base, Fixture) {
 #endif
 }
 
+BOOST_FIXTURE_TEST_CASE(thread_pool_completions, Fixture) {
+  // Completions from the workers are queued back to several IO threads, and
+  // fresh connections are handed from the listening thread to the others.
+  numIOThreads = 3;
+  threadManager = ThreadManager::newSimpleThreadManager(4);
+  threadManager->threadFactory(make_shared<ThreadFactory>());
+  threadManager->start();
+  startServer(0);
+  int port = server->getListenPort();
+
+  std::vector<shared_ptr<test::ParentServiceClient> > clients;
+  for (int i = 0; i < 6; ++i) {
+    shared_ptr<transport::TSocket> socket(new transport::TSocket("localhost", port));
+    socket->open();
+    clients.push_back(make_shared<test::ParentServiceClient>(
+        make_shared<protocol::TBinaryProtocol>(make_shared<transport::TFramedTransport>(socket))));
+  }
+  for (int round = 0; round < 50; ++round) {
+    for (auto& client : clients) {
+      client->send_getGeneration();
+    }
+    for (auto& client : clients) {
+      BOOST_CHECK_EQUAL(0, client->recv_getGeneration());
+    }
+  }
+
+  server->stop();
+  threadManager->stop();
+}
+
+BOOST_FIXTURE_TEST_CASE(async_late_callback, Fixture) {
+  // A callback that runs after process() threw must not complete the next
+  // call served by the recycled connection.
+  shared_ptr<HeldAsyncProcessor> held = make_shared<HeldAsyncProcessor>();
+  asyncProcessor = held;
+  startServer(0);
+  int port = server->getListenPort();
+
+  held->throwNext = true;
+  {
+    shared_ptr<transport::TSocket> socket(new transport::TSocket("localhost", port));
+    socket->open();
+    test::ParentServiceClient client(make_shared<protocol::TBinaryProtocol>(
+        make_shared<transport::TFramedTransport>(socket)));
+    client.send_getGeneration();
+    BOOST_CHECK_THROW(client.recv_getGeneration(), transport::TTransportException);
+  }
+
+  shared_ptr<transport::TSocket> socket(new transport::TSocket("localhost", port));
+  socket->setRecvTimeout(200);
+  socket->open();
+  test::ParentServiceClient client(make_shared<protocol::TBinaryProtocol>(
+      make_shared<transport::TFramedTransport>(socket)));
+  client.send_getGeneration();
+  held->waitForCalls(2);
+  held->complete(1);
+  BOOST_CHECK_THROW(client.recv_getGeneration(), transport::TTransportException);
+  held->complete(2);
+  BOOST_CHECK_EQUAL(0, client.recv_getGeneration());
+
+  server->stop();
+}
+
+BOOST_FIXTURE_TEST_CASE(task_lane_selector, Fixture) {
+  // TJSONProtocol is left mid-message by readMessageBegin(), so the protocol
+  // that looked at one call on a connection must not look at the next.
+  Mutex namesMutex;
+  std::vector<std::string> names;
+  taskLaneSelector = [&](const std::string& name) {
+    Guard g(namesMutex);
+    names.push_back(name);
+    return name == "getGeneration" ? 1 : 0;
+  };
+  protocolFactory = make_shared<protocol::TJSONProtocolFactory>();
+  threadManager = ThreadManager::newSimpleThreadManager(2);
+  threadManager->threadFactory(make_shared<ThreadFactory>());
+  threadManager->setPriorityLanes(std::vector<size_t>{1, 4});
+  threadManager->start();
+  startServer(0);
+
+  shared_ptr<transport::TSocket> socket(
+      new transport::TSocket("localhost", server->getListenPort()));
+  socket->open();
+  test::ParentServiceClient client(make_shared<protocol::TJSONProtocol>(
+      make_shared<transport::TFramedTransport>(socket)));
+  client.addString("foo");
+  for (int i = 0; i < 3; ++i) {
+    BOOST_CHECK_EQUAL(0, client.getGeneration());
+  }
+  std::vector<std::string> strings;
+  client.getStrings(strings);
+  BOOST_CHECK_EQUAL(1u, strings.size());
+
+  {
+    Guard g(namesMutex);
+    std::vector<std::string> expected{"addString", "getGeneration", "getGeneration",
+                                      "getGeneration", "getStrings"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(names.begin(), names.end(), expected.begin(), expected.end());
+  }
+
+  server->stop();
+  threadManager->stop();
+}
+
+BOOST_FIXTURE_TEST_CASE(numa_paired_thread_managers, Fixture) {
+  // Each IO thread is pinned to a node and hands its calls to workers
+  // pinned to the same node; with one node they all share it.
+  std::vector<AffinityThreadFactory::CpuSet> nodes = AffinityThreadFactory::getNumaNodes();
+  BOOST_REQUIRE(!nodes.empty());
+  numIOThreads = 2;
+  ioThreadCpuSets = nodes;
+  for (size_t i = 0; i < numIOThreads; ++i) {
+    std::vector<AffinityThreadFactory::CpuSet> node(1, nodes[i % nodes.size()]);
+    ioThreadThreadManagers.push_back(ThreadManager::newSimpleThreadManager(2));
+    ioThreadThreadManagers.back()->threadFactory(make_shared<AffinityThreadFactory>(node));
+    ioThreadThreadManagers.back()->start();
+  }
+  startServer(0);
+  int port = server->getListenPort();
+  BOOST_CHECK(server->getThreadManager() == ioThreadThreadManagers.front());
+
+  // round robin hands the connections to threads 0, 1, 0, 1
+  std::vector<shared_ptr<test::ParentServiceClient> > clients;
+  for (int i = 0; i < 4; ++i) {
+    shared_ptr<transport::TSocket> socket(new transport::TSocket("localhost", port));
+    socket->open();
+    clients.push_back(make_shared<test::ParentServiceClient>(
+        make_shared<protocol::TBinaryProtocol>(make_shared<transport::TFramedTransport>(socket))));
+  }
+  for (int round = 0; round < 10; ++round) {
+    for (auto& client : clients) {
+      BOOST_CHECK_EQUAL(0, client->getGeneration());
+    }
+  }
+
+  server->stop();
+  for (auto& threadManager : ioThreadThreadManagers) {
+    threadManager->stop();
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(least_connections, Fixture) {
+  numIOThreads = 3;
+  ioThreadAssignment = server::T_IO_THREAD_LEAST_CONNECTIONS;
+  startServer(0);
+  int port = server->getListenPort();
+
+  // With equal load the threads take turns: 0, 1, 2, 0, 1, 2
+  std::vector<shared_ptr<transport::TSocket> > sockets;
+  std::vector<shared_ptr<test::ParentServiceClient> > clients;
+  for (int i = 0; i < 8; ++i) {
+    if (i == 6) {
+      // free up thread 2, which the next two connections should go to
+      // rather than to threads 0 and 1 as round robin would have it
+      sockets[2]->close();
+      sockets[5]->close();
+      for (int wait = 0; wait < 100 && server->getNumIOThreadConnections(2) > 0; ++wait) {
+        THRIFT_SLEEP_USEC(10 * 1000);
+      }
+      BOOST_REQUIRE_EQUAL(0u, server->getNumIOThreadConnections(2));
+    }
+    sockets.push_back(make_shared<transport::TSocket>("localhost", port));
+    sockets.back()->open();
+    clients.push_back(make_shared<test::ParentServiceClient>(make_shared<protocol::TBinaryProtocol>(
+        make_shared<transport::TFramedTransport>(sockets.back()))));
+    BOOST_CHECK_EQUAL(0, clients.back()->getGeneration());
+  }
+
+  BOOST_CHECK_EQUAL(2u, server->getNumIOThreadConnections(0));
+  BOOST_CHECK_EQUAL(2u, server->getNumIOThreadConnections(1));
+  BOOST_CHECK_EQUAL(2u, server->getNumIOThreadConnections(2));
+}
+
+#ifdef SO_REUSEPORT
+BOOST_FIXTURE_TEST_CASE(reuse_port_acceptors, Fixture) {
+  // Every IO thread accepts on its own socket bound to the same port, and
+  // the kernel spreads the connections between them.
+  numIOThreads = 3;
+  reusePort = true;
+  startServer(0);
+  int port = server->getListenPort();
+  BOOST_REQUIRE_GT(port, 0);
+
+  std::vector<shared_ptr<test::ParentServiceClient> > clients;
+  for (int i = 0; i < 12; ++i) {
+    shared_ptr<transport::TSocket> socket(new transport::TSocket("localhost", port));
+    socket->open();
+    clients.push_back(make_shared<test::ParentServiceClient>(
+        make_shared<protocol::TBinaryProtocol>(make_shared<transport::TFramedTransport>(socket))));
+  }
+  for (auto& client : clients) {
+    BOOST_CHECK_EQUAL(0, client->getGeneration());
+  }
+  BOOST_CHECK(canCommunicate(port));
+}
+#endif
+
+BOOST_FIXTURE_TEST_CASE(pooled_buffers, Fixture) {
+  bufferPoolLimit = 4 * 1024 * 1024;
+  int port = startServer(0);
+  BOOST_REQUIRE_EQUAL(port, 0);
+  BOOST_CHECK(canCommunicate(server->getListenPort(), std::string(100 * 1024, 'x')));
+
+  // Buffers go back once the last response has been written, which may be
+  // just after the client has read it.
+  server::TBufferPoolStats stats;
+  for (int i = 0; i < 100; ++i) {
+    stats = server->getBufferPoolStats();
+    if (stats.borrowed == 0) {
+      break;
+    }
+    THRIFT_SLEEP_USEC(10 * 1000);
+  }
+  BOOST_CHECK_EQUAL(0u, stats.borrowed);
+  BOOST_CHECK_GT(stats.pooledBytes, 100u * 1024);
+
+  uint64_t misses = 0;
+  for (const auto& sizeClass : stats.classes) {
+    misses += sizeClass.misses;
+  }
+  BOOST_CHECK_GE(misses, 2u);
+
+  // Later requests are served from the pool.
+  shared_ptr<transport::TSocket> socket(new transport::TSocket("localhost", server->getListenPort()));
+  socket->open();
+  test::ParentServiceClient client(make_shared<protocol::TBinaryProtocol>(
+      make_shared<transport::TFramedTransport>(socket)));
+  std::vector<std::string> strings;
+  client.getStrings(strings);
+  BOOST_CHECK_EQUAL(1u, strings.size());
+  uint64_t hits = 0;
+  for (const auto& sizeClass : server->getBufferPoolStats().classes) {
+    hits += sizeClass.hits;
+  }
+  BOOST_CHECK_GE(hits, 2u);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
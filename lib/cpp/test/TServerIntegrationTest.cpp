@@ -18,17 +18,20 @@
  */
 
 #define BOOST_TEST_MODULE TServerIntegrationTest
+#include <algorithm>
 #include <atomic>
 #include <boost/test/unit_test.hpp>
 #include <boost/date_time/posix_time/ptime.hpp>
 #include <boost/foreach.hpp>
 #include <boost/format.hpp>
 #include <boost/thread.hpp>
+#include <thrift/async/TConcurrentClientChannel.h>
 #include <thrift/server/TSimpleServer.h>
 #include <thrift/server/TThreadPoolServer.h>
 #include <thrift/server/TThreadedServer.h>
 #include <memory>
 #include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/transport/TBufferTransports.h>
 #include <thrift/transport/TServerSocket.h>
 #include <thrift/transport/TSocket.h>
 #include <thrift/transport/TTransport.h>
@@ -36,6 +39,7 @@
 #include <string>
 #include <vector>
 
+using apache::thrift::async::TConcurrentClientChannel;
 using apache::thrift::concurrency::Guard;
 using apache::thrift::concurrency::Monitor;
 using apache::thrift::concurrency::Mutex;
@@ -44,6 +48,8 @@ using apache::thrift::protocol::TBinaryProtocol;
 using apache::thrift::protocol::TBinaryProtocolFactory;
 using apache::thrift::protocol::TProtocol;
 using apache::thrift::protocol::TProtocolFactory;
+using apache::thrift::transport::TFramedTransport;
+using apache::thrift::transport::TFramedTransportFactory;
 using apache::thrift::transport::TServerSocket;
 using apache::thrift::transport::TServerTransport;
 using apache::thrift::transport::TSocket;
@@ -59,6 +65,8 @@ using std::dynamic_pointer_cast;
 using std::make_shared;
 using std::shared_ptr;
 using apache::thrift::test::ParentServiceClient;
+using apache::thrift::test::ParentService_getDataWait_args;
+using apache::thrift::test::ParentService_getDataWait_result;
 using apache::thrift::test::ParentServiceIf;
 using apache::thrift::test::ParentServiceIfFactory;
 using apache::thrift::test::ParentServiceIfSingletonFactory;
@@ -534,3 +542,176 @@ BOOST_AUTO_TEST_CASE(test_concurrent_client_limit) {
 }
 
 BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(TConcurrentClientChannelTest)
+
+BOOST_AUTO_TEST_CASE(test_threaded_server) {
+  TThreadedServer server(make_shared<ParentServiceProcessor>(make_shared<ParentHandler>()),
+                         make_shared<TServerSocket>("localhost", 0),
+                         make_shared<TFramedTransportFactory>(),
+                         make_shared<TBinaryProtocolFactory>());
+  shared_ptr<TServerReadyEventHandler> ready(new TServerReadyEventHandler);
+  server.setServerEventHandler(ready);
+  boost::thread serverThread(std::bind(&TThreadedServer::serve, &server));
+  {
+    Synchronized sync(*ready);
+    while (!ready->isListening()) {
+      ready->wait();
+    }
+  }
+  int port = dynamic_pointer_cast<TServerSocket>(server.getServerTransport())->getPort();
+
+  {
+    TConcurrentClientChannel channel(make_shared<TSocket>("localhost", port),
+                                     make_shared<TBinaryProtocolFactory>());
+
+    // many threads share the one connection, each with its own client
+    const int threadCount = 16;
+    const int callCount = 50;
+    Mutex mutex;
+    std::vector<int32_t> generations;
+    std::vector<shared_ptr<boost::thread> > threads;
+    for (int t = 0; t < threadCount; ++t) {
+      threads.push_back(make_shared<boost::thread>([&] {
+        shared_ptr<ParentServiceClient> client = channel.getClient<ParentServiceClient>();
+        for (int i = 0; i < callCount; ++i) {
+          int32_t generation = client->incrementGeneration();
+          Guard g(mutex);
+          generations.push_back(generation);
+        }
+      }));
+    }
+    BOOST_FOREACH (shared_ptr<boost::thread> thread, threads) { thread->join(); }
+
+    std::sort(generations.begin(), generations.end());
+    BOOST_REQUIRE_EQUAL(static_cast<size_t>(threadCount * callCount), generations.size());
+    for (size_t i = 0; i < generations.size(); ++i) {
+      BOOST_CHECK_EQUAL(static_cast<int32_t>(i + 1), generations[i]);
+    }
+
+    shared_ptr<ParentServiceClient> client = channel.getClient<ParentServiceClient>();
+    client->onewayWait();
+    BOOST_CHECK_EQUAL(threadCount * callCount, client->getGeneration());
+    BOOST_CHECK_EQUAL(0u, channel.getPendingCount());
+  }
+
+  server.stop();
+  serverThread.join();
+}
+
+BOOST_AUTO_TEST_CASE(test_out_of_order_replies) {
+  TServerSocket serverSocket("localhost", 0);
+  serverSocket.listen();
+  const int callCount = 8;
+
+  // reads every call before replying to any, then replies last first
+  boost::thread serverThread([&serverSocket] {
+    shared_ptr<TTransport> transport(new TFramedTransport(serverSocket.accept()));
+    TBinaryProtocol protocol(transport);
+    std::vector<std::pair<int32_t, int32_t> > calls;
+    for (int i = 0; i < callCount; ++i) {
+      std::string name;
+      apache::thrift::protocol::TMessageType type;
+      int32_t seqid;
+      protocol.readMessageBegin(name, type, seqid);
+      ParentService_getDataWait_args args;
+      args.read(&protocol);
+      protocol.readMessageEnd();
+      transport->readEnd();
+      calls.push_back(std::make_pair(seqid, args.length));
+    }
+    std::reverse(calls.begin(), calls.end());
+    for (const auto& call : calls) {
+      ParentService_getDataWait_result result;
+      result.success.assign(call.second, 'x');
+      result.__isset.success = true;
+      protocol.writeMessageBegin("getDataWait", apache::thrift::protocol::T_REPLY, call.first);
+      result.write(&protocol);
+      protocol.writeMessageEnd();
+      transport->writeEnd();
+      transport->flush();
+    }
+    transport->close();
+  });
+
+  {
+    TConcurrentClientChannel channel(make_shared<TSocket>("localhost", serverSocket.getPort()),
+                                     make_shared<TBinaryProtocolFactory>());
+    std::atomic<int> matched(0);
+    std::vector<shared_ptr<boost::thread> > threads;
+    for (int t = 0; t < callCount; ++t) {
+      threads.push_back(make_shared<boost::thread>([&channel, &matched, t] {
+        shared_ptr<ParentServiceClient> client = channel.getClient<ParentServiceClient>();
+        std::string data;
+        client->getDataWait(data, 10 * (t + 1));
+        if (data.size() == static_cast<size_t>(10 * (t + 1))) {
+          ++matched;
+        }
+      }));
+    }
+    BOOST_FOREACH (shared_ptr<boost::thread> thread, threads) { thread->join(); }
+    BOOST_CHECK_EQUAL(callCount, matched.load());
+  }
+
+  serverThread.join();
+  serverSocket.close();
+}
+
+BOOST_AUTO_TEST_CASE(test_timeout_and_lost_connection) {
+  TServerSocket serverSocket("localhost", 0);
+  serverSocket.listen();
+
+  // reads one call and never replies, then hangs up when told to
+  Monitor monitor;
+  bool hangUp = false;
+  boost::thread serverThread([&] {
+    shared_ptr<TTransport> transport(new TFramedTransport(serverSocket.accept()));
+    TBinaryProtocol protocol(transport);
+    std::string name;
+    apache::thrift::protocol::TMessageType type;
+    int32_t seqid;
+    protocol.readMessageBegin(name, type, seqid);
+    protocol.skip(apache::thrift::protocol::T_STRUCT);
+    {
+      Synchronized sync(monitor);
+      while (!hangUp) {
+        monitor.wait();
+      }
+    }
+    transport->close();
+  });
+
+  TConcurrentClientChannel channel(make_shared<TSocket>("localhost", serverSocket.getPort()),
+                                   make_shared<TBinaryProtocolFactory>());
+  channel.setRecvTimeout(50);
+  shared_ptr<ParentServiceClient> client = channel.getClient<ParentServiceClient>();
+  try {
+    client->getGeneration();
+    BOOST_ERROR("call did not time out");
+  } catch (const TTransportException& e) {
+    BOOST_CHECK_EQUAL(TTransportException::TIMED_OUT, e.getType());
+  }
+  BOOST_CHECK_EQUAL(0u, channel.getPendingCount());
+  BOOST_CHECK(channel.isOpen());
+
+  {
+    Synchronized sync(monitor);
+    hangUp = true;
+    monitor.notify();
+  }
+  serverThread.join();
+  while (channel.isOpen()) {
+    boost::this_thread::sleep(milliseconds(5));
+  }
+  try {
+    client->getGeneration();
+    BOOST_ERROR("call on a lost connection succeeded");
+  } catch (const TTransportException& e) {
+    BOOST_CHECK_EQUAL(TTransportException::NOT_OPEN, e.getType());
+  }
+
+  client.reset();
+  serverSocket.close();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
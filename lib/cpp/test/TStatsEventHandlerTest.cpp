@@ -0,0 +1,169 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+#include <thrift/processor/TStatsEventHandler.h>
+
+BOOST_AUTO_TEST_SUITE(TStatsEventHandlerTest)
+
+using apache::thrift::processor::THistogramSnapshot;
+using apache::thrift::processor::TLatencyHistogram;
+using apache::thrift::processor::TMethodStats;
+using apache::thrift::processor::TShardedCounter;
+using apache::thrift::processor::TStatsEventHandler;
+
+BOOST_AUTO_TEST_CASE(test_sharded_counter) {
+  TShardedCounter counter;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 20; ++t) {
+    threads.push_back(std::thread([&counter] {
+      for (int i = 0; i < 10000; ++i) {
+        counter.increment();
+      }
+    }));
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  counter.add(-5);
+  BOOST_CHECK_EQUAL(200000 - 5, counter.get());
+}
+
+BOOST_AUTO_TEST_CASE(test_histogram_buckets) {
+  // Small values are exact; larger ones are known to within 1/8.
+  for (uint64_t value = 0; value < 8; ++value) {
+    BOOST_CHECK_EQUAL(value, TLatencyHistogram::bucketUpperBound(TLatencyHistogram::bucketIndex(value)));
+  }
+  size_t last = 0;
+  for (uint64_t value = 1; value < (uint64_t(1) << 40); value = value * 3 / 2 + 1) {
+    size_t bucket = TLatencyHistogram::bucketIndex(value);
+    BOOST_CHECK_GE(bucket, last);
+    BOOST_REQUIRE_LT(bucket, TLatencyHistogram::BUCKETS);
+    uint64_t upper = TLatencyHistogram::bucketUpperBound(bucket);
+    BOOST_CHECK_GE(upper, value);
+    BOOST_CHECK_LE(upper - value, value / 8);
+    if (bucket > 0) {
+      BOOST_CHECK_LT(TLatencyHistogram::bucketUpperBound(bucket - 1), value);
+    }
+    last = bucket;
+  }
+  BOOST_CHECK_EQUAL(TLatencyHistogram::BUCKETS - 1, TLatencyHistogram::bucketIndex(~uint64_t(0)));
+}
+
+BOOST_AUTO_TEST_CASE(test_histogram_percentiles) {
+  TLatencyHistogram histogram;
+  for (uint64_t value = 1; value <= 1000; ++value) {
+    histogram.record(value);
+  }
+  THistogramSnapshot snapshot = histogram.snapshot();
+  BOOST_CHECK_EQUAL(1000u, snapshot.count);
+  BOOST_CHECK_EQUAL(500500u, snapshot.sum);
+  BOOST_CHECK_EQUAL(1000u, snapshot.max);
+  BOOST_CHECK_CLOSE(500.5, snapshot.mean(), 0.001);
+
+  uint64_t p50 = snapshot.percentile(0.5);
+  BOOST_CHECK_GE(p50, 500u);
+  BOOST_CHECK_LE(p50, 500u + 500u / 8);
+  uint64_t p99 = snapshot.percentile(0.99);
+  BOOST_CHECK_GE(p99, 990u);
+  BOOST_CHECK_LE(p99, 1000u);
+  BOOST_CHECK_EQUAL(1000u, snapshot.percentile(1.0));
+  BOOST_CHECK_EQUAL(1u, snapshot.percentile(0.0));
+
+  THistogramSnapshot both = snapshot;
+  both += snapshot;
+  BOOST_CHECK_EQUAL(2000u, both.count);
+  BOOST_CHECK_EQUAL(p50, both.percentile(0.5));
+}
+
+BOOST_AUTO_TEST_CASE(test_event_handler) {
+  TStatsEventHandler handler;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.push_back(std::thread([&handler, t] {
+      for (int i = 0; i < 1000; ++i) {
+        const char* name = (i % 4 == 0) ? "Service.slow" : "Service.fast";
+        void* ctx = handler.getContext(name, nullptr);
+        handler.preRead(ctx, name);
+        handler.postRead(ctx, name, 10);
+        if (t == 0 && i % 4 == 0) {
+          handler.handlerError(ctx, name);
+        }
+        handler.preWrite(ctx, name);
+        handler.postWrite(ctx, name, 100);
+        handler.freeContext(ctx, name);
+      }
+    }));
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // a name at another address still finds its method
+  std::string copy("Service.fast");
+  handler.freeContext(handler.getContext(copy.c_str(), nullptr), copy.c_str());
+
+  std::vector<TMethodStats> stats = handler.getStats();
+  BOOST_REQUIRE_EQUAL(2u, stats.size());
+  BOOST_CHECK_EQUAL("Service.fast", stats[0].name);
+  BOOST_CHECK_EQUAL(6001, stats[0].calls);
+  BOOST_CHECK_EQUAL(0, stats[0].errors);
+  BOOST_CHECK_EQUAL(60000, stats[0].bytesIn);
+  BOOST_CHECK_EQUAL(600000, stats[0].bytesOut);
+  BOOST_CHECK_EQUAL(6001u, stats[0].latencyUs.count);
+  BOOST_CHECK_EQUAL("Service.slow", stats[1].name);
+  BOOST_CHECK_EQUAL(2000, stats[1].calls);
+  BOOST_CHECK_EQUAL(250, stats[1].errors);
+  BOOST_CHECK_EQUAL(20000, stats[1].bytesIn);
+  BOOST_CHECK_EQUAL(200000, stats[1].bytesOut);
+  BOOST_CHECK_EQUAL(2000u, stats[1].latencyUs.count);
+}
+
+BOOST_AUTO_TEST_CASE(test_contexts_across_threads) {
+  // Calls may overlap on a thread and end on another, as with an async
+  // processor, so contexts move between the threads' pools.
+  TStatsEventHandler handler;
+  const char* name = "Service.async";
+  for (int round = 0; round < 3; ++round) {
+    std::vector<void*> contexts;
+    for (int i = 0; i < 100; ++i) {
+      void* ctx = handler.getContext(name, nullptr);
+      handler.postRead(ctx, name, 1);
+      contexts.push_back(ctx);
+    }
+    std::thread([&handler, &contexts, name] {
+      for (void* ctx : contexts) {
+        handler.postWrite(ctx, name, 2);
+        handler.freeContext(ctx, name);
+      }
+    }).join();
+  }
+
+  std::vector<TMethodStats> stats = handler.getStats();
+  BOOST_REQUIRE_EQUAL(1u, stats.size());
+  BOOST_CHECK_EQUAL(300, stats[0].calls);
+  BOOST_CHECK_EQUAL(300, stats[0].bytesIn);
+  BOOST_CHECK_EQUAL(600, stats[0].bytesOut);
+  BOOST_CHECK_EQUAL(300u, stats[0].latencyUs.count);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -198,6 +198,9 @@ BOOST_AUTO_TEST_CASE(test_tthriftcompactprotocol_read_check_exception) {
 }
 
 BOOST_AUTO_TEST_CASE(test_tthriftjsonprotocol_read_check_exception) {
+  // The JSON protocol reads the type names and sizes in runs counted against
+  // the limit, so each read gives up before reaching the end of its container
+  // and gets a transport of its own.
   std::shared_ptr<TConfiguration> config (new TConfiguration(MAX_MESSAGE_SIZE));
   std::shared_ptr<TMemoryBuffer> transport(new TMemoryBuffer(config));
   std::shared_ptr<TJSONProtocol> protocol(new TJSONProtocol(transport));
@@ -209,19 +212,20 @@ BOOST_AUTO_TEST_CASE(test_tthriftjsonprotocol_read_check_exception) {
   protocol->writeListBegin(list.elemType_, list.size_);
   protocol->writeListEnd();
   BOOST_CHECK_THROW(protocol->readListBegin(elemType, val), TTransportException);
-  protocol->readListEnd();
 
+  transport.reset(new TMemoryBuffer(config));
+  protocol.reset(new TJSONProtocol(transport));
   TSet set(T_I32, 8);
   protocol->writeSetBegin(set.elemType_, set.size_);
   protocol->writeSetEnd();
   BOOST_CHECK_THROW(protocol->readSetBegin(elemType, val), TTransportException);
-  protocol->readSetEnd();
 
+  transport.reset(new TMemoryBuffer(config));
+  protocol.reset(new TJSONProtocol(transport));
   TMap map(T_I32, T_I32, 8);
   protocol->writeMapBegin(map.keyType_, map.valueType_, map.size_);
   protocol->writeMapEnd();
   BOOST_CHECK_THROW(protocol->readMapBegin(elemType, elemType1, val), TTransportException);
-  protocol->readMapEnd();
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,255 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <thrift/thrift-config.h>
+#include <thrift/concurrency/Monitor.h>
+#include <thrift/concurrency/Mutex.h>
+#include <thrift/transport/PlatformSocket.h>
+
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace apache {
+namespace thrift {
+namespace concurrency {
+namespace test {
+
+using namespace apache::thrift::concurrency;
+
+/**
+ * Tests and contention benchmarks for Mutex and Monitor, whichever
+ * implementation the library was built with.
+ */
+class MutexTests {
+
+public:
+  static const char* implementation() {
+#ifdef THRIFT_ADAPTIVE_MUTEX
+    return "adaptive";
+#else
+    return "std::timed_mutex";
+#endif
+  }
+
+  /**
+   * Has threadCount threads each increment a shared count iterations times
+   * under the lock, using lock(), trylock() and timedlock() in turn, and
+   * checks none were lost.
+   */
+  bool lockTest(size_t threadCount, size_t iterations) {
+    Mutex mutex;
+    size_t count = 0;
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < threadCount; t++) {
+      threads.push_back(std::thread([&mutex, &count, iterations, t] {
+        for (size_t ix = 0; ix < iterations; ix++) {
+          switch ((ix + t) % 3) {
+          case 0:
+            mutex.lock();
+            break;
+          case 1:
+            while (!mutex.trylock()) {
+              std::this_thread::yield();
+            }
+            break;
+          default:
+            while (!mutex.timedlock(100)) {
+            }
+            break;
+          }
+          count++;
+          mutex.unlock();
+        }
+      }));
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    if (count != threadCount * iterations) {
+      std::cerr << "\t\t\tlost increments: " << count << " of " << threadCount * iterations
+                << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * Checks that trylock() and timedlock() fail while another thread holds
+   * the lock, timedlock() only after its timeout, and that both succeed
+   * once it is released.
+   */
+  bool timedLockTest() {
+    Mutex mutex;
+    Monitor held;
+    bool locked = false;
+    bool release = false;
+    std::thread holder([&] {
+      mutex.lock();
+      {
+        Synchronized s(held);
+        locked = true;
+        held.notifyAll();
+        while (!release) {
+          held.wait();
+        }
+      }
+      mutex.unlock();
+    });
+    {
+      Synchronized s(held);
+      while (!locked) {
+        held.wait();
+      }
+    }
+
+    bool success = !mutex.trylock();
+    auto start = std::chrono::steady_clock::now();
+    success = success && !mutex.timedlock(50);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    if (elapsed < std::chrono::milliseconds(45)) {
+      std::cerr << "\t\t\ttimedlock returned early" << std::endl;
+      success = false;
+    }
+
+    {
+      Synchronized s(held);
+      release = true;
+      held.notifyAll();
+    }
+    success = success && mutex.timedlock(10000);
+    mutex.unlock();
+    holder.join();
+    success = success && mutex.trylock();
+    mutex.unlock();
+    return success;
+  }
+
+  /**
+   * Passes a turn back and forth between two threads count times through
+   * a Monitor, and checks a wait with nothing to wake it times out.
+   */
+  bool monitorTest(size_t count) {
+    Monitor monitor;
+    size_t turn = 0;
+    std::thread other([&] {
+      for (size_t ix = 0; ix < count; ix++) {
+        Synchronized s(monitor);
+        while (turn % 2 == 0) {
+          monitor.waitForever();
+        }
+        turn++;
+        monitor.notify();
+      }
+    });
+    for (size_t ix = 0; ix < count; ix++) {
+      Synchronized s(monitor);
+      turn++;
+      monitor.notify();
+      while (turn % 2 == 1) {
+        monitor.waitForever();
+      }
+    }
+    other.join();
+
+    Synchronized s(monitor);
+    return turn == 2 * count && monitor.waitForTimeRelative(10) == THRIFT_ETIMEDOUT;
+  }
+
+  /**
+   * Times threadCount threads each taking and releasing a lock iterations
+   * times, with a little work inside, for Mutex, Guard with a timeout as
+   * ThreadManager uses it, and the std mutexes for comparison; then times a
+   * Monitor round trip between two threads.
+   */
+  bool benchmark(size_t threadCount, size_t iterations) {
+    Mutex mutex;
+    std::mutex stdMutex;
+    std::timed_mutex stdTimedMutex;
+
+    report("Mutex", threadCount, iterations, contend(threadCount, iterations, [&mutex] {
+      mutex.lock();
+      spin();
+      mutex.unlock();
+    }));
+    report("Guard(timeout)", threadCount, iterations, contend(threadCount, iterations, [&mutex] {
+      Guard g(mutex, 1000);
+      spin();
+    }));
+    report("std::mutex", threadCount, iterations, contend(threadCount, iterations, [&stdMutex] {
+      std::lock_guard<std::mutex> g(stdMutex);
+      spin();
+    }));
+    report("std::timed_mutex", threadCount, iterations,
+           contend(threadCount, iterations, [&stdTimedMutex] {
+             while (!stdTimedMutex.try_lock_for(std::chrono::milliseconds(1000))) {
+             }
+             spin();
+             stdTimedMutex.unlock();
+           }));
+
+    auto start = std::chrono::steady_clock::now();
+    if (!monitorTest(iterations / 10)) {
+      return false;
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()
+                                                                   - start).count();
+    std::cout << "\t\t\tMonitor round trip: " << ns / (iterations / 10) << "ns" << std::endl;
+    return true;
+  }
+
+private:
+  static void spin() {
+    volatile int sink = 0;
+    for (int ix = 0; ix < 10; ix++) {
+      sink = sink + ix;
+    }
+  }
+
+  template <typename F>
+  static int64_t contend(size_t threadCount, size_t iterations, F critical) {
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < threadCount; t++) {
+      threads.push_back(std::thread([&critical, iterations] {
+        for (size_t ix = 0; ix < iterations; ix++) {
+          critical();
+        }
+      }));
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()
+                                                                - start).count();
+  }
+
+  static void report(const char* name, size_t threadCount, size_t iterations, int64_t ns) {
+    std::cout << "\t\t\t" << name << ": " << ns / static_cast<int64_t>(threadCount * iterations)
+              << "ns per lock" << std::endl;
+  }
+};
+}
+}
+}
+} // apache::thrift::concurrency
+
+using namespace apache::thrift::concurrency::test;
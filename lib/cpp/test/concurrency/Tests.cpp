@@ -24,6 +24,7 @@
 #include "ThreadFactoryTests.h"
 #include "TimerManagerTests.h"
 #include "ThreadManagerTests.h"
+#include "MutexTests.h"
 
 // The test weight, where 10 is 10 times more threads than baseline
 // and the baseline is optimized for running in valgrind
@@ -84,6 +85,13 @@ int main(int argc, char** argv) {
       std::cerr << "\t\ttThreadFactory monitor timeout FAILED" << std::endl;
       return 1;
     }
+
+    std::cout << "\t\tAffinityThreadFactory affinity test" << std::endl;
+
+    if (!threadFactoryTests.affinityTest()) {
+      std::cerr << "\t\tAffinityThreadFactory affinity test FAILED" << std::endl;
+      return 1;
+    }
   }
 
   if (runAll || args[0].compare("util") == 0) {
@@ -109,79 +117,205 @@ int main(int argc, char** argv) {
     std::cout << "\t\t\tscall per ms: " << count / (time01 - time00) << std::endl;
   }
 
-  if (runAll || args[0].compare("timer-manager") == 0) {
+  if (runAll || args[0].compare("mutex") == 0) {
+
+    MutexTests mutexTests;
 
-    std::cout << "TimerManager tests..." << std::endl;
+    std::cout << "Mutex tests (" << MutexTests::implementation() << ")..." << std::endl;
 
-    std::cout << "\t\tTimerManager test00" << std::endl;
+    size_t threadCount = WEIGHT;
+    size_t iterations = 1000 * WEIGHT;
+
+    std::cout << "\t\tMutex lock test: thread count: " << threadCount
+              << " iterations: " << iterations << std::endl;
+
+    if (!mutexTests.lockTest(threadCount, iterations)) {
+      std::cerr << "\t\tMutex lock test FAILED" << std::endl;
+      return 1;
+    }
+
+    std::cout << "\t\tMutex timed lock test" << std::endl;
+
+    if (!mutexTests.timedLockTest()) {
+      std::cerr << "\t\tMutex timed lock test FAILED" << std::endl;
+      return 1;
+    }
+
+    std::cout << "\t\tMonitor ping-pong test: count: " << iterations << std::endl;
+
+    if (!mutexTests.monitorTest(iterations)) {
+      std::cerr << "\t\tMonitor ping-pong test FAILED" << std::endl;
+      return 1;
+    }
+  }
+
+  if (runAll || args[0].compare("mutex-benchmark") == 0) {
+
+    MutexTests mutexTests;
+
+    std::cout << "Mutex benchmark tests (" << MutexTests::implementation() << ")..." << std::endl;
+
+    size_t iterations = 10000 * WEIGHT;
+
+    for (size_t threadCount = 1; threadCount <= 16; threadCount *= 4) {
+
+      std::cout << "\t\tMutex contention benchmark: thread count: " << threadCount
+                << " iterations: " << iterations << std::endl;
+
+      if (!mutexTests.benchmark(threadCount, iterations)) {
+        std::cerr << "\t\tMutex contention benchmark FAILED" << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  const struct {
+    const char* section;
+    const char* name;
+    TimerManager::QUEUE queue;
+  } timerManagers[] = {
+    {"timer-manager", "TimerManager", TimerManager::ORDERED_MAP},
+    {"timing-wheel-timer-manager", "TimingWheelTimerManager", TimerManager::TIMING_WHEEL}
+  };
+
+  for (const auto& tm : timerManagers) {
+
+    if (!runAll && args[0].compare(tm.section) != 0) {
+      continue;
+    }
 
-    TimerManagerTests timerManagerTests;
+    std::cout << tm.name << " tests..." << std::endl;
+
+    TimerManagerTests timerManagerTests(tm.queue);
+
+    std::cout << "\t\t" << tm.name << " test00" << std::endl;
 
     if (!timerManagerTests.test00()) {
-      std::cerr << "\t\tTimerManager tests FAILED" << std::endl;
+      std::cerr << "\t\t" << tm.name << " tests FAILED" << std::endl;
       return 1;
     }
 
-    std::cout << "\t\tTimerManager test01" << std::endl;
+    std::cout << "\t\t" << tm.name << " test01" << std::endl;
 
     if (!timerManagerTests.test01()) {
-      std::cerr << "\t\tTimerManager tests FAILED" << std::endl;
+      std::cerr << "\t\t" << tm.name << " tests FAILED" << std::endl;
       return 1;
     }
 
-    std::cout << "\t\tTimerManager test02" << std::endl;
+    std::cout << "\t\t" << tm.name << " test02" << std::endl;
 
     if (!timerManagerTests.test02()) {
-      std::cerr << "\t\tTimerManager tests FAILED" << std::endl;
+      std::cerr << "\t\t" << tm.name << " tests FAILED" << std::endl;
       return 1;
     }
 
-    std::cout << "\t\tTimerManager test03" << std::endl;
+    std::cout << "\t\t" << tm.name << " test03" << std::endl;
 
     if (!timerManagerTests.test03()) {
-      std::cerr << "\t\tTimerManager tests FAILED" << std::endl;
+      std::cerr << "\t\t" << tm.name << " tests FAILED" << std::endl;
       return 1;
     }
 
-    std::cout << "\t\tTimerManager test04" << std::endl;
+    std::cout << "\t\t" << tm.name << " test04" << std::endl;
 
     if (!timerManagerTests.test04()) {
-      std::cerr << "\t\tTimerManager tests FAILED" << std::endl;
+      std::cerr << "\t\t" << tm.name << " tests FAILED" << std::endl;
       return 1;
     }
   }
 
-  if (runAll || args[0].compare("thread-manager") == 0) {
+  if (runAll || args[0].compare("timer-manager-benchmark") == 0) {
+
+    std::cout << "TimerManager benchmark tests..." << std::endl;
+
+    size_t timerCount = 20000 * WEIGHT;
+
+    for (const auto& tm : timerManagers) {
+
+      std::cout << "\t\t" << tm.name << " benchmark: timer count: " << timerCount << std::endl;
+
+      TimerManagerTests timerManagerTests(tm.queue);
+
+      if (!timerManagerTests.benchmark(timerCount)) {
+        std::cerr << "\t\t" << tm.name << " benchmark FAILED" << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  const struct {
+    const char* section;
+    const char* name;
+    ThreadManagerTests::Factory factory;
+  } threadManagers[] = {
+    {"thread-manager", "ThreadManager", &ThreadManager::newSimpleThreadManager},
+    {"work-stealing-thread-manager", "WorkStealingThreadManager",
+     &ThreadManager::newWorkStealingThreadManager}
+  };
+
+  for (const auto& tm : threadManagers) {
+
+    if (!runAll && args[0].compare(tm.section) != 0) {
+      continue;
+    }
 
-    std::cout << "ThreadManager tests..." << std::endl;
+    std::cout << tm.name << " tests..." << std::endl;
 
     {
       size_t workerCount = 10 * WEIGHT;
       size_t taskCount = 500 * WEIGHT;
       int64_t delay = 10LL;
 
-      ThreadManagerTests threadManagerTests;
+      ThreadManagerTests threadManagerTests(tm.factory);
 
-      std::cout << "\t\tThreadManager api test:" << std::endl;
+      std::cout << "\t\t" << tm.name << " api test:" << std::endl;
 
       if (!threadManagerTests.apiTest()) {
-        std::cerr << "\t\tThreadManager apiTest FAILED" << std::endl;
+        std::cerr << "\t\t" << tm.name << " apiTest FAILED" << std::endl;
         return 1;
       }
 
-      std::cout << "\t\tThreadManager load test: worker count: " << workerCount
+      std::cout << "\t\t" << tm.name << " load test: worker count: " << workerCount
                 << " task count: " << taskCount << " delay: " << delay << std::endl;
 
       if (!threadManagerTests.loadTest(taskCount, delay, workerCount)) {
-        std::cerr << "\t\tThreadManager loadTest FAILED" << std::endl;
+        std::cerr << "\t\t" << tm.name << " loadTest FAILED" << std::endl;
         return 1;
       }
 
-      std::cout << "\t\tThreadManager block test: worker count: " << workerCount
+      std::cout << "\t\t" << tm.name << " block test: worker count: " << workerCount
                 << " delay: " << delay << std::endl;
 
       if (!threadManagerTests.blockTest(delay, workerCount)) {
-        std::cerr << "\t\tThreadManager blockTest FAILED" << std::endl;
+        std::cerr << "\t\t" << tm.name << " blockTest FAILED" << std::endl;
+        return 1;
+      }
+
+      std::cout << "\t\t" << tm.name << " spawn test: worker count: " << workerCount << std::endl;
+
+      if (!threadManagerTests.spawnTest(10 * WEIGHT, 300, workerCount)) {
+        std::cerr << "\t\t" << tm.name << " spawnTest FAILED" << std::endl;
+        return 1;
+      }
+
+      std::cout << "\t\t" << tm.name << " pending limit test:" << std::endl;
+
+      if (!threadManagerTests.pendingLimitTest()) {
+        std::cerr << "\t\t" << tm.name << " pendingLimitTest FAILED" << std::endl;
+        return 1;
+      }
+
+      std::cout << "\t\t" << tm.name << " lane test:" << std::endl;
+
+      if (!threadManagerTests.laneTest()) {
+        std::cerr << "\t\t" << tm.name << " laneTest FAILED" << std::endl;
+        return 1;
+      }
+
+      std::cout << "\t\t" << tm.name << " pool policy test:" << std::endl;
+
+      if (!threadManagerTests.poolPolicyTest()) {
+        std::cerr << "\t\t" << tm.name << " poolPolicyTest FAILED" << std::endl;
         return 1;
       }
     }
@@ -18,6 +18,7 @@
  */
 
 #include <thrift/thrift-config.h>
+#include <thrift/concurrency/AffinityThreadFactory.h>
 #include <thrift/concurrency/Thread.h>
 #include <thrift/concurrency/ThreadFactory.h>
 #include <thrift/concurrency/Monitor.h>
@@ -27,6 +28,10 @@
 #include <iostream>
 #include <vector>
 
+#ifdef HAVE_SCHED_H
+#include <sched.h>
+#endif
+
 namespace apache {
 namespace thrift {
 namespace concurrency {
@@ -300,6 +305,75 @@ public:
 
     return success;
   }
+
+  /**
+   * Gets the CPUs the calling thread may run on, empty if unknown.
+   */
+  static AffinityThreadFactory::CpuSet currentAffinity() {
+    AffinityThreadFactory::CpuSet cpus;
+#ifdef HAVE_SCHED_SETAFFINITY
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+      for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &mask)) {
+          cpus.push_back(cpu);
+        }
+      }
+    }
+#endif
+    return cpus;
+  }
+
+  class AffinityTask : public Runnable {
+
+  public:
+    void run() override { _cpus = currentAffinity(); }
+
+    AffinityThreadFactory::CpuSet _cpus;
+  };
+
+  /**
+   * Affinity test.  Create threads from an AffinityThreadFactory with one set
+   * for each of up to two of the CPUs we may run on.  Verify that each thread
+   * runs pinned to the next set in turn.
+   */
+  bool affinityTest(size_t count = 4) {
+
+    std::vector<AffinityThreadFactory::CpuSet> nodes = AffinityThreadFactory::getNumaNodes();
+    if (nodes.empty() || nodes[0].empty()) {
+      return false;
+    }
+    std::cout << "\t\t\t" << nodes.size() << " NUMA node(s), " << nodes[0].size()
+              << " CPU(s) on the first" << std::endl;
+
+    AffinityThreadFactory::CpuSet allowed = currentAffinity();
+    if (allowed.empty()) {
+      std::cout << "\t\t\tCPU affinity not supported, skipped" << std::endl;
+      return true;
+    }
+
+    std::vector<AffinityThreadFactory::CpuSet> cpuSets;
+    for (size_t ix = 0; ix < allowed.size() && ix < 2; ix++) {
+      cpuSets.push_back(AffinityThreadFactory::CpuSet(1, allowed[ix]));
+    }
+    AffinityThreadFactory threadFactory(cpuSets, false);
+
+    for (size_t ix = 0; ix < count; ix++) {
+      shared_ptr<AffinityTask> task(new AffinityTask());
+      shared_ptr<Thread> thread = threadFactory.newThread(task);
+      thread->start();
+      thread->join();
+
+      if (task->_cpus != cpuSets[ix % cpuSets.size()]) {
+        std::cout << "\t\t\tthread " << ix << " not pinned to CPU " << cpuSets[ix % cpuSets.size()][0]
+                  << std::endl;
+        return false;
+      }
+    }
+
+    return true;
+  }
 };
 
 }
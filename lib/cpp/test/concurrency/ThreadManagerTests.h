@@ -18,13 +18,16 @@
  */
 
 #include <thrift/thrift-config.h>
+#include <thrift/concurrency/AdaptivePoolPolicy.h>
 #include <thrift/concurrency/ThreadManager.h>
 #include <thrift/concurrency/ThreadFactory.h>
 #include <thrift/concurrency/Monitor.h>
 
+#include <algorithm>
 #include <assert.h>
 #include <deque>
 #include <set>
+#include <vector>
 #include <iostream>
 #include <stdint.h>
 
@@ -57,6 +60,15 @@ static void sleep_(int64_t millisec) {
 class ThreadManagerTests {
 
 public:
+  /**
+   * Creates the thread manager under test from a worker count and a pending
+   * task limit, as newSimpleThreadManager() does.
+   */
+  typedef shared_ptr<ThreadManager> (*Factory)(size_t count, size_t pendingTaskCountMax);
+
+  ThreadManagerTests(Factory factory = &ThreadManager::newSimpleThreadManager)
+    : _factory(factory) {}
+
   class Task : public Runnable {
 
   public:
@@ -105,7 +117,7 @@ public:
 
     size_t activeCount = count;
 
-    shared_ptr<ThreadManager> threadManager = ThreadManager::newSimpleThreadManager(workerCount);
+    shared_ptr<ThreadManager> threadManager = _factory(workerCount, 0);
 
     shared_ptr<ThreadFactory> threadFactory
         = shared_ptr<ThreadFactory>(new ThreadFactory(false));
@@ -251,7 +263,7 @@ public:
       size_t activeCounts[] = {workerCount, pendingTaskMaxCount, 1};
 
       shared_ptr<ThreadManager> threadManager
-          = ThreadManager::newSimpleThreadManager(workerCount, pendingTaskMaxCount);
+          = _factory(workerCount, pendingTaskMaxCount);
 
       shared_ptr<ThreadFactory> threadFactory
           = shared_ptr<ThreadFactory>(new ThreadFactory());
@@ -400,7 +412,7 @@ public:
 
   bool apiTestWithThreadFactory(shared_ptr<ThreadFactory> threadFactory)
   {
-    shared_ptr<ThreadManager> threadManager = ThreadManager::newSimpleThreadManager(1);
+    shared_ptr<ThreadManager> threadManager = _factory(1, 0);
     threadManager->threadFactory(threadFactory);
 
     std::cout << "\t\t\t\tstarting.. " << std::endl;
@@ -629,6 +641,301 @@ public:
     threadManager.reset();
     return true;
   }
+
+  class SpawnTask : public Runnable {
+
+  public:
+    SpawnTask(ThreadManager& threadManager, Monitor& monitor, size_t& count, size_t children)
+      : _threadManager(threadManager), _monitor(monitor), _count(count), _children(children) {}
+
+    void run() override {
+      for (size_t ix = 0; ix < _children; ix++) {
+        _threadManager.add(shared_ptr<Runnable>(new SpawnTask(_threadManager, _monitor, _count, 0)));
+      }
+
+      Synchronized s(_monitor);
+      if (--_count == 0) {
+        _monitor.notify();
+      }
+    }
+
+    ThreadManager& _threadManager;
+    Monitor& _monitor;
+    size_t& _count;
+    size_t _children;
+  };
+
+  /**
+   * Dispatch count tasks, each of which adds children more tasks from the
+   * worker thread it runs on.  Verify that every task runs, including when a
+   * worker adds more tasks than it can keep to itself.
+   */
+  bool spawnTest(size_t count = 100, size_t children = 300, size_t workerCount = 4) {
+
+    Monitor monitor;
+
+    size_t activeCount = count * (children + 1);
+
+    shared_ptr<ThreadManager> threadManager = _factory(workerCount, 0);
+
+    threadManager->threadFactory(shared_ptr<ThreadFactory>(new ThreadFactory()));
+
+    threadManager->start();
+
+    for (size_t ix = 0; ix < count; ix++) {
+      threadManager->add(
+          shared_ptr<Runnable>(new SpawnTask(*threadManager, monitor, activeCount, children)));
+    }
+
+    {
+      Synchronized s(monitor);
+      while (activeCount > 0) {
+        monitor.wait();
+      }
+    }
+
+    threadManager->stop();
+
+    bool success = threadManager->totalTaskCount() == 0;
+
+    std::cout << "\t\t\t" << (success ? "Success" : "Failure") << std::endl;
+    return success;
+  }
+
+  class LaneTask : public Runnable {
+
+  public:
+    LaneTask(Monitor& monitor, std::vector<int>& order, int id) : _monitor(monitor), _order(order), _id(id) {}
+
+    void run() override {
+      Synchronized s(_monitor);
+      _order.push_back(_id);
+      _monitor.notify();
+    }
+
+    Monitor& _monitor;
+    std::vector<int>& _order;
+    int _id;
+  };
+
+  /**
+   * Pending limit test.  A limit as large as SIZE_MAX must neither hang nor
+   * allocate for that many tasks on start(), and tasks must still run.
+   */
+  bool pendingLimitTest() {
+    shared_ptr<ThreadManager> threadManager = _factory(1, SIZE_MAX);
+    threadManager->threadFactory(shared_ptr<ThreadFactory>(new ThreadFactory()));
+    threadManager->start();
+
+    bool success = threadManager->pendingTaskCountMax() == SIZE_MAX;
+
+    Monitor monitor;
+    std::vector<int> order;
+    for (int ix = 0; ix < 3; ix++) {
+      threadManager->add(shared_ptr<Runnable>(new LaneTask(monitor, order, ix)));
+    }
+    {
+      Synchronized s(monitor);
+      while (order.size() < 3) {
+        monitor.wait();
+      }
+    }
+    threadManager->stop();
+
+    std::cout << "\t\t\t" << (success ? "Success" : "Failure") << std::endl;
+    return success;
+  }
+
+  /**
+   * Lane test.  With the only worker blocked, queue tasks in a lane of weight 1
+   * and a lane of weight 4, some of the latter with expirations added latest
+   * deadline first.  Verify that the lanes are taken 1:4, spread out, and that
+   * the tasks with deadlines run earliest first, ahead of the rest of their
+   * lane.  A thread manager without lanes must refuse them cleanly.
+   */
+  bool laneTest() {
+    bool success = true;
+
+    shared_ptr<ThreadManager> threadManager = _factory(1, 0);
+    threadManager->threadFactory(shared_ptr<ThreadFactory>(new ThreadFactory()));
+    threadManager->start();
+
+    Monitor monitor;
+    std::vector<int> order;
+
+    std::vector<size_t> weights;
+    weights.push_back(1);
+    weights.push_back(4);
+    try {
+      threadManager->setPriorityLanes(weights);
+    } catch (InvalidArgumentException&) {
+      std::cout << "				lanes not supported.." << std::endl;
+      try {
+        threadManager->addToLane(1, shared_ptr<Runnable>(new LaneTask(monitor, order, 0)));
+        success = false;
+      } catch (InvalidArgumentException&) {
+      }
+      threadManager->addToLane(0, shared_ptr<Runnable>(new LaneTask(monitor, order, 0)));
+      {
+        Synchronized s(monitor);
+        while (order.empty()) {
+          monitor.wait();
+        }
+      }
+      threadManager->stop();
+      std::cout << "			" << (success ? "Success" : "Failure") << std::endl;
+      return success;
+    }
+    success = success && threadManager->priorityLaneCount() == 2;
+
+    Monitor entryMonitor;
+    Monitor blockMonitor;
+    bool blocked = true;
+    Monitor doneMonitor;
+    size_t blockCount = 1;
+    shared_ptr<BlockTask> blockTask(
+        new BlockTask(entryMonitor, blockMonitor, blocked, doneMonitor, blockCount));
+    threadManager->add(blockTask);
+    {
+      Synchronized s(entryMonitor);
+      while (!blockTask->_entered) {
+        entryMonitor.wait();
+      }
+    }
+
+    // lane 0: 100..104, lane 1: 200..202 with deadlines, latest first, then 203..209
+    for (int ix = 0; ix < 5; ix++) {
+      threadManager->addToLane(0, shared_ptr<Runnable>(new LaneTask(monitor, order, 100 + ix)));
+    }
+    for (int ix = 0; ix < 3; ix++) {
+      threadManager->addToLane(1,
+                               shared_ptr<Runnable>(new LaneTask(monitor, order, 200 + ix)),
+                               0LL,
+                               30000LL - 10000LL * ix);
+    }
+    for (int ix = 3; ix < 10; ix++) {
+      threadManager->addToLane(1, shared_ptr<Runnable>(new LaneTask(monitor, order, 200 + ix)));
+    }
+
+    std::cout << "				set lanes with tasks pending.." << std::endl;
+    try {
+      threadManager->setPriorityLanes(weights);
+      success = false;
+    } catch (IllegalStateException&) {
+    }
+
+    std::cout << "				add to a lane that does not exist.." << std::endl;
+    try {
+      threadManager->addToLane(2, shared_ptr<Runnable>(new LaneTask(monitor, order, 0)));
+      success = false;
+    } catch (InvalidArgumentException&) {
+    }
+
+    {
+      Synchronized s(blockMonitor);
+      blocked = false;
+      blockMonitor.notifyAll();
+    }
+    {
+      Synchronized s(monitor);
+      while (order.size() < 15) {
+        monitor.wait();
+      }
+    }
+    threadManager->stop();
+
+    const int expected[] = {202, 201, 100, 200, 203, 204, 205, 101, 206, 207, 208, 209, 102, 103, 104};
+    for (size_t ix = 0; ix < 15; ix++) {
+      if (order[ix] != expected[ix]) {
+        std::cout << "				task " << ix << " was " << order[ix] << ", expected " << expected[ix]
+                  << std::endl;
+        success = false;
+      }
+    }
+
+    std::cout << "			" << (success ? "Success" : "Failure") << std::endl;
+    return success;
+  }
+
+  class SleepTask : public Runnable {
+
+  public:
+    SleepTask(Monitor& monitor, size_t& count, int64_t timeout)
+      : _monitor(monitor), _count(count), _timeout(timeout) {}
+
+    void run() override {
+      sleep_(_timeout);
+
+      Synchronized s(_monitor);
+      if (--_count == 0) {
+        _monitor.notify();
+      }
+    }
+
+    Monitor& _monitor;
+    size_t& _count;
+    int64_t _timeout;
+  };
+
+  /**
+   * Pool policy test.  Start with one worker under an AdaptivePoolPolicy and
+   * dispatch a burst of count tasks that each take timeout ms.  Verify that
+   * the pool grows, within its bound, and that it shrinks back to its
+   * minimum once the burst is over.
+   */
+  bool poolPolicyTest(size_t count = 64, int64_t timeout = 20LL, size_t maxWorkers = 8) {
+
+    shared_ptr<ThreadManager> threadManager = _factory(1, 0);
+    threadManager->threadFactory(shared_ptr<ThreadFactory>(new ThreadFactory()));
+    threadManager->start();
+
+    AdaptivePoolPolicy policy(threadManager, 1, maxWorkers);
+    policy.setInterval(10);
+    policy.setLatencyTarget(timeout / 4);
+    policy.setShrinkDelay(5);
+    policy.start();
+
+    Monitor monitor;
+    size_t activeCount = count;
+    size_t peakWorkers = 0;
+
+    for (size_t ix = 0; ix < count; ix++) {
+      threadManager->add(shared_ptr<Runnable>(new SleepTask(monitor, activeCount, timeout)));
+    }
+
+    {
+      Synchronized s(monitor);
+      while (activeCount > 0) {
+        monitor.waitForTimeRelative(timeout);
+        peakWorkers = (std::max)(peakWorkers, threadManager->workerCount());
+      }
+    }
+
+    std::cout << "\t\t\t\tgrew " << policy.getGrowCount() << " times to " << peakWorkers
+              << " workers, " << policy.getWorkersAdded() << " added" << std::endl;
+
+    for (int ix = 0; ix < 500 && threadManager->workerCount() > 1; ix++) {
+      sleep_(10);
+    }
+
+    policy.stop();
+
+    std::cout << "\t\t\t\tshrank " << policy.getShrinkCount() << " times to "
+              << threadManager->workerCount() << " workers, " << policy.getWorkersRemoved()
+              << " removed, after " << policy.getSampleCount() << " samples" << std::endl;
+
+    bool success = policy.getGrowCount() > 0 && peakWorkers > 1 && peakWorkers <= maxWorkers
+                   && policy.getShrinkCount() > 0 && threadManager->workerCount() == 1
+                   && policy.getWorkersRemoved() == policy.getWorkersAdded();
+
+    threadManager->stop();
+
+    std::cout << "\t\t\t" << (success ? "Success" : "Failure") << std::endl;
+    return success;
+  }
+
+private:
+  Factory _factory;
 };
 
 }
@@ -23,8 +23,10 @@
 
 #include <assert.h>
 #include <chrono>
+#include <random>
 #include <thread>
 #include <iostream>
+#include <vector>
 
 namespace apache {
 namespace thrift {
@@ -36,6 +38,8 @@ using namespace apache::thrift::concurrency;
 class TimerManagerTests {
 
 public:
+  TimerManagerTests(TimerManager::QUEUE queue = TimerManager::ORDERED_MAP) : _queue(queue) {}
+
   class Task : public Runnable {
   public:
     Task(Monitor& monitor, uint64_t timeout)
@@ -80,7 +84,7 @@ public:
         = shared_ptr<TimerManagerTests::Task>(new TimerManagerTests::Task(_monitor, 10 * timeout));
 
     {
-      TimerManager timerManager;
+      TimerManager timerManager(_queue);
       timerManager.threadFactory(shared_ptr<ThreadFactory>(new ThreadFactory()));
       timerManager.start();
       if (timerManager.state() != TimerManager::STARTED) {
@@ -125,7 +129,7 @@ public:
    * task when the manager goes out of scope and its destructor is called.
    */
   bool test01(uint64_t timeout = 1000LL) {
-    TimerManager timerManager;
+    TimerManager timerManager(_queue);
     timerManager.threadFactory(shared_ptr<ThreadFactory>(new ThreadFactory()));
     timerManager.start();
     assert(timerManager.state() == TimerManager::STARTED);
@@ -158,7 +162,7 @@ public:
    * and its destructor is called.
    */
   bool test02(uint64_t timeout = 1000LL) {
-    TimerManager timerManager;
+    TimerManager timerManager(_queue);
     timerManager.threadFactory(shared_ptr<ThreadFactory>(new ThreadFactory()));
     timerManager.start();
     assert(timerManager.state() == TimerManager::STARTED);
@@ -191,7 +195,7 @@ public:
    * task when the manager goes out of scope and its destructor is called.
    */
   bool test03(uint64_t timeout = 1000LL) {
-    TimerManager timerManager;
+    TimerManager timerManager(_queue);
     timerManager.threadFactory(shared_ptr<ThreadFactory>(new ThreadFactory()));
     timerManager.start();
     assert(timerManager.state() == TimerManager::STARTED);
@@ -228,7 +232,7 @@ public:
    * This test creates one task, and tries to remove it after it has expired.
    */
   bool test04(uint64_t timeout = 1000LL) {
-    TimerManager timerManager;
+    TimerManager timerManager(_queue);
     timerManager.threadFactory(shared_ptr<ThreadFactory>(new ThreadFactory()));
     timerManager.start();
     assert(timerManager.state() == TimerManager::STARTED);
@@ -262,9 +266,81 @@ public:
     return true;
   }
 
+  class CountTask : public Runnable {
+  public:
+    CountTask(Monitor& monitor, size_t& count) : _monitor(monitor), _count(count) {}
+
+    void run() override {
+      Synchronized s(_monitor);
+      if (--_count == 0) {
+        _monitor.notifyAll();
+      }
+    }
+
+    Monitor& _monitor;
+    size_t& _count;
+  };
+
+  /**
+   * Times adding count timers spread over a minute and removing each of
+   * them by its handle, as request timeouts that are mostly cancelled do,
+   * then adding count timers due within 100ms and waiting for all of them
+   * to fire.
+   */
+  bool benchmark(size_t count) {
+    TimerManager timerManager(_queue);
+    timerManager.threadFactory(shared_ptr<ThreadFactory>(new ThreadFactory()));
+    timerManager.start();
+
+    size_t remaining = count;
+    shared_ptr<Runnable> task(new CountTask(_monitor, remaining));
+    std::minstd_rand random(1);
+
+    std::vector<TimerManager::Timer> timers;
+    timers.reserve(count);
+
+    auto addStart = std::chrono::steady_clock::now();
+    for (size_t ix = 0; ix < count; ix++) {
+      timers.push_back(timerManager.add(task, std::chrono::milliseconds(1000 + random() % 60000)));
+    }
+    auto removeStart = std::chrono::steady_clock::now();
+    for (const auto& timer : timers) {
+      timerManager.remove(timer);
+    }
+    auto removeEnd = std::chrono::steady_clock::now();
+
+    if (timerManager.taskCount() != 0) {
+      std::cerr << "timers left after removing all of them" << std::endl;
+      return false;
+    }
+
+    auto fireStart = std::chrono::steady_clock::now();
+    {
+      Synchronized s(_monitor);
+      for (size_t ix = 0; ix < count; ix++) {
+        timerManager.add(task, std::chrono::milliseconds(1 + random() % 100));
+      }
+      while (remaining > 0) {
+        _monitor.wait();
+      }
+    }
+    auto fireEnd = std::chrono::steady_clock::now();
+
+    std::cout << "\t\t\tadd: "
+              << std::chrono::duration_cast<std::chrono::nanoseconds>(removeStart - addStart).count() / count
+              << "ns/timer remove: "
+              << std::chrono::duration_cast<std::chrono::nanoseconds>(removeEnd - removeStart).count() / count
+              << "ns/timer add and fire within 100ms: "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(fireEnd - fireStart).count()
+              << "ms" << std::endl;
+    return true;
+  }
+
   friend class TestTask;
 
   Monitor _monitor;
+
+  TimerManager::QUEUE _queue;
 };
 
 }
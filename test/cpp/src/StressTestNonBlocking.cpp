@@ -35,6 +35,8 @@
 
 #include "Service.h"
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <set>
 #include <stdexcept>
@@ -112,13 +114,17 @@ public:
                Monitor& monitor,
                size_t& workerCount,
                size_t loopCount,
-               TType loopType)
+               TType loopType,
+               size_t reconnectCount = 0,
+               size_t listSize = 0)
     : _transport(transport),
       _client(client),
       _monitor(monitor),
       _workerCount(workerCount),
       _loopCount(loopCount),
-      _loopType(loopType) {}
+      _loopType(loopType),
+      _reconnectCount(reconnectCount),
+      _listSize(listSize) {}
 
   void run() override {
 
@@ -134,6 +140,7 @@ public:
     _startTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
 
     _transport->open();
+    _latencies.reserve(_loopCount);
 
     switch (_loopType) {
     case T_VOID:
@@ -151,6 +158,9 @@ public:
     case T_STRING:
       loopEchoString();
       break;
+    case T_LIST:
+      loopEchoList();
+      break;
     default:
       cerr << "Unexpected loop type" << _loopType << endl;
       break;
@@ -174,9 +184,25 @@ public:
     }
   }
 
+  // Reconnects every _reconnectCount calls and starts timing the call
+  void beginCall(size_t ix) {
+    if (_reconnectCount > 0 && ix > 0 && ix % _reconnectCount == 0) {
+      _transport->close();
+      _transport->open();
+    }
+    _callStart = std::chrono::steady_clock::now();
+  }
+
+  void endCall() {
+    _latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(
+                             std::chrono::steady_clock::now() - _callStart).count());
+  }
+
   void loopEchoVoid() {
     for (size_t ix = 0; ix < _loopCount; ix++) {
+      beginCall(ix);
       _client->echoVoid();
+      endCall();
     }
   }
 
@@ -184,7 +210,9 @@ public:
     for (size_t ix = 0; ix < _loopCount; ix++) {
       int8_t arg = 1;
       int8_t result;
+      beginCall(ix);
       result = _client->echoByte(arg);
+      endCall();
       (void)result;
       assert(result == arg);
     }
@@ -194,7 +222,9 @@ public:
     for (size_t ix = 0; ix < _loopCount; ix++) {
       int32_t arg = 1;
       int32_t result;
+      beginCall(ix);
       result = _client->echoI32(arg);
+      endCall();
       (void)result;
       assert(result == arg);
     }
@@ -204,7 +234,9 @@ public:
     for (size_t ix = 0; ix < _loopCount; ix++) {
       int64_t arg = 1;
       int64_t result;
+      beginCall(ix);
       result = _client->echoI64(arg);
+      endCall();
       (void)result;
       assert(result == arg);
     }
@@ -214,7 +246,20 @@ public:
     for (size_t ix = 0; ix < _loopCount; ix++) {
       string arg = "hello";
       string result;
+      beginCall(ix);
       _client->echoString(result, arg);
+      endCall();
+      assert(result == arg);
+    }
+  }
+
+  void loopEchoList() {
+    vector<int8_t> arg(_listSize, 1);
+    for (size_t ix = 0; ix < _loopCount; ix++) {
+      vector<int8_t> result;
+      beginCall(ix);
+      _client->echoList(result, arg);
+      endCall();
       assert(result == arg);
     }
   }
@@ -225,6 +270,10 @@ public:
   size_t& _workerCount;
   size_t _loopCount;
   TType _loopType;
+  size_t _reconnectCount;
+  size_t _listSize;
+  std::chrono::steady_clock::time_point _callStart;
+  vector<int64_t> _latencies;
   int64_t _startTime;
   int64_t _endTime;
   bool _done;
@@ -248,6 +297,12 @@ int main(int argc, char** argv) {
   bool logRequests = false;
   string requestLogPath = "./requestlog.tlog";
   bool replayRequests = false;
+  size_t ioThreadCount = 1;
+  string ioAssignment = "round-robin";
+  string eventLoop = "libevent";
+  uint32_t heavyCount = 0;
+  uint32_t heavySize = 64 * 1024;
+  uint32_t reconnectCount = 0;
 
   ostringstream usage;
 
@@ -270,7 +325,16 @@ int main(int argc, char** argv) {
         << endl << "\treplay-request Replay requests from log file (./requestlog.tlog) Default is "
         << replayRequests << endl << "\tworkers        Number of thread pools workers.  Only valid "
                                      "for thread-pool server type.  Default is " << workerCount
-        << endl;
+        << endl << "\tio-threads     Number of IO threads per server.  Default is " << ioThreadCount
+        << endl << "\tio-assignment  How connections are assigned to IO threads: \"round-robin\", "
+                   "\"least-connections\", \"least-recent-bytes\" or \"power-of-two\".  Default is "
+        << ioAssignment << endl
+        << "\tevent-loop     Event loop, \"libevent\" or \"epoll\".  Default is " << eventLoop << endl
+        << "\theavy          Number of clients that stay connected and echo lists of heavy-size "
+           "bytes instead of making the given call.  Default is " << heavyCount << endl
+        << "\theavy-size     List size for heavy clients.  Default is " << heavySize << endl
+        << "\treconnect      Light clients reconnect after this many calls, 0 for never.  Default is "
+        << reconnectCount << endl;
 
   map<string, string> args;
 
@@ -337,6 +401,30 @@ int main(int argc, char** argv) {
       workerCount = atoi(args["workers"].c_str());
     }
 
+    if (!args["io-threads"].empty()) {
+      ioThreadCount = atoi(args["io-threads"].c_str());
+    }
+
+    if (!args["io-assignment"].empty()) {
+      ioAssignment = args["io-assignment"];
+    }
+
+    if (!args["event-loop"].empty()) {
+      eventLoop = args["event-loop"];
+    }
+
+    if (!args["heavy"].empty()) {
+      heavyCount = atoi(args["heavy"].c_str());
+    }
+
+    if (!args["heavy-size"].empty()) {
+      heavySize = atoi(args["heavy-size"].c_str());
+    }
+
+    if (!args["reconnect"].empty()) {
+      reconnectCount = atoi(args["reconnect"].c_str());
+    }
+
   } catch (std::exception& e) {
     cerr << e.what() << endl;
     cerr << usage.str();
@@ -369,6 +457,28 @@ int main(int argc, char** argv) {
 
   if (runServer) {
 
+    TIOThreadAssignment ioThreadAssignment;
+    if (ioAssignment == "round-robin") {
+      ioThreadAssignment = T_IO_THREAD_ROUND_ROBIN;
+    } else if (ioAssignment == "least-connections") {
+      ioThreadAssignment = T_IO_THREAD_LEAST_CONNECTIONS;
+    } else if (ioAssignment == "least-recent-bytes") {
+      ioThreadAssignment = T_IO_THREAD_LEAST_RECENT_BYTES;
+    } else if (ioAssignment == "power-of-two") {
+      ioThreadAssignment = T_IO_THREAD_POWER_OF_TWO_CHOICES;
+    } else {
+      throw invalid_argument("Unknown IO thread assignment " + ioAssignment);
+    }
+
+    TEventLoopType eventLoopType;
+    if (eventLoop == "libevent") {
+      eventLoopType = T_EVENT_LOOP_LIBEVENT;
+    } else if (eventLoop == "epoll") {
+      eventLoopType = T_EVENT_LOOP_EPOLL;
+    } else {
+      throw invalid_argument("Unknown event loop " + eventLoop);
+    }
+
     std::shared_ptr<ServiceProcessor> serviceProcessor(new ServiceProcessor(serviceHandler));
 
     // Protocol Factory
@@ -391,15 +501,15 @@ int main(int argc, char** argv) {
     std::shared_ptr<Thread> serverThread2;
     std::shared_ptr<transport::TNonblockingServerSocket> nbSocket1;
     std::shared_ptr<transport::TNonblockingServerSocket> nbSocket2;
+    std::shared_ptr<TNonblockingServer> server1;
+    std::shared_ptr<TNonblockingServer> server2;
 
     if (serverType == "simple") {
 
       nbSocket1.reset(new transport::TNonblockingServerSocket(port));
-      serverThread = threadFactory->newThread(std::shared_ptr<TServer>(
-          new TNonblockingServer(serviceProcessor, protocolFactory, nbSocket1)));
+      server1.reset(new TNonblockingServer(serviceProcessor, protocolFactory, nbSocket1));
       nbSocket2.reset(new transport::TNonblockingServerSocket(port + 1));
-      serverThread2 = threadFactory->newThread(std::shared_ptr<TServer>(
-          new TNonblockingServer(serviceProcessor, protocolFactory, nbSocket2)));
+      server2.reset(new TNonblockingServer(serviceProcessor, protocolFactory, nbSocket2));
 
     } else if (serverType == "thread-pool") {
 
@@ -409,13 +519,22 @@ int main(int argc, char** argv) {
       threadManager->threadFactory(threadFactory);
       threadManager->start();
       nbSocket1.reset(new transport::TNonblockingServerSocket(port));
-      serverThread = threadFactory->newThread(std::shared_ptr<TServer>(
-          new TNonblockingServer(serviceProcessor, protocolFactory, nbSocket1, threadManager)));
+      server1.reset(
+          new TNonblockingServer(serviceProcessor, protocolFactory, nbSocket1, threadManager));
       nbSocket2.reset(new transport::TNonblockingServerSocket(port + 1));
-      serverThread2 = threadFactory->newThread(std::shared_ptr<TServer>(
-          new TNonblockingServer(serviceProcessor, protocolFactory, nbSocket2, threadManager)));
+      server2.reset(
+          new TNonblockingServer(serviceProcessor, protocolFactory, nbSocket2, threadManager));
     }
 
+    server1->setNumIOThreads(ioThreadCount);
+    server1->setIOThreadAssignment(ioThreadAssignment);
+    server2->setNumIOThreads(ioThreadCount);
+    server2->setIOThreadAssignment(ioThreadAssignment);
+    server1->setEventLoopType(eventLoopType);
+    server2->setEventLoopType(eventLoopType);
+    serverThread = threadFactory->newThread(server1);
+    serverThread2 = threadFactory->newThread(server2);
+
     cerr << "Starting the server on port " << port << " and " << (port + 1) << endl;
     serverThread->start();
     serverThread2->start();
@@ -451,6 +570,10 @@ int main(int argc, char** argv) {
       throw invalid_argument("Unknown service call " + callName);
     }
 
+    // The heavy clients are spread out over the client list, so with round
+    // robin assignment they tend to land on the same few IO threads.
+    uint32_t heavyEvery = heavyCount > 0 ? std::max(clientCount / heavyCount, 1u) : 0;
+
     for (uint32_t ix = 0; ix < clientCount; ix++) {
 
       std::shared_ptr<TSocket> socket(new TSocket("127.0.0.1", port + (ix % 2)));
@@ -458,8 +581,15 @@ int main(int argc, char** argv) {
       std::shared_ptr<TProtocol> protocol(new TBinaryProtocol(framedSocket));
       std::shared_ptr<ServiceClient> serviceClient(new ServiceClient(protocol));
 
-      clientThreads.insert(threadFactory->newThread(std::shared_ptr<ClientThread>(
-          new ClientThread(socket, serviceClient, monitor, threadCount, loopCount, loopType))));
+      std::shared_ptr<ClientThread> clientThread;
+      if (heavyEvery > 0 && ix % heavyEvery == 0 && ix / heavyEvery < heavyCount) {
+        clientThread.reset(new ClientThread(socket, serviceClient, monitor, threadCount,
+                                            loopCount, T_LIST, 0, heavySize));
+      } else {
+        clientThread.reset(new ClientThread(socket, serviceClient, monitor, threadCount,
+                                            loopCount, loopType, reconnectCount));
+      }
+      clientThreads.insert(threadFactory->newThread(clientThread));
     }
 
     for (auto thread = clientThreads.begin();
@@ -488,6 +618,9 @@ int main(int argc, char** argv) {
       time01 = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
     }
 
+    vector<int64_t> latencies;
+    vector<int64_t> heavyLatencies;
+
     int64_t firstTime = 9223372036854775807LL;
     int64_t lastTime = 0;
 
@@ -523,6 +656,9 @@ int main(int argc, char** argv) {
       }
 
       averageTime += delta;
+
+      vector<int64_t>& into = client->_loopType == T_LIST ? heavyLatencies : latencies;
+      into.insert(into.end(), client->_latencies.begin(), client->_latencies.end());
     }
 
     averageTime /= clientCount;
@@ -530,6 +666,18 @@ int main(int argc, char** argv) {
     cout << "workers :" << workerCount << ", client : " << clientCount << ", loops : " << loopCount
          << ", rate : " << (clientCount * loopCount * 1000) / ((double)(time01 - time00)) << endl;
 
+    std::sort(latencies.begin(), latencies.end());
+    if (!latencies.empty()) {
+      cout << "call latency (us) : p50 " << latencies[latencies.size() / 2] << ", p99 "
+           << latencies[latencies.size() * 99 / 100] << ", max " << latencies.back() << endl;
+    }
+    std::sort(heavyLatencies.begin(), heavyLatencies.end());
+    if (!heavyLatencies.empty()) {
+      cout << "heavy call latency (us) : p50 " << heavyLatencies[heavyLatencies.size() / 2]
+           << ", p99 " << heavyLatencies[heavyLatencies.size() * 99 / 100] << ", max "
+           << heavyLatencies.back() << endl;
+    }
+
     count_map count = serviceHandler->getCount();
     count_map::iterator iter;
     for (iter = count.begin(); iter != count.end(); ++iter) {